@@ -99,6 +99,8 @@ typedef struct
 {
    rc_trigger_t* trigger;
    const rcheevos_racheevo_t* info;
+   unsigned* slots;
+   unsigned num_slots;
    int active;
    int last;
 } rcheevos_cheevo_t;
@@ -107,6 +109,8 @@ typedef struct
 {
    rc_lboard_t* lboard;
    const rcheevos_ralboard_t* info;
+   unsigned* slots;
+   unsigned num_slots;
    bool active;
    unsigned last_value;
    int format;
@@ -127,6 +131,8 @@ typedef struct
    rcheevos_lboard_t* lboards;
 
    rcheevos_fixups_t fixups;
+   rcheevos_snapshot_t snapshot;
+   bool snapshot_ready;
 
    char token[32];
 } rcheevos_locals_t;
@@ -160,6 +166,8 @@ static rcheevos_locals_t rcheevos_locals =
    NULL, /* unofficial */
    NULL, /* lboards */
    {0},  /* fixups */
+   {0},  /* snapshot */
+   false, /* snapshot_ready */
    {0},  /* token */
 };
 
@@ -295,6 +303,7 @@ static int rcheevos_parse(const char* json)
    rcheevos_racheevo_t* rac  = NULL;
 
    rcheevos_fixup_init(&rcheevos_locals.fixups);
+   rcheevos_locals.snapshot_ready = false;
 
    res = rcheevos_get_patchdata(json, &rcheevos_locals.patchdata);
 
@@ -546,21 +555,62 @@ static void rcheevos_award(rcheevos_cheevo_t* cheevo, int mode)
 
 static unsigned rcheevos_peek(unsigned address, unsigned num_bytes, void* ud)
 {
-   const uint8_t* data = rcheevos_fixup_find(&rcheevos_locals.fixups,
-      address, rcheevos_locals.patchdata.console_id);
-   unsigned value = 0;
+   return rcheevos_fixup_peek(&rcheevos_locals.fixups,
+      address, num_bytes, rcheevos_locals.patchdata.console_id);
+}
 
-   if (data)
-   {
-      switch (num_bytes)
-      {
-         case 4: value |= data[2] << 16 | data[3] << 24;
-         case 2: value |= data[1] << 8;
-         case 1: value |= data[0];
-      }
-   }
+/* Collects the addresses used by every trigger and leaderboard so they
+ * can be read once per frame, and gives each of them the snapshot slots
+ * of its memrefs. Done on the first frame, when the core's memory map is
+ * known. On failure everything keeps using rcheevos_peek. */
+static void rcheevos_snapshot_build(void)
+{
+   rcheevos_snapshot_t* snapshot = &rcheevos_locals.snapshot;
+   rcheevos_cheevo_t* cheevo;
+   rcheevos_lboard_t* lboard;
+   unsigned i;
+
+   rcheevos_snapshot_init(snapshot, &rcheevos_locals.fixups,
+      rcheevos_locals.patchdata.console_id);
+
+   cheevo = rcheevos_locals.core;
+   for (i = 0; i < rcheevos_locals.patchdata.core_count; i++, cheevo++)
+      if (!rcheevos_snapshot_add(snapshot, cheevo->trigger->memrefs))
+         goto error;
+
+   cheevo = rcheevos_locals.unofficial;
+   for (i = 0; i < rcheevos_locals.patchdata.unofficial_count; i++, cheevo++)
+      if (!rcheevos_snapshot_add(snapshot, cheevo->trigger->memrefs))
+         goto error;
+
+   lboard = rcheevos_locals.lboards;
+   for (i = 0; i < rcheevos_locals.patchdata.lboard_count; i++, lboard++)
+      if (lboard->lboard && !rcheevos_snapshot_add(snapshot, lboard->lboard->memrefs))
+         goto error;
+
+   if (!rcheevos_snapshot_resolve(snapshot))
+      goto error;
+
+   cheevo = rcheevos_locals.core;
+   for (i = 0; i < rcheevos_locals.patchdata.core_count; i++, cheevo++)
+      cheevo->slots = rcheevos_snapshot_slots(snapshot, cheevo->trigger->memrefs, &cheevo->num_slots);
 
-   return value;
+   cheevo = rcheevos_locals.unofficial;
+   for (i = 0; i < rcheevos_locals.patchdata.unofficial_count; i++, cheevo++)
+      cheevo->slots = rcheevos_snapshot_slots(snapshot, cheevo->trigger->memrefs, &cheevo->num_slots);
+
+   lboard = rcheevos_locals.lboards;
+   for (i = 0; i < rcheevos_locals.patchdata.lboard_count; i++, lboard++)
+      if (lboard->lboard)
+         lboard->slots = rcheevos_snapshot_slots(snapshot, lboard->lboard->memrefs, &lboard->num_slots);
+
+   CHEEVOS_LOG(RCHEEVOS_TAG "%u distinct addresses in the memory snapshot\n", snapshot->count);
+   rcheevos_locals.snapshot_ready = true;
+   return;
+
+error:
+   CHEEVOS_ERR(RCHEEVOS_TAG "Error allocating memory for the memory snapshot\n");
+   rcheevos_snapshot_destroy(snapshot);
 }
 
 static void rcheevos_test_cheevo_set(bool official)
@@ -592,7 +642,20 @@ static void rcheevos_test_cheevo_set(bool official)
 
       if (cheevo->active & mode)
       {
-         int valid = rc_test_trigger(cheevo->trigger, rcheevos_peek, NULL, NULL);
+         int valid;
+
+         if (rcheevos_locals.snapshot_ready)
+         {
+            rcheevos_snapshot_peek_t peek;
+            peek.snapshot = &rcheevos_locals.snapshot;
+            peek.slots    = cheevo->slots;
+            peek.count    = cheevo->num_slots;
+            peek.next     = 0;
+
+            valid = rc_test_trigger(cheevo->trigger, rcheevos_snapshot_peek, &peek, NULL);
+         }
+         else
+            valid = rc_test_trigger(cheevo->trigger, rcheevos_peek, NULL, NULL);
 
          if (cheevo->last)
             rc_reset_trigger(cheevo->trigger);
@@ -681,8 +744,24 @@ static void rcheevos_test_leaderboards(void)
 
    for (i = 0; i < rcheevos_locals.patchdata.lboard_count; i++, lboard++)
    {
+      rcheevos_snapshot_peek_t peek;
+      int state;
+
       if (!lboard->lboard) continue;
-      switch (rc_evaluate_lboard(lboard->lboard, &lboard->last_value, rcheevos_peek, NULL, NULL))
+
+      if (rcheevos_locals.snapshot_ready)
+      {
+         peek.snapshot = &rcheevos_locals.snapshot;
+         peek.slots    = lboard->slots;
+         peek.count    = lboard->num_slots;
+         peek.next     = 0;
+
+         state = rc_evaluate_lboard(lboard->lboard, &lboard->last_value, rcheevos_snapshot_peek, &peek, NULL);
+      }
+      else
+         state = rc_evaluate_lboard(lboard->lboard, &lboard->last_value, rcheevos_peek, NULL, NULL);
+
+      switch (state)
       {
          default:
          case RC_LBOARD_INACTIVE:
@@ -936,28 +1015,34 @@ bool rcheevos_unload(void)
       for (i = 0, count = rcheevos_locals.patchdata.core_count; i < count; i++)
       {
          CHEEVOS_FREE(rcheevos_locals.core[i].trigger);
+         CHEEVOS_FREE(rcheevos_locals.core[i].slots);
       }
 
       for (i = 0, count = rcheevos_locals.patchdata.unofficial_count; i < count; i++)
       {
          CHEEVOS_FREE(rcheevos_locals.unofficial[i].trigger);
+         CHEEVOS_FREE(rcheevos_locals.unofficial[i].slots);
       }
 
       for (i = 0, count = rcheevos_locals.patchdata.lboard_count; i < count; i++)
       {
          CHEEVOS_FREE(rcheevos_locals.lboards[i].lboard);
+         CHEEVOS_FREE(rcheevos_locals.lboards[i].slots);
       }
 
       CHEEVOS_FREE(rcheevos_locals.core);
       CHEEVOS_FREE(rcheevos_locals.unofficial);
       CHEEVOS_FREE(rcheevos_locals.lboards);
       rcheevos_free_patchdata(&rcheevos_locals.patchdata);
+      rcheevos_snapshot_destroy(&rcheevos_locals.snapshot);
       rcheevos_fixup_destroy(&rcheevos_locals.fixups);
 
       rcheevos_locals.core       = NULL;
       rcheevos_locals.unofficial = NULL;
       rcheevos_locals.lboards    = NULL;
 
+      rcheevos_locals.snapshot_ready = false;
+
       rcheevos_loaded            = false;
       rcheevos_hardcore_active   = false;
       rcheevos_hardcore_paused   = false;
@@ -1007,6 +1092,12 @@ void rcheevos_test(void)
 {
    settings_t *settings = config_get_ptr();
 
+   if (!rcheevos_locals.snapshot_ready)
+      rcheevos_snapshot_build();
+
+   if (rcheevos_locals.snapshot_ready)
+      rcheevos_snapshot_update(&rcheevos_locals.snapshot);
+
    rcheevos_test_cheevo_set(true);
 
    if (settings)
@@ -64,6 +64,47 @@ static size_t rcheevos_var_highest_bit(size_t n)
    return n ^ (n >> 1);
 }
 
+static unsigned rcheevos_read(const uint8_t* data, unsigned num_bytes)
+{
+   unsigned value = 0;
+
+   switch (num_bytes)
+   {
+      case 4: value |= data[2] << 16 | data[3] << 24;
+      case 2: value |= data[1] << 8;
+      case 1: value |= data[0];
+   }
+
+   return value;
+}
+
+static unsigned rcheevos_memref_bytes(const rc_memref_t* memref)
+{
+   switch (memref->size)
+   {
+      case RC_MEMSIZE_16_BITS:
+         return 2;
+      case RC_MEMSIZE_24_BITS:
+      case RC_MEMSIZE_32_BITS:
+         return 4;
+      default:
+         return 1;
+   }
+}
+
+static int rcheevos_cmpentry(const void* e1, const void* e2)
+{
+   const rcheevos_snapshot_entry_t* s1 = (const rcheevos_snapshot_entry_t*)e1;
+   const rcheevos_snapshot_entry_t* s2 = (const rcheevos_snapshot_entry_t*)e2;
+
+   if (s1->address < s2->address)
+      return -1;
+   else if (s1->address > s2->address)
+      return 1;
+
+   return 0;
+}
+
 void rcheevos_fixup_init(rcheevos_fixups_t* fixups)
 {
    fixups->elements = NULL;
@@ -262,3 +303,169 @@ const uint8_t* rcheevos_patch_address(unsigned address, int console)
 
    return (const uint8_t*)pointer + address;
 }
+
+unsigned rcheevos_fixup_peek(rcheevos_fixups_t* fixups, unsigned address, unsigned num_bytes, int console)
+{
+   const uint8_t* data = rcheevos_fixup_find(fixups, address, console);
+   return data ? rcheevos_read(data, num_bytes) : 0;
+}
+
+void rcheevos_snapshot_init(rcheevos_snapshot_t* snapshot, rcheevos_fixups_t* fixups, int console)
+{
+   snapshot->entries = NULL;
+   snapshot->values = NULL;
+   snapshot->capacity = snapshot->count = 0;
+   snapshot->fixups = fixups;
+   snapshot->console = console;
+}
+
+void rcheevos_snapshot_destroy(rcheevos_snapshot_t* snapshot)
+{
+   CHEEVOS_FREE(snapshot->entries);
+   CHEEVOS_FREE(snapshot->values);
+   rcheevos_snapshot_init(snapshot, snapshot->fixups, snapshot->console);
+}
+
+bool rcheevos_snapshot_add(rcheevos_snapshot_t* snapshot, const rc_memref_value_t* memrefs)
+{
+   for (; memrefs; memrefs = memrefs->next)
+   {
+      rcheevos_snapshot_entry_t* entry;
+
+      if (snapshot->count == snapshot->capacity)
+      {
+         unsigned new_capacity = snapshot->capacity == 0 ? 64 : snapshot->capacity * 2;
+         rcheevos_snapshot_entry_t* new_entries = (rcheevos_snapshot_entry_t*)
+            realloc(snapshot->entries, new_capacity * sizeof(rcheevos_snapshot_entry_t));
+
+         if (new_entries == NULL)
+         {
+            return false;
+         }
+
+         snapshot->entries = new_entries;
+         snapshot->capacity = new_capacity;
+      }
+
+      entry = &snapshot->entries[snapshot->count++];
+      entry->address = memrefs->memref.address;
+      entry->num_bytes = rcheevos_memref_bytes(&memrefs->memref);
+      entry->location = NULL;
+   }
+
+   return true;
+}
+
+bool rcheevos_snapshot_resolve(rcheevos_snapshot_t* snapshot)
+{
+   unsigned i, count = 0;
+
+   qsort(snapshot->entries, snapshot->count, sizeof(rcheevos_snapshot_entry_t), rcheevos_cmpentry);
+
+   /* Merge duplicates, keeping the widest read at each address. */
+   for (i = 0; i < snapshot->count; i++)
+   {
+      if (count != 0 && snapshot->entries[count - 1].address == snapshot->entries[i].address)
+      {
+         if (snapshot->entries[i].num_bytes > snapshot->entries[count - 1].num_bytes)
+            snapshot->entries[count - 1].num_bytes = snapshot->entries[i].num_bytes;
+      }
+      else
+      {
+         snapshot->entries[count++] = snapshot->entries[i];
+      }
+   }
+
+   snapshot->count = count;
+   snapshot->values = (unsigned*)calloc(count + 1, sizeof(unsigned));
+
+   if (snapshot->values == NULL)
+   {
+      return false;
+   }
+
+   for (i = 0; i < count; i++)
+   {
+      snapshot->entries[i].location = rcheevos_fixup_find(snapshot->fixups,
+         snapshot->entries[i].address, snapshot->console);
+   }
+
+   return true;
+}
+
+unsigned* rcheevos_snapshot_slots(const rcheevos_snapshot_t* snapshot, const rc_memref_value_t* memrefs, unsigned* count)
+{
+   const rc_memref_value_t* memref;
+   unsigned* slots;
+   unsigned i = 0;
+
+   *count = 0;
+
+   for (memref = memrefs; memref; memref = memref->next)
+      (*count)++;
+
+   slots = (unsigned*)malloc((*count + 1) * sizeof(unsigned));
+
+   if (slots == NULL)
+   {
+      *count = 0;
+      return NULL;
+   }
+
+   for (memref = memrefs; memref; memref = memref->next, i++)
+   {
+      rcheevos_snapshot_entry_t key;
+      const rcheevos_snapshot_entry_t* found;
+
+      key.address = memref->memref.address;
+      found = (const rcheevos_snapshot_entry_t*)bsearch(&key, snapshot->entries, snapshot->count, sizeof(rcheevos_snapshot_entry_t), rcheevos_cmpentry);
+
+      if (found == NULL)
+      {
+         /* Not part of the snapshot, let the peeks go the slow way. */
+         free(slots);
+         *count = 0;
+         return NULL;
+      }
+
+      slots[i] = (unsigned)(found - snapshot->entries);
+   }
+
+   return slots;
+}
+
+void rcheevos_snapshot_update(rcheevos_snapshot_t* snapshot)
+{
+   const rcheevos_snapshot_entry_t* entry = snapshot->entries;
+   unsigned* value = snapshot->values;
+   unsigned i;
+
+   for (i = 0; i < snapshot->count; i++, entry++, value++)
+      *value = entry->location ? rcheevos_read(entry->location, entry->num_bytes) : 0;
+}
+
+unsigned rcheevos_snapshot_peek(unsigned address, unsigned num_bytes, void* ud)
+{
+   rcheevos_snapshot_peek_t* peek = (rcheevos_snapshot_peek_t*)ud;
+   const rcheevos_snapshot_t* snapshot = peek->snapshot;
+
+   if (peek->next < peek->count)
+   {
+      unsigned slot = peek->slots[peek->next++];
+
+      if (snapshot->entries[slot].address == address)
+      {
+         unsigned value = snapshot->values[slot];
+
+         switch (num_bytes)
+         {
+            case 1: return value & 0xff;
+            case 2: return value & 0xffff;
+            default: return value;
+         }
+      }
+   }
+
+   /* Anything the memrefs didn't predict, e.g. Lua operands. */
+   return rcheevos_fixup_peek(snapshot->fixups, address, num_bytes, snapshot->console);
+}
@@ -21,6 +21,8 @@
 
 #include <retro_common_api.h>
 
+#include "../deps/rcheevos/include/rcheevos.h"
+
 RETRO_BEGIN_DECLS
 
 typedef struct
@@ -36,6 +38,34 @@ typedef struct
    bool dirty;
 } rcheevos_fixups_t;
 
+/* Every address referenced by the loaded triggers, resolved once and read
+ * once per frame into values[]. Slots index entries, which are sorted by
+ * address. */
+typedef struct
+{
+   unsigned address;
+   unsigned num_bytes;
+   const uint8_t* location;
+} rcheevos_snapshot_entry_t;
+
+typedef struct
+{
+   rcheevos_snapshot_entry_t* entries;
+   unsigned* values;
+   unsigned capacity, count;
+   rcheevos_fixups_t* fixups;
+   int console;
+} rcheevos_snapshot_t;
+
+/* Peek context for one trigger: memrefs are updated in list order, so the
+ * n-th peek is answered from slots[n]. */
+typedef struct
+{
+   const rcheevos_snapshot_t* snapshot;
+   const unsigned* slots;
+   unsigned count, next;
+} rcheevos_snapshot_peek_t;
+
 void rcheevos_fixup_init(rcheevos_fixups_t* fixups);
 void rcheevos_fixup_destroy(rcheevos_fixups_t* fixups);
 
@@ -43,6 +73,18 @@ const uint8_t* rcheevos_fixup_find(rcheevos_fixups_t* fixups, unsigned address,
 
 const uint8_t* rcheevos_patch_address(unsigned address, int console);
 
+unsigned rcheevos_fixup_peek(rcheevos_fixups_t* fixups, unsigned address, unsigned num_bytes, int console);
+
+void rcheevos_snapshot_init(rcheevos_snapshot_t* snapshot, rcheevos_fixups_t* fixups, int console);
+void rcheevos_snapshot_destroy(rcheevos_snapshot_t* snapshot);
+
+bool rcheevos_snapshot_add(rcheevos_snapshot_t* snapshot, const rc_memref_value_t* memrefs);
+bool rcheevos_snapshot_resolve(rcheevos_snapshot_t* snapshot);
+unsigned* rcheevos_snapshot_slots(const rcheevos_snapshot_t* snapshot, const rc_memref_value_t* memrefs, unsigned* count);
+
+void rcheevos_snapshot_update(rcheevos_snapshot_t* snapshot);
+unsigned rcheevos_snapshot_peek(unsigned address, unsigned num_bytes, void* ud);
+
 RETRO_END_DECLS
 
 #endif
@@ -194,6 +194,9 @@
 #endif
 #define DEFAULT_CHECK_FIRMWARE_BEFORE_LOADING false
 
+/* Memory-map content files instead of reading them into memory. */
+#define DEFAULT_CONTENT_MMAP_ENABLE true
+
 /* Forcibly disable composition.
  * Only valid on Windows Vista/7/8 for now. */
 #define DEFAULT_DISABLE_COMPOSITION false
@@ -221,6 +224,14 @@
  */
 #define DEFAULT_FRAME_DELAY 0
 
+/* Adjusts the frame delay every frame from measured core run
+ * and present times. The frame delay above becomes the upper
+ * limit (0 means no limit other than the frame time itself). */
+#define DEFAULT_FRAME_DELAY_AUTO false
+
+/* Milliseconds automatic frame delay keeps free before VSync. */
+#define DEFAULT_FRAME_DELAY_AUTO_MARGIN 2
+
 /* Inserts a black frame inbetween frames.
  * Useful for 120 Hz monitors who want to play 60 Hz material with eliminated
  * ghosting. video_refresh_rate should still be configured as if it
@@ -315,6 +326,9 @@
 
 #define DEFAULT_SHOW_HIDDEN_FILES false
 
+/* Keep parsed core info files in a binary cache. */
+#define DEFAULT_CORE_INFO_CACHE_ENABLE true
+
 #define DEFAULT_OVERLAY_HIDE_IN_MENU true
 #define DEFAULT_OVERLAY_SHOW_MOUSE_CURSOR true
 
@@ -600,6 +614,13 @@ static const float message_bgcolor_opacity = 1.0f;
 /* Watch shader files for changes and auto-apply as necessary. */
 #define DEFAULT_VIDEO_SHADER_WATCH_FILES false
 
+/* Cache compiled slang shaders (SPIR-V) on disk. */
+#define DEFAULT_VIDEO_SHADER_SPIRV_CACHE true
+
+/* Size limit in MB of the SPIR-V cache. Least recently
+ * used shaders are dropped first. */
+#define DEFAULT_VIDEO_SHADER_SPIRV_CACHE_SIZE 32
+
 /* Screenshots named automatically. */
 #define DEFAULT_AUTO_SCREENSHOT_FILENAME true
 
@@ -785,6 +806,10 @@ static const bool netplay_client_swap_input = true;
 
 static const bool netplay_nat_traversal = false;
 
+/* Also send input over UDP, with redundancy, so that
+ * a lost packet doesn't hold up the input after it. */
+static const bool netplay_udp_input = false;
+
 static const unsigned netplay_delay_frames = 16;
 
 static const int netplay_check_frames = 600;
@@ -848,6 +873,14 @@ static const bool network_on_demand_thumbnails = false;
 /* Number of entries that will be kept in content history playlist file. */
 static const unsigned default_content_history_size = 100;
 
+/* Size limit in MB of the cache of files extracted from zip/7z content,
+ * kept under the cache directory. 0 disables the cache. */
+static const unsigned default_content_archive_cache_size = 1024;
+
+/* Size limit in MB of the cache of soft-patched (IPS/BPS/UPS) content,
+ * kept under the cache directory. 0 disables the cache. */
+static const unsigned default_content_patch_cache_size = 64;
+
 /* Number of entries that will be kept in content favorites playlist file.
  * -1 == 'unlimited' (99999) */
 static const int default_content_favorites_size = 100;
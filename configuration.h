@@ -91,7 +91,9 @@ typedef struct settings
       bool video_scale_integer;
       bool video_shader_enable;
       bool video_shader_watch_files;
+      bool video_shader_spirv_cache;
       bool video_threaded;
+      bool video_frame_delay_auto;
       bool video_font_enable;
       bool video_disable_composition;
       bool video_post_filter_record;
@@ -262,6 +264,7 @@ typedef struct settings
       bool netplay_require_slaves;
       bool netplay_stateless_mode;
       bool netplay_nat_traversal;
+      bool netplay_udp_input;
       bool netplay_use_mitm_server;
       bool netplay_request_devices[MAX_USERS];
 
@@ -330,6 +333,7 @@ typedef struct settings
       bool network_remote_enable_user[MAX_USERS];
       bool load_dummy_on_core_shutdown;
       bool check_firmware_before_loading;
+      bool content_mmap_enable;
 
       bool game_specific_options;
       bool auto_overrides_enable;
@@ -341,6 +345,7 @@ typedef struct settings
       bool sort_savestates_enable;
       bool config_save_on_exit;
       bool show_hidden_files;
+      bool core_info_cache_enable;
 
       bool savefiles_in_content_dir;
       bool savestates_in_content_dir;
@@ -465,9 +470,13 @@ typedef struct settings
       unsigned netplay_input_latency_frames_range;
       unsigned netplay_share_digital;
       unsigned netplay_share_analog;
+      unsigned netplay_udp_sim_loss;
+      unsigned netplay_udp_sim_latency;
       unsigned bundle_assets_extract_version_current;
       unsigned bundle_assets_extract_last_version;
       unsigned content_history_size;
+      unsigned content_archive_cache_size;
+      unsigned content_patch_cache_size;
       unsigned frontend_log_level;
       unsigned libretro_log_level;
       unsigned rewind_granularity;
@@ -486,6 +495,8 @@ typedef struct settings
       unsigned video_swap_interval;
       unsigned video_hard_sync_frames;
       unsigned video_frame_delay;
+      unsigned video_frame_delay_auto_margin;
+      unsigned video_shader_spirv_cache_size;
       unsigned video_viwidth;
       unsigned video_aspect_ratio_idx;
       unsigned video_rotation;
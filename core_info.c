@@ -15,6 +15,11 @@
  *  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <ctype.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
 #include <compat/strl.h>
 #include <string/stdstring.h>
 #include <file/config_file.h>
@@ -22,6 +27,12 @@
 #include <lists/dir_list.h>
 #include <file/archive_file.h>
 #include <streams/file_stream.h>
+#include <encodings/crc32.h>
+#include <retro_miscellaneous.h>
+
+#if defined(_WIN32) && !defined(_XBOX) && !defined(LEGACY_WIN32)
+#include <encodings/utf.h>
+#endif
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -37,10 +48,99 @@
 #include "uwp/uwp_func.h"
 #endif
 
-#ifdef HAVE_COMPRESSION
-static const struct string_list *core_info_tmp_list = NULL;
-#endif
-static const char *core_info_tmp_path               = NULL;
+/* Bump whenever the layout of the cache or of core_info_t changes */
+#define CORE_INFO_CACHE_MAGIC   0x49434152 /* "RACI" */
+#define CORE_INFO_CACHE_VERSION 2
+
+#define CORE_INFO_CACHE_NULL_STRING 0xFFFFFFFF
+
+enum core_info_cache_flags
+{
+   CORE_INFO_CACHE_HAS_INFO                      = (1 << 0),
+   CORE_INFO_CACHE_SUPPORTS_NO_GAME              = (1 << 1),
+   CORE_INFO_CACHE_DATABASE_MATCH_ARCHIVE_MEMBER = (1 << 2)
+};
+
+/* Keys of the .info files that are plain strings */
+static const struct
+{
+   const char *key;
+   size_t offset;
+} core_info_string_fields[] = {
+   { "display_name",         offsetof(core_info_t, display_name)        },
+   { "display_version",      offsetof(core_info_t, display_version)     },
+   { "corename",             offsetof(core_info_t, core_name)           },
+   { "systemname",           offsetof(core_info_t, systemname)          },
+   { "systemid",             offsetof(core_info_t, system_id)           },
+   { "manufacturer",         offsetof(core_info_t, system_manufacturer) },
+   { "supported_extensions", offsetof(core_info_t, supported_extensions)},
+   { "authors",              offsetof(core_info_t, authors)             },
+   { "permissions",          offsetof(core_info_t, permissions)         },
+   { "license",              offsetof(core_info_t, licenses)            },
+   { "categories",           offsetof(core_info_t, categories)          },
+   { "database",             offsetof(core_info_t, databases)           },
+   { "notes",                offsetof(core_info_t, notes)               },
+   { "required_hw_api",      offsetof(core_info_t, required_hw_api)     }
+};
+
+#define CORE_INFO_STRING_FIELD(info, i) \
+   (*(char**)((char*)(info) + core_info_string_fields[i].offset))
+
+typedef struct
+{
+   uint32_t magic;
+   uint32_t version;
+   uint64_t cores_mtime;
+   uint64_t info_mtime;
+   uint32_t count;
+   /* CRC32 of everything following the header */
+   uint32_t crc;
+} core_info_cache_header_t;
+
+/* What the cache knows of each core's .info file. Updaters rewrite
+ * them in place, which doesn't always touch the directory. */
+typedef struct
+{
+   uint64_t mtime;
+   uint64_t size;
+} core_info_cache_stamp_t;
+
+typedef struct
+{
+   uint8_t *data;
+   size_t size;
+   size_t capacity;
+   bool error;
+} core_info_cache_writer_t;
+
+typedef struct
+{
+   const uint8_t *data;
+   size_t size;
+   size_t pos;
+   bool error;
+} core_info_cache_reader_t;
+
+/* Multimap from a key (core file name, extension or database name,
+ * compared without regard to case) to positions in core_info_list_t::list.
+ * The positions of a key are in ascending order. Since the list gets
+ * reordered by the qsort functions, the indexes are rebuilt after every
+ * sort. */
+typedef struct
+{
+   const char *key;
+   size_t *cores;
+   size_t count;
+   size_t capacity;
+   uint32_t hash;
+} core_info_index_entry_t;
+
+struct core_info_index
+{
+   core_info_index_entry_t *entries;
+   size_t mask;
+};
+
 static core_info_t *core_info_current               = NULL;
 static core_info_list_t *core_info_curr_list        = NULL;
 
@@ -54,6 +154,229 @@ enum compare_op
    COMPARE_OP_GREATER_EQUAL
 };
 
+static int core_info_qsort_func_display_name(const core_info_t *a,
+      const core_info_t *b);
+
+static uint32_t core_info_index_hash(const char *key)
+{
+   uint32_t hash = 2166136261u;
+
+   while (*key)
+   {
+      hash ^= (uint8_t)tolower((unsigned char)*key++);
+      hash *= 16777619u;
+   }
+
+   return hash;
+}
+
+static struct core_info_index *core_info_index_new(size_t max_keys)
+{
+   size_t capacity               = 16;
+   struct core_info_index *index = (struct core_info_index*)
+      calloc(1, sizeof(*index));
+
+   if (!index)
+      return NULL;
+
+   /* Keep the load factor at or below one half */
+   while (capacity < max_keys * 2)
+      capacity <<= 1;
+
+   index->entries = (core_info_index_entry_t*)
+      calloc(capacity, sizeof(*index->entries));
+   index->mask    = capacity - 1;
+
+   if (!index->entries)
+   {
+      free(index);
+      return NULL;
+   }
+
+   return index;
+}
+
+static void core_info_index_free(struct core_info_index *index)
+{
+   size_t i;
+
+   if (!index)
+      return;
+
+   for (i = 0; i <= index->mask; i++)
+      free(index->entries[i].cores);
+
+   free(index->entries);
+   free(index);
+}
+
+/* Returns the entry of @key, or the empty slot it would go into. */
+static core_info_index_entry_t *core_info_index_slot(
+      const struct core_info_index *index, const char *key, uint32_t hash)
+{
+   size_t i = hash & index->mask;
+
+   for (;;)
+   {
+      core_info_index_entry_t *entry = &index->entries[i];
+
+      if (!entry->key)
+         return entry;
+      if (entry->hash == hash && string_is_equal_noncase(entry->key, key))
+         return entry;
+
+      i = (i + 1) & index->mask;
+   }
+}
+
+/* @key has to outlive the index; it points into the core info strings. */
+static void core_info_index_add(struct core_info_index *index,
+      const char *key, size_t core)
+{
+   uint32_t hash;
+   core_info_index_entry_t *entry = NULL;
+
+   if (!index || string_is_empty(key))
+      return;
+
+   /* Accept both "ext" and ".ext" */
+   if (*key == '.' && key[1])
+      key++;
+
+   hash  = core_info_index_hash(key);
+   entry = core_info_index_slot(index, key, hash);
+
+   if (!entry->key)
+   {
+      entry->key  = key;
+      entry->hash = hash;
+   }
+
+   /* Cores are added in order, so a repeated key of the same core
+    * can only be the last one */
+   if (entry->count && entry->cores[entry->count - 1] == core)
+      return;
+
+   if (entry->count == entry->capacity)
+   {
+      size_t capacity = entry->capacity ? entry->capacity * 2 : 4;
+      size_t *cores   = (size_t*)realloc(entry->cores,
+            capacity * sizeof(*cores));
+
+      if (!cores)
+         return;
+
+      entry->cores    = cores;
+      entry->capacity = capacity;
+   }
+
+   entry->cores[entry->count++] = core;
+}
+
+static const core_info_index_entry_t *core_info_index_find(
+      const struct core_info_index *index, const char *key)
+{
+   const core_info_index_entry_t *entry = NULL;
+
+   if (!index || string_is_empty(key))
+      return NULL;
+
+   entry = core_info_index_slot(index, key, core_info_index_hash(key));
+
+   return entry->key ? entry : NULL;
+}
+
+/* Whether both entries share a core. */
+static bool core_info_index_intersects(
+      const core_info_index_entry_t *a,
+      const core_info_index_entry_t *b)
+{
+   size_t i = 0;
+   size_t j = 0;
+
+   while (i < a->count && j < b->count)
+   {
+      if (a->cores[i] == b->cores[j])
+         return true;
+      if (a->cores[i] < b->cores[j])
+         i++;
+      else
+         j++;
+   }
+
+   return false;
+}
+
+static void core_info_list_free_indexes(core_info_list_t *core_info_list)
+{
+   core_info_index_free(core_info_list->path_index);
+   core_info_index_free(core_info_list->ext_index);
+   core_info_index_free(core_info_list->database_index);
+   core_info_list->path_index     = NULL;
+   core_info_list->ext_index      = NULL;
+   core_info_list->database_index = NULL;
+}
+
+static void core_info_list_build_indexes(core_info_list_t *core_info_list)
+{
+   size_t i, j;
+   size_t num_exts      = 0;
+   size_t num_databases = 0;
+
+   core_info_list_free_indexes(core_info_list);
+
+   for (i = 0; i < core_info_list->count; i++)
+   {
+      const core_info_t *info = &core_info_list->list[i];
+
+      if (info->supported_extensions_list)
+         num_exts      += info->supported_extensions_list->size;
+      if (info->databases_list)
+         num_databases += info->databases_list->size;
+   }
+
+   core_info_list->path_index     = core_info_index_new(core_info_list->count);
+   core_info_list->ext_index      = core_info_index_new(num_exts);
+   core_info_list->database_index = core_info_index_new(num_databases);
+
+   for (i = 0; i < core_info_list->count; i++)
+   {
+      const core_info_t *info = &core_info_list->list[i];
+
+      if (!info->path)
+         continue;
+
+      core_info_index_add(core_info_list->path_index,
+            path_basename(info->path), i);
+
+      if (info->supported_extensions_list)
+         for (j = 0; j < info->supported_extensions_list->size; j++)
+            core_info_index_add(core_info_list->ext_index,
+                  info->supported_extensions_list->elems[j].data, i);
+
+      if (info->databases_list)
+         for (j = 0; j < info->databases_list->size; j++)
+            core_info_index_add(core_info_list->database_index,
+                  info->databases_list->elems[j].data, i);
+   }
+}
+
+/* Flags every core that supports the extension @ext. */
+static void core_info_list_mark_extension(
+      const core_info_list_t *core_info_list,
+      const char *ext, bool *supported)
+{
+   size_t i;
+   const core_info_index_entry_t *entry = core_info_index_find(
+         core_info_list->ext_index, ext);
+
+   if (!entry)
+      return;
+
+   for (i = 0; i < entry->count; i++)
+      supported[entry->cores[i]] = true;
+}
+
 static void core_info_list_resolve_all_extensions(
       core_info_list_t *core_info_list)
 {
@@ -96,120 +419,524 @@ static void core_info_list_resolve_all_extensions(
 #endif
 }
 
-static void core_info_list_resolve_all_firmware(
-      core_info_list_t *core_info_list)
+/* Splits the '|' separated strings of @info into their lists. */
+static void core_info_split_lists(core_info_t *info)
+{
+   if (info->supported_extensions)
+      info->supported_extensions_list =
+         string_split(info->supported_extensions, "|");
+   if (info->authors)
+      info->authors_list     = string_split(info->authors, "|");
+   if (info->permissions)
+      info->permissions_list = string_split(info->permissions, "|");
+   if (info->licenses)
+      info->licenses_list    = string_split(info->licenses, "|");
+   if (info->categories)
+      info->categories_list  = string_split(info->categories, "|");
+   if (info->databases)
+      info->databases_list   = string_split(info->databases, "|");
+   if (info->notes)
+      info->note_list        = string_split(info->notes, "|");
+   if (info->required_hw_api)
+      info->required_hw_api_list =
+         string_split(info->required_hw_api, "|");
+}
+
+static void core_info_parse_firmware(core_info_t *info,
+      config_file_t *config)
 {
-   size_t i;
    unsigned c;
+   unsigned count                  = 0;
+   core_info_firmware_t *firmware  = NULL;
 
-   for (i = 0; i < core_info_list->count; i++)
+   if (!config_get_uint(config, "firmware_count", &count) || !count)
+      return;
+
+   firmware = (core_info_firmware_t*)calloc(count, sizeof(*firmware));
+
+   if (!firmware)
+      return;
+
+   info->firmware       = firmware;
+   info->firmware_count = count;
+
+   for (c = 0; c < count; c++)
+   {
+      char path_key[64];
+      char desc_key[64];
+      char opt_key[64];
+      bool tmp_bool     = false;
+      char *tmp         = NULL;
+      path_key[0]       = desc_key[0] = opt_key[0] = '\0';
+
+      snprintf(path_key, sizeof(path_key), "firmware%u_path", c);
+      snprintf(desc_key, sizeof(desc_key), "firmware%u_desc", c);
+      snprintf(opt_key,  sizeof(opt_key),  "firmware%u_opt",  c);
+
+      if (config_get_string(config, path_key, &tmp) && !string_is_empty(tmp))
+      {
+         info->firmware[c].path = strdup(tmp);
+         free(tmp);
+         tmp = NULL;
+      }
+      if (config_get_string(config, desc_key, &tmp) && !string_is_empty(tmp))
+      {
+         info->firmware[c].desc = strdup(tmp);
+         free(tmp);
+         tmp = NULL;
+      }
+      if (tmp)
+         free(tmp);
+      tmp = NULL;
+      if (config_get_bool(config, opt_key , &tmp_bool))
+         info->firmware[c].optional = tmp_bool;
+   }
+}
+
+static void core_info_parse_config(core_info_t *info, config_file_t *conf)
+{
+   size_t i;
+   bool tmp_bool       = false;
+
+   for (i = 0; i < ARRAY_SIZE(core_info_string_fields); i++)
    {
-      unsigned count                  = 0;
-      core_info_firmware_t *firmware  = NULL;
-      core_info_t *info               = (core_info_t*)&core_info_list->list[i];
-      config_file_t *config           = (config_file_t*)info->config_data;
+      char *tmp = NULL;
 
-      if (!config || !config_get_uint(config, "firmware_count", &count))
+      if (config_get_string(conf, core_info_string_fields[i].key, &tmp)
+            && !string_is_empty(tmp))
+      {
+         CORE_INFO_STRING_FIELD(info, i) = tmp;
          continue;
+      }
 
-      firmware = (core_info_firmware_t*)calloc(count, sizeof(*firmware));
+      free(tmp);
+   }
 
-      if (!firmware)
-         continue;
+   core_info_split_lists(info);
+   core_info_parse_firmware(info, conf);
 
-      info->firmware = firmware;
+   if (config_get_bool(conf, "supports_no_game",
+            &tmp_bool))
+      info->supports_no_game = tmp_bool;
 
-      for (c = 0; c < count; c++)
+   if (config_get_bool(conf, "database_match_archive_member",
+            &tmp_bool))
+      info->database_match_archive_member = tmp_bool;
+
+   info->has_info = true;
+}
+
+static void core_info_free_entry(core_info_t *info)
+{
+   size_t i;
+
+   for (i = 0; i < ARRAY_SIZE(core_info_string_fields); i++)
+      free(CORE_INFO_STRING_FIELD(info, i));
+   free(info->path);
+   string_list_free(info->supported_extensions_list);
+   string_list_free(info->authors_list);
+   string_list_free(info->note_list);
+   string_list_free(info->permissions_list);
+   string_list_free(info->licenses_list);
+   string_list_free(info->categories_list);
+   string_list_free(info->databases_list);
+   string_list_free(info->required_hw_api_list);
+
+   for (i = 0; i < info->firmware_count; i++)
+   {
+      free(info->firmware[i].path);
+      free(info->firmware[i].desc);
+   }
+   free(info->firmware);
+
+   memset(info, 0, sizeof(*info));
+}
+
+static void core_info_list_free(core_info_list_t *core_info_list)
+{
+   size_t i;
+
+   if (!core_info_list)
+      return;
+
+   for (i = 0; i < core_info_list->count; i++)
+      core_info_free_entry(&core_info_list->list[i]);
+
+   core_info_list_free_indexes(core_info_list);
+   free(core_info_list->all_ext);
+   free(core_info_list->list);
+   free(core_info_list);
+}
+
+static bool core_info_path_stat(const char *path,
+      uint64_t *mtime, uint64_t *size)
+{
+#if defined(_WIN32) && !defined(_XBOX)
+   struct _stat buf;
+#if defined(LEGACY_WIN32)
+   if (_stat(path, &buf) != 0)
+      return false;
+#else
+   int ret;
+   wchar_t *path_wide = utf8_to_utf16_string_alloc(path);
+
+   if (!path_wide)
+      return false;
+   ret = _wstat(path_wide, &buf);
+   free(path_wide);
+   if (ret != 0)
+      return false;
+#endif
+   *mtime = (uint64_t)buf.st_mtime;
+   if (size)
+      *size = (uint64_t)buf.st_size;
+   return true;
+#elif defined(VITA) || defined(PSP) || defined(PS2) || defined(ORBIS) || defined(__CELLOS_LV2__) || defined(_XBOX)
+   /* No modification times, so nothing to validate a cache against */
+   return false;
+#else
+   struct stat buf;
+
+   if (stat(path, &buf) != 0)
+      return false;
+   *mtime = (uint64_t)buf.st_mtime;
+   if (size)
+      *size = (uint64_t)buf.st_size;
+   return true;
+#endif
+}
+
+static void core_info_cache_write(core_info_cache_writer_t *writer,
+      const void *data, size_t len)
+{
+   if (writer->error)
+      return;
+
+   if (writer->size + len > writer->capacity)
+   {
+      size_t capacity = writer->capacity ? writer->capacity : 65536;
+      uint8_t *buf    = NULL;
+
+      while (capacity < writer->size + len)
+         capacity *= 2;
+
+      if (!(buf = (uint8_t*)realloc(writer->data, capacity)))
       {
-         char path_key[64];
-         char desc_key[64];
-         char opt_key[64];
-         bool tmp_bool     = false;
-         char *tmp         = NULL;
-         path_key[0]       = desc_key[0] = opt_key[0] = '\0';
-
-         snprintf(path_key, sizeof(path_key), "firmware%u_path", c);
-         snprintf(desc_key, sizeof(desc_key), "firmware%u_desc", c);
-         snprintf(opt_key,  sizeof(opt_key),  "firmware%u_opt",  c);
-
-         if (config_get_string(config, path_key, &tmp) && !string_is_empty(tmp))
+         writer->error = true;
+         return;
+      }
+
+      writer->data     = buf;
+      writer->capacity = capacity;
+   }
+
+   memcpy(writer->data + writer->size, data, len);
+   writer->size += len;
+}
+
+static void core_info_cache_write_uint(core_info_cache_writer_t *writer,
+      uint32_t value)
+{
+   core_info_cache_write(writer, &value, sizeof(value));
+}
+
+static void core_info_cache_write_string(core_info_cache_writer_t *writer,
+      const char *s)
+{
+   uint32_t len = s ? (uint32_t)strlen(s) : CORE_INFO_CACHE_NULL_STRING;
+
+   core_info_cache_write_uint(writer, len);
+   if (s)
+      core_info_cache_write(writer, s, len);
+}
+
+static void core_info_cache_read(core_info_cache_reader_t *reader,
+      void *data, size_t len)
+{
+   if (reader->error || reader->size - reader->pos < len)
+   {
+      reader->error = true;
+      memset(data, 0, len);
+      return;
+   }
+
+   memcpy(data, reader->data + reader->pos, len);
+   reader->pos += len;
+}
+
+static uint32_t core_info_cache_read_uint(core_info_cache_reader_t *reader)
+{
+   uint32_t value;
+   core_info_cache_read(reader, &value, sizeof(value));
+   return value;
+}
+
+/* Returns the next string of the cache; *len is CORE_INFO_CACHE_NULL_STRING
+ * for a NULL string. */
+static const char *core_info_cache_read_raw_string(
+      core_info_cache_reader_t *reader, uint32_t *len)
+{
+   const char *s = NULL;
+
+   *len = core_info_cache_read_uint(reader);
+
+   if (reader->error || *len == CORE_INFO_CACHE_NULL_STRING)
+      return NULL;
+
+   if (reader->size - reader->pos < *len)
+   {
+      reader->error = true;
+      return NULL;
+   }
+
+   s            = (const char*)reader->data + reader->pos;
+   reader->pos += *len;
+   return s;
+}
+
+static char *core_info_cache_read_string(core_info_cache_reader_t *reader)
+{
+   uint32_t len;
+   char *s       = NULL;
+   const char *data = core_info_cache_read_raw_string(reader, &len);
+
+   if (!data || !(s = (char*)malloc(len + 1)))
+      return NULL;
+
+   memcpy(s, data, len);
+   s[len] = '\0';
+   return s;
+}
+
+static bool core_info_cache_read_equals(core_info_cache_reader_t *reader,
+      const char *s)
+{
+   uint32_t len;
+   const char *data = core_info_cache_read_raw_string(reader, &len);
+
+   if (!data || !s)
+      return !data && !s && !reader->error;
+
+   return len == strlen(s) && !memcmp(data, s, len);
+}
+
+/**
+ * core_info_cache_load:
+ * @core_info_list         : list with one zeroed entry per core.
+ * @contents               : the core files, in the same order as the list.
+ * @stamps                 : the .info files of @contents, see
+ *                           core_info_cache_stamp_all().
+ *
+ * Fills @core_info_list from the binary cache at @path_cache, provided it
+ * was written for the same core files, neither the core nor the info
+ * directory have been modified since and every .info file has the same
+ * modification time and size as then.
+ *
+ * Returns: true if the list was filled from the cache, otherwise false
+ * with the list left untouched.
+ **/
+static bool core_info_cache_load(core_info_list_t *core_info_list,
+      const struct string_list *contents,
+      const core_info_cache_stamp_t *stamps,
+      const char *dir_cores, const char *dir_info,
+      uint64_t cores_mtime, uint64_t info_mtime,
+      const char *path_cache)
+{
+   size_t i, j;
+   core_info_cache_header_t header;
+   core_info_cache_reader_t reader;
+   void *buf          = NULL;
+   int64_t len        = 0;
+
+   if (!path_is_valid(path_cache) ||
+         !filestream_read_file(path_cache, &buf, &len))
+      return false;
+
+   if ((size_t)len < sizeof(header))
+      goto error;
+
+   memcpy(&header, buf, sizeof(header));
+
+   if (     header.magic       != CORE_INFO_CACHE_MAGIC
+         || header.version     != CORE_INFO_CACHE_VERSION
+         || header.cores_mtime != cores_mtime
+         || header.info_mtime  != info_mtime
+         || header.count       != contents->size)
+      goto error;
+
+   reader.data  = (const uint8_t*)buf + sizeof(header);
+   reader.size  = (size_t)len - sizeof(header);
+   reader.pos   = 0;
+   reader.error = false;
+
+   if (encoding_crc32(0, reader.data, reader.size) != header.crc)
+      goto error;
+
+   if (     !core_info_cache_read_equals(&reader, dir_cores)
+         || !core_info_cache_read_equals(&reader, dir_info))
+      goto error;
+
+   for (i = 0; i < core_info_list->count; i++)
+   {
+      core_info_t *info = &core_info_list->list[i];
+      core_info_cache_stamp_t stamp;
+      uint32_t flags;
+
+      if (!core_info_cache_read_equals(&reader, contents->elems[i].data))
+         goto error;
+
+      core_info_cache_read(&reader, &stamp, sizeof(stamp));
+      if (     reader.error
+            || stamp.mtime != stamps[i].mtime
+            || stamp.size  != stamps[i].size)
+         goto error;
+
+      info->path = strdup(contents->elems[i].data);
+      flags      = core_info_cache_read_uint(&reader);
+
+      for (j = 0; j < ARRAY_SIZE(core_info_string_fields); j++)
+         CORE_INFO_STRING_FIELD(info, j) =
+            core_info_cache_read_string(&reader);
+
+      info->firmware_count = core_info_cache_read_uint(&reader);
+
+      if (reader.error || info->firmware_count > reader.size)
+         goto error;
+
+      if (info->firmware_count)
+      {
+         info->firmware = (core_info_firmware_t*)calloc(
+               info->firmware_count, sizeof(*info->firmware));
+
+         if (!info->firmware)
          {
-            info->firmware[c].path = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
+            info->firmware_count = 0;
+            goto error;
          }
-         if (config_get_string(config, desc_key, &tmp) && !string_is_empty(tmp))
+
+         for (j = 0; j < info->firmware_count; j++)
          {
-            info->firmware[c].desc = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
+            info->firmware[j].path     = core_info_cache_read_string(&reader);
+            info->firmware[j].desc     = core_info_cache_read_string(&reader);
+            info->firmware[j].optional = core_info_cache_read_uint(&reader)
+               != 0;
          }
-         if (tmp)
-            free(tmp);
-         tmp = NULL;
-         if (config_get_bool(config, opt_key , &tmp_bool))
-            info->firmware[c].optional = tmp_bool;
       }
+
+      if (reader.error)
+         goto error;
+
+      info->has_info                      = (flags
+            & CORE_INFO_CACHE_HAS_INFO) != 0;
+      info->supports_no_game              = (flags
+            & CORE_INFO_CACHE_SUPPORTS_NO_GAME) != 0;
+      info->database_match_archive_member = (flags
+            & CORE_INFO_CACHE_DATABASE_MATCH_ARCHIVE_MEMBER) != 0;
+
+      core_info_split_lists(info);
    }
+
+   free(buf);
+   return true;
+
+error:
+   for (i = 0; i < core_info_list->count; i++)
+      core_info_free_entry(&core_info_list->list[i]);
+   RARCH_LOG("[Core Info]: Rebuilding core info cache \"%s\".\n", path_cache);
+   free(buf);
+   return false;
 }
 
-static void core_info_list_free(core_info_list_t *core_info_list)
+static void core_info_cache_save(const core_info_list_t *core_info_list,
+      const core_info_cache_stamp_t *stamps,
+      const char *dir_cores, const char *dir_info,
+      uint64_t cores_mtime, uint64_t info_mtime,
+      const char *path_cache)
 {
    size_t i, j;
+   char dir[PATH_MAX_LENGTH];
+   char tmp_path[PATH_MAX_LENGTH];
+   core_info_cache_header_t header;
+   core_info_cache_writer_t writer;
 
-   if (!core_info_list)
+   fill_pathname_basedir(dir, path_cache, sizeof(dir));
+   if (!path_is_directory(dir) && !path_mkdir(dir))
       return;
 
+   memset(&writer, 0, sizeof(writer));
+   memset(&header, 0, sizeof(header));
+
+   /* Room for the header, filled in once the CRC is known */
+   core_info_cache_write(&writer, &header, sizeof(header));
+   core_info_cache_write_string(&writer, dir_cores);
+   core_info_cache_write_string(&writer, dir_info);
+
    for (i = 0; i < core_info_list->count; i++)
    {
-      core_info_t *info = (core_info_t*)&core_info_list->list[i];
-
-      free(info->path);
-      free(info->core_name);
-      free(info->systemname);
-      free(info->system_id);
-      free(info->system_manufacturer);
-      free(info->display_name);
-      free(info->display_version);
-      free(info->supported_extensions);
-      free(info->authors);
-      free(info->permissions);
-      free(info->licenses);
-      free(info->categories);
-      free(info->databases);
-      free(info->notes);
-      free(info->required_hw_api);
-      string_list_free(info->supported_extensions_list);
-      string_list_free(info->authors_list);
-      string_list_free(info->note_list);
-      string_list_free(info->permissions_list);
-      string_list_free(info->licenses_list);
-      string_list_free(info->categories_list);
-      string_list_free(info->databases_list);
-      string_list_free(info->required_hw_api_list);
-      config_file_free((config_file_t*)info->config_data);
+      const core_info_t *info = &core_info_list->list[i];
+      uint32_t flags          = 0;
+
+      if (info->has_info)
+         flags |= CORE_INFO_CACHE_HAS_INFO;
+      if (info->supports_no_game)
+         flags |= CORE_INFO_CACHE_SUPPORTS_NO_GAME;
+      if (info->database_match_archive_member)
+         flags |= CORE_INFO_CACHE_DATABASE_MATCH_ARCHIVE_MEMBER;
+
+      core_info_cache_write_string(&writer, info->path);
+      core_info_cache_write(&writer, &stamps[i], sizeof(stamps[i]));
+      core_info_cache_write_uint(&writer, flags);
+
+      for (j = 0; j < ARRAY_SIZE(core_info_string_fields); j++)
+         core_info_cache_write_string(&writer,
+               CORE_INFO_STRING_FIELD(info, j));
+
+      core_info_cache_write_uint(&writer, (uint32_t)info->firmware_count);
 
       for (j = 0; j < info->firmware_count; j++)
       {
-         free(info->firmware[j].path);
-         free(info->firmware[j].desc);
+         core_info_cache_write_string(&writer, info->firmware[j].path);
+         core_info_cache_write_string(&writer, info->firmware[j].desc);
+         core_info_cache_write_uint(&writer, info->firmware[j].optional);
       }
-      free(info->firmware);
    }
 
-   free(core_info_list->all_ext);
-   free(core_info_list->list);
-   free(core_info_list);
+   if (writer.error)
+      goto end;
+
+   header.magic       = CORE_INFO_CACHE_MAGIC;
+   header.version     = CORE_INFO_CACHE_VERSION;
+   header.cores_mtime = cores_mtime;
+   header.info_mtime  = info_mtime;
+   header.count       = (uint32_t)core_info_list->count;
+   header.crc         = encoding_crc32(0, writer.data + sizeof(header),
+         writer.size - sizeof(header));
+   memcpy(writer.data, &header, sizeof(header));
+
+   /* Write then rename, so that a concurrent load never sees half a file */
+   strlcpy(tmp_path, path_cache, sizeof(tmp_path));
+   strlcat(tmp_path, ".tmp", sizeof(tmp_path));
+
+   if (!filestream_write_file(tmp_path, writer.data, writer.size))
+      goto end;
+
+   filestream_delete(path_cache);
+   if (filestream_rename(tmp_path, path_cache) != 0)
+      filestream_delete(tmp_path);
+
+end:
+   free(writer.data);
 }
 
-static config_file_t *core_info_list_iterate(
+/* Returns the .info file path for the core at @current_path, or NULL.
+ * The caller frees it. */
+static char *core_info_get_info_path(
       const char *current_path,
       const char *path_basedir)
 {
    size_t info_path_base_size = PATH_MAX_LENGTH * sizeof(char);
    char *info_path_base       = NULL;
    char *info_path            = NULL;
-   config_file_t *conf        = NULL;
 
    if (!current_path)
       return NULL;
@@ -239,6 +966,20 @@ static config_file_t *core_info_list_iterate(
    free(info_path_base);
    info_path_base = NULL;
 
+   return info_path;
+}
+
+static config_file_t *core_info_list_iterate(
+      const char *current_path,
+      const char *path_basedir)
+{
+   config_file_t *conf = NULL;
+   char *info_path     = core_info_get_info_path(current_path,
+         path_basedir);
+
+   if (!info_path)
+      return NULL;
+
    if (path_is_valid(info_path))
       conf = config_file_new_from_path_to_string(info_path);
    free(info_path);
@@ -246,15 +987,46 @@ static config_file_t *core_info_list_iterate(
    return conf;
 }
 
+/* Stamps of the .info files, zeroed for missing ones */
+static void core_info_cache_stamp_all(core_info_cache_stamp_t *stamps,
+      const struct string_list *contents, const char *path_basedir)
+{
+   size_t i;
+
+   for (i = 0; i < contents->size; i++)
+   {
+      char *info_path = core_info_get_info_path(contents->elems[i].data,
+            path_basedir);
+
+      if (     !info_path
+            || !core_info_path_stat(info_path,
+               &stamps[i].mtime, &stamps[i].size))
+      {
+         stamps[i].mtime = 0;
+         stamps[i].size  = 0;
+      }
+      free(info_path);
+   }
+}
+
 static core_info_list_t *core_info_list_new(const char *path,
       const char *libretro_info_dir,
       const char *exts,
-      bool dir_show_hidden_files)
+      bool dir_show_hidden_files,
+      const char *path_cache)
 {
    size_t i;
    core_info_t *core_info           = NULL;
    core_info_list_t *core_info_list = NULL;
    const char       *path_basedir   = libretro_info_dir;
+   uint64_t cores_mtime             = 0;
+   uint64_t info_mtime              = 0;
+   /* Stat the directories before listing them, so that anything
+    * that changes in between invalidates the cache next time */
+   bool use_cache                   = !string_is_empty(path_cache)
+      && core_info_path_stat(path, &cores_mtime, NULL)
+      && core_info_path_stat(path_basedir, &info_mtime, NULL);
+   core_info_cache_stamp_t *stamps  = NULL;
    struct string_list *contents     = string_list_new();
    bool                          ok = dir_list_append(contents, path, exts,
          false, dir_show_hidden_files, false, false);
@@ -297,188 +1069,76 @@ static core_info_list_t *core_info_list_new(const char *path,
    core_info_list->list  = core_info;
    core_info_list->count = contents->size;
 
-   for (i = 0; i < contents->size; i++)
+   if (use_cache && contents->size)
    {
-      const char *base_path = contents->elems[i].data;
-      config_file_t *conf   = core_info_list_iterate(base_path,
-            path_basedir);
+      if ((stamps = (core_info_cache_stamp_t*)malloc(
+                  contents->size * sizeof(*stamps))))
+         core_info_cache_stamp_all(stamps, contents, path_basedir);
+      else
+         use_cache = false;
+   }
 
-      if (conf)
+   if (!use_cache || !core_info_cache_load(core_info_list, contents, stamps,
+            path, path_basedir, cores_mtime, info_mtime, path_cache))
+   {
+      for (i = 0; i < contents->size; i++)
       {
-         char *tmp           = NULL;
-
-         if (config_get_string(conf, "display_name", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].display_name = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-         if (config_get_string(conf, "display_version", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].display_version = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-         if (config_get_string(conf, "corename", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].core_name = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (config_get_string(conf, "systemname", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].systemname = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (config_get_string(conf, "systemid", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].system_id = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (config_get_string(conf, "manufacturer", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].system_manufacturer = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-
-         {
-            unsigned count      = 0;
-            config_get_uint(conf, "firmware_count", &count);
-            core_info[i].firmware_count = count;
-         }
-
-         if (config_get_string(conf, "supported_extensions", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].supported_extensions      = strdup(tmp);
-            core_info[i].supported_extensions_list =
-               string_split(core_info[i].supported_extensions, "|");
-
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (config_get_string(conf, "authors", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].authors      = strdup(tmp);
-            core_info[i].authors_list =
-               string_split(core_info[i].authors, "|");
-
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (config_get_string(conf, "permissions", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].permissions      = strdup(tmp);
-            core_info[i].permissions_list =
-               string_split(core_info[i].permissions, "|");
-
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (config_get_string(conf, "license", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].licenses      = strdup(tmp);
-            core_info[i].licenses_list =
-               string_split(core_info[i].licenses, "|");
-
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (config_get_string(conf, "categories", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].categories      = strdup(tmp);
-            core_info[i].categories_list =
-               string_split(core_info[i].categories, "|");
-
-            free(tmp);
-            tmp = NULL;
-         }
+         const char *base_path = contents->elems[i].data;
+         config_file_t *conf   = core_info_list_iterate(base_path,
+               path_basedir);
 
-         if (config_get_string(conf, "database", &tmp)
-               && !string_is_empty(tmp))
+         if (conf)
          {
-            core_info[i].databases      = strdup(tmp);
-            core_info[i].databases_list =
-               string_split(core_info[i].databases, "|");
-
-            free(tmp);
-            tmp = NULL;
+            core_info_parse_config(&core_info[i], conf);
+            config_file_free(conf);
          }
 
-         if (config_get_string(conf, "notes", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].notes     = strdup(tmp);
-            core_info[i].note_list = string_split(core_info[i].notes, "|");
+         if (!string_is_empty(base_path))
+            core_info[i].path = strdup(base_path);
 
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (config_get_string(conf, "required_hw_api", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].required_hw_api = strdup(tmp);
-            core_info[i].required_hw_api_list = string_split(core_info[i].required_hw_api, "|");
+         if (!core_info[i].display_name)
+            core_info[i].display_name =
+               strdup(path_basename(core_info[i].path));
+      }
 
-            free(tmp);
-            tmp = NULL;
-         }
+      if (use_cache)
+         core_info_cache_save(core_info_list, stamps, path, path_basedir,
+               cores_mtime, info_mtime, path_cache);
+   }
 
-         if (tmp)
-            free(tmp);
-         tmp    = NULL;
+   free(stamps);
 
-         {
-            bool tmp_bool       = false;
-            if (config_get_bool(conf, "supports_no_game",
-                     &tmp_bool))
-               core_info[i].supports_no_game = tmp_bool;
-
-            if (config_get_bool(conf, "database_match_archive_member",
-                     &tmp_bool))
-               core_info[i].database_match_archive_member = tmp_bool;
-         }
+   core_info_list_resolve_all_extensions(core_info_list);
+   core_info_list_build_indexes(core_info_list);
 
-         core_info[i].config_data = conf;
-      }
+   string_list_free(contents);
+   return core_info_list;
+}
 
-      if (!string_is_empty(base_path))
-         core_info[i].path = strdup(base_path);
+static core_info_t *core_info_find_internal(
+      core_info_list_t *list,
+      const char *core)
+{
+   size_t i;
+   const char *core_path_basename       = path_basename(core);
+   const core_info_index_entry_t *entry = core_info_index_find(
+         list->path_index, core_path_basename);
 
-      if (!core_info[i].display_name)
-         core_info[i].display_name =
-            strdup(path_basename(core_info[i].path));
-   }
+   if (!entry)
+      return NULL;
 
-   if (core_info_list)
+   /* The index ignores case, the file name comparison does not */
+   for (i = 0; i < entry->count; i++)
    {
-      core_info_list_resolve_all_extensions(core_info_list);
-      core_info_list_resolve_all_firmware(core_info_list);
+      core_info_t *info = core_info_get(list, entry->cores[i]);
+
+      if (!info || !info->path)
+         continue;
+      if (string_is_equal(path_basename(info->path), core_path_basename))
+         return info;
    }
 
-   string_list_free(contents);
-   return core_info_list;
+   return NULL;
 }
 
 /* Shallow-copies internal state.
@@ -488,93 +1148,18 @@ static core_info_list_t *core_info_list_new(const char *path,
 bool core_info_list_get_info(core_info_list_t *core_info_list,
       core_info_t *out_info, const char *path)
 {
-   size_t i;
+   core_info_t *info = NULL;
+
    if (!core_info_list || !out_info)
       return false;
 
    memset(out_info, 0, sizeof(*out_info));
 
-   for (i = 0; i < core_info_list->count; i++)
-   {
-      const core_info_t *info = &core_info_list->list[i];
-
-      if (string_is_equal(path_basename(info->path),
-               path_basename(path)))
-      {
-         *out_info = *info;
-         return true;
-      }
-   }
-
-   return false;
-}
-
-#ifdef HAVE_COMPRESSION
-static bool core_info_does_support_any_file(const core_info_t *core,
-      const struct string_list *list)
-{
-   size_t i;
-   if (!list || !core || !core->supported_extensions_list)
+   if (!(info = core_info_find_internal(core_info_list, path)))
       return false;
 
-   for (i = 0; i < list->size; i++)
-      if (string_list_find_elem_prefix(core->supported_extensions_list,
-               ".", path_get_extension(list->elems[i].data)))
-         return true;
-   return false;
-}
-#endif
-
-static bool core_info_does_support_file(
-      const core_info_t *core, const char *path)
-{
-   if (!core || !core->supported_extensions_list)
-      return false;
-   if (string_is_empty(path))
-      return false;
-
-   return string_list_find_elem_prefix(
-         core->supported_extensions_list, ".", path_get_extension(path));
-}
-
-/* qsort_r() is not in standard C, sadly. */
-
-static int core_info_qsort_cmp(const void *a_, const void *b_)
-{
-   const core_info_t *a = (const core_info_t*)a_;
-   const core_info_t *b = (const core_info_t*)b_;
-   int support_a        = core_info_does_support_file(a, core_info_tmp_path);
-   int support_b        = core_info_does_support_file(b, core_info_tmp_path);
-#ifdef HAVE_COMPRESSION
-   support_a            = support_a ||
-      core_info_does_support_any_file(a, core_info_tmp_list);
-   support_b            = support_b ||
-      core_info_does_support_any_file(b, core_info_tmp_list);
-#endif
-
-   if (support_a != support_b)
-      return support_b - support_a;
-   return strcasecmp(a->display_name, b->display_name);
-}
-
-static core_info_t *core_info_find_internal(
-      core_info_list_t *list,
-      const char *core)
-{
-   size_t i;
-   const char *core_path_basename = path_basename(core);
-
-   for (i = 0; i < list->count; i++)
-   {
-      core_info_t *info = core_info_get(list, i);
-
-      if (!info || !info->path)
-         continue;
-      if (string_is_equal(path_basename(info->path), core_path_basename))
-         return info;
-   }
-
-   return NULL;
+   *out_info = *info;
+   return true;
 }
 
 static bool core_info_list_update_missing_firmware_internal(
@@ -653,12 +1238,13 @@ void core_info_deinit_list(void)
 }
 
 bool core_info_init_list(const char *path_info, const char *dir_cores,
-      const char *exts, bool dir_show_hidden_files)
+      const char *exts, bool dir_show_hidden_files, const char *path_cache)
 {
    if (!(core_info_curr_list = core_info_list_new(dir_cores,
                !string_is_empty(path_info) ? path_info : dir_cores,
                exts,
-               dir_show_hidden_files)))
+               dir_show_hidden_files,
+               path_cache)))
       return false;
    return true;
 }
@@ -730,8 +1316,10 @@ core_info_t *core_info_get(core_info_list_t *list, size_t i)
 void core_info_list_get_supported_cores(core_info_list_t *core_info_list,
       const char *path, const core_info_t **infos, size_t *num_infos)
 {
-   size_t i;
+   size_t i, n;
    size_t supported         = 0;
+   bool *is_supported       = NULL;
+   core_info_t *sorted      = NULL;
 #ifdef HAVE_COMPRESSION
    struct string_list *list = NULL;
 #endif
@@ -739,41 +1327,62 @@ void core_info_list_get_supported_cores(core_info_list_t *core_info_list,
    if (!core_info_list)
       return;
 
-   core_info_tmp_path = path;
+   *infos     = core_info_list->list;
+   *num_infos = 0;
 
-#ifdef HAVE_COMPRESSION
-   if (path_is_compressed_file(path))
-      list = file_archive_get_file_list(path, NULL);
-   core_info_tmp_list = list;
-#endif
+   if (!core_info_list->count)
+      return;
 
-   /* Let supported core come first in list so we can return
-    * a pointer to them. */
-   qsort(core_info_list->list, core_info_list->count,
-         sizeof(core_info_t), core_info_qsort_cmp);
+   is_supported = (bool*)calloc(core_info_list->count, sizeof(*is_supported));
+   sorted       = (core_info_t*)malloc(
+         core_info_list->count * sizeof(*sorted));
 
-   for (i = 0; i < core_info_list->count; i++, supported++)
-   {
-      const core_info_t *core = &core_info_list->list[i];
+   if (!is_supported || !sorted)
+      goto end;
 
-      if (core_info_does_support_file(core, path))
-         continue;
+   if (!string_is_empty(path))
+      core_info_list_mark_extension(core_info_list,
+            path_get_extension(path), is_supported);
 
 #ifdef HAVE_COMPRESSION
-      if (core_info_does_support_any_file(core, list))
-         continue;
-#endif
-
-      break;
-   }
+   if (path_is_compressed_file(path))
+      list = file_archive_get_file_list(path, NULL);
 
-#ifdef HAVE_COMPRESSION
    if (list)
+   {
+      for (i = 0; i < list->size; i++)
+         core_info_list_mark_extension(core_info_list,
+               path_get_extension(list->elems[i].data), is_supported);
       string_list_free(list);
+   }
 #endif
 
-   *infos     = core_info_list->list;
+   /* Let supported core come first in list so we can return
+    * a pointer to them. Both parts are sorted by display name. */
+   for (i = 0; i < core_info_list->count; i++)
+      if (is_supported[i])
+         sorted[supported++] = core_info_list->list[i];
+   for (i = 0, n = supported; i < core_info_list->count; i++)
+      if (!is_supported[i])
+         sorted[n++] = core_info_list->list[i];
+
+   qsort(sorted, supported, sizeof(core_info_t),
+         (int (*)(const void *, const void *))
+         core_info_qsort_func_display_name);
+   qsort(sorted + supported, core_info_list->count - supported,
+         sizeof(core_info_t),
+         (int (*)(const void *, const void *))
+         core_info_qsort_func_display_name);
+
+   memcpy(core_info_list->list, sorted,
+         core_info_list->count * sizeof(*sorted));
+   core_info_list_build_indexes(core_info_list);
+
    *num_infos = supported;
+
+end:
+   free(is_supported);
+   free(sorted);
 }
 
 void core_info_get_name(const char *path, char *s, size_t len,
@@ -830,11 +1439,7 @@ size_t core_info_list_num_info_files(core_info_list_t *core_info_list)
       return 0;
 
    for (i = 0; i < core_info_list->count; i++)
-   {
-      config_file_t *conf = (config_file_t*)
-         core_info_list->list[i].config_data;
-      num += !!conf;
-   }
+      num += core_info_list->list[i].has_info;
 
    return num;
 }
@@ -857,17 +1462,17 @@ bool core_info_database_match_archive_member(const char *database_path)
    if (core_info_curr_list)
    {
       size_t i;
+      const core_info_index_entry_t *entry = core_info_index_find(
+            core_info_curr_list->database_index, database);
 
-      for (i = 0; i < core_info_curr_list->count; i++)
+      for (i = 0; entry && i < entry->count; i++)
       {
-         const core_info_t *info = &core_info_curr_list->list[i];
+         const core_info_t *info = &core_info_curr_list->list[
+            entry->cores[i]];
 
          if (!info->database_match_archive_member)
              continue;
 
-         if (!string_list_find_elem(info->databases_list, database))
-             continue;
-
          free(database);
          return true;
       }
@@ -897,19 +1502,13 @@ bool core_info_database_supports_content_path(
 
    if (core_info_curr_list)
    {
-      size_t i;
+      const core_info_index_entry_t *databases = core_info_index_find(
+            core_info_curr_list->database_index, database);
+      const core_info_index_entry_t *exts      = core_info_index_find(
+            core_info_curr_list->ext_index, path_get_extension(path));
 
-      for (i = 0; i < core_info_curr_list->count; i++)
+      if (databases && exts && core_info_index_intersects(databases, exts))
       {
-         const core_info_t *info = &core_info_curr_list->list[i];
-
-         if (!string_list_find_elem(info->supported_extensions_list,
-                  path_get_extension(path)))
-            continue;
-
-         if (!string_list_find_elem(info->databases_list, database))
-            continue;
-
          free(database);
          return true;
       }
@@ -924,26 +1523,18 @@ error:
 bool core_info_list_get_display_name(core_info_list_t *core_info_list,
       const char *path, char *s, size_t len)
 {
-   size_t i;
+   const core_info_t *info = NULL;
 
    if (!core_info_list)
       return false;
 
-   for (i = 0; i < core_info_list->count; i++)
-   {
-      const core_info_t *info = &core_info_list->list[i];
-
-      if (!string_is_equal(path_basename(info->path), path_basename(path)))
-         continue;
+   info = core_info_find_internal(core_info_list, path);
 
-      if (!info->display_name)
-         continue;
-
-      strlcpy(s, info->display_name, len);
-      return true;
-   }
+   if (!info || !info->display_name)
+      return false;
 
-   return false;
+   strlcpy(s, info->display_name, len);
+   return true;
 }
 
 bool core_info_get_display_name(const char *path, char *s, size_t len)
@@ -1054,6 +1645,8 @@ void core_info_qsort(core_info_list_t *core_info_list,
       default:
          return;
    }
+
+   core_info_list_build_indexes(core_info_list);
 }
 
 static bool core_info_compare_api_version(int sys_major, int sys_minor, int major, int minor, enum compare_op op)
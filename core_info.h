@@ -39,9 +39,10 @@ typedef struct
 {
    bool supports_no_game;
    bool database_match_archive_member;
+   /* Whether a .info file was found for the core */
+   bool has_info;
    size_t firmware_count;
    char *path;
-   void *config_data;
    char *display_name;
    char *display_version;
    char *core_name;
@@ -68,11 +69,17 @@ typedef struct
    void *userdata;
 } core_info_t;
 
+struct core_info_index;
+
 typedef struct
 {
    core_info_t *list;
    size_t count;
    char *all_ext;
+   /* Core file name, extension and database name to cores */
+   struct core_info_index *path_index;
+   struct core_info_index *ext_index;
+   struct core_info_index *database_index;
 } core_info_list_t;
 
 typedef struct core_info_ctx_firmware
@@ -124,8 +131,9 @@ bool core_info_get_current_core(core_info_t **core);
 
 void core_info_deinit_list(void);
 
+/* @path_cache is where the parsed core info is cached, NULL to disable. */
 bool core_info_init_list(const char *path_info, const char *dir_cores,
-      const char *exts, bool show_hidden_files);
+      const char *exts, bool show_hidden_files, const char *path_cache);
 
 bool core_info_get_list(core_info_list_t **core);
 
@@ -157,6 +157,49 @@ static bool gl1_raster_font_upload_atlas(gl1_raster_t *font)
    return true;
 }
 
+/* Uploads only the part of the atlas the font renderer
+ * reported as changed, falling back to a full upload. */
+static bool gl1_raster_font_update_atlas(gl1_raster_t *font)
+{
+   unsigned i, j;
+   uint8_t       *tmp                   = NULL;
+   struct font_atlas *atlas             = font->atlas;
+
+   if (     !atlas->dirty_width
+         || !atlas->dirty_height
+         || atlas->dirty_x + atlas->dirty_width  > atlas->width
+         || atlas->dirty_y + atlas->dirty_height > atlas->height)
+      return gl1_raster_font_upload_atlas(font);
+
+   tmp = (uint8_t*)malloc(atlas->dirty_width * atlas->dirty_height * 2);
+
+   if (!tmp)
+      return gl1_raster_font_upload_atlas(font);
+
+   for (i = 0; i < atlas->dirty_height; ++i)
+   {
+      const uint8_t *src = &atlas->buffer[
+         (atlas->dirty_y + i) * atlas->width + atlas->dirty_x];
+      uint8_t       *dst = &tmp[i * atlas->dirty_width * 2];
+
+      for (j = 0; j < atlas->dirty_width; ++j)
+      {
+         *dst++ = 0xff;
+         *dst++ = *src++;
+      }
+   }
+
+   glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+   glTexSubImage2D(GL_TEXTURE_2D, 0, atlas->dirty_x, atlas->dirty_y,
+         atlas->dirty_width, atlas->dirty_height,
+         GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, tmp);
+   glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+   free(tmp);
+
+   return true;
+}
+
 static void *gl1_raster_font_init_font(void *data,
       const char *font_path, float font_size,
       bool is_threaded)
@@ -247,7 +290,7 @@ static void gl1_raster_font_draw_vertices(gl1_raster_t *font,
 {
    if (font->atlas->dirty)
    {
-      gl1_raster_font_upload_atlas(font);
+      gl1_raster_font_update_atlas(font);
       font->atlas->dirty   = false;
    }
 
@@ -24,14 +24,15 @@
 
 #include "../common/gl_core_common.h"
 #include "../font_driver.h"
+#include "../font_glyph_run.h"
 #include "../../retroarch.h"
 #include "../../verbosity.h"
 
 /* TODO: Move viewport side effects to the caller: it's a source of bugs. */
 
 #define gl_core_raster_font_emit(c, vx, vy) do { \
-   font_vertex[     2 * (6 * i + c) + 0] = (x + (delta_x + off_x + vx * width) * scale) * inv_win_width; \
-   font_vertex[     2 * (6 * i + c) + 1] = (y + (delta_y - off_y - vy * height) * scale) * inv_win_height; \
+   font_vertex[     2 * (6 * i + c) + 0] = (x + (off_x + vx * width) * scale) * inv_win_width; \
+   font_vertex[     2 * (6 * i + c) + 1] = (y + (-off_y - vy * height) * scale) * inv_win_height; \
    font_tex_coords[ 2 * (6 * i + c) + 0] = (tex_x + vx * width) * inv_tex_size_x; \
    font_tex_coords[ 2 * (6 * i + c) + 1] = (tex_y + vy * height) * inv_tex_size_y; \
    font_color[      4 * (6 * i + c) + 0] = color[0]; \
@@ -50,6 +51,7 @@ typedef struct
    const font_renderer_driver_t *font_driver;
    void *font_data;
    struct font_atlas *atlas;
+   font_glyph_run_cache_t *runs;
 
    video_font_raster_block_t *block;
 } gl_core_raster_t;
@@ -61,6 +63,8 @@ static void gl_core_raster_font_free_font(void *data,
    if (!font)
       return;
 
+   font_glyph_run_cache_free(font->runs);
+
    if (font->font_driver && font->font_data)
       font->font_driver->free(font->font_data);
 
@@ -98,6 +102,32 @@ static bool gl_core_raster_font_upload_atlas(gl_core_raster_t *font)
    return true;
 }
 
+/* Uploads only the part of the atlas the font renderer
+ * reported as changed, falling back to a full upload. */
+static bool gl_core_raster_font_update_atlas(gl_core_raster_t *font)
+{
+   struct font_atlas *atlas = font->atlas;
+
+   if (     !font->tex
+         || !atlas->dirty_width
+         || !atlas->dirty_height
+         || atlas->dirty_x + atlas->dirty_width  > atlas->width
+         || atlas->dirty_y + atlas->dirty_height > atlas->height)
+      return gl_core_raster_font_upload_atlas(font);
+
+   glBindTexture(GL_TEXTURE_2D, font->tex);
+   glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+   glPixelStorei(GL_UNPACK_ROW_LENGTH, atlas->width);
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+   glTexSubImage2D(GL_TEXTURE_2D, 0, atlas->dirty_x, atlas->dirty_y,
+                   atlas->dirty_width, atlas->dirty_height, GL_RED, GL_UNSIGNED_BYTE,
+                   atlas->buffer + atlas->dirty_y * atlas->width + atlas->dirty_x);
+   glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+   glBindTexture(GL_TEXTURE_2D, 0);
+
+   return true;
+}
+
 static void *gl_core_raster_font_init_font(void *data,
       const char *font_path, float font_size,
       bool is_threaded)
@@ -126,6 +156,8 @@ static void *gl_core_raster_font_init_font(void *data,
          font->gl->ctx_driver->make_current(false);
 
    font->atlas      = font->font_driver->get_atlas(font->font_data);
+   font->runs       = font_glyph_run_cache_new(
+         font->font_driver, font->font_data);
 
    if (!gl_core_raster_font_upload_atlas(font))
       goto error;
@@ -141,9 +173,8 @@ error:
 static int gl_core_get_message_width(void *data, const char *msg,
       unsigned msg_len, float scale)
 {
-   gl_core_raster_t *font   = (gl_core_raster_t*)data;
-   const char* msg_end = msg + msg_len;
-   int delta_x         = 0;
+   const font_glyph_run_t *run = NULL;
+   gl_core_raster_t *font      = (gl_core_raster_t*)data;
 
    if (     !font
          || !font->font_driver
@@ -151,21 +182,10 @@ static int gl_core_get_message_width(void *data, const char *msg,
          || !font->font_data )
       return 0;
 
-   while (msg < msg_end)
-   {
-      unsigned code                  = utf8_walk(&msg);
-      const struct font_glyph *glyph = font->font_driver->get_glyph(
-            font->font_data, code);
-
-      if (!glyph) /* Do something smarter here ... */
-         glyph = font->font_driver->get_glyph(font->font_data, '?');
-      if (!glyph)
-         continue;
-
-      delta_x += glyph->advance_x;
-   }
+   if (!(run = font_glyph_run_cache_get(font->runs, msg, msg_len)))
+      return 0;
 
-   return delta_x * scale;
+   return run->width * scale;
 }
 
 static void gl_core_raster_font_draw_vertices(gl_core_raster_t *font,
@@ -174,7 +194,7 @@ static void gl_core_raster_font_draw_vertices(gl_core_raster_t *font,
 {
    if (font->atlas->dirty)
    {
-      gl_core_raster_font_upload_atlas(font);
+      gl_core_raster_font_update_atlas(font);
       font->atlas->dirty   = false;
    }
 
@@ -215,16 +235,13 @@ static void gl_core_raster_font_render_line(
       video_frame_info_t *video_info)
 {
    unsigned i;
+   float key[FONT_GLYPH_RUN_KEY_SIZE]      = {0};
    struct video_coords coords;
-   GLfloat font_tex_coords[2 * 6 * MAX_MSG_LEN_CHUNK];
-   GLfloat font_vertex[2 * 6 * MAX_MSG_LEN_CHUNK];
-   GLfloat font_color[4 * 6 * MAX_MSG_LEN_CHUNK];
+   const font_glyph_run_coords_t *cached = NULL;
+   font_glyph_run_t *run                 = NULL;
    gl_core_t *gl        = font->gl;
-   const char* msg_end  = msg + msg_len;
    int x                = roundf(pos_x * gl->vp.width);
    int y                = roundf(pos_y * gl->vp.height);
-   int delta_x          = 0;
-   int delta_y          = 0;
    float inv_tex_size_x = 1.0f / font->atlas->width;
    float inv_tex_size_y = 1.0f / font->atlas->height;
    float inv_win_width  = 1.0f / font->gl->vp.width;
@@ -240,28 +257,47 @@ static void gl_core_raster_font_render_line(
          break;
    }
 
-   while (msg < msg_end)
+   if (!(run = font_glyph_run_cache_get(font->runs, msg, msg_len)))
+      return;
+
+   /* Everything the vertices below depend on */
+   key[0]               = x;
+   key[1]               = y;
+   key[2]               = scale;
+   key[3]               = inv_tex_size_x;
+   key[4]               = inv_tex_size_y;
+   key[5]               = inv_win_width;
+   key[6]               = inv_win_height;
+   key[7]               = color[0];
+   key[8]               = color[1];
+   key[9]               = color[2];
+   key[10]              = color[3];
+
+   /* Static labels reuse the vertices built last frame */
+   if (!(cached = font_glyph_run_find_coords(run, key)))
    {
-      i = 0;
-      while ((i < MAX_MSG_LEN_CHUNK) && (msg < msg_end))
-      {
-         int off_x, off_y, tex_x, tex_y, width, height;
-         unsigned                  code = utf8_walk(&msg);
-         const struct font_glyph *glyph = font->font_driver->get_glyph(
-               font->font_data, code);
+      font_glyph_run_coords_t *cached_new = font_glyph_run_alloc_coords(
+            run, key);
+      GLfloat *font_tex_coords            = NULL;
+      GLfloat *font_vertex                = NULL;
+      GLfloat *font_color                 = NULL;
 
-         if (!glyph) /* Do something smarter here ... */
-            glyph = font->font_driver->get_glyph(font->font_data, '?');
+      if (!cached_new)
+         return;
 
-         if (!glyph)
-            continue;
+      font_tex_coords = cached_new->tex_coord;
+      font_vertex     = cached_new->vertex;
+      font_color      = cached_new->color;
 
-         off_x  = glyph->draw_offset_x;
-         off_y  = glyph->draw_offset_y;
-         tex_x  = glyph->atlas_offset_x;
-         tex_y  = glyph->atlas_offset_y;
-         width  = glyph->width;
-         height = glyph->height;
+      for (i = 0; i < run->count; i++)
+      {
+         const struct font_glyph *glyph = &run->glyphs[i];
+         int off_x                      = glyph->draw_offset_x;
+         int off_y                      = glyph->draw_offset_y;
+         int tex_x                      = glyph->atlas_offset_x;
+         int tex_y                      = glyph->atlas_offset_y;
+         int width                      = glyph->width;
+         int height                     = glyph->height;
 
          gl_core_raster_font_emit(0, 0, 1); /* Bottom-left */
          gl_core_raster_font_emit(1, 1, 1); /* Bottom-right */
@@ -270,18 +306,20 @@ static void gl_core_raster_font_render_line(
          gl_core_raster_font_emit(3, 1, 0); /* Top-right */
          gl_core_raster_font_emit(4, 0, 0); /* Top-left */
          gl_core_raster_font_emit(5, 1, 1); /* Bottom-right */
+      }
 
-         i++;
+      cached = cached_new;
+   }
 
-         delta_x += glyph->advance_x;
-         delta_y -= glyph->advance_y;
-      }
+   for (i = 0; i < run->count; i += MAX_MSG_LEN_CHUNK)
+   {
+      unsigned count       = MIN(run->count - i, MAX_MSG_LEN_CHUNK);
 
-      coords.tex_coord     = font_tex_coords;
-      coords.vertex        = font_vertex;
-      coords.color         = font_color;
-      coords.vertices      = i * 6;
-      coords.lut_tex_coord = font_tex_coords;
+      coords.tex_coord     = cached->tex_coord     + 2 * 6 * i;
+      coords.vertex        = cached->vertex        + 2 * 6 * i;
+      coords.color         = cached->color         + 4 * 6 * i;
+      coords.vertices      = count * 6;
+      coords.lut_tex_coord = cached->tex_coord     + 2 * 6 * i;
 
       if (font->block)
          video_coord_array_append(&font->block->carr, &coords, coords.vertices);
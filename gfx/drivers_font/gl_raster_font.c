@@ -23,14 +23,15 @@
 
 #include "../common/gl_common.h"
 #include "../font_driver.h"
+#include "../font_glyph_run.h"
 #include "../../retroarch.h"
 #include "../../verbosity.h"
 
 /* TODO: Move viewport side effects to the caller: it's a source of bugs. */
 
 #define gl_raster_font_emit(c, vx, vy) do { \
-   font_vertex[     2 * (6 * i + c) + 0] = (x + (delta_x + off_x + vx * width) * scale) * inv_win_width; \
-   font_vertex[     2 * (6 * i + c) + 1] = (y + (delta_y - off_y - vy * height) * scale) * inv_win_height; \
+   font_vertex[     2 * (6 * i + c) + 0] = (x + (off_x + vx * width) * scale) * inv_win_width; \
+   font_vertex[     2 * (6 * i + c) + 1] = (y + (-off_y - vy * height) * scale) * inv_win_height; \
    font_tex_coords[ 2 * (6 * i + c) + 0] = (tex_x + vx * width) * inv_tex_size_x; \
    font_tex_coords[ 2 * (6 * i + c) + 1] = (tex_y + vy * height) * inv_tex_size_y; \
    font_color[      4 * (6 * i + c) + 0] = color[0]; \
@@ -52,6 +53,7 @@ typedef struct
    const font_renderer_driver_t *font_driver;
    void *font_data;
    struct font_atlas *atlas;
+   font_glyph_run_cache_t *runs;
 
    video_font_raster_block_t *block;
 } gl_raster_t;
@@ -63,6 +65,8 @@ static void gl_raster_font_free_font(void *data,
    if (!font)
       return;
 
+   font_glyph_run_cache_free(font->runs);
+
    if (font->font_driver && font->font_data)
       font->font_driver->free(font->font_data);
 
@@ -119,56 +123,78 @@ static bool gl_raster_font_upload_atlas_components_4(gl_raster_t *font)
 }
 #endif
 
-static bool gl_raster_font_upload_atlas(gl_raster_t *font)
+static size_t gl_raster_font_atlas_format(gl_raster_t *font,
+      GLint *gl_internal, GLenum *gl_format)
+{
+#if defined(GL_VERSION_3_0)
+   struct retro_hw_render_callback *hwr = video_driver_get_hw_context();
+
+   if (font->gl->core_context_in_use ||
+         (hwr->context_type == RETRO_HW_CONTEXT_OPENGL &&
+          hwr->version_major >= 3))
+   {
+      *gl_internal = GL_R8;
+      *gl_format   = GL_RED;
+      return 1;
+   }
+#endif
+
+   *gl_internal = GL_LUMINANCE_ALPHA;
+   *gl_format   = GL_LUMINANCE_ALPHA;
+   return 2;
+}
+
+static void gl_raster_font_convert_atlas(gl_raster_t *font,
+      uint8_t *dst, size_t dst_stride, size_t ncomponents,
+      unsigned x, unsigned y, unsigned width, unsigned height)
 {
    unsigned i, j;
+
+   for (i = 0; i < height; ++i)
+   {
+      const uint8_t *src = &font->atlas->buffer[
+         (y + i) * font->atlas->width + x];
+      uint8_t       *out = &dst[i * dst_stride];
+
+      switch (ncomponents)
+      {
+         case 1:
+            memcpy(out, src, width);
+            break;
+         case 2:
+            for (j = 0; j < width; ++j)
+            {
+               *out++ = 0xff;
+               *out++ = *src++;
+            }
+            break;
+      }
+   }
+}
+
+static bool gl_raster_font_upload_atlas(gl_raster_t *font)
+{
    GLint  gl_internal                   = GL_LUMINANCE_ALPHA;
    GLenum gl_format                     = GL_LUMINANCE_ALPHA;
-   size_t ncomponents                   = 2;
+   size_t ncomponents                   = gl_raster_font_atlas_format(
+         font, &gl_internal, &gl_format);
    uint8_t       *tmp                   = NULL;
-#if defined(GL_VERSION_3_0)
-   struct retro_hw_render_callback *hwr = video_driver_get_hw_context();
 
-    if (font->gl->core_context_in_use ||
-        (hwr->context_type == RETRO_HW_CONTEXT_OPENGL &&
-         hwr->version_major >= 3))
+#if defined(GL_VERSION_3_0)
+   if (ncomponents == 1)
    {
       GLint swizzle[] = { GL_ONE, GL_ONE, GL_ONE, GL_RED };
       glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
-
-      gl_internal = GL_R8;
-      gl_format   = GL_RED;
-      ncomponents = 1;
    }
 #endif
 
    tmp = (uint8_t*)calloc(font->tex_height, font->tex_width * ncomponents);
 
-   switch (ncomponents)
-   {
-      case 1:
-         for (i = 0; i < font->atlas->height; ++i)
-         {
-            const uint8_t *src = &font->atlas->buffer[i * font->atlas->width];
-            uint8_t       *dst = &tmp[i * font->tex_width * ncomponents];
-
-            memcpy(dst, src, font->atlas->width);
-         }
-         break;
-      case 2:
-         for (i = 0; i < font->atlas->height; ++i)
-         {
-            const uint8_t *src = &font->atlas->buffer[i * font->atlas->width];
-            uint8_t       *dst = &tmp[i * font->tex_width * ncomponents];
+   if (!tmp)
+      return false;
 
-            for (j = 0; j < font->atlas->width; ++j)
-            {
-               *dst++ = 0xff;
-               *dst++ = *src++;
-            }
-         }
-         break;
-   }
+   gl_raster_font_convert_atlas(font, tmp, font->tex_width * ncomponents,
+         ncomponents, 0, 0, font->atlas->width, font->atlas->height);
 
    glTexImage2D(GL_TEXTURE_2D, 0, gl_internal, font->tex_width, font->tex_height,
          0, gl_format, GL_UNSIGNED_BYTE, tmp);
@@ -178,6 +204,44 @@ static bool gl_raster_font_upload_atlas(gl_raster_t *font)
    return true;
 }
 
+/* Uploads only the part of the atlas the font renderer
+ * reported as changed, falling back to a full upload. */
+static bool gl_raster_font_update_atlas(gl_raster_t *font)
+{
+   GLint  gl_internal                   = GL_LUMINANCE_ALPHA;
+   GLenum gl_format                     = GL_LUMINANCE_ALPHA;
+   size_t ncomponents                   = 0;
+   uint8_t       *tmp                   = NULL;
+   struct font_atlas *atlas             = font->atlas;
+
+   if (     !atlas->dirty_width
+         || !atlas->dirty_height
+         || atlas->dirty_x + atlas->dirty_width  > atlas->width
+         || atlas->dirty_y + atlas->dirty_height > atlas->height)
+      return gl_raster_font_upload_atlas(font);
+
+   ncomponents = gl_raster_font_atlas_format(font, &gl_internal, &gl_format);
+   tmp         = (uint8_t*)malloc(
+         atlas->dirty_width * atlas->dirty_height * ncomponents);
+
+   if (!tmp)
+      return gl_raster_font_upload_atlas(font);
+
+   gl_raster_font_convert_atlas(font, tmp, atlas->dirty_width * ncomponents,
+         ncomponents, atlas->dirty_x, atlas->dirty_y,
+         atlas->dirty_width, atlas->dirty_height);
+
+   glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+   glTexSubImage2D(GL_TEXTURE_2D, 0, atlas->dirty_x, atlas->dirty_y,
+         atlas->dirty_width, atlas->dirty_height,
+         gl_format, GL_UNSIGNED_BYTE, tmp);
+   glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+   free(tmp);
+
+   return true;
+}
+
 static void *gl_raster_font_init_font(void *data,
       const char *font_path, float font_size,
       bool is_threaded)
@@ -210,6 +274,8 @@ static void *gl_raster_font_init_font(void *data,
    gl_bind_texture(font->tex, GL_CLAMP_TO_EDGE, GL_LINEAR, GL_LINEAR);
 
    font->atlas      = font->font_driver->get_atlas(font->font_data);
+   font->runs       = font_glyph_run_cache_new(
+         font->font_driver, font->font_data);
    font->tex_width  = next_pow2(font->atlas->width);
    font->tex_height = next_pow2(font->atlas->height);
 
@@ -232,9 +298,8 @@ error:
 static int gl_get_message_width(void *data, const char *msg,
       unsigned msg_len, float scale)
 {
-   gl_raster_t *font   = (gl_raster_t*)data;
-   const char* msg_end = msg + msg_len;
-   int delta_x         = 0;
+   const font_glyph_run_t *run = NULL;
+   gl_raster_t *font           = (gl_raster_t*)data;
 
    if (     !font
          || !font->font_driver
@@ -242,21 +307,10 @@ static int gl_get_message_width(void *data, const char *msg,
          || !font->font_data )
       return 0;
 
-   while (msg < msg_end)
-   {
-      unsigned code                  = utf8_walk(&msg);
-      const struct font_glyph *glyph = font->font_driver->get_glyph(
-            font->font_data, code);
-
-      if (!glyph) /* Do something smarter here ... */
-         glyph = font->font_driver->get_glyph(font->font_data, '?');
-      if (!glyph)
-         continue;
-
-      delta_x += glyph->advance_x;
-   }
+   if (!(run = font_glyph_run_cache_get(font->runs, msg, msg_len)))
+      return 0;
 
-   return delta_x * scale;
+   return run->width * scale;
 }
 
 static void gl_raster_font_draw_vertices(gl_raster_t *font,
@@ -265,7 +319,7 @@ static void gl_raster_font_draw_vertices(gl_raster_t *font,
 {
    if (font->atlas->dirty)
    {
-      gl_raster_font_upload_atlas(font);
+      gl_raster_font_update_atlas(font);
       font->atlas->dirty   = false;
    }
 
@@ -283,17 +337,13 @@ static void gl_raster_font_render_line(
       video_frame_info_t *video_info)
 {
    unsigned i;
+   float key[FONT_GLYPH_RUN_KEY_SIZE]      = {0};
    struct video_coords coords;
-   GLfloat font_tex_coords[2 * 6 * MAX_MSG_LEN_CHUNK];
-   GLfloat font_vertex[2 * 6 * MAX_MSG_LEN_CHUNK];
-   GLfloat font_color[4 * 6 * MAX_MSG_LEN_CHUNK];
-   GLfloat font_lut_tex_coord[2 * 6 * MAX_MSG_LEN_CHUNK];
+   const font_glyph_run_coords_t *cached = NULL;
+   font_glyph_run_t *run                 = NULL;
    gl_t      *gl        = font->gl;
-   const char* msg_end  = msg + msg_len;
    int x                = roundf(pos_x * gl->vp.width);
    int y                = roundf(pos_y * gl->vp.height);
-   int delta_x          = 0;
-   int delta_y          = 0;
    float inv_tex_size_x = 1.0f / font->tex_width;
    float inv_tex_size_y = 1.0f / font->tex_height;
    float inv_win_width  = 1.0f / font->gl->vp.width;
@@ -309,28 +359,51 @@ static void gl_raster_font_render_line(
          break;
    }
 
-   while (msg < msg_end)
+   if (!(run = font_glyph_run_cache_get(font->runs, msg, msg_len)))
+      return;
+
+   /* Everything the vertices below depend on */
+   key[0]               = x;
+   key[1]               = y;
+   key[2]               = scale;
+   key[3]               = inv_tex_size_x;
+   key[4]               = inv_tex_size_y;
+   key[5]               = inv_win_width;
+   key[6]               = inv_win_height;
+   key[7]               = color[0];
+   key[8]               = color[1];
+   key[9]               = color[2];
+   key[10]              = color[3];
+   key[11]              = gl->coords.lut_tex_coord[0];
+   key[12]              = gl->coords.lut_tex_coord[1];
+
+   /* Static labels reuse the vertices built last frame */
+   if (!(cached = font_glyph_run_find_coords(run, key)))
    {
-      i = 0;
-      while ((i < MAX_MSG_LEN_CHUNK) && (msg < msg_end))
+      font_glyph_run_coords_t *cached_new = font_glyph_run_alloc_coords(
+            run, key);
+      GLfloat *font_tex_coords            = NULL;
+      GLfloat *font_vertex                = NULL;
+      GLfloat *font_color                 = NULL;
+      GLfloat *font_lut_tex_coord         = NULL;
+
+      if (!cached_new)
+         return;
+
+      font_tex_coords    = cached_new->tex_coord;
+      font_vertex        = cached_new->vertex;
+      font_color         = cached_new->color;
+      font_lut_tex_coord = cached_new->lut_tex_coord;
+
+      for (i = 0; i < run->count; i++)
       {
-         int off_x, off_y, tex_x, tex_y, width, height;
-         unsigned                  code = utf8_walk(&msg);
-         const struct font_glyph *glyph = font->font_driver->get_glyph(
-               font->font_data, code);
-
-         if (!glyph) /* Do something smarter here ... */
-            glyph = font->font_driver->get_glyph(font->font_data, '?');
-
-         if (!glyph)
-            continue;
-
-         off_x  = glyph->draw_offset_x;
-         off_y  = glyph->draw_offset_y;
-         tex_x  = glyph->atlas_offset_x;
-         tex_y  = glyph->atlas_offset_y;
-         width  = glyph->width;
-         height = glyph->height;
+         const struct font_glyph *glyph = &run->glyphs[i];
+         int off_x                      = glyph->draw_offset_x;
+         int off_y                      = glyph->draw_offset_y;
+         int tex_x                      = glyph->atlas_offset_x;
+         int tex_y                      = glyph->atlas_offset_y;
+         int width                      = glyph->width;
+         int height                     = glyph->height;
 
          gl_raster_font_emit(0, 0, 1); /* Bottom-left */
          gl_raster_font_emit(1, 1, 1); /* Bottom-right */
@@ -339,18 +412,20 @@ static void gl_raster_font_render_line(
          gl_raster_font_emit(3, 1, 0); /* Top-right */
          gl_raster_font_emit(4, 0, 0); /* Top-left */
          gl_raster_font_emit(5, 1, 1); /* Bottom-right */
+      }
 
-         i++;
+      cached = cached_new;
+   }
 
-         delta_x += glyph->advance_x;
-         delta_y -= glyph->advance_y;
-      }
+   for (i = 0; i < run->count; i += MAX_MSG_LEN_CHUNK)
+   {
+      unsigned count       = MIN(run->count - i, MAX_MSG_LEN_CHUNK);
 
-      coords.tex_coord     = font_tex_coords;
-      coords.vertex        = font_vertex;
-      coords.color         = font_color;
-      coords.vertices      = i * 6;
-      coords.lut_tex_coord = font_lut_tex_coord;
+      coords.tex_coord     = cached->tex_coord     + 2 * 6 * i;
+      coords.vertex        = cached->vertex        + 2 * 6 * i;
+      coords.color         = cached->color         + 4 * 6 * i;
+      coords.vertices      = count * 6;
+      coords.lut_tex_coord = cached->lut_tex_coord + 2 * 6 * i;
 
       if (font->block)
          video_coord_array_append(&font->block->carr, &coords, coords.vertices);
@@ -109,11 +109,26 @@ static INLINE void vulkan_raster_font_update_glyph(vulkan_raster_t *font, const
    if(font->atlas->dirty)
    {
       unsigned row;
-      for (row = glyph->atlas_offset_y; row < (glyph->atlas_offset_y + glyph->height); row++)
+      unsigned x      = glyph->atlas_offset_x;
+      unsigned y      = glyph->atlas_offset_y;
+      unsigned width  = glyph->width;
+      unsigned height = glyph->height;
+
+      /* Renderers tracking the changed region may have
+       * touched more than this glyph since the last update */
+      if (font->atlas->dirty_width)
       {
-         uint8_t *src = font->atlas->buffer + row * font->atlas->width + glyph->atlas_offset_x;
-         uint8_t *dst = (uint8_t*)font->texture.mapped + row * font->texture.stride + glyph->atlas_offset_x;
-         memcpy(dst, src, glyph->width);
+         x      = font->atlas->dirty_x;
+         y      = font->atlas->dirty_y;
+         width  = font->atlas->dirty_width;
+         height = font->atlas->dirty_height;
+      }
+
+      for (row = y; row < (y + height); row++)
+      {
+         uint8_t *src = font->atlas->buffer + row * font->atlas->width + x;
+         uint8_t *dst = (uint8_t*)font->texture.mapped + row * font->texture.stride + x;
+         memcpy(dst, src, width);
       }
 
       font->atlas->dirty = false;
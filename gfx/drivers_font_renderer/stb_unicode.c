@@ -40,15 +40,46 @@
 
 #define STB_UNICODE_ATLAS_ROWS 16
 #define STB_UNICODE_ATLAS_COLS 16
-#define STB_UNICODE_ATLAS_SIZE (STB_UNICODE_ATLAS_ROWS * STB_UNICODE_ATLAS_COLS)
+
+/* Glyphs are packed on shelves, so many more than
+ * ROWS * COLS glyphs usually fit in the atlas. */
+#define STB_UNICODE_MAX_SLOTS  1024
+#define STB_UNICODE_MAP_BITS   10
+#define STB_UNICODE_MAP_SIZE   (1 << STB_UNICODE_MAP_BITS)
+
+/* Shelf heights are rounded up to 1/8th of the maximum
+ * glyph height, which gives this many size classes. */
+#define STB_UNICODE_SHELF_STEPS   8
+#define STB_UNICODE_SHELF_CLASSES (STB_UNICODE_SHELF_STEPS + 2)
+
+/* How many glyphs to evict looking for a fitting
+ * hole before starting over with an empty atlas. */
+#define STB_UNICODE_EVICT_TRIES 32
 
 typedef struct stb_unicode_atlas_slot
 {
    struct font_glyph glyph;
-   unsigned charcode;
-   unsigned last_used;
-   struct stb_unicode_atlas_slot* next;
-}stb_unicode_atlas_slot_t;
+   uint32_t charcode;
+
+   /* Atlas area owned by this slot, padding included.
+    * Empty glyphs (e.g. space) don't own any. */
+   unsigned x, y, w, h;
+   unsigned shelf_class;
+
+   struct stb_unicode_atlas_slot *map_next;
+   /* LRU list while cached, otherwise the free or unused list */
+   struct stb_unicode_atlas_slot *prev;
+   struct stb_unicode_atlas_slot *next;
+} stb_unicode_atlas_slot_t;
+
+typedef struct
+{
+   unsigned x;       /* First free column of the open shelf */
+   unsigned y;       /* Top of the open shelf */
+   bool open;
+   /* Evicted slots keeping their atlas area, for reuse */
+   stb_unicode_atlas_slot_t *free_list;
+} stb_unicode_shelf_class_t;
 
 typedef struct
 {
@@ -61,9 +92,18 @@ typedef struct
    float scale_factor;
 
    struct font_atlas atlas;
-   stb_unicode_atlas_slot_t atlas_slots[STB_UNICODE_ATLAS_SIZE];
-   stb_unicode_atlas_slot_t* uc_map[0x100];
-   unsigned usage_counter;
+
+   unsigned shelf_step;
+   unsigned next_shelf_y;
+   stb_unicode_shelf_class_t shelf_classes[STB_UNICODE_SHELF_CLASSES];
+
+   /* Most recently used first */
+   stb_unicode_atlas_slot_t *lru_head;
+   stb_unicode_atlas_slot_t *lru_tail;
+   stb_unicode_atlas_slot_t *unused;
+
+   stb_unicode_atlas_slot_t atlas_slots[STB_UNICODE_MAX_SLOTS];
+   stb_unicode_atlas_slot_t *uc_map[STB_UNICODE_MAP_SIZE];
 } stb_unicode_font_renderer_t;
 
 /* Ugly little thing... */
@@ -73,6 +113,11 @@ static int INLINE round_away_from_zero(float f)
    return (int)round;
 }
 
+static INLINE unsigned font_renderer_stb_unicode_hash(uint32_t charcode)
+{
+   return (charcode * 2654435761U) >> (32 - STB_UNICODE_MAP_BITS);
+}
+
 static struct font_atlas *font_renderer_stb_unicode_get_atlas(void *data)
 {
    stb_unicode_font_renderer_t *self = (stb_unicode_font_renderer_t*)data;
@@ -88,29 +133,246 @@ static void font_renderer_stb_unicode_free(void *data)
    free(self);
 }
 
-static stb_unicode_atlas_slot_t* font_renderer_stb_unicode_get_slot(stb_unicode_font_renderer_t *handle)
+static void font_renderer_stb_unicode_mark_dirty(
+      stb_unicode_font_renderer_t *self,
+      unsigned x, unsigned y, unsigned w, unsigned h)
+{
+   struct font_atlas *atlas = &self->atlas;
+
+   if (!atlas->dirty || !atlas->dirty_width)
+   {
+      /* A dirty atlas without a region is dirty as a whole */
+      if (atlas->dirty)
+         return;
+
+      atlas->dirty        = true;
+      atlas->dirty_x      = x;
+      atlas->dirty_y      = y;
+      atlas->dirty_width  = w;
+      atlas->dirty_height = h;
+      return;
+   }
+
+   {
+      unsigned x1 = MAX(atlas->dirty_x + atlas->dirty_width,  x + w);
+      unsigned y1 = MAX(atlas->dirty_y + atlas->dirty_height, y + h);
+
+      atlas->dirty_x      = MIN(atlas->dirty_x, x);
+      atlas->dirty_y      = MIN(atlas->dirty_y, y);
+      atlas->dirty_width  = x1 - atlas->dirty_x;
+      atlas->dirty_height = y1 - atlas->dirty_y;
+   }
+}
+
+static void font_renderer_stb_unicode_lru_unlink(
+      stb_unicode_font_renderer_t *self, stb_unicode_atlas_slot_t *slot)
+{
+   if (slot->prev)
+      slot->prev->next = slot->next;
+   else
+      self->lru_head   = slot->next;
+
+   if (slot->next)
+      slot->next->prev = slot->prev;
+   else
+      self->lru_tail   = slot->prev;
+
+   slot->prev = NULL;
+   slot->next = NULL;
+}
+
+static void font_renderer_stb_unicode_lru_push(
+      stb_unicode_font_renderer_t *self, stb_unicode_atlas_slot_t *slot)
+{
+   slot->prev = NULL;
+   slot->next = self->lru_head;
+
+   if (self->lru_head)
+      self->lru_head->prev = slot;
+   else
+      self->lru_tail       = slot;
+
+   self->lru_head = slot;
+}
+
+static void font_renderer_stb_unicode_map_remove(
+      stb_unicode_font_renderer_t *self, stb_unicode_atlas_slot_t *slot)
+{
+   stb_unicode_atlas_slot_t **ptr = &self->uc_map[
+      font_renderer_stb_unicode_hash(slot->charcode)];
+
+   while (*ptr && *ptr != slot)
+      ptr = &(*ptr)->map_next;
+
+   if (*ptr)
+      *ptr = slot->map_next;
+   slot->map_next = NULL;
+}
+
+/* Drops every glyph and starts packing from scratch. */
+static void font_renderer_stb_unicode_reset_atlas(
+      stb_unicode_font_renderer_t *self)
+{
+   unsigned i;
+
+   memset(self->uc_map, 0, sizeof(self->uc_map));
+   memset(self->shelf_classes, 0, sizeof(self->shelf_classes));
+
+   self->lru_head     = NULL;
+   self->lru_tail     = NULL;
+   self->unused       = NULL;
+   self->next_shelf_y = 0;
+
+   for (i = STB_UNICODE_MAX_SLOTS; i-- > 0; )
+   {
+      stb_unicode_atlas_slot_t *slot = &self->atlas_slots[i];
+      slot->w        = 0;
+      slot->h        = 0;
+      slot->map_next = NULL;
+      slot->prev     = NULL;
+      slot->next     = self->unused;
+      self->unused   = slot;
+   }
+
+   memset(self->atlas.buffer, 0, self->atlas.width * self->atlas.height);
+
+   self->atlas.generation++;
+   self->atlas.dirty        = true;
+   self->atlas.dirty_x      = 0;
+   self->atlas.dirty_y      = 0;
+   self->atlas.dirty_width  = self->atlas.width;
+   self->atlas.dirty_height = self->atlas.height;
+}
+
+/* Moves the least recently used glyph out of the cache,
+ * its atlas area goes to the free list of its shelf class. */
+static bool font_renderer_stb_unicode_evict(
+      stb_unicode_font_renderer_t *self)
+{
+   stb_unicode_atlas_slot_t *slot = self->lru_tail;
+
+   if (!slot)
+      return false;
+
+   font_renderer_stb_unicode_lru_unlink(self, slot);
+   font_renderer_stb_unicode_map_remove(self, slot);
+   self->atlas.generation++;
+
+   if (slot->w)
+   {
+      stb_unicode_shelf_class_t *sc =
+         &self->shelf_classes[slot->shelf_class];
+      slot->next    = sc->free_list;
+      sc->free_list = slot;
+   }
+   else
+   {
+      slot->next    = self->unused;
+      self->unused  = slot;
+   }
+
+   return true;
+}
+
+/* Finds room for a w x h glyph (padding included),
+ * without evicting anything. */
+static stb_unicode_atlas_slot_t *font_renderer_stb_unicode_alloc(
+      stb_unicode_font_renderer_t *self, unsigned w, unsigned h)
 {
-   int i, map_id;
-   unsigned oldest = 0;
-
-   for (i = 1; i < STB_UNICODE_ATLAS_SIZE; i++)
-      if((handle->usage_counter - handle->atlas_slots[i].last_used) >
-         (handle->usage_counter - handle->atlas_slots[oldest].last_used))
-         oldest = i;
-
-   /* remove from map */
-   map_id = handle->atlas_slots[oldest].charcode & 0xFF;
-   if(handle->uc_map[map_id] == &handle->atlas_slots[oldest])
-      handle->uc_map[map_id] = handle->atlas_slots[oldest].next;
-   else if (handle->uc_map[map_id])
+   unsigned i, shelf_class, shelf_height;
+   stb_unicode_shelf_class_t *sc  = NULL;
+   stb_unicode_atlas_slot_t *slot = NULL;
+
+   if (!w || !h)
    {
-      stb_unicode_atlas_slot_t* ptr = handle->uc_map[map_id];
-      while(ptr->next && ptr->next != &handle->atlas_slots[oldest])
-         ptr = ptr->next;
-      ptr->next = handle->atlas_slots[oldest].next;
+      if ((slot = self->unused))
+      {
+         self->unused = slot->next;
+         return slot;
+      }
+
+      /* Borrow any free area, it returns to its
+       * free list once this glyph is evicted */
+      for (i = 0; i < STB_UNICODE_SHELF_CLASSES; i++)
+      {
+         if ((slot = self->shelf_classes[i].free_list))
+         {
+            self->shelf_classes[i].free_list = slot->next;
+            return slot;
+         }
+      }
+      return NULL;
+   }
+
+   shelf_class  = (h + self->shelf_step - 1) / self->shelf_step;
+   if (shelf_class >= STB_UNICODE_SHELF_CLASSES)
+      shelf_class = STB_UNICODE_SHELF_CLASSES - 1;
+   shelf_height = shelf_class * self->shelf_step;
+   sc           = &self->shelf_classes[shelf_class];
+
+   /* Reuse the area of an evicted glyph, preferring
+    * the same class so the taller shelves stay free */
+   for (i = shelf_class; i < STB_UNICODE_SHELF_CLASSES; i++)
+   {
+      stb_unicode_atlas_slot_t **ptr = &self->shelf_classes[i].free_list;
+
+      while (*ptr)
+      {
+         if ((*ptr)->w >= w)
+         {
+            slot = *ptr;
+            *ptr = slot->next;
+            return slot;
+         }
+         ptr = &(*ptr)->next;
+      }
+   }
+
+   if (!self->unused)
+      return NULL;
+
+   /* Open a new shelf when the current one is full */
+   if (!sc->open || sc->x + w > self->atlas.width)
+   {
+      if (self->next_shelf_y + shelf_height > self->atlas.height)
+         return NULL;
+
+      sc->open           = true;
+      sc->x              = 0;
+      sc->y              = self->next_shelf_y;
+      self->next_shelf_y += shelf_height;
    }
 
-   return &handle->atlas_slots[oldest];
+   slot              = self->unused;
+   self->unused      = slot->next;
+   slot->x           = sc->x;
+   slot->y           = sc->y;
+   slot->w           = w;
+   slot->h           = shelf_height;
+   slot->shelf_class = shelf_class;
+   sc->x            += w;
+
+   return slot;
+}
+
+static stb_unicode_atlas_slot_t* font_renderer_stb_unicode_get_slot(
+      stb_unicode_font_renderer_t *handle, unsigned w, unsigned h)
+{
+   unsigned tries;
+   stb_unicode_atlas_slot_t *slot = NULL;
+
+   for (tries = 0; ; tries++)
+   {
+      if ((slot = font_renderer_stb_unicode_alloc(handle, w, h)))
+         return slot;
+
+      if (     tries >= STB_UNICODE_EVICT_TRIES
+            || !font_renderer_stb_unicode_evict(handle))
+         break;
+   }
+
+   font_renderer_stb_unicode_reset_atlas(handle);
+   return font_renderer_stb_unicode_alloc(handle, w, h);
 }
 
 static const struct font_glyph *font_renderer_stb_unicode_get_glyph(
@@ -118,75 +380,97 @@ static const struct font_glyph *font_renderer_stb_unicode_get_glyph(
 {
    int glyph_index                      = 0;
    int x0                               = 0;
+   int y0                               = 0;
+   int x1                               = 0;
    int y1                               = 0;
    int advance_width                    = 0;
    int left_side_bearing                = 0;
+   unsigned width                       = 0;
+   unsigned height                      = 0;
    unsigned map_id                      = 0;
-   uint8_t *dst                         = NULL;
    stb_unicode_atlas_slot_t* atlas_slot = NULL;
    stb_unicode_font_renderer_t *self    = (stb_unicode_font_renderer_t*)data;
 
    if(!self)
       return NULL;
 
-   map_id                               = charcode & 0xFF;
+   map_id                               = font_renderer_stb_unicode_hash(charcode);
    atlas_slot                           = self->uc_map[map_id];
 
    while(atlas_slot)
    {
       if(atlas_slot->charcode == charcode)
       {
-         atlas_slot->last_used = self->usage_counter++;
+         if (self->lru_head != atlas_slot)
+         {
+            font_renderer_stb_unicode_lru_unlink(self, atlas_slot);
+            font_renderer_stb_unicode_lru_push(self, atlas_slot);
+         }
          return &atlas_slot->glyph;
       }
-      atlas_slot = atlas_slot->next;
+      atlas_slot = atlas_slot->map_next;
    }
 
-   atlas_slot             = font_renderer_stb_unicode_get_slot(self);
-   atlas_slot->charcode   = charcode;
-   atlas_slot->next       = self->uc_map[map_id];
-   self->uc_map[map_id] = atlas_slot;
-
    glyph_index              = stbtt_FindGlyphIndex(&self->info, charcode);
 
-   dst = (uint8_t*)self->atlas.buffer + atlas_slot->glyph.atlas_offset_x
-         + atlas_slot->glyph.atlas_offset_y * self->atlas.width;
-
    stbtt_GetGlyphHMetrics(&self->info, glyph_index, &advance_width, &left_side_bearing);
-   if (stbtt_GetGlyphBox(&self->info, glyph_index, &x0, NULL, NULL, &y1))
+
+   /* stbtt_MakeGlyphBitmap() fills empty glyphs with garbage,
+    * so those don't get any atlas area at all */
+   if (stbtt_GetGlyphBox(&self->info, glyph_index, NULL, NULL, NULL, NULL))
    {
-      stbtt_MakeGlyphBitmap(&self->info, dst, self->max_glyph_width, self->max_glyph_height,
-            self->atlas.width, self->scale_factor, self->scale_factor, glyph_index);
+      stbtt_GetGlyphBitmapBox(&self->info, glyph_index,
+            self->scale_factor, self->scale_factor, &x0, &y0, &x1, &y1);
+      width  = MIN(x1 - x0, self->max_glyph_width);
+      height = MIN(y1 - y0, self->max_glyph_height);
    }
-   else
+
+   /* One texel of padding keeps neighbours out of filtered samples */
+   atlas_slot = font_renderer_stb_unicode_get_slot(self,
+         width  ? width  + 1 : 0,
+         height ? height + 1 : 0);
+
+   if (!atlas_slot)
+      return NULL;
+
+   atlas_slot->charcode     = charcode;
+   atlas_slot->map_next     = self->uc_map[map_id];
+   self->uc_map[map_id]     = atlas_slot;
+   font_renderer_stb_unicode_lru_push(self, atlas_slot);
+
+   if (width && height)
    {
-      /* This means the glyph is empty. In this case, stbtt_MakeGlyphBitmap()
-       * fills the corresponding region of the atlas buffer with garbage,
-       * so just zero it */
-      int x, y;
-      for (x = 0; x < self->max_glyph_width; x++)
-         for (y = 0; y < self->max_glyph_height; y++)
-            dst[x + (y * self->atlas.width)] = 0;
+      unsigned y;
+      uint8_t *dst = (uint8_t*)self->atlas.buffer + atlas_slot->x
+            + atlas_slot->y * self->atlas.width;
+
+      /* Reused areas still hold the previous glyph */
+      for (y = 0; y < atlas_slot->h; y++)
+         memset(dst + y * self->atlas.width, 0, atlas_slot->w);
+
+      stbtt_MakeGlyphBitmap(&self->info, dst, width, height,
+            self->atlas.width, self->scale_factor, self->scale_factor, glyph_index);
+
+      font_renderer_stb_unicode_mark_dirty(self,
+            atlas_slot->x, atlas_slot->y, atlas_slot->w, atlas_slot->h);
    }
 
-   atlas_slot->glyph.width          = self->max_glyph_width;
-   atlas_slot->glyph.height         = self->max_glyph_height;
+   atlas_slot->glyph.width          = width;
+   atlas_slot->glyph.height         = height;
+   atlas_slot->glyph.atlas_offset_x = atlas_slot->x;
+   atlas_slot->glyph.atlas_offset_y = atlas_slot->y;
    atlas_slot->glyph.advance_x      = round_away_from_zero((float)advance_width * self->scale_factor);
    atlas_slot->glyph.advance_y      = 0;
-   atlas_slot->glyph.draw_offset_x  = round_away_from_zero((float)x0 * self->scale_factor);
-   atlas_slot->glyph.draw_offset_y  = round_away_from_zero((float)(-y1) * self->scale_factor);
+   atlas_slot->glyph.draw_offset_x  = x0;
+   atlas_slot->glyph.draw_offset_y  = y0;
 
-   self->atlas.dirty = true;
-   atlas_slot->last_used = self->usage_counter++;
    return &atlas_slot->glyph;
-
 }
 
 static bool font_renderer_stb_unicode_create_atlas(
       stb_unicode_font_renderer_t *self, float font_size)
 {
-   unsigned i, x, y;
-   stb_unicode_atlas_slot_t* slot = NULL;
+   unsigned i;
 
    self->max_glyph_width  = font_size < 0 ? -font_size : font_size;
    self->max_glyph_height = font_size < 0 ? -font_size : font_size;
@@ -200,17 +484,12 @@ static bool font_renderer_stb_unicode_create_atlas(
    if (!self->atlas.buffer)
       return false;
 
-   slot = self->atlas_slots;
+   self->shelf_step       = (self->max_glyph_height + 1
+         + STB_UNICODE_SHELF_STEPS - 1) / STB_UNICODE_SHELF_STEPS;
+   if (self->shelf_step < 1)
+      self->shelf_step    = 1;
 
-   for (y = 0; y < STB_UNICODE_ATLAS_ROWS; y++)
-   {
-      for (x = 0; x < STB_UNICODE_ATLAS_COLS; x++)
-      {
-         slot->glyph.atlas_offset_x = x * self->max_glyph_width;
-         slot->glyph.atlas_offset_y = y * self->max_glyph_height;
-         slot++;
-      }
-   }
+   font_renderer_stb_unicode_reset_atlas(self);
 
    for (i = 0; i < 256; i++)
       font_renderer_stb_unicode_get_glyph(self, i);
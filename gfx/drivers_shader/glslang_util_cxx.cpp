@@ -15,15 +15,29 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include <string>
 #include <sstream>
 #include <algorithm>
+#include <atomic>
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
 
 #include <retro_miscellaneous.h>
 #include <file/file_path.h>
 #include <file/config_file.h>
+#include <lists/dir_list.h>
 #include <streams/file_stream.h>
 #include <string/stdstring.h>
+#include <encodings/crc32.h>
+#include <features/features_cpu.h>
+#include <rhash.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -33,9 +47,71 @@
 #include "glslang_util_cxx.h"
 #if defined(HAVE_GLSLANG)
 #include <glslang.hpp>
+#include <glslang/Include/revision.h>
 #endif
+#include "../../configuration.h"
+#include "../../paths.h"
 #include "../../verbosity.h"
 
+/* SPIR-V cache file: header, then the vertex and fragment SPIR-V.
+ * Bump the version whenever the way sources are built or compiled changes
+ * without the sources themselves changing. */
+#define GLSLANG_CACHE_MAGIC   0x43565053 /* "SPVC" */
+#define GLSLANG_CACHE_VERSION 2
+
+/* Loads only refresh an entry's last use time once this many seconds
+ * have passed, so that a hit doesn't always cost a write. */
+#define GLSLANG_CACHE_TOUCH_INTERVAL 3600
+
+struct glslang_cache_header
+{
+   uint32_t magic;
+   uint32_t version;
+   uint32_t vertex_words;
+   uint32_t fragment_words;
+   uint32_t crc;
+   /* time() of the last compile that used the entry */
+   uint32_t last_used;
+};
+
+/* Upper bound on worker threads used by glslang_parallel_for. */
+#define GLSLANG_MAX_THREADS 16
+
+#ifdef HAVE_THREADS
+struct glslang_parallel_state
+{
+   const std::function<bool(unsigned)> *func;
+   slock_t *lock;
+   unsigned next;
+   unsigned count;
+   bool ok;
+};
+
+static void glslang_parallel_worker(void *data)
+{
+   glslang_parallel_state *state = (glslang_parallel_state*)data;
+
+   for (;;)
+   {
+      unsigned index;
+
+      slock_lock(state->lock);
+      index = state->ok ? state->next++ : state->count;
+      slock_unlock(state->lock);
+
+      if (index >= state->count)
+         break;
+
+      if (!(*state->func)(index))
+      {
+         slock_lock(state->lock);
+         state->ok = false;
+         slock_unlock(state->lock);
+      }
+   }
+}
+#endif
+
 static std::string build_stage_source(
       const struct string_list *lines, const char *stage)
 {
@@ -220,36 +296,286 @@ bool glslang_parse_meta(const struct string_list *lines, glslang_meta *meta)
    return true;
 }
 
+#if defined(HAVE_GLSLANG)
+/* Where the SPIR-V for these sources is cached, named after a hash of the
+ * fully expanded sources and the compiler version. */
+static bool glslang_cache_path(char *path, size_t size,
+      const std::string &vertex, const std::string &fragment)
+{
+   char hash[65];
+   char dir[PATH_MAX_LENGTH];
+   char key_prefix[64];
+   std::string key;
+   settings_t *settings = config_get_ptr();
+
+   if (     !settings
+         || !settings->bools.video_shader_spirv_cache
+         || !settings->uints.video_shader_spirv_cache_size)
+      return false;
+
+   if (!string_is_empty(settings->paths.directory_cache))
+      fill_pathname_join(dir, settings->paths.directory_cache, "slang",
+            sizeof(dir));
+   else if (!path_is_empty(RARCH_PATH_CONFIG))
+   {
+      char config_dir[PATH_MAX_LENGTH];
+      fill_pathname_basedir(config_dir, path_get(RARCH_PATH_CONFIG),
+            sizeof(config_dir));
+      fill_pathname_join(dir, config_dir, "cache", sizeof(dir));
+      fill_pathname_join(dir, dir, "slang", sizeof(dir));
+   }
+   else
+      return false;
+
+   snprintf(key_prefix, sizeof(key_prefix), "slang %u glslang %u\n",
+         (unsigned)GLSLANG_CACHE_VERSION, (unsigned)GLSLANG_PATCH_LEVEL);
+
+   key.reserve(strlen(key_prefix) + vertex.size() + fragment.size() + 1);
+   key += key_prefix;
+   key += vertex;
+   key += '\0';
+   key += fragment;
+
+   sha256_hash(hash, (const uint8_t*)key.data(), key.size());
+
+   fill_pathname_join(path, dir, hash, size);
+   strlcat(path, ".spv", size);
+   return true;
+}
+
+/* Limit on the total size of the SPIR-V cache, in bytes. */
+static uint64_t glslang_cache_max_size(void)
+{
+   settings_t *settings = config_get_ptr();
+   return (uint64_t)settings->uints.video_shader_spirv_cache_size
+      * 1024 * 1024;
+}
+
+static void glslang_cache_touch(const char *path,
+      struct glslang_cache_header *header)
+{
+   RFILE *file;
+   uint32_t now = (uint32_t)time(NULL);
+
+   if (now - header->last_used < GLSLANG_CACHE_TOUCH_INTERVAL)
+      return;
+
+   file = filestream_open(path,
+         RETRO_VFS_FILE_ACCESS_READ_WRITE | RETRO_VFS_FILE_ACCESS_UPDATE_EXISTING,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+   if (!file)
+      return;
+
+   header->last_used = now;
+   filestream_write(file, header, sizeof(*header));
+   filestream_close(file);
+}
+
+/* Drops the least recently used entries until the cache, including
+ * the entry at @keep, fits in the size limit. */
+static void glslang_cache_evict(const char *dir, const char *keep)
+{
+   size_t i;
+   uint64_t total           = 0;
+   uint64_t max_size        = glslang_cache_max_size();
+   std::vector<uint64_t> sizes;
+   std::vector<uint32_t> last_used;
+   struct string_list *list = dir_list_new(dir, "spv",
+         false, false, false, false);
+
+   if (!list)
+      return;
+
+   sizes.resize(list->size);
+   last_used.resize(list->size);
+
+   for (i = 0; i < list->size; i++)
+   {
+      struct glslang_cache_header header;
+      RFILE *file = filestream_open(list->elems[i].data,
+            RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+      if (!file)
+         continue;
+
+      sizes[i] = (uint64_t)filestream_get_size(file);
+      if (     filestream_read(file, &header, sizeof(header)) == sizeof(header)
+            && header.magic   == GLSLANG_CACHE_MAGIC
+            && header.version == GLSLANG_CACHE_VERSION)
+         last_used[i] = header.last_used;
+      filestream_close(file);
+
+      /* The entry just written goes last */
+      if (string_is_equal(list->elems[i].data, keep))
+         last_used[i] = (uint32_t)-1;
+
+      total += sizes[i];
+   }
+
+   while (total > max_size)
+   {
+      size_t oldest = 0;
+
+      for (i = 1; i < list->size; i++)
+         if (sizes[i] && (!sizes[oldest] || last_used[i] < last_used[oldest]))
+            oldest = i;
+
+      if (!sizes[oldest] || last_used[oldest] == (uint32_t)-1)
+         break;
+
+      filestream_delete(list->elems[oldest].data);
+      total        -= sizes[oldest];
+      sizes[oldest] = 0;
+   }
+
+   string_list_free(list);
+}
+
+static bool glslang_cache_load(const char *path, glslang_output *output)
+{
+   struct glslang_cache_header header;
+   void *buf          = NULL;
+   int64_t len        = 0;
+   const uint32_t *words;
+   size_t total;
+
+   if (!path_is_valid(path) || !filestream_read_file(path, &buf, &len))
+      return false;
+
+   if ((size_t)len < sizeof(header))
+      goto error;
+
+   memcpy(&header, buf, sizeof(header));
+   total = (size_t)header.vertex_words + header.fragment_words;
+
+   if (     header.magic   != GLSLANG_CACHE_MAGIC
+         || header.version != GLSLANG_CACHE_VERSION
+         || !header.vertex_words || !header.fragment_words
+         || (size_t)len != sizeof(header) + total * sizeof(uint32_t))
+      goto error;
+
+   words = (const uint32_t*)((const uint8_t*)buf + sizeof(header));
+   if (encoding_crc32(0, (const uint8_t*)words,
+            total * sizeof(uint32_t)) != header.crc)
+      goto error;
+
+   output->vertex.assign(words, words + header.vertex_words);
+   output->fragment.assign(words + header.vertex_words, words + total);
+
+   free(buf);
+   glslang_cache_touch(path, &header);
+   return true;
+
+error:
+   RARCH_WARN("[slang]: Ignoring invalid SPIR-V cache file \"%s\".\n", path);
+   free(buf);
+   return false;
+}
+
+static void glslang_cache_save(const char *path, const glslang_output *output)
+{
+   static std::atomic<unsigned> tmp_counter(0);
+   char dir[PATH_MAX_LENGTH];
+   char tmp_path[PATH_MAX_LENGTH + 32];
+   struct glslang_cache_header header;
+   std::vector<uint32_t> data;
+   size_t header_words = sizeof(header) / sizeof(uint32_t);
+
+   fill_pathname_basedir(dir, path, sizeof(dir));
+   if (!path_is_directory(dir) && !path_mkdir(dir))
+      return;
+
+   data.resize(header_words);
+   data.insert(data.end(), output->vertex.begin(), output->vertex.end());
+   data.insert(data.end(), output->fragment.begin(), output->fragment.end());
+
+   header.magic          = GLSLANG_CACHE_MAGIC;
+   header.version        = GLSLANG_CACHE_VERSION;
+   header.vertex_words   = (uint32_t)output->vertex.size();
+   header.fragment_words = (uint32_t)output->fragment.size();
+   header.crc            = encoding_crc32(0,
+         (const uint8_t*)(data.data() + header_words),
+         (data.size() - header_words) * sizeof(uint32_t));
+   header.last_used      = (uint32_t)time(NULL);
+   memcpy(data.data(), &header, sizeof(header));
+
+   /* Write then rename, so that a concurrent load never sees half a file.
+    * The temporary name is unique to this process and call, since passes
+    * are compiled in parallel, possibly by several instances at once. */
+#ifdef _WIN32
+   snprintf(tmp_path, sizeof(tmp_path), "%s.%u.%u.tmp", path,
+         (unsigned)_getpid(), tmp_counter++);
+#else
+   snprintf(tmp_path, sizeof(tmp_path), "%s.%u.%u.tmp", path,
+         (unsigned)getpid(), tmp_counter++);
+#endif
+
+   if (!filestream_write_file(tmp_path, data.data(),
+            data.size() * sizeof(uint32_t)))
+      return;
+
+   filestream_delete(path);
+   if (filestream_rename(tmp_path, path) != 0)
+   {
+      filestream_delete(tmp_path);
+      return;
+   }
+
+   glslang_cache_evict(dir, path);
+}
+#endif
+
 bool glslang_compile_shader(const char *shader_path, glslang_output *output)
 {
 #if defined(HAVE_GLSLANG)
+   char cache_path[PATH_MAX_LENGTH];
+   std::string vertex_source, fragment_source;
+   bool cache_enabled        = false;
    struct string_list *lines = string_list_new();
 
    if (!lines)
       return false;
 
-   RARCH_LOG("[slang]: Compiling shader \"%s\".\n", shader_path);
-
    if (!glslang_read_shader_file(shader_path, lines, true))
       goto error;
    output->meta = glslang_meta{};
+   output->vertex.clear();
+   output->fragment.clear();
    if (!glslang_parse_meta(lines, &output->meta))
       goto error;
 
-   if (    !glslang::compile_spirv(build_stage_source(lines, "vertex"),
+   vertex_source   = build_stage_source(lines, "vertex");
+   fragment_source = build_stage_source(lines, "fragment");
+
+   cache_enabled = glslang_cache_path(cache_path, sizeof(cache_path),
+         vertex_source, fragment_source);
+
+   if (cache_enabled && glslang_cache_load(cache_path, output))
+   {
+      RARCH_LOG("[slang]: Loaded cached SPIR-V for \"%s\".\n", shader_path);
+      string_list_free(lines);
+      return true;
+   }
+
+   RARCH_LOG("[slang]: Compiling shader \"%s\".\n", shader_path);
+
+   if (    !glslang::compile_spirv(vertex_source,
             glslang::StageVertex, &output->vertex))
    {
       RARCH_ERR("Failed to compile vertex shader stage.\n");
       goto error;
    }
 
-   if (    !glslang::compile_spirv(build_stage_source(lines, "fragment"),
+   if (    !glslang::compile_spirv(fragment_source,
             glslang::StageFragment, &output->fragment))
    {
       RARCH_ERR("Failed to compile fragment shader stage.\n");
       goto error;
    }
 
+   if (cache_enabled)
+      glslang_cache_save(cache_path, output);
+
    string_list_free(lines);
 
    return true;
@@ -262,3 +588,59 @@ error:
 
    return false;
 }
+
+/**
+ * glslang_parallel_for:
+ * @count             : Number of jobs.
+ * @func              : Job function, called once with each index
+ *                      in [0, @count).
+ *
+ * Spreads the jobs over up to one thread per core, the calling thread
+ * included, and waits for all of them. Jobs are started in index order,
+ * but may finish in any order, so @func must only touch state belonging
+ * to its own index. Once a job fails, no new ones are started.
+ *
+ * Returns: true if every job succeeded, otherwise false.
+ **/
+bool glslang_parallel_for(unsigned count,
+      const std::function<bool(unsigned)> &func)
+{
+   unsigned i;
+#ifdef HAVE_THREADS
+   sthread_t *threads[GLSLANG_MAX_THREADS];
+   glslang_parallel_state state;
+   unsigned num_threads = cpu_features_get_core_amount();
+
+   if (num_threads > count)
+      num_threads = count;
+   if (num_threads > GLSLANG_MAX_THREADS)
+      num_threads = GLSLANG_MAX_THREADS;
+
+   if (num_threads > 1 && (state.lock = slock_new()))
+   {
+      state.func  = &func;
+      state.next  = 0;
+      state.count = count;
+      state.ok    = true;
+
+      /* If a thread cannot be created, the others pick up its share. */
+      for (i = 1; i < num_threads; i++)
+         threads[i] = sthread_create(glslang_parallel_worker, &state);
+
+      glslang_parallel_worker(&state);
+
+      for (i = 1; i < num_threads; i++)
+         if (threads[i])
+            sthread_join(threads[i]);
+
+      slock_free(state.lock);
+      return state.ok;
+   }
+#endif
+
+   for (i = 0; i < count; i++)
+      if (!func(i))
+         return false;
+
+   return true;
+}
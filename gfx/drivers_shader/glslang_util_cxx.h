@@ -23,6 +23,7 @@
 
 #include <vector>
 #include <string>
+#include <functional>
 
 struct glslang_parameter
 {
@@ -55,6 +56,11 @@ struct glslang_output
 
 bool glslang_compile_shader(const char *shader_path, glslang_output *output);
 
+/* Runs func(0) .. func(count - 1) on a few worker threads.
+ * Used to compile and reflect the passes of a preset in parallel. */
+bool glslang_parallel_for(unsigned count,
+      const std::function<bool(unsigned)> &func);
+
 /* Helpers for internal use. */
 bool glslang_parse_meta(const struct string_list *lines, glslang_meta *meta);
 
@@ -27,6 +27,7 @@
 #include <compat/strl.h>
 #include <formats/image.h>
 #include <retro_miscellaneous.h>
+#include <features/features_cpu.h>
 
 #include "slang_reflection.h"
 #include "slang_reflection.hpp"
@@ -940,6 +941,7 @@ public:
                    const uint32_t *spirv,
                    size_t spirv_words);
 
+   bool reflect();
    bool build();
    bool init_feedback();
 
@@ -1084,19 +1086,12 @@ private:
    void reflect_parameter_array(const std::string &name, std::vector<slang_texture_semantic_meta> &meta);
 };
 
-bool Pass::build()
+bool Pass::reflect()
 {
    unordered_map<string, slang_semantic_map> semantic_map;
    unsigned i;
    unsigned j = 0;
 
-   framebuffer.reset();
-   framebuffer_feedback.reset();
-
-   if (!final_pass)
-      framebuffer = unique_ptr<Framebuffer>(
-            new Framebuffer(pass_info.rt_format, pass_info.max_levels));
-
    for (i = 0; i < parameters.size(); i++)
    {
       if (!gl_core_shader_set_unique_map(semantic_map, parameters[i].id,
@@ -1124,6 +1119,18 @@ bool Pass::build()
          filtered_parameters.push_back(parameters[i]);
    }
 
+   return true;
+}
+
+bool Pass::build()
+{
+   framebuffer.reset();
+   framebuffer_feedback.reset();
+
+   if (!final_pass)
+      framebuffer = unique_ptr<Framebuffer>(
+            new Framebuffer(pass_info.rt_format, pass_info.max_levels));
+
    if (!init_pipeline())
       return false;
 
@@ -2210,6 +2217,12 @@ bool gl_core_filter_chain::init()
    if (!init_alias())
       return false;
 
+   if (!glslang_parallel_for(passes.size(), [&](unsigned index) -> bool
+         {
+            return passes[index]->reflect();
+         }))
+      return false;
+
    for (i = 0; i < passes.size(); i++)
    {
       RARCH_LOG("[slang]: Building pass #%u (%s)\n", i,
@@ -2424,9 +2437,30 @@ gl_core_filter_chain_t *gl_core_filter_chain_create_from_preset(
 
    shader->num_parameters = 0;
 
+   /* Compile every pass up front, in parallel; the results are consumed
+    * in pass order below. */
+   vector<glslang_output> outputs(shader->passes);
+   retro_time_t start = cpu_features_get_time_usec();
+
+   if (!glslang_parallel_for(shader->passes, [&](unsigned index) -> bool
+         {
+            if (!glslang_compile_shader(
+                     shader->pass[index].source.path, &outputs[index]))
+            {
+               RARCH_ERR("Failed to compile shader: \"%s\".\n",
+                     shader->pass[index].source.path);
+               return false;
+            }
+            return true;
+         }))
+      return nullptr;
+
+   RARCH_LOG("[slang]: Compiled %u passes in %.1f ms.\n", shader->passes,
+         (cpu_features_get_time_usec() - start) / 1000.0);
+
    for (i = 0; i < shader->passes; i++)
    {
-      glslang_output output;
+      glslang_output &output             = outputs[i];
       struct gl_core_filter_chain_pass_info pass_info;
       const video_shader_pass *pass      = &shader->pass[i];
       const video_shader_pass *next_pass =
@@ -2442,13 +2476,6 @@ gl_core_filter_chain_t *gl_core_filter_chain_create_from_preset(
       pass_info.address       = GL_CORE_FILTER_CHAIN_ADDRESS_REPEAT;
       pass_info.max_levels    = 0;
 
-      if (!glslang_compile_shader(pass->source.path, &output))
-      {
-         RARCH_ERR("Failed to compile shader: \"%s\".\n",
-               pass->source.path);
-         return nullptr;
-      }
-
       for (auto &meta_param : output.meta.parameters)
       {
          if (shader->num_parameters >= GFX_MAX_PARAMETERS)
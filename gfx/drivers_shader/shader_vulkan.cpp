@@ -27,6 +27,7 @@
 #include <compat/strl.h>
 #include <formats/image.h>
 #include <retro_miscellaneous.h>
+#include <features/features_cpu.h>
 
 #include "slang_reflection.h"
 #include "slang_reflection.hpp"
@@ -353,6 +354,7 @@ class Pass
             const uint32_t *spirv,
             size_t spirv_words);
 
+      bool reflect();
       bool build();
       bool init_feedback();
 
@@ -1092,6 +1094,12 @@ bool vulkan_filter_chain::init()
    if (!init_alias())
       return false;
 
+   if (!glslang_parallel_for(passes.size(), [&](unsigned index) -> bool
+         {
+            return passes[index]->reflect();
+         }))
+      return false;
+
    for (i = 0; i < passes.size(); i++)
    {
       const string name = passes[i]->get_name();
@@ -1972,21 +1980,12 @@ bool Pass::init_feedback()
    return true;
 }
 
-bool Pass::build()
+bool Pass::reflect()
 {
    unordered_map<string, slang_semantic_map> semantic_map;
    unsigned i;
    unsigned j = 0;
 
-   framebuffer.reset();
-   framebuffer_feedback.reset();
-
-   if (!final_pass)
-      framebuffer = unique_ptr<Framebuffer>(
-            new Framebuffer(device, memory_properties,
-               current_framebuffer_size,
-               pass_info.rt_format, pass_info.max_levels));
-
    for (i = 0; i < parameters.size(); i++)
    {
       if (!vk_shader_set_unique_map(semantic_map, parameters[i].id,
@@ -2014,6 +2013,20 @@ bool Pass::build()
          filtered_parameters.push_back(parameters[i]);
    }
 
+   return true;
+}
+
+bool Pass::build()
+{
+   framebuffer.reset();
+   framebuffer_feedback.reset();
+
+   if (!final_pass)
+      framebuffer = unique_ptr<Framebuffer>(
+            new Framebuffer(device, memory_properties,
+               current_framebuffer_size,
+               pass_info.rt_format, pass_info.max_levels));
+
    if (!init_pipeline())
       return false;
 
@@ -2907,9 +2920,30 @@ vulkan_filter_chain_t *vulkan_filter_chain_create_from_preset(
 
    shader->num_parameters = 0;
 
+   /* Compile every pass up front, in parallel; the results are consumed
+    * in pass order below. */
+   vector<glslang_output> outputs(shader->passes);
+   retro_time_t start = cpu_features_get_time_usec();
+
+   if (!glslang_parallel_for(shader->passes, [&](unsigned index) -> bool
+         {
+            if (!glslang_compile_shader(
+                     shader->pass[index].source.path, &outputs[index]))
+            {
+               RARCH_ERR("Failed to compile shader: \"%s\".\n",
+                     shader->pass[index].source.path);
+               return false;
+            }
+            return true;
+         }))
+      return nullptr;
+
+   RARCH_LOG("[slang]: Compiled %u passes in %.1f ms.\n", shader->passes,
+         (cpu_features_get_time_usec() - start) / 1000.0);
+
    for (i = 0; i < shader->passes; i++)
    {
-      glslang_output output;
+      glslang_output &output             = outputs[i];
       struct vulkan_filter_chain_pass_info pass_info;
       const video_shader_pass *pass      = &shader->pass[i];
       const video_shader_pass *next_pass =
@@ -2925,13 +2959,6 @@ vulkan_filter_chain_t *vulkan_filter_chain_create_from_preset(
       pass_info.address       = VULKAN_FILTER_CHAIN_ADDRESS_REPEAT;
       pass_info.max_levels    = 0;
 
-      if (!glslang_compile_shader(pass->source.path, &output))
-      {
-         RARCH_ERR("Failed to compile shader: \"%s\".\n",
-               pass->source.path);
-         return nullptr;
-      }
-
       for (auto &meta_param : output.meta.parameters)
       {
          if (shader->num_parameters >= GFX_MAX_PARAMETERS)
@@ -59,6 +59,18 @@ struct font_atlas
    unsigned width;
    unsigned height;
    bool dirty;
+
+   /* Region changed since the atlas was last uploaded.
+    * Only meaningful while dirty; a zero width means the
+    * whole atlas has to be uploaded again. */
+   unsigned dirty_x;
+   unsigned dirty_y;
+   unsigned dirty_width;
+   unsigned dirty_height;
+
+   /* Bumped whenever glyphs handed out before may have
+    * moved or been replaced, see font_glyph_run.c. */
+   unsigned generation;
 };
 
 struct font_params
@@ -0,0 +1,421 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <encodings/utf.h>
+
+#include "font_glyph_run.h"
+
+#define FONT_GLYPH_RUN_BUCKETS  256
+#define FONT_GLYPH_RUN_MAX      256
+
+/* Longer strings are laid out every time, they are
+ * rarely static and would crowd out the menu labels. */
+#define FONT_GLYPH_RUN_MAX_LEN  256
+
+typedef struct font_glyph_run_entry
+{
+   font_glyph_run_t run;
+   unsigned capacity;
+
+   char *msg;
+   unsigned msg_len;
+   uint32_t hash;
+   /* Atlas generation the glyphs were last checked against */
+   unsigned generation;
+
+   struct font_glyph_run_entry *map_next;
+   /* Most recently used first */
+   struct font_glyph_run_entry *prev;
+   struct font_glyph_run_entry *next;
+} font_glyph_run_entry_t;
+
+struct font_glyph_run_cache
+{
+   const font_renderer_driver_t *driver;
+   void *renderer_data;
+   struct font_atlas *atlas;
+
+   font_glyph_run_entry_t *buckets[FONT_GLYPH_RUN_BUCKETS];
+   font_glyph_run_entry_t *lru_head;
+   font_glyph_run_entry_t *lru_tail;
+   unsigned count;
+
+   /* Layout of the last uncached string */
+   font_glyph_run_entry_t scratch;
+};
+
+static uint32_t font_glyph_run_hash(const char *msg, unsigned msg_len)
+{
+   unsigned i;
+   uint32_t hash = 2166136261U;
+
+   for (i = 0; i < msg_len; i++)
+   {
+      hash ^= (uint8_t)msg[i];
+      hash *= 16777619U;
+   }
+
+   return hash;
+}
+
+static void font_glyph_run_coords_free(font_glyph_run_t *run)
+{
+   unsigned i;
+
+   for (i = 0; i < FONT_GLYPH_RUN_COORDS; i++)
+   {
+      free(run->coords[i].vertex);
+      run->coords[i].vertex        = NULL;
+      run->coords[i].tex_coord     = NULL;
+      run->coords[i].color         = NULL;
+      run->coords[i].lut_tex_coord = NULL;
+      run->coords[i].valid         = false;
+   }
+}
+
+static void font_glyph_run_entry_free(font_glyph_run_entry_t *entry)
+{
+   font_glyph_run_coords_free(&entry->run);
+   free(entry->run.glyphs);
+   free(entry->msg);
+}
+
+static void font_glyph_run_lru_unlink(font_glyph_run_cache_t *cache,
+      font_glyph_run_entry_t *entry)
+{
+   if (entry->prev)
+      entry->prev->next = entry->next;
+   else
+      cache->lru_head   = entry->next;
+
+   if (entry->next)
+      entry->next->prev = entry->prev;
+   else
+      cache->lru_tail   = entry->prev;
+
+   entry->prev = NULL;
+   entry->next = NULL;
+}
+
+static void font_glyph_run_lru_push(font_glyph_run_cache_t *cache,
+      font_glyph_run_entry_t *entry)
+{
+   entry->prev = NULL;
+   entry->next = cache->lru_head;
+
+   if (cache->lru_head)
+      cache->lru_head->prev = entry;
+   else
+      cache->lru_tail       = entry;
+
+   cache->lru_head = entry;
+}
+
+static void font_glyph_run_evict(font_glyph_run_cache_t *cache)
+{
+   font_glyph_run_entry_t  *entry = cache->lru_tail;
+   font_glyph_run_entry_t **ptr   = NULL;
+
+   if (!entry)
+      return;
+
+   font_glyph_run_lru_unlink(cache, entry);
+
+   ptr = &cache->buckets[entry->hash % FONT_GLYPH_RUN_BUCKETS];
+   while (*ptr && *ptr != entry)
+      ptr = &(*ptr)->map_next;
+   if (*ptr)
+      *ptr = entry->map_next;
+
+   font_glyph_run_entry_free(entry);
+   free(entry);
+   cache->count--;
+}
+
+static const struct font_glyph *font_glyph_run_get_glyph(
+      font_glyph_run_cache_t *cache, uint32_t code)
+{
+   const struct font_glyph *glyph = cache->driver->get_glyph(
+         cache->renderer_data, code);
+
+   if (!glyph) /* Do something smarter here ... */
+      glyph = cache->driver->get_glyph(cache->renderer_data, '?');
+
+   return glyph;
+}
+
+/* Looks up every glyph of a cached run again once the atlas
+ * evicted something, which moves them to the front of the
+ * renderer's LRU list, and checks that none of them changed
+ * place. Evictions of glyphs other runs use don't invalidate
+ * this one. */
+static bool font_glyph_run_validate(font_glyph_run_cache_t *cache,
+      font_glyph_run_entry_t *entry)
+{
+   const char *msg      = entry->msg;
+   const char *msg_end  = msg + entry->msg_len;
+   unsigned generation  = cache->atlas ? cache->atlas->generation : 0;
+   unsigned i           = 0;
+
+   if (generation == entry->generation)
+      return true;
+
+   while (msg < msg_end)
+   {
+      const struct font_glyph *cached = NULL;
+      const struct font_glyph *glyph  = font_glyph_run_get_glyph(cache,
+            utf8_walk(&msg));
+
+      if (!glyph)
+         continue;
+      if (i >= entry->run.count)
+         return false;
+
+      cached = &entry->run.glyphs[i++];
+
+      if (     glyph->atlas_offset_x != cached->atlas_offset_x
+            || glyph->atlas_offset_y != cached->atlas_offset_y
+            || glyph->width          != cached->width
+            || glyph->height         != cached->height)
+         return false;
+   }
+
+   if (i != entry->run.count)
+      return false;
+
+   /* Looking glyphs up may have evicted others of this run,
+    * check again next time */
+   entry->generation = generation;
+   return true;
+}
+
+static bool font_glyph_run_layout(font_glyph_run_cache_t *cache,
+      font_glyph_run_entry_t *entry, const char *msg, unsigned msg_len)
+{
+   const char *msg_end  = msg + msg_len;
+   unsigned generation  = cache->atlas ? cache->atlas->generation : 0;
+   int delta_x          = 0;
+   int delta_y          = 0;
+
+   entry->run.count     = 0;
+   entry->run.width     = 0;
+
+   /* Vertex data is sized and built for the old layout */
+   font_glyph_run_coords_free(&entry->run);
+
+   /* There can't be more glyphs than bytes */
+   if (entry->capacity < msg_len)
+   {
+      struct font_glyph *glyphs = (struct font_glyph*)realloc(
+            entry->run.glyphs, msg_len * sizeof(*glyphs));
+
+      if (!glyphs)
+         return false;
+
+      entry->run.glyphs = glyphs;
+      entry->capacity   = msg_len;
+   }
+
+   while (msg < msg_end)
+   {
+      struct font_glyph *out         = NULL;
+      const struct font_glyph *glyph = font_glyph_run_get_glyph(cache,
+            utf8_walk(&msg));
+
+      if (!glyph)
+         continue;
+
+      out                 = &entry->run.glyphs[entry->run.count++];
+      *out                = *glyph;
+      out->draw_offset_x += delta_x;
+      out->draw_offset_y -= delta_y;
+
+      delta_x            += glyph->advance_x;
+      delta_y            -= glyph->advance_y;
+   }
+
+   entry->run.width  = delta_x;
+   /* As above, this string may have evicted its own glyphs */
+   entry->generation = generation;
+
+   return true;
+}
+
+font_glyph_run_cache_t *font_glyph_run_cache_new(
+      const font_renderer_driver_t *driver, void *renderer_data)
+{
+   font_glyph_run_cache_t *cache = NULL;
+
+   if (!driver || !driver->get_glyph || !renderer_data)
+      return NULL;
+
+   cache = (font_glyph_run_cache_t*)calloc(1, sizeof(*cache));
+
+   if (!cache)
+      return NULL;
+
+   cache->driver        = driver;
+   cache->renderer_data = renderer_data;
+
+   if (driver->get_atlas)
+      cache->atlas      = driver->get_atlas(renderer_data);
+
+   return cache;
+}
+
+void font_glyph_run_cache_free(font_glyph_run_cache_t *cache)
+{
+   if (!cache)
+      return;
+
+   while (cache->lru_tail)
+      font_glyph_run_evict(cache);
+
+   font_glyph_run_entry_free(&cache->scratch);
+   free(cache);
+}
+
+font_glyph_run_t *font_glyph_run_cache_get(
+      font_glyph_run_cache_t *cache, const char *msg, unsigned msg_len)
+{
+   uint32_t hash;
+   font_glyph_run_entry_t *entry = NULL;
+
+   if (!cache || !msg)
+      return NULL;
+
+   if (msg_len > FONT_GLYPH_RUN_MAX_LEN)
+   {
+      if (!font_glyph_run_layout(cache, &cache->scratch, msg, msg_len))
+         return NULL;
+      return &cache->scratch.run;
+   }
+
+   hash  = font_glyph_run_hash(msg, msg_len);
+   entry = cache->buckets[hash % FONT_GLYPH_RUN_BUCKETS];
+
+   while (entry)
+   {
+      if (     entry->hash    == hash
+            && entry->msg_len == msg_len
+            && !memcmp(entry->msg, msg, msg_len))
+         break;
+      entry = entry->map_next;
+   }
+
+   if (entry)
+   {
+      if (cache->lru_head != entry)
+      {
+         font_glyph_run_lru_unlink(cache, entry);
+         font_glyph_run_lru_push(cache, entry);
+      }
+
+      if (!font_glyph_run_validate(cache, entry))
+      {
+         if (!font_glyph_run_layout(cache, entry, msg, msg_len))
+            return NULL;
+      }
+
+      return &entry->run;
+   }
+
+   if (cache->count >= FONT_GLYPH_RUN_MAX)
+      font_glyph_run_evict(cache);
+
+   entry = (font_glyph_run_entry_t*)calloc(1, sizeof(*entry));
+
+   if (!entry)
+      return NULL;
+
+   entry->msg = (char*)malloc(msg_len + 1);
+
+   if (     !entry->msg
+         || !font_glyph_run_layout(cache, entry, msg, msg_len))
+   {
+      font_glyph_run_entry_free(entry);
+      free(entry);
+      return NULL;
+   }
+
+   memcpy(entry->msg, msg, msg_len);
+   entry->msg[msg_len] = '\0';
+   entry->msg_len      = msg_len;
+   entry->hash         = hash;
+   entry->map_next     = cache->buckets[hash % FONT_GLYPH_RUN_BUCKETS];
+   cache->buckets[hash % FONT_GLYPH_RUN_BUCKETS] = entry;
+   font_glyph_run_lru_push(cache, entry);
+   cache->count++;
+
+   return &entry->run;
+}
+
+const font_glyph_run_coords_t *font_glyph_run_find_coords(
+      const font_glyph_run_t *run, const float *key)
+{
+   unsigned i;
+
+   if (!run)
+      return NULL;
+
+   for (i = 0; i < FONT_GLYPH_RUN_COORDS; i++)
+   {
+      const font_glyph_run_coords_t *coords = &run->coords[i];
+
+      if (     coords->valid
+            && !memcmp(coords->key, key, sizeof(coords->key)))
+         return coords;
+   }
+
+   return NULL;
+}
+
+font_glyph_run_coords_t *font_glyph_run_alloc_coords(
+      font_glyph_run_t *run, const float *key)
+{
+   font_glyph_run_coords_t *coords = NULL;
+   size_t vertices                 = 0;
+
+   if (!run || !run->count)
+      return NULL;
+
+   coords            = &run->coords[run->coords_next];
+   run->coords_next  = (run->coords_next + 1) % FONT_GLYPH_RUN_COORDS;
+   vertices          = 6 * run->count;
+
+   /* All four arrays share one allocation,
+    * which only changes when the run is laid out again */
+   if (!coords->vertex)
+   {
+      if (!(coords->vertex = (float*)malloc(
+                  (2 + 2 + 4 + 2) * vertices * sizeof(float))))
+      {
+         coords->valid = false;
+         return NULL;
+      }
+
+      coords->tex_coord     = coords->vertex    + 2 * vertices;
+      coords->color         = coords->tex_coord + 2 * vertices;
+      coords->lut_tex_coord = coords->color     + 4 * vertices;
+   }
+
+   memcpy(coords->key, key, sizeof(coords->key));
+   coords->valid = true;
+
+   return coords;
+}
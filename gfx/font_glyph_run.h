@@ -0,0 +1,121 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __FONT_GLYPH_RUN_H__
+#define __FONT_GLYPH_RUN_H__
+
+#include <stdint.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+
+#include "font_driver.h"
+
+RETRO_BEGIN_DECLS
+
+#define FONT_GLYPH_RUN_KEY_SIZE 16
+#define FONT_GLYPH_RUN_COORDS   2
+
+/* Vertex data a font driver built from a run, laid out like
+ * struct video_coords (six vertices per glyph). It is only
+ * valid for the key it was built with: position, scale, color
+ * and whatever else the driver baked into the vertices. */
+typedef struct font_glyph_run_coords
+{
+   float key[FONT_GLYPH_RUN_KEY_SIZE];
+   float *vertex;
+   float *tex_coord;
+   float *color;
+   float *lut_tex_coord;
+   bool valid;
+} font_glyph_run_coords_t;
+
+/* A line of text laid out once by a font renderer.
+ *
+ * Menus draw the same labels every frame, so font drivers
+ * keep a cache of runs per font and only walk the UTF-8 and
+ * look up glyphs when a string is seen for the first time.
+ * The layout itself doesn't depend on scale, position or
+ * color; the vertex data built from it does, so a couple
+ * of versions are kept (e.g. for text and its drop shadow). */
+typedef struct font_glyph_run
+{
+   /* draw_offset_x/y already include the pen position,
+    * advance_x/y are those of the glyph itself. */
+   struct font_glyph *glyphs;
+   unsigned count;
+
+   /* Sum of all horizontal advances, in unscaled pixels */
+   int width;
+
+   font_glyph_run_coords_t coords[FONT_GLYPH_RUN_COORDS];
+   unsigned coords_next;
+} font_glyph_run_t;
+
+typedef struct font_glyph_run_cache font_glyph_run_cache_t;
+
+/**
+ * font_glyph_run_cache_new:
+ * @driver               : font renderer driver.
+ * @renderer_data        : font renderer handle.
+ *
+ * Returns: a run cache for the given font, or NULL on failure.
+ **/
+font_glyph_run_cache_t *font_glyph_run_cache_new(
+      const font_renderer_driver_t *driver, void *renderer_data);
+
+void font_glyph_run_cache_free(font_glyph_run_cache_t *cache);
+
+/**
+ * font_glyph_run_cache_get:
+ * @cache                : run cache.
+ * @msg                  : UTF-8 string, doesn't need to be terminated.
+ * @msg_len              : length of @msg in bytes.
+ *
+ * Looks up @msg, laying it out first if it isn't cached or its
+ * glyphs moved in the atlas since. The run stays valid until the
+ * next call on @cache.
+ *
+ * Returns: the laid out run, or NULL on failure.
+ **/
+font_glyph_run_t *font_glyph_run_cache_get(
+      font_glyph_run_cache_t *cache, const char *msg, unsigned msg_len);
+
+/**
+ * font_glyph_run_find_coords:
+ * @run                  : glyph run.
+ * @key                  : FONT_GLYPH_RUN_KEY_SIZE floats, unused ones zeroed.
+ *
+ * Returns: vertex data built for @key earlier, or NULL.
+ **/
+const font_glyph_run_coords_t *font_glyph_run_find_coords(
+      const font_glyph_run_t *run, const float *key);
+
+/**
+ * font_glyph_run_alloc_coords:
+ * @run                  : glyph run.
+ * @key                  : FONT_GLYPH_RUN_KEY_SIZE floats, unused ones zeroed.
+ *
+ * Makes room for the vertex data of @run under @key, replacing
+ * the oldest version. The caller fills in all arrays.
+ *
+ * Returns: the vertex data to fill in, or NULL on failure.
+ **/
+font_glyph_run_coords_t *font_glyph_run_alloc_coords(
+      font_glyph_run_t *run, const float *key);
+
+RETRO_END_DECLS
+
+#endif
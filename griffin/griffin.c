@@ -98,6 +98,7 @@ ALGORITHMS
 ARCHIVE FILE
 ============================================================ */
 #include "../libretro-common/file/archive_file.c"
+#include "../libretro-common/file/archive_file_cache.c"
 
 #ifdef HAVE_ZLIB
 #include "../libretro-common/file/archive_file_zlib.c"
@@ -504,6 +505,7 @@ FONTS
 
 #include "../gfx/drivers_font_renderer/bitmapfont.c"
 #include "../gfx/font_driver.c"
+#include "../gfx/font_glyph_run.c"
 
 #if defined(HAVE_D3D9) && defined(HAVE_D3DX)
 #include "../gfx/drivers_font/d3d_w32_font.c"
@@ -975,6 +977,7 @@ FILE
 #ifndef __WINRT__
 #include "../libretro-common/vfs/vfs_implementation.c"
 #endif
+#include "../libretro-common/vfs/vfs_implementation_async.c"
 
 #ifdef HAVE_CDROM
 #include "../libretro-common/cdrom/cdrom.c"
@@ -1182,6 +1185,7 @@ NETPLAY
 #include "../network/netplay/netplay_sync.c"
 #include "../network/netplay/netplay_discovery.c"
 #include "../network/netplay/netplay_buf.c"
+#include "../network/netplay/netplay_udp.c"
 #include "../network/netplay/netplay_room_parse.c"
 #include "../libretro-common/net/net_compat.c"
 #include "../libretro-common/net/net_socket.c"
@@ -1206,6 +1210,7 @@ DATA RUNLOOP
 #include "../tasks/task_image.c"
 #include "../tasks/task_file_transfer.c"
 #include "../tasks/task_playlist_manager.c"
+#include "../tasks/task_dir_list.c"
 #ifdef HAVE_ZLIB
 #include "../tasks/task_decompress.c"
 #endif
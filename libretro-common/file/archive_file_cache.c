@@ -0,0 +1,406 @@
+/* Copyright  (C) 2010-2018 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (archive_file_cache.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if defined(_WIN32) && !defined(_XBOX) && !defined(LEGACY_WIN32)
+#include <encodings/utf.h>
+#endif
+
+#include <compat/strl.h>
+#include <file/archive_file.h>
+#include <file/archive_file_cache.h>
+#include <file/file_path.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
+#include <retro_miscellaneous.h>
+#include <rhash.h>
+
+#define ARCHIVE_CACHE_INDEX "index.txt"
+
+/* Entries of the index are "last_used size_kib name" lines; last_used is
+ * a counter that is bumped whenever an entry is added or hit. */
+struct archive_cache_entry
+{
+   char *name;
+   uint64_t size;
+   unsigned last_used;
+};
+
+struct archive_cache
+{
+   struct archive_cache_entry *entries;
+   size_t count;
+   size_t capacity;
+   unsigned clock;
+   char dir[PATH_MAX_LENGTH];
+};
+
+static bool archive_cache_stat(const char *path,
+      uint64_t *size, uint64_t *mtime)
+{
+#if defined(_WIN32) && !defined(_XBOX)
+   struct _stat buf;
+#if defined(LEGACY_WIN32)
+   if (_stat(path, &buf) != 0)
+      return false;
+#else
+   int ret;
+   wchar_t *path_wide = utf8_to_utf16_string_alloc(path);
+
+   if (!path_wide)
+      return false;
+   ret = _wstat(path_wide, &buf);
+   free(path_wide);
+   if (ret != 0)
+      return false;
+#endif
+   *size  = (uint64_t)buf.st_size;
+   *mtime = (uint64_t)buf.st_mtime;
+   return true;
+#elif defined(VITA) || defined(PSP) || defined(PS2) || defined(ORBIS) || defined(__CELLOS_LV2__) || defined(_XBOX)
+   /* No modification time here; the size has to do */
+   int32_t size32 = path_get_size(path);
+
+   if (size32 < 0)
+      return false;
+   *size  = (uint64_t)size32;
+   *mtime = 0;
+   return true;
+#else
+   struct stat buf;
+
+   if (stat(path, &buf) != 0)
+      return false;
+   *size  = (uint64_t)buf.st_size;
+   *mtime = (uint64_t)buf.st_mtime;
+   return true;
+#endif
+}
+
+/* Name of the cache file for "archive#member": a hash of the key followed
+ * by the member's own name, so cores still see the right extension. */
+static bool archive_cache_entry_name(const char *path, char *name, size_t len)
+{
+   char hash[65];
+   char key[PATH_MAX_LENGTH + 64];
+   char archive[PATH_MAX_LENGTH];
+   uint64_t size                   = 0;
+   uint64_t mtime                  = 0;
+   const char *member              = path_get_archive_delim(path);
+
+   if (!member || !member[1])
+      return false;
+
+   strlcpy(archive, path, sizeof(archive));
+   archive[member - path] = '\0';
+   member++;
+
+   if (!archive_cache_stat(archive, &size, &mtime))
+      return false;
+
+   snprintf(key, sizeof(key), "%s\n%.0f\n%.0f\n%s",
+         archive, (double)size, (double)mtime, member);
+   sha256_hash(hash, (const uint8_t*)key, strlen(key));
+
+   hash[16] = '\0';
+   snprintf(name, len, "%s_%s", hash, path_basename(member));
+   return true;
+}
+
+static void archive_cache_free(struct archive_cache *cache)
+{
+   size_t i;
+
+   for (i = 0; i < cache->count; i++)
+      free(cache->entries[i].name);
+   free(cache->entries);
+   cache->entries  = NULL;
+   cache->count    = 0;
+   cache->capacity = 0;
+}
+
+static bool archive_cache_push(struct archive_cache *cache,
+      const char *name, uint64_t size, unsigned last_used)
+{
+   struct archive_cache_entry *entry;
+
+   if (cache->count == cache->capacity)
+   {
+      size_t capacity = cache->capacity ? cache->capacity * 2 : 32;
+      struct archive_cache_entry *entries = (struct archive_cache_entry*)
+         realloc(cache->entries, capacity * sizeof(*entries));
+
+      if (!entries)
+         return false;
+
+      cache->entries  = entries;
+      cache->capacity = capacity;
+   }
+
+   entry            = &cache->entries[cache->count];
+   entry->name      = strdup(name);
+   entry->size      = size;
+   entry->last_used = last_used;
+
+   if (!entry->name)
+      return false;
+
+   if (last_used > cache->clock)
+      cache->clock = last_used;
+   cache->count++;
+   return true;
+}
+
+static void archive_cache_remove(struct archive_cache *cache, size_t i)
+{
+   char path[PATH_MAX_LENGTH];
+
+   fill_pathname_join(path, cache->dir, cache->entries[i].name, sizeof(path));
+   filestream_delete(path);
+
+   free(cache->entries[i].name);
+   cache->entries[i] = cache->entries[--cache->count];
+}
+
+static bool archive_cache_load(struct archive_cache *cache, const char *dir)
+{
+   char index[PATH_MAX_LENGTH];
+   int64_t len = 0;
+   void *buf   = NULL;
+   char *line;
+
+   memset(cache, 0, sizeof(*cache));
+   strlcpy(cache->dir, dir, sizeof(cache->dir));
+
+   if (!path_is_directory(dir) && !path_mkdir(dir))
+      return false;
+
+   fill_pathname_join(index, dir, ARCHIVE_CACHE_INDEX, sizeof(index));
+
+   /* A missing index is an empty cache */
+   if (!path_is_valid(index) || !filestream_read_file(index, &buf, &len))
+      return true;
+
+   for (line = (char*)buf; line && *line; )
+   {
+      char entry_path[PATH_MAX_LENGTH];
+      char *name;
+      char *end          = strchr(line, '\n');
+      unsigned last_used = (unsigned)strtoul(line, &name, 10);
+      uint64_t size_kib  = (uint64_t)strtoul(name, &name, 10);
+
+      if (end)
+         *end++ = '\0';
+
+      if (*name == ' ')
+      {
+         name++;
+         fill_pathname_join(entry_path, dir, name, sizeof(entry_path));
+
+         /* Skip entries whose file went away behind our back */
+         if (*name && path_is_valid(entry_path))
+            archive_cache_push(cache, name, size_kib * 1024, last_used);
+      }
+
+      line = end;
+   }
+
+   free(buf);
+   return true;
+}
+
+static void archive_cache_save(struct archive_cache *cache)
+{
+   size_t i;
+   char index[PATH_MAX_LENGTH];
+   RFILE *file;
+
+   fill_pathname_join(index, cache->dir, ARCHIVE_CACHE_INDEX, sizeof(index));
+
+   file = filestream_open(index, RETRO_VFS_FILE_ACCESS_WRITE,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!file)
+      return;
+
+   for (i = 0; i < cache->count; i++)
+      filestream_printf(file, "%u %u %s\n",
+            cache->entries[i].last_used,
+            (unsigned)((cache->entries[i].size + 1023) / 1024),
+            cache->entries[i].name);
+
+   filestream_close(file);
+}
+
+static bool archive_cache_touch(struct archive_cache *cache, const char *name)
+{
+   size_t i;
+
+   for (i = 0; i < cache->count; i++)
+   {
+      if (string_is_equal(cache->entries[i].name, name))
+      {
+         cache->entries[i].last_used = ++cache->clock;
+         return true;
+      }
+   }
+
+   return false;
+}
+
+static void archive_cache_forget(struct archive_cache *cache, const char *name)
+{
+   size_t i;
+
+   for (i = 0; i < cache->count; i++)
+   {
+      if (string_is_equal(cache->entries[i].name, name))
+      {
+         archive_cache_remove(cache, i);
+         return;
+      }
+   }
+}
+
+/* Registers a freshly written entry and evicts the least recently used
+ * ones until the cache fits in max_size again. */
+static bool archive_cache_add(struct archive_cache *cache,
+      const char *name, uint64_t size, uint64_t max_size)
+{
+   uint64_t total = size;
+   size_t i;
+
+   if (size > max_size || !archive_cache_push(cache, name, size,
+            cache->clock + 1))
+      return false;
+
+   for (i = 0; i < cache->count - 1; i++)
+      total += cache->entries[i].size;
+
+   while (total > max_size)
+   {
+      size_t oldest = 0;
+
+      /* The new entry is last and the most recent, so never picked */
+      for (i = 1; i < cache->count - 1; i++)
+         if (cache->entries[i].last_used < cache->entries[oldest].last_used)
+            oldest = i;
+
+      total -= cache->entries[oldest].size;
+      archive_cache_remove(cache, oldest);
+   }
+
+   return true;
+}
+
+bool file_archive_cache_extract(const char *dir, uint64_t max_size,
+      const char *path, char *out_path, size_t len)
+{
+   struct archive_cache cache;
+   char name[PATH_MAX_LENGTH];
+   uint64_t size  = 0;
+   uint64_t mtime = 0;
+   int64_t length = 0;
+   bool ret       = false;
+
+   if (     string_is_empty(dir)
+         || !archive_cache_entry_name(path, name, sizeof(name))
+         || !archive_cache_load(&cache, dir))
+      return false;
+
+   fill_pathname_join(out_path, dir, name, len);
+
+   if (archive_cache_touch(&cache, name))
+      ret = true;
+   else
+   {
+      /* Left over from an interrupted extraction;
+       * file_archive_compressed_read would take it as is */
+      if (path_is_valid(out_path))
+         filestream_delete(out_path);
+
+      if (     file_archive_compressed_read(path, NULL, out_path, &length)
+            && length >= 0
+            && archive_cache_stat(out_path, &size, &mtime))
+         ret = archive_cache_add(&cache, name, size, max_size);
+
+      if (!ret)
+         filestream_delete(out_path);
+   }
+
+   if (ret)
+      archive_cache_save(&cache);
+
+   archive_cache_free(&cache);
+   return ret;
+}
+
+bool file_archive_cache_read(const char *dir, uint64_t max_size,
+      const char *path, void **buf, int64_t *length)
+{
+   struct archive_cache cache;
+   char name[PATH_MAX_LENGTH];
+   char entry_path[PATH_MAX_LENGTH];
+
+   if (     string_is_empty(dir)
+         || !archive_cache_entry_name(path, name, sizeof(name))
+         || !archive_cache_load(&cache, dir))
+      return file_archive_compressed_read(path, buf, NULL, length) != 0;
+
+   fill_pathname_join(entry_path, dir, name, sizeof(entry_path));
+
+   if (archive_cache_touch(&cache, name))
+   {
+      if (filestream_read_file(entry_path, buf, length))
+      {
+         archive_cache_save(&cache);
+         archive_cache_free(&cache);
+         return true;
+      }
+
+      archive_cache_forget(&cache, name);
+   }
+
+   if (!file_archive_compressed_read(path, buf, NULL, length) || *length < 0)
+   {
+      archive_cache_free(&cache);
+      return false;
+   }
+
+   if ((uint64_t)*length <= max_size)
+   {
+      if (     filestream_write_file(entry_path, *buf, *length)
+            && archive_cache_add(&cache, name, (uint64_t)*length, max_size))
+         archive_cache_save(&cache);
+      else
+         filestream_delete(entry_path);
+   }
+
+   archive_cache_free(&cache);
+   return true;
+}
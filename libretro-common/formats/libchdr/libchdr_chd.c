@@ -62,6 +62,10 @@
 #include <retro_inline.h>
 #include <streams/file_stream.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 #define TRUE 1
 #define FALSE 0
 
@@ -190,6 +194,31 @@ struct _metadata_entry
 	UINT8					flags;			/* flag bits */
 };
 
+/* codec state and scratch buffer needed to decompress hunks; every
+   file has one for chd_read(), and every worker thread of
+   chd_read_hunks() gets its own */
+typedef struct _chd_decoder chd_decoder;
+struct _chd_decoder
+{
+	UINT8 *					compressed;		/* pointer to buffer for compressed data */
+
+#ifdef HAVE_ZLIB
+	zlib_codec_data			zlib_codec_data;		/* zlib codec data */
+	cdzl_codec_data			cdzl_codec_data;		/* cdzl codec data */
+#endif
+#ifdef HAVE_7ZIP
+	cdlz_codec_data			cdlz_codec_data;		/* cdlz codec data */
+#endif
+#ifdef HAVE_FLAC
+	cdfl_codec_data			cdfl_codec_data;		/* cdfl codec data */
+#endif
+};
+
+#ifdef HAVE_THREADS
+typedef struct _chd_read_job chd_read_job;
+typedef struct _chd_read_worker chd_read_worker;
+#endif
+
 /* internal representation of an open CHD file */
 struct _chd_file
 {
@@ -211,24 +240,22 @@ struct _chd_file
 	UINT32					comparehunk;	/* index of current compare data */
 #endif
 
-	UINT8 *					compressed;		/* pointer to buffer for compressed data */
 	const codec_interface *	codecintf[4];	/* interface to the codec */
-
-#ifdef HAVE_ZLIB
-	zlib_codec_data			zlib_codec_data;		/* zlib codec data */
-	cdzl_codec_data			cdzl_codec_data;		/* cdzl codec data */
-#endif
-#ifdef HAVE_7ZIP
-	cdlz_codec_data			cdlz_codec_data;		/* cdlz codec data */
-#endif
-#ifdef HAVE_FLAC
-	cdfl_codec_data			cdfl_codec_data;		/* cdfl codec data */
+	chd_decoder				decoder;		/* decoder used by chd_read() */
+
+	chd_decoder *			workers;		/* extra decoders for chd_read_hunks() */
+	UINT32					numworkers;		/* number of extra decoders */
+#ifdef HAVE_THREADS
+	chd_read_job *			job;			/* work shared with the threads below */
+	chd_read_worker *		threads;		/* one thread per extra decoder, idle between calls */
+	slock_t *				io_lock;		/* serializes file access while the threads exist */
 #endif
 
 #ifdef NEED_CACHE_HUNK
 	UINT32					maxhunk;		/* maximum hunk accessed */
 #endif
    UINT8 *              file_cache; /* cache of underlying file */
+	UINT8 *					hunk_cache;		/* every hunk decompressed, see chd_precache_hunks() */
 };
 
 /***************************************************************************
@@ -250,7 +277,16 @@ static chd_error header_read(chd_file *chd, chd_header *header);
 #ifdef NEED_CACHE_HUNK
 static chd_error hunk_read_into_cache(chd_file *chd, UINT32 hunknum);
 #endif
-static chd_error hunk_read_into_memory(chd_file *chd, UINT32 hunknum, UINT8 *dest);
+static chd_error hunk_read_into_memory(chd_file *chd, chd_decoder *decoder, UINT32 hunknum, UINT8 *dest);
+
+/* internal decoder operations */
+static chd_error decoder_init(chd_file *chd, chd_decoder *decoder);
+static void decoder_free(chd_file *chd, chd_decoder *decoder);
+
+#ifdef HAVE_THREADS
+/* internal threads of chd_read_hunks() */
+static void chd_read_threads_free(chd_file *chd);
+#endif
 
 /* internal map access */
 static chd_error map_read(chd_file *chd);
@@ -845,11 +881,6 @@ chd_error chd_open_file(RFILE *file, int mode, chd_file *parent, chd_file **chd)
 	newchd->comparehunk = ~0;
 #endif
 
-	/* allocate the temporary compressed buffer */
-	newchd->compressed = (UINT8 *)malloc(newchd->header.hunkbytes);
-	if (newchd->compressed == NULL)
-		EARLY_EXIT(err = CHDERR_OUT_OF_MEMORY);
-
 	/* find the codec interface */
 	if (newchd->header.version < 5)
 	{
@@ -861,20 +892,11 @@ chd_error chd_open_file(RFILE *file, int mode, chd_file *parent, chd_file **chd)
 			}
 		if (intfnum == ARRAY_SIZE(codec_interfaces))
 			EARLY_EXIT(err = CHDERR_UNSUPPORTED_FORMAT);
-
-#ifdef HAVE_ZLIB
-		/* initialize the codec */
-		if (newchd->codecintf[0]->init != NULL)
-      {
-         err = (*newchd->codecintf[0]->init)(&newchd->zlib_codec_data, newchd->header.hunkbytes);
-         (void)err;
-      }
-#endif
 	}
 	else
 	{
 		int i, decompnum;
-		/* verify the compression types and initialize the codecs */
+		/* verify the compression types */
 		for (decompnum = 0; decompnum < ARRAY_SIZE(newchd->header.compression); decompnum++)
 		{
 			for (i = 0 ; i < ARRAY_SIZE(codec_interfaces) ; i++)
@@ -887,43 +909,16 @@ chd_error chd_open_file(RFILE *file, int mode, chd_file *parent, chd_file **chd)
 						err = CHDERR_UNSUPPORTED_FORMAT;
                         (void)err;
                     }
-
-					/* initialize the codec */
-					if (newchd->codecintf[decompnum]->init != NULL)
-					{
-						void* codec = NULL;
-						switch (newchd->header.compression[decompnum])
-						{
-							case CHD_CODEC_CD_ZLIB:
-#ifdef HAVE_ZLIB
-								codec = &newchd->cdzl_codec_data;
-#endif
-								break;
-
-							case CHD_CODEC_CD_LZMA:
-#ifdef HAVE_7ZIP
-								codec = &newchd->cdlz_codec_data;
-#endif
-								break;
-
-							case CHD_CODEC_CD_FLAC:
-#ifdef HAVE_FLAC
-								codec = &newchd->cdfl_codec_data;
-#endif
-								break;
-						}
-						if (codec != NULL)
-                        {
-							err = (*newchd->codecintf[decompnum]->init)(codec, newchd->header.hunkbytes);
-                            (void)err;
-                        }
-					}
-
 				}
 			}
 		}
 	}
 
+	/* allocate the temporary compressed buffer and initialize the codecs */
+	err = decoder_init(newchd, &newchd->decoder);
+	if (err != CHDERR_NONE)
+		EARLY_EXIT(err);
+
 #if 0
 	/* HACK */
 	if (err != CHDERR_NONE)
@@ -1022,56 +1017,25 @@ void chd_close(chd_file *chd)
 	if (chd == NULL || chd->cookie != COOKIE_VALUE)
 		return;
 
-	/* deinit the codec */
-	if (chd->header.version < 5)
-	{
-#ifdef HAVE_ZLIB
-		if (chd->codecintf[0] != NULL && chd->codecintf[0]->free != NULL)
-			(*chd->codecintf[0]->free)(&chd->zlib_codec_data);
-#endif
-	}
-	else
-	{
-		int i;
-		/* Free the codecs */
-		for (i = 0 ; i < 4 ; i++)
-      {
-         void* codec = NULL;
-         if (!chd->codecintf[i])
-            continue;
-
-         switch (chd->codecintf[i]->compression)
-         {
-            case CHD_CODEC_CD_LZMA:
-#ifdef HAVE_7ZIP
-               codec = &chd->cdlz_codec_data;
-#endif
-               break;
+	/* deinit the codecs */
+	decoder_free(chd, &chd->decoder);
 
-            case CHD_CODEC_CD_ZLIB:
-#ifdef HAVE_ZLIB
-               codec = &chd->cdzl_codec_data;
+#ifdef HAVE_THREADS
+	/* stop the threads before their decoders go */
+	chd_read_threads_free(chd);
 #endif
-               break;
 
-            case CHD_CODEC_CD_FLAC:
-#ifdef HAVE_FLAC
-               codec = &chd->cdfl_codec_data;
-#endif
-               break;
-         }
-         if (codec)
-            (*chd->codecintf[i]->free)(codec);
-      }
-
-		/* Free the raw map */
-		if (chd->header.rawmap != NULL)
-			free(chd->header.rawmap);
+	if (chd->workers != NULL)
+	{
+		UINT32 i;
+		for (i = 0; i < chd->numworkers; i++)
+			decoder_free(chd, &chd->workers[i]);
+		free(chd->workers);
 	}
 
-	/* free the compressed data buffer */
-	if (chd->compressed != NULL)
-		free(chd->compressed);
+	/* Free the raw map */
+	if (chd->header.version >= 5 && chd->header.rawmap != NULL)
+		free(chd->header.rawmap);
 
 #ifdef NEED_CACHE_HUNK
 	/* free the hunk cache and compare data */
@@ -1096,6 +1060,9 @@ void chd_close(chd_file *chd)
    if (chd->file_cache)
       free(chd->file_cache);
 
+	if (chd->hunk_cache)
+		free(chd->hunk_cache);
+
 	/* free our memory */
 	free(chd);
 }
@@ -1184,8 +1151,331 @@ chd_error chd_read(chd_file *chd, UINT32 hunknum, void *buffer)
 	if (chd == NULL || chd->cookie != COOKIE_VALUE)
 		return CHDERR_INVALID_PARAMETER;
 
+	/* everything already decompressed? */
+	if (chd->hunk_cache != NULL)
+	{
+		if (hunknum >= chd->header.totalhunks)
+			return CHDERR_HUNK_OUT_OF_RANGE;
+		memcpy(buffer, chd->hunk_cache + (size_t)hunknum * chd->header.hunkbytes, chd->header.hunkbytes);
+		return CHDERR_NONE;
+	}
+
 	/* perform the read */
-	return hunk_read_into_memory(chd, hunknum, (UINT8 *)buffer);
+	return hunk_read_into_memory(chd, &chd->decoder, hunknum, (UINT8 *)buffer);
+}
+
+#ifdef HAVE_THREADS
+/* state shared by chd_read_hunks() and the file's threads; they sleep
+   on work_cond until a call hands them a new range */
+struct _chd_read_job
+{
+	chd_file *				chd;
+	slock_t *				lock;			/* protects the fields below */
+	scond_t *				work_cond;		/* signalled when a range is handed out */
+	scond_t *				done_cond;		/* signalled when the last thread is done */
+	UINT32					generation;		/* bumped for every range */
+	UINT32					threads;		/* extra threads to use for this range */
+	UINT32					active;			/* threads still working on the range */
+	UINT32					next;			/* next hunk to decompress */
+	UINT32					end;			/* one past the last hunk */
+	UINT32					first;			/* first hunk of the range */
+	UINT8 *					buffer;			/* destination of the first hunk */
+	chd_error				err;			/* first error seen, if any */
+	int						quit;			/* set by chd_close() */
+};
+
+struct _chd_read_worker
+{
+	chd_read_job *			job;
+	chd_decoder *			decoder;
+	sthread_t *				thread;
+	UINT32					index;
+};
+
+/* decompresses hunks of the current range until there are none left */
+static void chd_read_job_run(chd_read_job *job, chd_decoder *decoder)
+{
+	UINT32 hunkbytes = job->chd->header.hunkbytes;
+
+	for (;;)
+	{
+		UINT32 hunknum;
+		chd_error err;
+
+		slock_lock(job->lock);
+		hunknum = (job->err == CHDERR_NONE) ? job->next++ : job->end;
+		slock_unlock(job->lock);
+
+		if (hunknum >= job->end)
+			break;
+
+		err = hunk_read_into_memory(job->chd, decoder, hunknum,
+			job->buffer + (size_t)(hunknum - job->first) * hunkbytes);
+
+		if (err != CHDERR_NONE)
+		{
+			slock_lock(job->lock);
+			if (job->err == CHDERR_NONE)
+				job->err = err;
+			slock_unlock(job->lock);
+		}
+	}
+}
+
+static void chd_read_hunks_thread(void *data)
+{
+	chd_read_worker *worker = (chd_read_worker *)data;
+	chd_read_job *job = worker->job;
+	UINT32 seen = 0;
+
+	slock_lock(job->lock);
+	for (;;)
+	{
+		while (!job->quit && job->generation == seen)
+			scond_wait(job->work_cond, job->lock);
+		if (job->quit)
+			break;
+
+		seen = job->generation;
+		if (worker->index >= job->threads)
+			continue;
+
+		/* a thread waking up late finds the range used up, or helps
+		   with the next one; the caller waits for it either way */
+		job->active++;
+		slock_unlock(job->lock);
+		chd_read_job_run(job, worker->decoder);
+		slock_lock(job->lock);
+		if (--job->active == 0)
+			scond_signal(job->done_cond);
+	}
+	slock_unlock(job->lock);
+}
+
+/* stops and frees the threads of chd_read_hunks(), keeping the decoders */
+static void chd_read_threads_free(chd_file *chd)
+{
+	chd_read_job *job = chd->job;
+	UINT32 i;
+
+	if (job == NULL)
+		return;
+
+	slock_lock(job->lock);
+	job->quit = 1;
+	scond_broadcast(job->work_cond);
+	slock_unlock(job->lock);
+
+	for (i = 0; i < chd->numworkers; i++)
+		if (chd->threads[i].thread != NULL)
+			sthread_join(chd->threads[i].thread);
+
+	scond_free(job->done_cond);
+	scond_free(job->work_cond);
+	slock_free(job->lock);
+	free(job);
+	free(chd->threads);
+	chd->job = NULL;
+	chd->threads = NULL;
+
+	if (chd->io_lock != NULL)
+		slock_free(chd->io_lock);
+	chd->io_lock = NULL;
+}
+
+/* starts one thread per extra decoder, which stay until chd_close() */
+static chd_error chd_read_threads_init(chd_file *chd)
+{
+	chd_read_job *job = (chd_read_job *)calloc(1, sizeof(*job));
+	UINT32 i;
+
+	chd->job = job;
+	chd->threads = (chd_read_worker *)calloc(chd->numworkers, sizeof(*chd->threads));
+	if (job == NULL || chd->threads == NULL)
+		goto nomem;
+
+	job->chd = chd;
+	job->lock = slock_new();
+	job->work_cond = scond_new();
+	job->done_cond = scond_new();
+	if (!chd->file_cache)
+		chd->io_lock = slock_new();
+
+	if (job->lock == NULL || job->work_cond == NULL || job->done_cond == NULL
+		|| (!chd->file_cache && chd->io_lock == NULL))
+		goto nomem;
+
+	/* if a thread cannot be started, the others do its share */
+	for (i = 0; i < chd->numworkers; i++)
+	{
+		chd->threads[i].job = job;
+		chd->threads[i].decoder = &chd->workers[i];
+		chd->threads[i].index = i;
+		chd->threads[i].thread = sthread_create(chd_read_hunks_thread, &chd->threads[i]);
+	}
+
+	return CHDERR_NONE;
+
+nomem:
+	if (job != NULL)
+	{
+		if (job->done_cond != NULL)
+			scond_free(job->done_cond);
+		if (job->work_cond != NULL)
+			scond_free(job->work_cond);
+		if (job->lock != NULL)
+			slock_free(job->lock);
+		free(job);
+	}
+	free(chd->threads);
+	if (chd->io_lock != NULL)
+		slock_free(chd->io_lock);
+	chd->job = NULL;
+	chd->threads = NULL;
+	chd->io_lock = NULL;
+	return CHDERR_OUT_OF_MEMORY;
+}
+#endif
+
+/*-------------------------------------------------
+    chd_read_hunks - read a range of consecutive
+    hunks from the CHD file, decompressing them
+    on up to 'threads' threads; the calling
+    thread is one of them
+-------------------------------------------------*/
+
+chd_error chd_read_hunks(chd_file *chd, UINT32 hunknum, UINT32 count, void *buffer, UINT32 threads)
+{
+	UINT8 *dest = (UINT8 *)buffer;
+	chd_error err;
+	UINT32 i;
+
+	/* punt if NULL or invalid */
+	if (chd == NULL || chd->cookie != COOKIE_VALUE || buffer == NULL)
+		return CHDERR_INVALID_PARAMETER;
+
+	if (hunknum >= chd->header.totalhunks || count > chd->header.totalhunks - hunknum)
+		return CHDERR_HUNK_OUT_OF_RANGE;
+
+	if (chd->hunk_cache != NULL)
+	{
+		memcpy(dest, chd->hunk_cache + (size_t)hunknum * chd->header.hunkbytes, (size_t)count * chd->header.hunkbytes);
+		return CHDERR_NONE;
+	}
+
+	if (threads > count)
+		threads = count;
+
+#ifdef HAVE_THREADS
+	/* parent hunks are decompressed with the parent's own decoder, which
+	   cannot be shared, so files with a parent are read serially */
+	if (threads > 1 && chd->parent == NULL)
+	{
+		chd_read_job *job;
+
+		/* one decoder and thread per extra thread, kept for later calls */
+		if (chd->numworkers < threads - 1)
+		{
+			chd_decoder *decoders = (chd_decoder *)calloc(threads - 1, sizeof(*decoders));
+			if (decoders == NULL)
+				return CHDERR_OUT_OF_MEMORY;
+
+			for (i = 0; i < threads - 1; i++)
+			{
+				err = decoder_init(chd, &decoders[i]);
+				if (err != CHDERR_NONE)
+				{
+					while (i-- > 0)
+						decoder_free(chd, &decoders[i]);
+					free(decoders);
+					return err;
+				}
+			}
+
+			chd_read_threads_free(chd);
+			if (chd->workers != NULL)
+			{
+				for (i = 0; i < chd->numworkers; i++)
+					decoder_free(chd, &chd->workers[i]);
+				free(chd->workers);
+			}
+			chd->workers = decoders;
+			chd->numworkers = threads - 1;
+		}
+
+		if (chd->job == NULL)
+		{
+			err = chd_read_threads_init(chd);
+			if (err != CHDERR_NONE)
+				return err;
+		}
+
+		job = chd->job;
+
+		slock_lock(job->lock);
+		job->threads = threads - 1;
+		job->next = hunknum;
+		job->end = hunknum + count;
+		job->first = hunknum;
+		job->buffer = dest;
+		job->err = CHDERR_NONE;
+		job->generation++;
+		scond_broadcast(job->work_cond);
+		slock_unlock(job->lock);
+
+		/* the calling thread helps, using the file's own decoder */
+		chd_read_job_run(job, &chd->decoder);
+
+		slock_lock(job->lock);
+		while (job->active > 0)
+			scond_wait(job->done_cond, job->lock);
+		err = job->err;
+		slock_unlock(job->lock);
+		return err;
+	}
+#endif
+
+	for (i = 0; i < count; i++)
+	{
+		err = hunk_read_into_memory(chd, &chd->decoder, hunknum + i, dest + (size_t)i * chd->header.hunkbytes);
+		if (err != CHDERR_NONE)
+			return err;
+	}
+
+	return CHDERR_NONE;
+}
+
+/*-------------------------------------------------
+    chd_precache_hunks - decompress the whole CHD
+    into memory using up to 'threads' threads, so
+    that later reads are plain copies
+-------------------------------------------------*/
+
+chd_error chd_precache_hunks(chd_file *chd, UINT32 threads)
+{
+	UINT8 *cache;
+	chd_error err;
+
+	/* punt if NULL or invalid */
+	if (chd == NULL || chd->cookie != COOKIE_VALUE)
+		return CHDERR_INVALID_PARAMETER;
+
+	if (chd->hunk_cache != NULL)
+		return CHDERR_NONE;
+
+	cache = (UINT8 *)malloc((size_t)chd->header.totalhunks * chd->header.hunkbytes);
+	if (cache == NULL)
+		return CHDERR_OUT_OF_MEMORY;
+
+	err = chd_read_hunks(chd, 0, chd->header.totalhunks, cache, threads);
+	if (err != CHDERR_NONE)
+	{
+		free(cache);
+		return err;
+	}
+
+	chd->hunk_cache = cache;
+	return CHDERR_NONE;
 }
 
 /***************************************************************************
@@ -1497,6 +1787,112 @@ static chd_error header_read(chd_file *chd, chd_header *header)
 	return CHDERR_NONE;
 }
 
+/***************************************************************************
+    INTERNAL DECODER MANAGEMENT
+***************************************************************************/
+
+/*-------------------------------------------------
+    decoder_codec - return the codec data of a
+    decoder for the given codec slot
+-------------------------------------------------*/
+
+static void *decoder_codec(chd_file *chd, chd_decoder *decoder, int decompnum)
+{
+	if (chd->header.version < 5)
+	{
+#ifdef HAVE_ZLIB
+		return &decoder->zlib_codec_data;
+#else
+		return NULL;
+#endif
+	}
+
+	switch (chd->codecintf[decompnum]->compression)
+	{
+		case CHD_CODEC_CD_ZLIB:
+#ifdef HAVE_ZLIB
+			return &decoder->cdzl_codec_data;
+#endif
+			break;
+
+		case CHD_CODEC_CD_LZMA:
+#ifdef HAVE_7ZIP
+			return &decoder->cdlz_codec_data;
+#endif
+			break;
+
+		case CHD_CODEC_CD_FLAC:
+#ifdef HAVE_FLAC
+			return &decoder->cdfl_codec_data;
+#endif
+			break;
+	}
+
+	return NULL;
+}
+
+/*-------------------------------------------------
+    decoder_init - allocate the compressed data
+    buffer and initialize the codecs of a decoder
+-------------------------------------------------*/
+
+static chd_error decoder_init(chd_file *chd, chd_decoder *decoder)
+{
+	int decompnum;
+
+	memset(decoder, 0, sizeof(*decoder));
+
+	decoder->compressed = (UINT8 *)malloc(chd->header.hunkbytes);
+	if (decoder->compressed == NULL)
+		return CHDERR_OUT_OF_MEMORY;
+
+	for (decompnum = 0; decompnum < ARRAY_SIZE(chd->codecintf); decompnum++)
+	{
+		void *codec;
+
+		if (chd->codecintf[decompnum] == NULL || chd->codecintf[decompnum]->init == NULL)
+			continue;
+
+		/* codec init failures are not fatal here; decompression
+		   will report them */
+		codec = decoder_codec(chd, decoder, decompnum);
+		if (codec != NULL)
+			(*chd->codecintf[decompnum]->init)(codec, chd->header.hunkbytes);
+	}
+
+	return CHDERR_NONE;
+}
+
+/*-------------------------------------------------
+    decoder_free - free the codecs and buffers of
+    a decoder
+-------------------------------------------------*/
+
+static void decoder_free(chd_file *chd, chd_decoder *decoder)
+{
+	int decompnum;
+
+	/* never initialized */
+	if (decoder->compressed == NULL)
+		return;
+
+	for (decompnum = 0; decompnum < ARRAY_SIZE(chd->codecintf); decompnum++)
+	{
+		void *codec;
+
+		if (chd->codecintf[decompnum] == NULL || chd->codecintf[decompnum]->free == NULL)
+			continue;
+
+		codec = decoder_codec(chd, decoder, decompnum);
+		if (codec != NULL)
+			(*chd->codecintf[decompnum]->free)(codec);
+	}
+
+	if (decoder->compressed != NULL)
+		free(decoder->compressed);
+	decoder->compressed = NULL;
+}
+
 /***************************************************************************
     INTERNAL HUNK READ/WRITE
 ***************************************************************************/
@@ -1521,7 +1917,7 @@ static chd_error hunk_read_into_cache(chd_file *chd, UINT32 hunknum)
 	chd->cachehunk = ~0;
 
 	/* otherwise, read the data */
-	err = hunk_read_into_memory(chd, hunknum, chd->cache);
+	err = hunk_read_into_memory(chd, &chd->decoder, hunknum, chd->cache);
 	if (err != CHDERR_NONE)
 		return err;
 
@@ -1531,29 +1927,41 @@ static chd_error hunk_read_into_cache(chd_file *chd, UINT32 hunknum)
 }
 #endif
 
-static UINT8* read_compressed(chd_file *chd, UINT64 offset, size_t size)
+/* seek and read from the underlying file; while chd_read_hunks() is
+   running, several threads may get here at once */
+static int64_t read_file(chd_file *chd, UINT64 offset, void *dest, size_t size)
 {
    int64_t bytes;
+#ifdef HAVE_THREADS
+   if (chd->io_lock)
+      slock_lock(chd->io_lock);
+#endif
+   filestream_seek(chd->file, offset, SEEK_SET);
+   bytes = filestream_read(chd->file, dest, size);
+#ifdef HAVE_THREADS
+   if (chd->io_lock)
+      slock_unlock(chd->io_lock);
+#endif
+   return bytes;
+}
+
+static UINT8* read_compressed(chd_file *chd, chd_decoder *decoder, UINT64 offset, size_t size)
+{
    if (chd->file_cache)
       return chd->file_cache + offset;
-   filestream_seek(chd->file, offset, SEEK_SET);
-   bytes = filestream_read(chd->file, chd->compressed, size);
-   if (bytes != size)
+   if (read_file(chd, offset, decoder->compressed, size) != size)
       return NULL;
-   return chd->compressed;
+   return decoder->compressed;
 }
 
 static chd_error read_uncompressed(chd_file *chd, UINT64 offset, size_t size, UINT8 *dest)
 {
-   int64_t bytes;
    if (chd->file_cache)
    {
       memcpy(dest, chd->file_cache + offset, size);
       return CHDERR_NONE;
    }
-   filestream_seek(chd->file, offset, SEEK_SET);
-   bytes = filestream_read(chd->file, dest, size);
-   if (bytes != size)
+   if (read_file(chd, offset, dest, size) != size)
       return CHDERR_READ_ERROR;
    return CHDERR_NONE;
 }
@@ -1563,7 +1971,7 @@ static chd_error read_uncompressed(chd_file *chd, UINT64 offset, size_t size, UI
     memory at the given location
 -------------------------------------------------*/
 
-static chd_error hunk_read_into_memory(chd_file *chd, UINT32 hunknum, UINT8 *dest)
+static chd_error hunk_read_into_memory(chd_file *chd, chd_decoder *decoder, UINT32 hunknum, UINT8 *dest)
 {
 	chd_error err;
 
@@ -1590,7 +1998,7 @@ static chd_error hunk_read_into_memory(chd_file *chd, UINT32 hunknum, UINT8 *des
 			case MAP_ENTRY_TYPE_COMPRESSED:
             {
                void *codec;
-               UINT8 *bytes = read_compressed(chd, entry->offset,
+               UINT8 *bytes = read_compressed(chd, decoder, entry->offset,
                      entry->length);
                if (bytes == NULL)
                   return CHDERR_READ_ERROR;
@@ -1598,9 +2006,9 @@ static chd_error hunk_read_into_memory(chd_file *chd, UINT32 hunknum, UINT8 *des
 #ifdef HAVE_ZLIB
                /* now decompress using the codec */
                err   = CHDERR_NONE;
-               codec = &chd->zlib_codec_data;
+               codec = &decoder->zlib_codec_data;
                if (chd->codecintf[0]->decompress != NULL)
-                  err = (*chd->codecintf[0]->decompress)(codec, chd->compressed, entry->length, dest, chd->header.hunkbytes);
+                  err = (*chd->codecintf[0]->decompress)(codec, bytes, entry->length, dest, chd->header.hunkbytes);
                if (err != CHDERR_NONE)
                   return err;
 #endif
@@ -1627,11 +2035,11 @@ static chd_error hunk_read_into_memory(chd_file *chd, UINT32 hunknum, UINT8 *des
 				if (chd->cachehunk == entry->offset && dest == chd->cache)
 					break;
 #endif
-				return hunk_read_into_memory(chd, (UINT32)entry->offset, dest);
+				return hunk_read_into_memory(chd, decoder, (UINT32)entry->offset, dest);
 
 			/* parent-referenced data */
 			case MAP_ENTRY_TYPE_PARENT_HUNK:
-				err = hunk_read_into_memory(chd->parent, (UINT32)entry->offset, dest);
+				err = hunk_read_into_memory(chd->parent, &chd->parent->decoder, (UINT32)entry->offset, dest);
 				if (err != CHDERR_NONE)
 					return err;
 				break;
@@ -1679,32 +2087,32 @@ static chd_error hunk_read_into_memory(chd_file *chd, UINT32 hunknum, UINT8 *des
 			case COMPRESSION_TYPE_1:
 			case COMPRESSION_TYPE_2:
 			case COMPRESSION_TYPE_3:
-            bytes = read_compressed(chd, blockoffs, blocklen);
+            bytes = read_compressed(chd, decoder, blockoffs, blocklen);
             if (bytes == NULL)
                return CHDERR_READ_ERROR;
 				switch (chd->codecintf[rawmap[0]]->compression)
 				{
 					case CHD_CODEC_CD_LZMA:
 #ifdef HAVE_7ZIP
-						codec = &chd->cdlz_codec_data;
+						codec = &decoder->cdlz_codec_data;
 #endif
 						break;
 
 					case CHD_CODEC_CD_ZLIB:
 #ifdef HAVE_ZLIB
-						codec = &chd->cdzl_codec_data;
+						codec = &decoder->cdzl_codec_data;
 #endif
 						break;
 
 					case CHD_CODEC_CD_FLAC:
 #ifdef HAVE_FLAC
-						codec = &chd->cdfl_codec_data;
+						codec = &decoder->cdfl_codec_data;
 #endif
 						break;
 				}
 				if (codec==NULL)
 					return CHDERR_CODEC_ERROR;
-				err = (*chd->codecintf[rawmap[0]]->decompress)(codec, chd->compressed, blocklen, dest, chd->header.hunkbytes);
+				err = (*chd->codecintf[rawmap[0]]->decompress)(codec, bytes, blocklen, dest, chd->header.hunkbytes);
 				if (err != CHDERR_NONE)
 					return err;
 #ifdef VERIFY_BLOCK_CRC
@@ -1724,7 +2132,7 @@ static chd_error hunk_read_into_memory(chd_file *chd, UINT32 hunknum, UINT8 *des
 				return CHDERR_NONE;
 
 			case COMPRESSION_SELF:
-				return hunk_read_into_memory(chd, (UINT32)blockoffs, dest);
+				return hunk_read_into_memory(chd, decoder, (UINT32)blockoffs, dest);
 
 			case COMPRESSION_PARENT:
 #if 0
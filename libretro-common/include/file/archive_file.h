@@ -40,6 +40,7 @@
 RETRO_BEGIN_DECLS
 
 struct archive_extract_userdata;
+struct decompress_pool;
 
 enum file_archive_transfer_type
 {
@@ -100,6 +101,8 @@ typedef struct
 
    file_archive_transfer_t archive;
    struct archive_extract_userdata *userdata;
+   /* Worker threads inflating entries, NULL to inflate on the task */
+   struct decompress_pool *pool;
 } decompress_state_t;
 
 struct archive_extract_userdata
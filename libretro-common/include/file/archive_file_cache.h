@@ -0,0 +1,80 @@
+/* Copyright  (C) 2010-2018 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (archive_file_cache.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef LIBRETRO_SDK_ARCHIVE_FILE_CACHE_H__
+#define LIBRETRO_SDK_ARCHIVE_FILE_CACHE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <boolean.h>
+
+#include <retro_common_api.h>
+
+RETRO_BEGIN_DECLS
+
+/* On-disk cache of files extracted from archives.
+ *
+ * Members are addressed the same way as for file_archive_compressed_read
+ * ("/path/to/archive.7z#member.ext") and keyed by archive path, archive
+ * size and modification time and member name, so an archive that changes
+ * on disk is extracted again. The cache lives in its own directory; once
+ * its total size exceeds @max_size the least recently used entries are
+ * deleted. */
+
+/**
+ * file_archive_cache_extract:
+ * @dir                         : directory of the cache.
+ * @max_size                    : size limit of the cache, in bytes.
+ * @path                        : archive member, "archive#member".
+ * @out_path                    : receives the path of the extracted file.
+ * @len                         : size of @out_path.
+ *
+ * Looks @path up in the cache and extracts it there on a miss.
+ * The file at @out_path stays until it is evicted by a later call, so
+ * it must not be deleted as temporary content.
+ *
+ * Returns: true on success. False if the member could not be extracted
+ * or does not fit in the cache, in which case the caller should extract
+ * it itself.
+ **/
+bool file_archive_cache_extract(const char *dir, uint64_t max_size,
+      const char *path, char *out_path, size_t len);
+
+/**
+ * file_archive_cache_read:
+ * @dir                         : directory of the cache.
+ * @max_size                    : size limit of the cache, in bytes.
+ * @path                        : archive member, "archive#member".
+ * @buf                         : receives the member's data.
+ * @length                      : receives the size of @buf.
+ *
+ * Like file_archive_compressed_read() into memory, but reads the member
+ * from the cache when present and adds it to the cache otherwise.
+ *
+ * Returns: true on success, otherwise false.
+ **/
+bool file_archive_cache_read(const char *dir, uint64_t max_size,
+      const char *path, void **buf, int64_t *length);
+
+RETRO_END_DECLS
+
+#endif
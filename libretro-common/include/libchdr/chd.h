@@ -346,6 +346,9 @@ chd_error chd_open(const char *filename, int mode, chd_file *parent, chd_file **
 /* precache underlying file */
 chd_error chd_precache(chd_file *chd);
 
+/* decompress every hunk into memory, using up to 'threads' threads */
+chd_error chd_precache_hunks(chd_file *chd, UINT32 threads);
+
 /* close a CHD file */
 void chd_close(chd_file *chd);
 
@@ -365,6 +368,11 @@ const chd_header *chd_get_header(chd_file *chd);
 /* read one hunk from the CHD file */
 chd_error chd_read(chd_file *chd, UINT32 hunknum, void *buffer);
 
+/* read 'count' consecutive hunks, decompressing them on up to 'threads'
+   threads; 'buffer' must hold count * hunkbytes bytes. The threads are
+   started on first use and kept until chd_close() */
+chd_error chd_read_hunks(chd_file *chd, UINT32 hunknum, UINT32 count, void *buffer, UINT32 threads);
+
 /* ----- metadata management ----- */
 
 /* get indexed metadata of a particular sort */
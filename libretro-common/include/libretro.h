@@ -1273,6 +1273,20 @@ struct retro_vfs_file_handle;
  * Introduced in VFS API v3 */
 struct retro_vfs_dir_handle;
 
+/* Opaque queue of asynchronous reads
+ * Introduced in VFS API v4 */
+struct retro_vfs_async_queue;
+
+/* Completed asynchronous read
+ * Introduced in VFS API v4 */
+struct retro_vfs_async_result
+{
+   /* userdata passed to async_read */
+   void *userdata;
+   /* Number of bytes read, less than requested at the end of the file, or -1 for error */
+   int64_t bytes;
+};
+
 /* File open flags
  * Introduced in VFS API v1 */
 #define RETRO_VFS_FILE_ACCESS_READ            (1 << 0) /* Read only mode */
@@ -1381,6 +1395,35 @@ typedef bool (RETRO_CALLCONV *retro_vfs_dirent_is_dir_t)(struct retro_vfs_dir_ha
  * Introduced in VFS API v3 */
 typedef int (RETRO_CALLCONV *retro_vfs_closedir_t)(struct retro_vfs_dir_handle *dirstream);
 
+/* Create a queue for reads that run in the background. depth is the maximum number of reads queued
+ * but not returned by async_wait yet. Returns the opaque queue handle, or NULL for error.
+ * Introduced in VFS API v4 */
+typedef struct retro_vfs_async_queue *(RETRO_CALLCONV *retro_vfs_async_open_t)(unsigned depth);
+
+/* Queue a read of len bytes at offset from the start of the file. Does not move the read / write position of stream.
+ * stream and s must stay valid until the read is returned by async_wait. Returns 0 on success, or -1 for error
+ * (including a full queue, in which case async_wait has to be called first).
+ * Introduced in VFS API v4 */
+typedef int (RETRO_CALLCONV *retro_vfs_async_read_t)(struct retro_vfs_async_queue *queue, struct retro_vfs_file_handle *stream, void *s, uint64_t len, int64_t offset, void *userdata);
+
+/* Wait until at least min_complete queued reads have completed (or all of them, if fewer are queued),
+ * and store up to max completed reads into results, in no particular order. min_complete 0 only polls.
+ * Returns the number of results stored, or -1 for error.
+ * Introduced in VFS API v4 */
+typedef int (RETRO_CALLCONV *retro_vfs_async_wait_t)(struct retro_vfs_async_queue *queue, struct retro_vfs_async_result *results, unsigned max, unsigned min_complete);
+
+/* Wait for the queued reads and release the queue. Returns 0 on success, -1 on failure.
+ * Introduced in VFS API v4 */
+typedef int (RETRO_CALLCONV *retro_vfs_async_close_t)(struct retro_vfs_async_queue *queue);
+
+/* Get a read-only pointer to the contents of a file, starting at offset, without copying them.
+ * Stores the number of bytes that can be read from the pointer into len, which may be less than the rest of the file.
+ * Only available for files the frontend keeps in memory, typically those opened for reading with
+ * RETRO_VFS_FILE_ACCESS_HINT_FREQUENT_ACCESS. The pointer stays valid until the file is closed and
+ * the read / write position does not change. Returns NULL if the region is not available, read() still works then.
+ * Introduced in VFS API v5 */
+typedef const void *(RETRO_CALLCONV *retro_vfs_get_mapped_t)(struct retro_vfs_file_handle *stream, int64_t offset, uint64_t *len);
+
 struct retro_vfs_interface
 {
    /* VFS API v1 */
@@ -1405,6 +1448,13 @@ struct retro_vfs_interface
    retro_vfs_dirent_get_name_t dirent_get_name;
    retro_vfs_dirent_is_dir_t dirent_is_dir;
    retro_vfs_closedir_t closedir;
+   /* VFS API v4 */
+   retro_vfs_async_open_t async_open;
+   retro_vfs_async_read_t async_read;
+   retro_vfs_async_wait_t async_wait;
+   retro_vfs_async_close_t async_close;
+   /* VFS API v5 */
+   retro_vfs_get_mapped_t get_mapped;
 };
 
 struct retro_vfs_interface_info
@@ -73,6 +73,22 @@ struct string_list *dir_list_new(const char *dir, const char *ext,
  **/
 void dir_list_sort(struct string_list *list, bool dir_first);
 
+/**
+ * dir_list_merge:
+ * @list      : sorted directory listing.
+ * @batch     : entries to add to the listing.
+ * @dir_first : move the directories in the listing to the top?
+ *
+ * Sorts @batch and merges it into @list, which stays sorted the same
+ * way as by dir_list_sort. The entries are moved rather than copied,
+ * @batch is left empty.
+ *
+ * Returns: true on success, false if out of memory (both lists are
+ * then left as they were).
+ **/
+bool dir_list_merge(struct string_list *list,
+      struct string_list *batch, bool dir_first);
+
 /**
  * dir_list_free:
  * @list : pointer to the directory listing
@@ -82,6 +98,48 @@ void dir_list_sort(struct string_list *list, bool dir_first);
  **/
 void dir_list_free(struct string_list *list);
 
+typedef struct dir_list_stream dir_list_stream_t;
+
+/**
+ * dir_list_stream_new:
+ * @dir                : directory path.
+ * @ext                : allowed extensions of file directory entries to include.
+ * @include_dirs       : include directories as part of the finished directory listing?
+ * @include_hidden     : include hidden files and directories as part of the finished directory listing?
+ * @include_compressed : include compressed files, even when not part of ext.
+ *
+ * Opens a directory to be listed a few entries at a time with
+ * dir_list_stream_read, with the same filtering as dir_list_new.
+ *
+ * Returns: the stream, NULL if the directory could not be opened.
+ * Has to be freed with dir_list_stream_free.
+ **/
+dir_list_stream_t *dir_list_stream_new(const char *dir, const char *ext,
+      bool include_dirs, bool include_hidden, bool include_compressed);
+
+/**
+ * dir_list_stream_read:
+ * @stream             : directory stream.
+ * @list               : the string list to add files to.
+ * @max                : number of directory entries to go through,
+ *                       whether they pass the filters or not.
+ *
+ * Appends the next entries of a directory listing to @list.
+ *
+ * Returns: 1 if there are more entries to read, 0 at the end of the
+ * directory, -1 on error.
+ **/
+int dir_list_stream_read(dir_list_stream_t *stream,
+      struct string_list *list, size_t max);
+
+/**
+ * dir_list_stream_free:
+ * @stream             : directory stream.
+ *
+ * Closes a directory stream.
+ **/
+void dir_list_stream_free(dir_list_stream_t *stream);
+
 RETRO_END_DECLS
 
 #endif
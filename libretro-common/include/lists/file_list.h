@@ -44,10 +44,16 @@ struct item_file
    void *actiondata;
 };
 
+struct file_list_arena;
+
 typedef struct file_list
 {
    struct item_file *list;
 
+   /* Block the entry strings are allocated from, NULL when every
+    * string is a separate allocation */
+   struct file_list_arena *arena;
+
    size_t capacity;
    size_t size;
 } file_list_t;
@@ -82,6 +88,22 @@ void file_list_free(file_list_t *list);
  */
 bool file_list_reserve(file_list_t *list, size_t nitems);
 
+/**
+ * @brief makes the list allocate its entry strings from an arena
+ *
+ * Path, label and alt strings are then carved from blocks owned by
+ * the list and released all at once by file_list_clear, instead of
+ * one malloc and free per string. Strings replaced or popped before
+ * that stay allocated until the next clear.
+ *
+ * Only for lists whose strings are never freed or assigned directly,
+ * without going through the file_list functions.
+ *
+ * @param list an empty list
+ * @return whether or not the operation succeeded
+ */
+bool file_list_use_arena(file_list_t *list);
+
 bool file_list_append(file_list_t *userdata, const char *path,
       const char *label, unsigned type, size_t current_directory_ptr,
       size_t entry_index);
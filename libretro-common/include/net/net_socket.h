@@ -58,6 +58,15 @@ typedef struct socket_target
    enum socket_protocol prot;
 } socket_target_t;
 
+/* Most buffers a single vectored send accepts */
+#define SOCKET_IOV_MAX 16
+
+typedef struct socket_iov
+{
+   const void *data;
+   size_t size;
+} socket_iov_t;
+
 int socket_init(void **address, uint16_t port, const char *server, enum socket_type type);
 
 int socket_next(void **address);
@@ -74,6 +83,31 @@ int socket_send_all_blocking(int fd, const void *data_, size_t size, bool no_sig
 ssize_t socket_send_all_nonblocking(int fd, const void *data_, size_t size,
       bool no_signal);
 
+/**
+ * socket_send_iov_all_blocking:
+ * @fd                   : socket
+ * @iov                  : buffers to send, in order
+ * @count                : number of buffers, at most SOCKET_IOV_MAX
+ * @no_signal            : don't raise SIGPIPE on a closed peer
+ *
+ * Send several buffers as one stream of data, using scatter/gather I/O
+ * where the platform has it.
+ *
+ * Returns: true on success, false on socket error.
+ **/
+int socket_send_iov_all_blocking(int fd, const socket_iov_t *iov,
+      size_t count, bool no_signal);
+
+/**
+ * socket_send_iov_all_nonblocking:
+ *
+ * As socket_send_iov_all_blocking, but stops when the socket would block.
+ *
+ * Returns: number of bytes sent, or -1 on socket error.
+ **/
+ssize_t socket_send_iov_all_nonblocking(int fd, const socket_iov_t *iov,
+      size_t count, bool no_signal);
+
 int socket_receive_all_blocking(int fd, void *data_, size_t size);
 
 ssize_t socket_receive_all_nonblocking(int fd, bool *error,
@@ -24,8 +24,10 @@
 #define __LIBRETRO_SDK_MSG_QUEUE_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include <retro_common_api.h>
+#include <boolean.h>
 
 RETRO_BEGIN_DECLS
 
@@ -64,18 +66,50 @@ msg_queue_t *msg_queue_new(size_t size);
  *                      before it vanishes (E.g. show a message for
  *                      3 seconds @ 60fps = 180 duration).
  *
- * Push a new message onto the queue.
+ * Push a new message onto the queue. Can be called from any thread,
+ * see msg_queue_submit.
  **/
 void msg_queue_push(msg_queue_t *queue, const char *msg,
       unsigned prio, unsigned duration,
       char *title,
       enum message_queue_icon icon, enum message_queue_category category);
 
+/**
+ * msg_queue_submit:
+ * @queue             : pointer to queue object
+ * @msg               : message to add to the queue
+ * @prio              : priority level of the message
+ * @duration          : how many times the message can be pulled
+ *                      before it vanishes
+ * @flush             : drop the queued messages first
+ * @tag               : identifies the sender, 0 for none
+ *
+ * Hands a message to the queue without blocking and without
+ * allocating. Can be called from any thread, concurrently with
+ * the thread pulling messages.
+ *
+ * The message is queued on the next pull. A message replaces the
+ * queued one with the same non-zero @tag, so that only the latest
+ * progress of e.g. a task is shown, and a message identical to an
+ * untagged queued one restarts its duration instead of being queued
+ * twice. @flush only replaces the message with the same @tag when
+ * @tag is set.
+ *
+ * Tags must not be reused while a message with them may still be
+ * queued, so use an id such as a task's ident rather than a pointer,
+ * whose address can come back once it is freed.
+ *
+ * Returns: false if too many messages are pending.
+ **/
+bool msg_queue_submit(msg_queue_t *queue, const char *msg,
+      unsigned prio, unsigned duration, bool flush, uint32_t tag);
+
 /**
  * msg_queue_pull:
  * @queue             : pointer to queue object
  *
- * Pulls highest priority message in queue.
+ * Pulls highest priority message in queue. Only one thread
+ * at a time may pull from or clear the queue.
  *
  * Returns: NULL if no message in queue, otherwise a string
  * containing the message.
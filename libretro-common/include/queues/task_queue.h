@@ -111,7 +111,7 @@ struct retro_task
 
    enum task_type type;
 
-   /* task identifier */
+   /* task identifier, unique and never 0 for tasks from task_init() */
    uint32_t ident;
 
    /* frontend userdata
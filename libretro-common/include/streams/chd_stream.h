@@ -27,6 +27,7 @@
 #include <stddef.h>
 
 #include <retro_common_api.h>
+#include <boolean.h>
 
 RETRO_BEGIN_DECLS
 
@@ -39,10 +40,32 @@ typedef struct chdstream chdstream_t;
 /* Primary (largest) data track, used for CRC identification purposes */
 #define CHDSTREAM_TRACK_PRIMARY (-3)
 
+/* Decompressed hunks cached per stream */
+#define CHDSTREAM_DEFAULT_CACHE_HUNKS 16
+/* Hunks decompressed ahead of the read cursor once reads are sequential */
+#define CHDSTREAM_DEFAULT_READ_AHEAD 4
+
 chdstream_t *chdstream_open(const char *path, int32_t track);
 
 void chdstream_close(chdstream_t *stream);
 
+/**
+ * chdstream_set_cache:
+ * @stream     : CHD stream.
+ * @hunks      : Number of decompressed hunks to keep in the LRU cache.
+ * @read_ahead : Number of hunks following the one being read that are
+ *               decompressed on a background thread once reads become
+ *               sequential. 0 disables read-ahead, which is always off
+ *               without HAVE_THREADS. Limited to @hunks - 2.
+ *
+ * Replaces the hunk cache of @stream, dropping everything cached so far.
+ *
+ * Returns: true on success, false if @hunks is 0 or on allocation
+ * failure, in which case the previous cache is kept.
+ **/
+bool chdstream_set_cache(chdstream_t *stream, unsigned hunks,
+      unsigned read_ahead);
+
 ssize_t chdstream_read(chdstream_t *stream, void *data, size_t bytes);
 
 int chdstream_getc(chdstream_t *stream);
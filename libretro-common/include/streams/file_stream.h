@@ -103,6 +103,71 @@ int filestream_rename(const char *old_path, const char *new_path);
 
 const char* filestream_get_path(RFILE *stream);
 
+/**
+ * filestream_get_mapped:
+ * @stream             : file opened for reading with
+ *                       RETRO_VFS_FILE_ACCESS_HINT_FREQUENT_ACCESS
+ * @len                : size of the mapping
+ *
+ * Reads without copying. With the VFS of a frontend, this needs
+ * VFS API v5.
+ *
+ * Returns: read-only pointer to the whole file contents, valid until
+ * @stream is closed, or NULL if the file is not memory-mapped.
+ */
+const void *filestream_get_mapped(RFILE *stream, int64_t *len);
+
+/**
+ * filestream_async_open:
+ * @depth              : maximum number of reads queued and not
+ *                       returned by filestream_async_wait yet.
+ *
+ * Creates a queue of reads that run in the background, so that I/O of
+ * several reads overlaps with each other and with the caller's work.
+ *
+ * Returns: the queue, NULL on error or if the VFS in use has no
+ * asynchronous reads. Callers then fall back to filestream_read.
+ */
+struct retro_vfs_async_queue *filestream_async_open(unsigned depth);
+
+/**
+ * filestream_async_read:
+ * @queue              : queue from filestream_async_open.
+ * @stream             : file to read from, open until the read completed.
+ * @s                  : destination, valid until the read completed.
+ * @len                : bytes to read.
+ * @offset             : position in the file, the stream position
+ *                       does not change.
+ * @userdata           : returned with the result.
+ *
+ * Returns: 0 if the read was queued, -1 on error or if the queue is full.
+ */
+int filestream_async_read(struct retro_vfs_async_queue *queue,
+      RFILE *stream, void *s, int64_t len, int64_t offset, void *userdata);
+
+/**
+ * filestream_async_wait:
+ * @queue              : queue from filestream_async_open.
+ * @results            : where to store completed reads.
+ * @max                : size of @results.
+ * @min_complete       : number of reads to wait for, 0 to only poll.
+ *
+ * Returns: number of completed reads stored, -1 on error.
+ */
+int filestream_async_wait(struct retro_vfs_async_queue *queue,
+      struct retro_vfs_async_result *results, unsigned max,
+      unsigned min_complete);
+
+/**
+ * filestream_async_close:
+ * @queue              : queue from filestream_async_open.
+ *
+ * Waits for the queued reads and frees the queue.
+ *
+ * Returns: 0 on success, -1 on error.
+ */
+int filestream_async_close(struct retro_vfs_async_queue *queue);
+
 bool filestream_exists(const char *path);
 
 /* Returned pointer must be freed by the caller. */
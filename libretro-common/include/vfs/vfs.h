@@ -106,6 +106,12 @@ typedef struct retro_vfs_dir_handle libretro_vfs_implementation_dir;
 typedef struct libretro_vfs_implementation_dir libretro_vfs_implementation_dir;
 #endif
 
+#ifdef VFS_FRONTEND
+typedef struct retro_vfs_async_queue libretro_vfs_implementation_async_queue;
+#else
+typedef struct libretro_vfs_implementation_async_queue libretro_vfs_implementation_async_queue;
+#endif
+
 RETRO_END_DECLS
 
 #endif
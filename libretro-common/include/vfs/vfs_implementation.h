@@ -57,6 +57,11 @@ int retro_vfs_file_rename_impl(const char *old_path, const char *new_path);
 
 const char *retro_vfs_file_get_path_impl(libretro_vfs_implementation_file *stream);
 
+/* Read-only view of a file opened with RETRO_VFS_FILE_ACCESS_HINT_FREQUENT_ACCESS, starting at offset,
+ * valid until the file is closed. Stores the bytes left from offset to the end of the file into len.
+ * NULL if the file could not be mapped or offset is past the end. */
+const void *retro_vfs_file_get_mapped_impl(libretro_vfs_implementation_file *stream, int64_t offset, uint64_t *len);
+
 int retro_vfs_stat_impl(const char *path, int32_t *size);
 
 int retro_vfs_mkdir_impl(const char *dir);
@@ -71,6 +76,14 @@ bool retro_vfs_dirent_is_dir_impl(libretro_vfs_implementation_dir *dirstream);
 
 int retro_vfs_closedir_impl(libretro_vfs_implementation_dir *dirstream);
 
+libretro_vfs_implementation_async_queue *retro_vfs_async_open_impl(unsigned depth);
+
+int retro_vfs_async_read_impl(libretro_vfs_implementation_async_queue *queue, libretro_vfs_implementation_file *stream, void *s, uint64_t len, int64_t offset, void *userdata);
+
+int retro_vfs_async_wait_impl(libretro_vfs_implementation_async_queue *queue, struct retro_vfs_async_result *results, unsigned max, unsigned min_complete);
+
+int retro_vfs_async_close_impl(libretro_vfs_implementation_async_queue *queue);
+
 RETRO_END_DECLS
 
 #endif
@@ -74,6 +74,60 @@ void dir_list_sort(struct string_list *list, bool dir_first)
             dir_first ? qstrcmp_dir : qstrcmp_plain);
 }
 
+/**
+ * dir_list_merge:
+ * @list      : sorted directory listing.
+ * @batch     : entries to add to the listing.
+ * @dir_first : move the directories in the listing to the top?
+ *
+ * Sorts @batch and merges it into @list, which stays sorted the same
+ * way as by dir_list_sort. The entries are moved rather than copied,
+ * @batch is left empty.
+ *
+ * Returns: true on success, false if out of memory (both lists are
+ * then left as they were).
+ **/
+bool dir_list_merge(struct string_list *list,
+      struct string_list *batch, bool dir_first)
+{
+   size_t i = 0, j = 0, k = 0;
+   size_t cap;
+   struct string_list_elem *elems = NULL;
+   int (*cmp)(const void*, const void*) = dir_first
+      ? qstrcmp_dir : qstrcmp_plain;
+
+   if (!list || !batch || batch->size == 0)
+      return true;
+
+   cap   = list->size + batch->size + 32;
+   elems = (struct string_list_elem*)malloc(cap * sizeof(*elems));
+
+   if (!elems)
+      return false;
+
+   dir_list_sort(batch, dir_first);
+
+   while (i < list->size && j < batch->size)
+   {
+      /* Ties keep the entries already listed first */
+      if (cmp(&batch->elems[j], &list->elems[i]) < 0)
+         elems[k++] = batch->elems[j++];
+      else
+         elems[k++] = list->elems[i++];
+   }
+   while (i < list->size)
+      elems[k++] = list->elems[i++];
+   while (j < batch->size)
+      elems[k++] = batch->elems[j++];
+
+   free(list->elems);
+   list->elems = elems;
+   list->size  = k;
+   list->cap   = cap;
+   batch->size = 0;
+   return true;
+}
+
 /**
  * dir_list_free:
  * @list : pointer to the directory listing
@@ -86,6 +140,13 @@ void dir_list_free(struct string_list *list)
    string_list_free(list);
 }
 
+/* Adds the entry @entry of @dir to @list if it passes the filters.
+ * Returns -1 on error, 0 otherwise. */
+static int dir_list_read_entry(const char *dir, struct RDIR *entry,
+      struct string_list *list, struct string_list *ext_list,
+      bool include_dirs, bool include_hidden,
+      bool include_compressed, bool recursive);
+
 /**
  * dir_list_read:
  * @dir                : directory path.
@@ -112,57 +173,8 @@ static int dir_list_read(const char *dir,
 
    while (retro_readdir(entry))
    {
-      union string_list_elem_attr attr;
-      char file_path[PATH_MAX_LENGTH];
-      const char *name                = retro_dirent_get_name(entry);
-
-      if (!include_hidden && *name == '.')
-         continue;
-      if (!strcmp(name, ".") || !strcmp(name, ".."))
-         continue;
-
-      file_path[0] = '\0';
-      fill_pathname_join(file_path, dir, name, sizeof(file_path));
-
-      if (retro_dirent_is_dir(entry, NULL))
-      {
-         if (recursive)
-            dir_list_read(file_path, list, ext_list, include_dirs,
-                  include_hidden, include_compressed, recursive);
-
-         if (!include_dirs)
-            continue;
-         attr.i = RARCH_DIRECTORY;
-      }
-      else
-      {
-         const char *file_ext    = path_get_extension(name);
-
-         attr.i                  = RARCH_FILETYPE_UNSET;
-
-         /*
-          * If the file format is explicitly supported by the libretro-core, we
-          * need to immediately load it and not designate it as a compressed file.
-          *
-          * Example: .zip could be supported as a image by the core and as a
-          * compressed_file. In that case, we have to interpret it as a image.
-          *
-          * */
-         if (string_list_find_elem_prefix(ext_list, ".", file_ext))
-            attr.i            = RARCH_PLAIN_FILE;
-         else
-         {
-            bool is_compressed_file;
-            if ((is_compressed_file = path_is_compressed_file(file_path)))
-               attr.i               = RARCH_COMPRESSED_ARCHIVE;
-
-            if (ext_list &&
-                  (!is_compressed_file || !include_compressed))
-               continue;
-         }
-      }
-
-      if (!string_list_append(list, file_path, attr))
+      if (dir_list_read_entry(dir, entry, list, ext_list, include_dirs,
+               include_hidden, include_compressed, recursive) == -1)
          goto error;
    }
 
@@ -176,6 +188,67 @@ error:
    return -1;
 }
 
+static int dir_list_read_entry(const char *dir, struct RDIR *entry,
+      struct string_list *list, struct string_list *ext_list,
+      bool include_dirs, bool include_hidden,
+      bool include_compressed, bool recursive)
+{
+   union string_list_elem_attr attr;
+   char file_path[PATH_MAX_LENGTH];
+   const char *name                = retro_dirent_get_name(entry);
+
+   if (!include_hidden && *name == '.')
+      return 0;
+   if (!strcmp(name, ".") || !strcmp(name, ".."))
+      return 0;
+
+   file_path[0] = '\0';
+   fill_pathname_join(file_path, dir, name, sizeof(file_path));
+
+   if (retro_dirent_is_dir(entry, NULL))
+   {
+      if (recursive)
+         dir_list_read(file_path, list, ext_list, include_dirs,
+               include_hidden, include_compressed, recursive);
+
+      if (!include_dirs)
+         return 0;
+      attr.i = RARCH_DIRECTORY;
+   }
+   else
+   {
+      const char *file_ext    = path_get_extension(name);
+
+      attr.i                  = RARCH_FILETYPE_UNSET;
+
+      /*
+       * If the file format is explicitly supported by the libretro-core, we
+       * need to immediately load it and not designate it as a compressed file.
+       *
+       * Example: .zip could be supported as a image by the core and as a
+       * compressed_file. In that case, we have to interpret it as a image.
+       *
+       * */
+      if (string_list_find_elem_prefix(ext_list, ".", file_ext))
+         attr.i            = RARCH_PLAIN_FILE;
+      else
+      {
+         bool is_compressed_file;
+         if ((is_compressed_file = path_is_compressed_file(file_path)))
+            attr.i               = RARCH_COMPRESSED_ARCHIVE;
+
+         if (ext_list &&
+               (!is_compressed_file || !include_compressed))
+            return 0;
+      }
+   }
+
+   if (!string_list_append(list, file_path, attr))
+      return -1;
+
+   return 0;
+}
+
 /**
  * dir_list_append:
  * @list               : existing list to append to.
@@ -238,3 +311,101 @@ struct string_list *dir_list_new(const char *dir,
 
    return list;
 }
+
+struct dir_list_stream
+{
+   struct RDIR *entry;
+   struct string_list *ext_list;
+   char dir[PATH_MAX_LENGTH];
+   bool include_dirs;
+   bool include_hidden;
+   bool include_compressed;
+};
+
+/**
+ * dir_list_stream_new:
+ * @dir                : directory path.
+ * @ext                : allowed extensions of file directory entries to include.
+ * @include_dirs       : include directories as part of the finished directory listing?
+ * @include_hidden     : include hidden files and directories as part of the finished directory listing?
+ * @include_compressed : include compressed files, even when not part of ext.
+ *
+ * Opens a directory to be listed a few entries at a time with
+ * dir_list_stream_read, with the same filtering as dir_list_new.
+ *
+ * Returns: the stream, NULL if the directory could not be opened.
+ * Has to be freed with dir_list_stream_free.
+ **/
+dir_list_stream_t *dir_list_stream_new(const char *dir,
+      const char *ext, bool include_dirs,
+      bool include_hidden, bool include_compressed)
+{
+   dir_list_stream_t *stream = (dir_list_stream_t*)
+      calloc(1, sizeof(*stream));
+
+   if (!stream)
+      return NULL;
+
+   stream->entry = retro_opendir_include_hidden(dir, include_hidden);
+
+   if (!stream->entry || retro_dirent_error(stream->entry))
+   {
+      dir_list_stream_free(stream);
+      return NULL;
+   }
+
+   strlcpy(stream->dir, dir, sizeof(stream->dir));
+   stream->ext_list           = ext ? string_split(ext, "|") : NULL;
+   stream->include_dirs       = include_dirs;
+   stream->include_hidden     = include_hidden;
+   stream->include_compressed = include_compressed;
+
+   return stream;
+}
+
+/**
+ * dir_list_stream_read:
+ * @stream             : directory stream.
+ * @list               : the string list to add files to.
+ * @max                : number of directory entries to go through,
+ *                       whether they pass the filters or not.
+ *
+ * Appends the next entries of a directory listing to @list.
+ *
+ * Returns: 1 if there are more entries to read, 0 at the end of the
+ * directory, -1 on error.
+ **/
+int dir_list_stream_read(dir_list_stream_t *stream,
+      struct string_list *list, size_t max)
+{
+   while (max--)
+   {
+      if (!retro_readdir(stream->entry))
+         return 0;
+
+      if (dir_list_read_entry(stream->dir, stream->entry, list,
+               stream->ext_list, stream->include_dirs,
+               stream->include_hidden, stream->include_compressed,
+               false) == -1)
+         return -1;
+   }
+
+   return 1;
+}
+
+/**
+ * dir_list_stream_free:
+ * @stream             : directory stream.
+ *
+ * Closes a directory stream.
+ **/
+void dir_list_stream_free(dir_list_stream_t *stream)
+{
+   if (!stream)
+      return;
+
+   if (stream->entry)
+      retro_closedir(stream->entry);
+   string_list_free(stream->ext_list);
+   free(stream);
+}
@@ -29,6 +29,125 @@
 #include <string/stdstring.h>
 #include <compat/strcasestr.h>
 
+/* Smallest arena block, enough for the strings of a typical menu */
+#define FILE_LIST_ARENA_BLOCK_SIZE 16384
+
+struct file_list_arena
+{
+   /* Block allocated before this one, NULL for the first */
+   struct file_list_arena *prev;
+   size_t size;
+   size_t used;
+   char data[1];
+};
+
+static struct file_list_arena *file_list_arena_new(size_t size,
+      struct file_list_arena *prev)
+{
+   struct file_list_arena *arena = (struct file_list_arena*)
+      malloc(offsetof(struct file_list_arena, data) + size);
+
+   if (!arena)
+      return NULL;
+
+   arena->prev = prev;
+   arena->size = size;
+   arena->used = 0;
+
+   return arena;
+}
+
+static void file_list_arena_free(struct file_list_arena *arena)
+{
+   while (arena)
+   {
+      struct file_list_arena *prev = arena->prev;
+      free(arena);
+      arena = prev;
+   }
+}
+
+/* Forgets every string of the arena. When the strings did not fit
+ * in one block, the blocks are replaced by one as large as all of
+ * them together, so that refilling the list with as many strings
+ * does not allocate again. */
+static void file_list_arena_reset(file_list_t *list)
+{
+   struct file_list_arena *arena = list->arena;
+
+   if (arena->prev)
+   {
+      size_t total                  = 0;
+      struct file_list_arena *block = arena;
+      struct file_list_arena *fresh = NULL;
+
+      for (; block; block = block->prev)
+         total += block->size;
+
+      if ((fresh = file_list_arena_new(total, NULL)))
+      {
+         file_list_arena_free(arena);
+         list->arena = fresh;
+         return;
+      }
+
+      /* Out of memory, keep the last block only */
+      file_list_arena_free(arena->prev);
+      arena->prev = NULL;
+   }
+
+   arena->used = 0;
+}
+
+static char *file_list_strdup(file_list_t *list, const char *s)
+{
+   size_t len;
+   char *copy;
+   struct file_list_arena *arena = list->arena;
+
+   if (!arena)
+      return strdup(s);
+
+   len = strlen(s) + 1;
+
+   if (arena->size - arena->used < len)
+   {
+      size_t size = arena->size * 2;
+      if (size < len)
+         size = len;
+
+      if (!(arena = file_list_arena_new(size, arena)))
+         return NULL;
+
+      list->arena = arena;
+   }
+
+   copy         = arena->data + arena->used;
+   arena->used += len;
+   memcpy(copy, s, len);
+
+   return copy;
+}
+
+static void file_list_free_string(const file_list_t *list, char *s)
+{
+   /* Arena strings are released with the arena */
+   if (s && !list->arena)
+      free(s);
+}
+
+bool file_list_use_arena(file_list_t *list)
+{
+   if (!list || list->size != 0)
+      return false;
+
+   if (list->arena)
+      return true;
+
+   return (list->arena = file_list_arena_new(
+            FILE_LIST_ARENA_BLOCK_SIZE, NULL)) != NULL;
+}
+
 bool file_list_reserve(file_list_t *list, size_t nitems)
 {
    const size_t item_size = sizeof(struct item_file);
@@ -68,25 +187,14 @@ bool file_list_insert(file_list_t *list,
       size_t entry_idx,
       size_t idx)
 {
-   int i;
-
    /* Expand file list if needed */
    if (list->size >= list->capacity)
       if (!file_list_reserve(list, list->capacity * 2 + 1))
          return false;
 
-   for (i = (unsigned)list->size; i > (int)idx; i--)
-   {
-      struct item_file *copy = (struct item_file*)
-         calloc(1, sizeof(struct item_file));
-
-      memcpy(copy, &list->list[i-1], sizeof(struct item_file));
-
-      memcpy(&list->list[i-1], &list->list[i], sizeof(struct item_file));
-      memcpy(&list->list[i],             copy, sizeof(struct item_file));
-
-      free(copy);
-   }
+   if (idx < list->size)
+      memmove(&list->list[idx + 1], &list->list[idx],
+            (list->size - idx) * sizeof(struct item_file));
 
    list->list[idx].path          = NULL;
    list->list[idx].label         = NULL;
@@ -98,9 +206,9 @@ bool file_list_insert(file_list_t *list,
    list->list[idx].actiondata    = NULL;
 
    if (label)
-      list->list[idx].label      = strdup(label);
+      list->list[idx].label      = file_list_strdup(list, label);
    if (path)
-      list->list[idx].path       = strdup(path);
+      list->list[idx].path       = file_list_strdup(list, path);
 
    list->size++;
 
@@ -128,9 +236,9 @@ bool file_list_append(file_list_t *list,
    list->list[idx].actiondata    = NULL;
 
    if (label)
-      list->list[idx].label      = strdup(label);
+      list->list[idx].label      = file_list_strdup(list, label);
    if (path)
-      list->list[idx].path       = strdup(path);
+      list->list[idx].path       = file_list_strdup(list, path);
 
    list->size++;
 
@@ -158,12 +266,10 @@ void file_list_pop(file_list_t *list, size_t *directory_ptr)
    if (list->size != 0)
    {
       --list->size;
-      if (list->list[list->size].path)
-         free(list->list[list->size].path);
+      file_list_free_string(list, list->list[list->size].path);
       list->list[list->size].path = NULL;
 
-      if (list->list[list->size].label)
-         free(list->list[list->size].label);
+      file_list_free_string(list, list->list[list->size].label);
       list->list[list->size].label = NULL;
    }
 
@@ -183,21 +289,19 @@ void file_list_free(file_list_t *list)
       file_list_free_userdata(list, i);
       file_list_free_actiondata(list, i);
 
-      if (list->list[i].path)
-         free(list->list[i].path);
+      file_list_free_string(list, list->list[i].path);
       list->list[i].path = NULL;
 
-      if (list->list[i].label)
-         free(list->list[i].label);
+      file_list_free_string(list, list->list[i].label);
       list->list[i].label = NULL;
 
-      if (list->list[i].alt)
-         free(list->list[i].alt);
+      file_list_free_string(list, list->list[i].alt);
       list->list[i].alt = NULL;
    }
    if (list->list)
       free(list->list);
    list->list = NULL;
+   file_list_arena_free(list->arena);
    free(list);
 }
 
@@ -210,20 +314,20 @@ void file_list_clear(file_list_t *list)
 
    for (i = 0; i < list->size; i++)
    {
-      if (list->list[i].path)
-         free(list->list[i].path);
+      file_list_free_string(list, list->list[i].path);
       list->list[i].path = NULL;
 
-      if (list->list[i].label)
-         free(list->list[i].label);
+      file_list_free_string(list, list->list[i].label);
       list->list[i].label = NULL;
 
-      if (list->list[i].alt)
-         free(list->list[i].alt);
+      file_list_free_string(list, list->list[i].alt);
       list->list[i].alt = NULL;
    }
 
    list->size = 0;
+
+   if (list->arena)
+      file_list_arena_reset(list);
 }
 
 void file_list_set_label_at_offset(file_list_t *list, size_t idx,
@@ -232,12 +336,11 @@ void file_list_set_label_at_offset(file_list_t *list, size_t idx,
    if (!list)
       return;
 
-   if (list->list[idx].label)
-      free(list->list[idx].label);
+   file_list_free_string(list, list->list[idx].label);
    list->list[idx].alt      = NULL;
 
    if (label)
-      list->list[idx].label = strdup(label);
+      list->list[idx].label = file_list_strdup(list, label);
 }
 
 void file_list_get_label_at_offset(const file_list_t *list, size_t idx,
@@ -257,12 +360,11 @@ void file_list_set_alt_at_offset(file_list_t *list, size_t idx,
    if (!list || !alt)
       return;
 
-   if (list->list[idx].alt)
-      free(list->list[idx].alt);
+   file_list_free_string(list, list->list[idx].alt);
    list->list[idx].alt      = NULL;
 
    if (alt)
-      list->list[idx].alt   = strdup(alt);
+      list->list[idx].alt   = file_list_strdup(list, alt);
 }
 
 static int file_list_alt_cmp(const void *a_, const void *b_)
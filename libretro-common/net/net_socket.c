@@ -24,6 +24,11 @@
 #include <net/net_compat.h>
 #include <net/net_socket.h>
 
+#if defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__) || defined(__HAIKU__)
+#include <sys/uio.h>
+#define HAVE_SOCKET_SENDMSG
+#endif
+
 int socket_init(void **address, uint16_t port, const char *server, enum socket_type type)
 {
    char port_buf[16];
@@ -221,6 +226,112 @@ ssize_t socket_send_all_nonblocking(int fd, const void *data_, size_t size,
    return sent;
 }
 
+static ssize_t socket_send_iov(int fd, const socket_iov_t *iov,
+      size_t count, bool no_signal)
+{
+#if defined(_WIN32) && !defined(_XBOX)
+   WSABUF bufs[SOCKET_IOV_MAX];
+   DWORD sent = 0;
+   size_t i;
+
+   for (i = 0; i < count; i++)
+   {
+      bufs[i].buf = (char*)iov[i].data;
+      bufs[i].len = (ULONG)iov[i].size;
+   }
+
+   if (WSASend(fd, bufs, (DWORD)count, &sent, 0, NULL, NULL) != 0)
+      return SOCKET_ERROR;
+   return (ssize_t)sent;
+#elif defined(HAVE_SOCKET_SENDMSG)
+   struct iovec vec[SOCKET_IOV_MAX];
+   struct msghdr msg;
+   size_t i;
+
+   for (i = 0; i < count; i++)
+   {
+      vec[i].iov_base = (void*)iov[i].data;
+      vec[i].iov_len  = iov[i].size;
+   }
+
+   memset(&msg, 0, sizeof(msg));
+   msg.msg_iov    = vec;
+   msg.msg_iovlen = count;
+
+   return sendmsg(fd, &msg, no_signal ? MSG_NOSIGNAL : 0);
+#else
+   /* No scatter/gather here, the caller will come back for the rest */
+   return send(fd, (const char*)iov[0].data, iov[0].size,
+         no_signal ? MSG_NOSIGNAL : 0);
+#endif
+}
+
+static ssize_t socket_send_iov_all(int fd, const socket_iov_t *iov_,
+      size_t count, bool no_signal, bool block)
+{
+   socket_iov_t iov[SOCKET_IOV_MAX];
+   size_t first = 0;
+   ssize_t sent = 0;
+
+   if (count > SOCKET_IOV_MAX)
+      return -1;
+   memcpy(iov, iov_, count * sizeof(*iov));
+
+   while (first < count)
+   {
+      ssize_t ret;
+
+      if (!iov[first].size)
+      {
+         first++;
+         continue;
+      }
+
+      ret = socket_send_iov(fd, iov + first, count - first, no_signal);
+      if (ret <= 0)
+      {
+         if (isagain((int)ret))
+         {
+            if (block)
+               continue;
+            break;
+         }
+
+         if (ret == 0 && !block)
+            break;
+         return -1;
+      }
+
+      sent += ret;
+
+      /* Skip over whatever went out */
+      while (ret > 0)
+      {
+         size_t chunk = ((size_t)ret < iov[first].size)
+            ? (size_t)ret : iov[first].size;
+         iov[first].data  = (const uint8_t*)iov[first].data + chunk;
+         iov[first].size -= chunk;
+         ret             -= chunk;
+         if (!iov[first].size)
+            first++;
+      }
+   }
+
+   return sent;
+}
+
+int socket_send_iov_all_blocking(int fd, const socket_iov_t *iov,
+      size_t count, bool no_signal)
+{
+   return socket_send_iov_all(fd, iov, count, no_signal, true) >= 0;
+}
+
+ssize_t socket_send_iov_all_nonblocking(int fd, const socket_iov_t *iov,
+      size_t count, bool no_signal)
+{
+   return socket_send_iov_all(fd, iov, count, no_signal, false);
+}
+
 bool socket_bind(int fd, void *data)
 {
    int yes               = 1;
@@ -20,33 +20,134 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+
 #include <stdlib.h>
 #include <string.h>
 
 #include <boolean.h>
+#include <retro_inline.h>
 #include <queues/message_queue.h>
 #include <compat/strl.h>
-#include <compat/posix_string.h>
+#include <string/stdstring.h>
+
+/* Producers claim ring cells with atomic operations where the compiler
+ * provides them and fall back to a lock otherwise */
+#if defined(__ATOMIC_ACQUIRE)
+#define MSG_QUEUE_ATOMIC_BUILTINS
+#elif defined(_MSC_VER)
+#define MSG_QUEUE_ATOMIC_INTERLOCKED
+#if defined(_XBOX)
+#include <xtl.h>
+#else
+#include <windows.h>
+#endif
+#elif defined(HAVE_THREADS)
+#define MSG_QUEUE_ATOMIC_LOCK
+#include <rthreads/rthreads.h>
+#endif
+
+/* Longer messages are truncated */
+#define MSG_QUEUE_MSG_SIZE 256
+
+/* Minimum amount of submissions that can be pending between two pulls */
+#define MSG_QUEUE_MIN_CELLS 64
 
 struct queue_elem
 {
    unsigned duration;
    unsigned prio;
-   char *msg;
-
-   char *title;
-   enum message_queue_icon icon;
-   enum message_queue_category category;
+   /* Submission order, older messages are shown first
+    * among those with the same priority */
+   unsigned order;
+   uint32_t tag;
+   char msg[MSG_QUEUE_MSG_SIZE];
 };
 
+typedef struct msg_queue_cell
+{
+   /* Equals the ring position when the cell is free, position + 1
+    * once a producer has filled it. Accessed atomically. */
+   unsigned seq;
+   unsigned prio;
+   unsigned duration;
+   bool flush;
+   uint32_t tag;
+   char msg[MSG_QUEUE_MSG_SIZE];
+} msg_queue_cell_t;
+
 struct msg_queue
 {
+   /* Binary heap of queued messages, starting at index 1 */
    struct queue_elem **elems;
    size_t ptr;
    size_t size;
-   char *tmp_msg;
+
+   /* Storage for the queued messages and the entries not in use */
+   struct queue_elem *pool;
+   struct queue_elem **free_elems;
+   size_t free_count;
+   unsigned order;
+
+   /* Submission ring, written by any thread and drained by
+    * the thread pulling messages */
+   msg_queue_cell_t *cells;
+   unsigned cells_mask;
+   unsigned enqueue_pos;
+   unsigned dequeue_pos;
+#ifdef MSG_QUEUE_ATOMIC_LOCK
+   slock_t *lock;
+#endif
+
+   char tmp_msg[MSG_QUEUE_MSG_SIZE];
 };
 
+#if defined(MSG_QUEUE_ATOMIC_BUILTINS)
+#define msg_queue_load(ptr)       __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define msg_queue_store(ptr, val) __atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+#define msg_queue_cas(ptr, expected, desired) \
+   __atomic_compare_exchange_n((ptr), (expected), (desired), true, \
+         __ATOMIC_RELAXED, __ATOMIC_RELAXED)
+#elif defined(MSG_QUEUE_ATOMIC_INTERLOCKED)
+#define msg_queue_load(ptr) \
+   ((unsigned)InterlockedCompareExchange((volatile LONG*)(ptr), 0, 0))
+#define msg_queue_store(ptr, val) \
+   InterlockedExchange((volatile LONG*)(ptr), (LONG)(val))
+
+static INLINE bool msg_queue_cas(unsigned *ptr,
+      unsigned *expected, unsigned desired)
+{
+   unsigned prev = (unsigned)InterlockedCompareExchange(
+         (volatile LONG*)ptr, (LONG)desired, (LONG)*expected);
+   if (prev == *expected)
+      return true;
+   *expected = prev;
+   return false;
+}
+#else
+#define msg_queue_load(ptr)       (*(ptr))
+#define msg_queue_store(ptr, val) (*(ptr) = (val))
+
+static INLINE bool msg_queue_cas(unsigned *ptr,
+      unsigned *expected, unsigned desired)
+{
+   if (*ptr != *expected)
+   {
+      *expected = *ptr;
+      return false;
+   }
+   *ptr = desired;
+   return true;
+}
+#endif
+
+#ifdef MSG_QUEUE_ATOMIC_LOCK
+#define msg_queue_lock(queue)   slock_lock((queue)->lock)
+#define msg_queue_unlock(queue) slock_unlock((queue)->lock)
+#else
+#define msg_queue_lock(queue)
+#define msg_queue_unlock(queue)
+#endif
+
 /**
  * msg_queue_new:
  * @size              : maximum size of message
@@ -58,27 +159,47 @@ struct msg_queue
  **/
 msg_queue_t *msg_queue_new(size_t size)
 {
-   struct queue_elem **elems = NULL;
-   msg_queue_t *queue        = (msg_queue_t*)calloc(1, sizeof(*queue));
+   size_t i;
+   size_t cells   = MSG_QUEUE_MIN_CELLS;
+   msg_queue_t *queue = (msg_queue_t*)calloc(1, sizeof(*queue));
 
    if (!queue)
       return NULL;
 
-   queue->size = size + 1;
-
-   elems = (struct queue_elem**)calloc(queue->size,
-         sizeof(struct queue_elem*));
-
-   if (!elems)
-   {
-      free(queue);
-      return NULL;
-   }
-
-   queue->elems = elems;
-   queue->ptr   = 1;
+   while (cells < size * 16)
+      cells <<= 1;
+
+   queue->size       = size + 1;
+   queue->ptr        = 1;
+   queue->elems      = (struct queue_elem**)calloc(queue->size,
+         sizeof(*queue->elems));
+   queue->pool       = (struct queue_elem*)calloc(size + 1,
+         sizeof(*queue->pool));
+   queue->free_elems = (struct queue_elem**)calloc(size + 1,
+         sizeof(*queue->free_elems));
+   queue->cells      = (msg_queue_cell_t*)calloc(cells,
+         sizeof(*queue->cells));
+   queue->cells_mask = (unsigned)(cells - 1);
+#ifdef MSG_QUEUE_ATOMIC_LOCK
+   queue->lock       = slock_new();
+   if (!queue->lock)
+      goto error;
+#endif
+
+   if (!queue->elems || !queue->pool || !queue->free_elems || !queue->cells)
+      goto error;
+
+   for (i = 0; i < size; i++)
+      queue->free_elems[queue->free_count++] = &queue->pool[i];
+
+   for (i = 0; i < cells; i++)
+      queue->cells[i].seq = (unsigned)i;
 
    return queue;
+
+error:
+   msg_queue_free(queue);
+   return NULL;
 }
 
 /**
@@ -89,12 +210,94 @@ msg_queue_t *msg_queue_new(size_t size)
  **/
 void msg_queue_free(msg_queue_t *queue)
 {
-   if (queue)
+   if (!queue)
+      return;
+
+#ifdef MSG_QUEUE_ATOMIC_LOCK
+   if (queue->lock)
+      slock_free(queue->lock);
+#endif
+   free(queue->cells);
+   free(queue->free_elems);
+   free(queue->pool);
+   free(queue->elems);
+   free(queue);
+}
+
+/**
+ * msg_queue_submit:
+ * @queue             : pointer to queue object
+ * @msg               : message to add to the queue
+ * @prio              : priority level of the message
+ * @duration          : how many times the message can be pulled
+ *                      before it vanishes
+ * @flush             : drop the queued messages first
+ * @tag               : identifies the sender, 0 for none
+ *
+ * Hands a message to the queue without blocking and without
+ * allocating. Can be called from any thread, concurrently with
+ * the thread pulling messages.
+ *
+ * The message is queued on the next pull. A message replaces the
+ * queued one with the same non-zero @tag, so that only the latest
+ * progress of e.g. a task is shown, and a message identical to an
+ * untagged queued one restarts its duration instead of being queued
+ * twice. @flush only replaces the message with the same @tag when
+ * @tag is set.
+ *
+ * Tags must not be reused while a message with them may still be
+ * queued, so use an id such as a task's ident rather than a pointer,
+ * whose address can come back once it is freed.
+ *
+ * Returns: false if too many messages are pending.
+ **/
+bool msg_queue_submit(msg_queue_t *queue, const char *msg,
+      unsigned prio, unsigned duration, bool flush, uint32_t tag)
+{
+   unsigned pos;
+   msg_queue_cell_t *cell = NULL;
+
+   if (!queue || !msg)
+      return false;
+
+   msg_queue_lock(queue);
+
+   pos = msg_queue_load(&queue->enqueue_pos);
+
+   for (;;)
    {
-      msg_queue_clear(queue);
-      free(queue->elems);
+      int diff;
+
+      cell = &queue->cells[pos & queue->cells_mask];
+      diff = (int)(msg_queue_load(&cell->seq) - pos);
+
+      if (diff == 0)
+      {
+         /* Claim the cell, on failure pos is the current position */
+         if (msg_queue_cas(&queue->enqueue_pos, &pos, pos + 1))
+            break;
+      }
+      else if (diff < 0)
+      {
+         /* Ring is full */
+         msg_queue_unlock(queue);
+         return false;
+      }
+      else
+         pos = msg_queue_load(&queue->enqueue_pos);
    }
-   free(queue);
+
+   cell->prio     = prio;
+   cell->duration = duration;
+   cell->flush    = flush;
+   cell->tag      = tag;
+   strlcpy(cell->msg, msg, sizeof(cell->msg));
+
+   msg_queue_store(&cell->seq, pos + 1);
+
+   msg_queue_unlock(queue);
+
+   return true;
 }
 
 /**
@@ -106,45 +309,173 @@ void msg_queue_free(msg_queue_t *queue)
  *                      before it vanishes (E.g. show a message for
  *                      3 seconds @ 60fps = 180 duration).
  *
- * Push a new message onto the queue.
+ * Push a new message onto the queue. Can be called from any thread,
+ * see msg_queue_submit.
  **/
 void msg_queue_push(msg_queue_t *queue, const char *msg,
       unsigned prio, unsigned duration,
       char *title,
       enum message_queue_icon icon, enum message_queue_category category)
 {
-   size_t tmp_ptr = 0;
-   struct queue_elem *new_elem = NULL;
+   msg_queue_submit(queue, msg, prio, duration, false, 0);
+}
 
-   if (!queue || queue->ptr >= queue->size)
-      return;
+static INLINE bool msg_queue_elem_before(
+      const struct queue_elem *a, const struct queue_elem *b)
+{
+   if (a->prio != b->prio)
+      return a->prio > b->prio;
+   return (int)(a->order - b->order) < 0;
+}
 
-   new_elem                      = (struct queue_elem*)
-      calloc(1, sizeof(struct queue_elem));
-   if (!new_elem)
-      return;
+static void msg_queue_sift_up(msg_queue_t *queue, size_t i)
+{
+   while (i > 1)
+   {
+      struct queue_elem *parent = queue->elems[i >> 1];
+      struct queue_elem *child  = queue->elems[i];
+
+      if (!msg_queue_elem_before(child, parent))
+         break;
+
+      queue->elems[i >> 1] = child;
+      queue->elems[i]      = parent;
+      i                  >>= 1;
+   }
+}
 
-   new_elem->prio                = prio;
-   new_elem->duration            = duration;
-   new_elem->msg                 = msg ? strdup(msg) : NULL;
+static void msg_queue_sift_down(msg_queue_t *queue, size_t i)
+{
+   for (;;)
+   {
+      struct queue_elem *parent = NULL;
+      size_t left               = i * 2;
+      size_t right              = left + 1;
+      size_t first              = i;
+
+      if (left < queue->ptr
+            && msg_queue_elem_before(queue->elems[left], queue->elems[first]))
+         first = left;
+      if (right < queue->ptr
+            && msg_queue_elem_before(queue->elems[right], queue->elems[first]))
+         first = right;
+
+      if (first == i)
+         break;
+
+      parent                = queue->elems[i];
+      queue->elems[i]       = queue->elems[first];
+      queue->elems[first]   = parent;
+      i                     = first;
+   }
+}
+
+static void msg_queue_remove(msg_queue_t *queue, size_t i)
+{
+   queue->free_elems[queue->free_count++] = queue->elems[i];
+
+   if (i != --queue->ptr)
+   {
+      queue->elems[i] = queue->elems[queue->ptr];
+      msg_queue_sift_up(queue, i);
+      msg_queue_sift_down(queue, i);
+   }
+
+   queue->elems[queue->ptr] = NULL;
+}
+
+static void msg_queue_remove_all(msg_queue_t *queue)
+{
+   while (queue->ptr > 1)
+      msg_queue_remove(queue, queue->ptr - 1);
+}
+
+static void msg_queue_add(msg_queue_t *queue, const msg_queue_cell_t *cell)
+{
+   size_t i;
+   struct queue_elem *elem = NULL;
+
+   if (cell->flush && !cell->tag)
+      msg_queue_remove_all(queue);
+
+   for (i = 1; i < queue->ptr; i++)
+   {
+      struct queue_elem *cur = queue->elems[i];
+
+      if (cur->tag != cell->tag)
+         continue;
+
+      if (cur->tag || string_is_equal(cur->msg, cell->msg))
+      {
+         /* Update the queued message, in place */
+         elem = cur;
+         break;
+      }
+   }
+
+   if (!elem)
+   {
+      if (!queue->free_count)
+      {
+         size_t victim = 0;
+
+         /* Make room by evicting the stalest message of the
+          * lowest priority, unless the new one ranks below them all */
+         for (i = 1; i < queue->ptr; i++)
+         {
+            struct queue_elem *cur = queue->elems[i];
 
-   queue->elems[queue->ptr]      = new_elem;
+            if (!victim
+                  || cur->prio < queue->elems[victim]->prio
+                  || (cur->prio == queue->elems[victim]->prio
+                     && (int)(cur->order - queue->elems[victim]->order) < 0))
+               victim = i;
+         }
 
-   tmp_ptr                       = queue->ptr++;
+         if (!victim || cell->prio < queue->elems[victim]->prio)
+            return;
 
-   while (tmp_ptr > 1)
+         msg_queue_remove(queue, victim);
+      }
+
+      elem                     = queue->free_elems[--queue->free_count];
+      elem->order              = queue->order++;
+      elem->tag                = cell->tag;
+      i                        = queue->ptr++;
+      queue->elems[i]          = elem;
+   }
+
+   elem->prio     = cell->prio;
+   elem->duration = cell->duration;
+   strlcpy(elem->msg, cell->msg, sizeof(elem->msg));
+
+   msg_queue_sift_up(queue, i);
+   msg_queue_sift_down(queue, i);
+}
+
+/* Moves the submitted messages into the heap,
+ * or drops them if @discard is set */
+static void msg_queue_drain(msg_queue_t *queue, bool discard)
+{
+   msg_queue_lock(queue);
+
+   for (;;)
    {
-      struct queue_elem *parent  = queue->elems[tmp_ptr >> 1];
-      struct queue_elem *child   = queue->elems[tmp_ptr];
+      unsigned pos           = queue->dequeue_pos;
+      msg_queue_cell_t *cell = &queue->cells[pos & queue->cells_mask];
 
-      if (child->prio <= parent->prio)
+      if ((int)(msg_queue_load(&cell->seq) - (pos + 1)) < 0)
          break;
 
-      queue->elems[tmp_ptr >> 1] = child;
-      queue->elems[tmp_ptr]      = parent;
+      if (!discard)
+         msg_queue_add(queue, cell);
 
-      tmp_ptr >>= 1;
+      /* Hand the cell back to producers for the next lap of the ring */
+      msg_queue_store(&cell->seq, pos + queue->cells_mask + 1);
+      queue->dequeue_pos = pos + 1;
    }
+
+   msg_queue_unlock(queue);
 }
 
 /**
@@ -155,91 +486,46 @@ void msg_queue_push(msg_queue_t *queue, const char *msg,
  **/
 void msg_queue_clear(msg_queue_t *queue)
 {
-   size_t i;
-
    if (!queue)
       return;
 
-   for (i = 1; i < queue->ptr; i++)
-   {
-      if (queue->elems[i])
-      {
-         free(queue->elems[i]->msg);
-         free(queue->elems[i]);
-         queue->elems[i] = NULL;
-      }
-   }
-   queue->ptr = 1;
-   free(queue->tmp_msg);
-   queue->tmp_msg = NULL;
+   msg_queue_drain(queue, true);
+   msg_queue_remove_all(queue);
+   queue->tmp_msg[0] = '\0';
 }
 
 /**
  * msg_queue_pull:
  * @queue             : pointer to queue object
  *
- * Pulls highest priority message in queue.
+ * Pulls highest priority message in queue. Only one thread
+ * at a time may pull from or clear the queue.
  *
  * Returns: NULL if no message in queue, otherwise a string
  * containing the message.
  **/
 const char *msg_queue_pull(msg_queue_t *queue)
 {
-   struct queue_elem *front  = NULL, *last = NULL;
-   size_t tmp_ptr = 1;
+   struct queue_elem *front = NULL;
 
-   (void)tmp_ptr;
-
-   /* Nothing in queue. */
-   if (!queue || queue->ptr == 1)
+   if (!queue)
       return NULL;
 
-   front = (struct queue_elem*)queue->elems[1];
-   front->duration--;
-   if (front->duration > 0)
-      return front->msg;
-
-   free(queue->tmp_msg);
-   queue->tmp_msg = front->msg;
-   front->msg = NULL;
+   msg_queue_drain(queue, false);
 
-   front = (struct queue_elem*)queue->elems[1];
-   last  = (struct queue_elem*)queue->elems[--queue->ptr];
-   queue->elems[1] = last;
-   free(front);
+   /* Nothing in queue. */
+   if (queue->ptr == 1)
+      return NULL;
 
-   for (;;)
+   front = queue->elems[1];
+   if (front->duration > 1)
    {
-      struct queue_elem *parent = NULL;
-      struct queue_elem *child  = NULL;
-      size_t switch_index       = tmp_ptr;
-      bool left                 = (tmp_ptr * 2 <= queue->ptr)
-         && (queue->elems[tmp_ptr] < queue->elems[tmp_ptr * 2]);
-      bool right                = (tmp_ptr * 2 + 1 <= queue->ptr)
-         && (queue->elems[tmp_ptr] < queue->elems[tmp_ptr * 2 + 1]);
-
-      if (!left && !right)
-         break;
-
-      if (left && !right)
-         switch_index <<= 1;
-      else if (right && !left)
-         switch_index += switch_index + 1;
-      else
-      {
-         if (queue->elems[tmp_ptr * 2]
-               >= queue->elems[tmp_ptr * 2 + 1])
-            switch_index <<= 1;
-         else
-            switch_index += switch_index + 1;
-      }
-
-      parent = (struct queue_elem*)queue->elems[tmp_ptr];
-      child  = (struct queue_elem*)queue->elems[switch_index];
-      queue->elems[tmp_ptr]      = child;
-      queue->elems[switch_index] = parent;
-      tmp_ptr                    = switch_index;
+      front->duration--;
+      return front->msg;
    }
 
+   strlcpy(queue->tmp_msg, front->msg, sizeof(queue->tmp_msg));
+   msg_queue_remove(queue, 1);
+
    return queue->tmp_msg;
 }
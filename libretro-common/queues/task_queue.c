@@ -62,7 +62,7 @@ static task_queue_t tasks_finished = {NULL, NULL};
 static struct retro_task_impl *impl_current = NULL;
 static bool task_threaded_enable            = false;
 
-static uint32_t task_count                  = 0;
+static uint32_t task_count                  = 1;
 
 static void task_queue_msg_push(retro_task_t *task,
       unsigned prio, unsigned duration,
@@ -829,7 +829,13 @@ retro_task_t *task_init(void)
 {
    retro_task_t *task      = (retro_task_t*)calloc(1, sizeof(*task));
 
+   if (!task)
+      return NULL;
+
+   /* 0 is left for "no task", e.g. untagged messages */
    task->ident             = task_count++;
+   if (!task_count)
+      task_count           = 1;
 
    return task;
 }
@@ -0,0 +1,180 @@
+/* Copyright  (C) 2010-2018 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (chd_bench.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Decompression throughput of whole CHD files, one hunk at a time with
+ * chd_read() and in batches with chd_read_hunks() on several threads.
+ * The codecs are taken from the header, so pass one zlib, one LZMA and
+ * one FLAC CHD (e.g. made with chdman createcd -c cdzl / cdlz / cdfl)
+ * to compare them.
+ *
+ * Usage: chd_bench [-t threads] [-b batch] file.chd... */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <libchdr/chd.h>
+#include <encodings/crc32.h>
+#include <features/features_cpu.h>
+
+static double now_sec(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void codec_names(const chd_header *hd, char *s, size_t len)
+{
+   unsigned i;
+
+   *s = '\0';
+
+   if (hd->version < 5)
+   {
+      snprintf(s, len, "v%u compression %u", hd->version, hd->compression[0]);
+      return;
+   }
+
+   for (i = 0; i < 4 && hd->compression[i]; i++)
+   {
+      char tag[6];
+      uint32_t c = hd->compression[i];
+
+      tag[0] = i ? ',' : ' ';
+      tag[1] = (char)(c >> 24);
+      tag[2] = (char)(c >> 16);
+      tag[3] = (char)(c >>  8);
+      tag[4] = (char)c;
+      tag[5] = '\0';
+      strncat(s, tag + (i ? 0 : 1), len - strlen(s) - 1);
+   }
+}
+
+/* Returns the CRC32 of all hunks, or 0 with *ok cleared on error */
+static uint32_t bench(chd_file *chd, unsigned threads, unsigned batch,
+      double *mbps, int *ok)
+{
+   const chd_header *hd = chd_get_header(chd);
+   uint8_t *buf         = (uint8_t*)malloc((size_t)batch * hd->hunkbytes);
+   uint32_t crc         = 0;
+   uint32_t hunk;
+   double start;
+
+   *ok = buf != NULL;
+   if (!buf)
+      return 0;
+
+   start = now_sec();
+
+   for (hunk = 0; hunk < hd->totalhunks; hunk += batch)
+   {
+      uint32_t count = hd->totalhunks - hunk;
+      chd_error err;
+
+      if (count > batch)
+         count = batch;
+
+      if (threads)
+         err = chd_read_hunks(chd, hunk, count, buf, threads);
+      else
+         err = chd_read(chd, hunk, buf);
+
+      if (err != CHDERR_NONE)
+      {
+         fprintf(stderr, "hunk %u: %s\n", hunk, chd_error_string(err));
+         *ok = 0;
+         break;
+      }
+
+      crc = encoding_crc32(crc, buf, (size_t)count * hd->hunkbytes);
+   }
+
+   *mbps = (double)hd->totalhunks * hd->hunkbytes
+      / (now_sec() - start) / (1024.0 * 1024.0);
+
+   free(buf);
+   return crc;
+}
+
+int main(int argc, char *argv[])
+{
+   int i;
+   unsigned threads = cpu_features_get_core_amount();
+   unsigned batch   = 64;
+
+   for (i = 1; i < argc && argv[i][0] == '-'; i += 2)
+   {
+      if (i + 1 >= argc)
+         break;
+      if (!strcmp(argv[i], "-t"))
+         threads = (unsigned)atoi(argv[i + 1]);
+      else if (!strcmp(argv[i], "-b"))
+         batch = (unsigned)atoi(argv[i + 1]);
+   }
+
+   if (i >= argc || !threads || !batch)
+   {
+      fprintf(stderr, "Usage: %s [-t threads] [-b batch] file.chd...\n",
+            argv[0]);
+      return 1;
+   }
+
+   for (; i < argc; i++)
+   {
+      char codecs[64];
+      chd_file *chd   = NULL;
+      double serial   = 0.0;
+      double parallel = 0.0;
+      int ok_serial, ok_parallel;
+      uint32_t crc_serial, crc_parallel;
+      const chd_header *hd;
+
+      if (chd_open(argv[i], CHD_OPEN_READ, NULL, &chd) != CHDERR_NONE)
+      {
+         fprintf(stderr, "%s: cannot open\n", argv[i]);
+         continue;
+      }
+
+      hd = chd_get_header(chd);
+      codec_names(hd, codecs, sizeof(codecs));
+
+      /* Read the file once so both runs start with a warm page cache */
+      chd_precache(chd);
+
+      crc_serial   = bench(chd, 0, 1, &serial, &ok_serial);
+      crc_parallel = bench(chd, threads, batch, &parallel, &ok_parallel);
+
+      printf("%s [%s]: %u hunks of %u bytes\n", argv[i], codecs,
+            hd->totalhunks, hd->hunkbytes);
+      printf("  chd_read:                      %8.1f MB/s\n", serial);
+      printf("  chd_read_hunks (%2u threads):   %8.1f MB/s (%.2fx)%s\n",
+            threads, parallel, parallel / serial,
+            (!ok_serial || !ok_parallel || crc_serial != crc_parallel)
+            ? " MISMATCH" : "");
+
+      chd_close(chd);
+   }
+
+   return 0;
+}
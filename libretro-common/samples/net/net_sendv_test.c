@@ -0,0 +1,240 @@
+/* Copyright  (C) 2010-2018 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (net_sendv_test.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Loopback benchmark of netplay-style broadcasting: one host sends every
+ * frame's commands to a number of spectators, and a savestate every so
+ * often.
+ *
+ * "copy" queues each command into a per-peer buffer and sends large
+ * payloads separately, as netplay_buf used to.
+ * "sendv" queues small commands the same way but sends the queue and a
+ * shared large payload together with socket_send_iov_all_nonblocking.
+ *
+ * Usage: net_sendv_test [peers] [frames] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <net/net_compat.h>
+#include <net/net_socket.h>
+
+#define CMDS_PER_FRAME  8
+#define CMD_SIZE        24
+#define STATE_SIZE      (64 * 1024)
+#define STATE_INTERVAL  60
+#define QUEUE_SIZE      (CMDS_PER_FRAME * CMD_SIZE)
+
+struct peer
+{
+   int host_fd;
+   int spec_fd;
+   size_t received;
+};
+
+static unsigned long syscalls;
+
+static double now_sec(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void drain(struct peer *peers, unsigned num_peers)
+{
+   static char sink[65536];
+   unsigned i;
+
+   for (i = 0; i < num_peers; i++)
+   {
+      ssize_t ret;
+      while ((ret = recv(peers[i].spec_fd, sink, sizeof(sink), 0)) > 0)
+         peers[i].received += ret;
+   }
+}
+
+/* Keep trying until everything is out, draining the spectators meanwhile */
+static void send_iov(struct peer *peers, unsigned num_peers, unsigned idx,
+      const socket_iov_t *iov_, size_t count)
+{
+   socket_iov_t iov[SOCKET_IOV_MAX];
+   size_t first = 0;
+
+   memcpy(iov, iov_, count * sizeof(*iov));
+
+   while (first < count)
+   {
+      ssize_t sent = socket_send_iov_all_nonblocking(peers[idx].host_fd,
+            iov + first, count - first, true);
+      syscalls++;
+      if (sent < 0)
+      {
+         perror("send");
+         exit(1);
+      }
+
+      while (first < count && (size_t)sent >= iov[first].size)
+      {
+         sent -= iov[first].size;
+         first++;
+      }
+      if (first < count)
+      {
+         iov[first].data  = (const char*)iov[first].data + sent;
+         iov[first].size -= sent;
+         drain(peers, num_peers);
+      }
+   }
+}
+
+static double run(struct peer *peers, unsigned num_peers, unsigned frames,
+      bool vectored)
+{
+   static char queue[QUEUE_SIZE];
+   static char state[STATE_SIZE];
+   char cmd[CMD_SIZE];
+   unsigned frame, i, c;
+   double start = now_sec();
+
+   memset(cmd, 0x5A, sizeof(cmd));
+   memset(state, 0xA5, sizeof(state));
+
+   for (frame = 0; frame < frames; frame++)
+   {
+      bool send_state = (frame % STATE_INTERVAL) == 0;
+
+      for (i = 0; i < num_peers; i++)
+      {
+         socket_iov_t iov[2];
+
+         /* Per-peer command queue, as in netplay_buf */
+         for (c = 0; c < CMDS_PER_FRAME; c++)
+            memcpy(queue + c * CMD_SIZE, cmd, CMD_SIZE);
+
+         iov[0].data = queue;
+         iov[0].size = QUEUE_SIZE;
+         iov[1].data = state;
+         iov[1].size = STATE_SIZE;
+
+         if (vectored)
+            send_iov(peers, num_peers, i, iov, send_state ? 2 : 1);
+         else
+         {
+            send_iov(peers, num_peers, i, &iov[0], 1);
+            if (send_state)
+               send_iov(peers, num_peers, i, &iov[1], 1);
+         }
+      }
+
+      drain(peers, num_peers);
+   }
+
+   /* Wait for everything to arrive */
+   for (;;)
+   {
+      size_t expected = (size_t)frames * QUEUE_SIZE +
+         (size_t)((frames + STATE_INTERVAL - 1) / STATE_INTERVAL) * STATE_SIZE;
+      bool done       = true;
+
+      drain(peers, num_peers);
+      for (i = 0; i < num_peers; i++)
+         if (peers[i].received < expected)
+            done = false;
+      if (done)
+         break;
+   }
+
+   return now_sec() - start;
+}
+
+int main(int argc, char *argv[])
+{
+   struct sockaddr_in addr;
+   socklen_t addrlen  = sizeof(addr);
+   unsigned num_peers = (argc > 1) ? (unsigned)atoi(argv[1]) : 16;
+   unsigned frames    = (argc > 2) ? (unsigned)atoi(argv[2]) : 6000;
+   struct peer *peers = (struct peer*)calloc(num_peers, sizeof(*peers));
+   int listen_fd;
+   unsigned i;
+   double t;
+
+   if (!peers || !network_init())
+      return 1;
+
+   listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+   memset(&addr, 0, sizeof(addr));
+   addr.sin_family      = AF_INET;
+   addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+   if (listen_fd < 0 ||
+         bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+         getsockname(listen_fd, (struct sockaddr*)&addr, &addrlen) < 0 ||
+         listen(listen_fd, num_peers) < 0)
+   {
+      perror("listen");
+      return 1;
+   }
+
+   for (i = 0; i < num_peers; i++)
+   {
+      int flag = 1;
+
+      peers[i].spec_fd = socket(AF_INET, SOCK_STREAM, 0);
+      if (connect(peers[i].spec_fd, (struct sockaddr*)&addr,
+               sizeof(addr)) < 0)
+      {
+         perror("connect");
+         return 1;
+      }
+      peers[i].host_fd = accept(listen_fd, NULL, NULL);
+      setsockopt(peers[i].host_fd, IPPROTO_TCP, TCP_NODELAY,
+            (const char*)&flag, sizeof(flag));
+      socket_nonblock(peers[i].host_fd);
+      socket_nonblock(peers[i].spec_fd);
+   }
+
+   printf("%u spectators, %u frames, %u x %u byte commands per frame, "
+         "%u byte state every %u frames\n", num_peers, frames,
+         CMDS_PER_FRAME, CMD_SIZE, STATE_SIZE, STATE_INTERVAL);
+
+   syscalls = 0;
+   t = run(peers, num_peers, frames, false);
+   printf("copy:  %8.3f s, %lu send calls\n", t, syscalls);
+
+   for (i = 0; i < num_peers; i++)
+      peers[i].received = 0;
+
+   syscalls = 0;
+   t = run(peers, num_peers, frames, true);
+   printf("sendv: %8.3f s, %lu send calls\n", t, syscalls);
+
+   for (i = 0; i < num_peers; i++)
+   {
+      socket_close(peers[i].host_fd);
+      socket_close(peers[i].spec_fd);
+   }
+   socket_close(listen_fd);
+   free(peers);
+
+   return 0;
+}
@@ -0,0 +1,283 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (message_queue_stress.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Stress test for the message queue: many producer threads submit
+ * tagged progress messages, the way tasks report their progress,
+ * while the main thread pulls them like the video driver does every
+ * frame. Every pulled message has to be intact, the messages of a
+ * producer have to arrive in order and the last message of every
+ * producer must not get lost. A few single-threaded checks cover
+ * coalescing, flushing and priorities.
+ *
+ * Build with "CFLAGS=-fsanitize=thread LDFLAGS=-fsanitize=thread make"
+ * to have the thread sanitizer watch the run.
+ *
+ * Usage: message_queue_stress [producers] [messages per producer] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/time.h>
+
+#include <boolean.h>
+#include <queues/message_queue.h>
+#include <rthreads/rthreads.h>
+#include <retro_timers.h>
+
+#define MAX_PRODUCERS 256
+
+typedef struct producer
+{
+   msg_queue_t *queue;
+   unsigned id;
+   unsigned count;
+   /* Submissions refused because the ring was full */
+   unsigned long retries;
+} producer_t;
+
+static slock_t *done_lock      = NULL;
+static unsigned producers_done = 0;
+
+static double now_ms(void)
+{
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+   return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+/* Padding makes torn copies of a message detectable */
+static void format_msg(char *s, size_t len, unsigned id, unsigned seq)
+{
+   int n = snprintf(s, len, "%u:%u:", id, seq);
+   memset(s + n, 'a' + (id + seq) % 26, len - n - 1);
+   s[len - 1] = '\0';
+}
+
+static bool parse_msg(const char *s, unsigned *id, unsigned *seq)
+{
+   char expected[200];
+
+   if (sscanf(s, "%u:%u:", id, seq) != 2)
+      return false;
+
+   format_msg(expected, sizeof(expected), *id, *seq);
+   return !strcmp(s, expected);
+}
+
+static void producer_thread(void *data)
+{
+   unsigned seq;
+   char msg[200];
+   producer_t *p = (producer_t*)data;
+
+   for (seq = 1; seq <= p->count; seq++)
+   {
+      format_msg(msg, sizeof(msg), p->id, seq);
+      /* The producer's id is the tag, like a task's ident */
+      while (!msg_queue_submit(p->queue, msg, 1, 1, true, p->id + 1))
+      {
+         /* Give the consumer a chance to catch up */
+         p->retries++;
+         retro_sleep(1);
+      }
+   }
+
+   slock_lock(done_lock);
+   producers_done++;
+   slock_unlock(done_lock);
+}
+
+static bool stress(unsigned num_producers, unsigned count)
+{
+   unsigned i;
+   double start, elapsed;
+   unsigned last[MAX_PRODUCERS] = {0};
+   producer_t producers[MAX_PRODUCERS];
+   sthread_t *threads[MAX_PRODUCERS];
+   unsigned long pulled = 0, retries = 0;
+   bool finished        = false;
+   bool ok              = true;
+   /* One slot per producer, so nothing gets evicted */
+   msg_queue_t *queue   = msg_queue_new(num_producers);
+
+   done_lock            = slock_new();
+   producers_done       = 0;
+
+   start = now_ms();
+
+   for (i = 0; i < num_producers; i++)
+   {
+      producers[i].queue   = queue;
+      producers[i].id      = i;
+      producers[i].count   = count;
+      producers[i].retries = 0;
+      threads[i]           = sthread_create(producer_thread, &producers[i]);
+   }
+
+   while (ok)
+   {
+      const char *msg = msg_queue_pull(queue);
+
+      if (!msg)
+      {
+         /* Only stop once everything submitted after the
+          * producers finished has been pulled as well */
+         if (finished)
+            break;
+         slock_lock(done_lock);
+         finished = producers_done == num_producers;
+         slock_unlock(done_lock);
+         continue;
+      }
+
+      {
+         unsigned id, seq;
+
+         pulled++;
+
+         if (!parse_msg(msg, &id, &seq) || id >= num_producers)
+         {
+            printf("Corrupted message: %.40s\n", msg);
+            ok = false;
+         }
+         else if (seq <= last[id])
+         {
+            printf("Producer %u: message %u after %u\n", id, seq, last[id]);
+            ok = false;
+         }
+         else
+            last[id] = seq;
+      }
+   }
+
+   elapsed = now_ms() - start;
+
+   for (i = 0; i < num_producers; i++)
+   {
+      sthread_join(threads[i]);
+      retries += producers[i].retries;
+
+      if (ok && last[i] != count)
+      {
+         printf("Producer %u: last message %u, expected %u\n",
+               i, last[i], count);
+         ok = false;
+      }
+   }
+
+   printf("%u producers x %u messages: %lu pulled after coalescing, "
+         "%lu retries on a full ring, %.1f ms (%.0f submits/s)\n",
+         num_producers, count, pulled, retries, elapsed,
+         (double)num_producers * count * 1000.0 / elapsed);
+
+   msg_queue_free(queue);
+   slock_free(done_lock);
+   return ok;
+}
+
+static bool check(bool cond, const char *what)
+{
+   if (!cond)
+      printf("FAILED: %s\n", what);
+   return cond;
+}
+
+static bool pulls(msg_queue_t *queue, const char *expected)
+{
+   const char *msg = msg_queue_pull(queue);
+   if (!expected)
+      return !msg;
+   return msg && !strcmp(msg, expected);
+}
+
+static bool semantics(void)
+{
+   unsigned i;
+   bool ok            = true;
+   msg_queue_t *queue = msg_queue_new(2);
+
+   /* Identical untagged messages are queued once */
+   for (i = 0; i < 10; i++)
+      msg_queue_push(queue, "same", 1, 1, NULL,
+            MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+   ok &= check(pulls(queue, "same") && pulls(queue, NULL),
+         "identical messages coalesce");
+
+   /* A tagged message replaces the previous one with that tag only */
+   msg_queue_submit(queue, "a 10%", 1, 1, true, 1);
+   msg_queue_submit(queue, "b 10%", 1, 1, true, 2);
+   msg_queue_submit(queue, "a 20%", 1, 1, true, 1);
+   ok &= check(pulls(queue, "a 20%") && pulls(queue, "b 10%")
+         && pulls(queue, NULL), "tagged messages replace each other");
+
+   /* Untagged flush drops everything queued before */
+   msg_queue_submit(queue, "old", 1, 1, false, 0);
+   msg_queue_submit(queue, "new", 1, 1, true, 0);
+   ok &= check(pulls(queue, "new") && pulls(queue, NULL), "flush");
+
+   /* Higher priority first, FIFO among equals */
+   msg_queue_submit(queue, "low", 1, 1, false, 0);
+   msg_queue_submit(queue, "high", 2, 1, false, 0);
+   ok &= check(pulls(queue, "high") && pulls(queue, "low"), "priority");
+
+   /* A full queue evicts the stalest message of the lowest priority
+    * instead of dropping the new one */
+   msg_queue_submit(queue, "first", 1, 1, false, 0);
+   msg_queue_submit(queue, "second", 1, 1, false, 0);
+   msg_queue_submit(queue, "third", 1, 1, false, 0);
+   msg_queue_submit(queue, "unimportant", 0, 1, false, 0);
+   ok &= check(pulls(queue, "second") && pulls(queue, "third")
+         && pulls(queue, NULL), "eviction");
+
+   /* Duration */
+   msg_queue_submit(queue, "three frames", 1, 3, false, 0);
+   ok &= check(pulls(queue, "three frames") && pulls(queue, "three frames")
+         && pulls(queue, "three frames") && pulls(queue, NULL), "duration");
+
+   /* Clearing drops pending submissions as well */
+   msg_queue_submit(queue, "pending", 1, 1, false, 0);
+   msg_queue_clear(queue);
+   ok &= check(pulls(queue, NULL), "clear");
+
+   msg_queue_free(queue);
+   return ok;
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned num_producers = argc > 1 ? (unsigned)atoi(argv[1]) : 32;
+   unsigned count         = argc > 2 ? (unsigned)atoi(argv[2]) : 20000;
+   bool ok                = true;
+
+   if (num_producers < 1 || num_producers > MAX_PRODUCERS)
+   {
+      fprintf(stderr, "Between 1 and %d producers\n", MAX_PRODUCERS);
+      return 1;
+   }
+
+   ok &= semantics();
+   ok &= stress(num_producers, count);
+
+   printf("%s\n", ok ? "OK" : "FAILED");
+   return ok ? 0 : 1;
+}
@@ -0,0 +1,144 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (mmap_load_bench.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Compares the two ways the frontend can hand content to a core:
+ * reading the file into a heap buffer (filestream_read_file) and
+ * memory-mapping it (RETRO_VFS_FILE_ACCESS_HINT_FREQUENT_ACCESS).
+ * Like a core in retro_load_game(), every load copies the content
+ * into a buffer of its own, so reading needs twice the content size
+ * in heap memory while a mapping only uses (reclaimable) page cache.
+ *
+ * Usage: mmap_load_bench <content file> [iterations] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <sys/time.h>
+
+#include <streams/file_stream.h>
+
+static double now_ms(void)
+{
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+   return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+/* What the core does with the content: copy it and look at it */
+static uint32_t core_load(const void *data, int64_t len)
+{
+   int64_t i;
+   uint32_t sum  = 0;
+   uint8_t *rom  = (uint8_t*)malloc((size_t)len);
+
+   if (!rom)
+      return 0;
+
+   memcpy(rom, data, (size_t)len);
+   for (i = 0; i < len; i += 4096)
+      sum += rom[i];
+
+   free(rom);
+   return sum;
+}
+
+static int run(const char *path, int iterations, int mapped)
+{
+   int i;
+   int64_t len  = 0;
+   uint32_t sum = 0;
+   double start = now_ms();
+
+   for (i = 0; i < iterations; i++)
+   {
+      if (mapped)
+      {
+         const void *data = NULL;
+         RFILE *file      = filestream_open(path,
+               RETRO_VFS_FILE_ACCESS_READ,
+               RETRO_VFS_FILE_ACCESS_HINT_FREQUENT_ACCESS);
+
+         if (!file || !(data = filestream_get_mapped(file, &len)))
+         {
+            fprintf(stderr, "Could not map \"%s\".\n", path);
+            return 1;
+         }
+
+         sum += core_load(data, len);
+         filestream_close(file);
+      }
+      else
+      {
+         void *data = NULL;
+
+         if (!filestream_read_file(path, &data, &len))
+         {
+            fprintf(stderr, "Could not read \"%s\".\n", path);
+            return 1;
+         }
+
+         sum += core_load(data, len);
+         free(data);
+      }
+   }
+
+   printf("%s: %8.3f ms/load, %6.1f MiB heap/load (checksum %08x)\n",
+         mapped ? "mmap" : "read",
+         (now_ms() - start) / iterations,
+         (mapped ? 1 : 2) * len / (1024.0 * 1024.0), (unsigned)sum);
+   return 0;
+}
+
+int main(int argc, char *argv[])
+{
+   int mode;
+   int64_t len    = 0;
+   void *data     = NULL;
+   int iterations = 20;
+
+   if (argc < 2)
+   {
+      fprintf(stderr, "Usage: %s <content file> [iterations]\n", argv[0]);
+      return 1;
+   }
+
+   if (argc > 2)
+      iterations = atoi(argv[2]);
+   if (iterations < 1)
+      iterations = 1;
+
+   /* Warm up the page cache, so both modes start from the same state */
+   if (!filestream_read_file(argv[1], &data, &len))
+   {
+      fprintf(stderr, "Could not read \"%s\".\n", argv[1]);
+      return 1;
+   }
+   free(data);
+
+   for (mode = 0; mode < 2; mode++)
+      if (run(argv[1], iterations, mode) != 0)
+         return 1;
+
+   return 0;
+}
@@ -0,0 +1,76 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (frontend_vfs.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* The VFS interface RetroArch hands to cores in
+ * RETRO_ENVIRONMENT_GET_VFS_INTERFACE, built from the same
+ * implementation. Kept apart from the core side, which does not
+ * see the frontend's file handle types. */
+
+#define VFS_FRONTEND
+
+#include <boolean.h>
+#include <libretro.h>
+#include <vfs/vfs_implementation.h>
+
+bool frontend_get_vfs_interface(struct retro_vfs_interface_info *info)
+{
+   const uint32_t supported_vfs_version = 5;
+   static struct retro_vfs_interface vfs_iface =
+   {
+      /* VFS API v1 */
+      retro_vfs_file_get_path_impl,
+      retro_vfs_file_open_impl,
+      retro_vfs_file_close_impl,
+      retro_vfs_file_size_impl,
+      retro_vfs_file_tell_impl,
+      retro_vfs_file_seek_impl,
+      retro_vfs_file_read_impl,
+      retro_vfs_file_write_impl,
+      retro_vfs_file_flush_impl,
+      retro_vfs_file_remove_impl,
+      retro_vfs_file_rename_impl,
+      /* VFS API v2 */
+      retro_vfs_file_truncate_impl,
+      /* VFS API v3 */
+      retro_vfs_stat_impl,
+      retro_vfs_mkdir_impl,
+      retro_vfs_opendir_impl,
+      retro_vfs_readdir_impl,
+      retro_vfs_dirent_get_name_impl,
+      retro_vfs_dirent_is_dir_impl,
+      retro_vfs_closedir_impl,
+      /* VFS API v4 */
+      retro_vfs_async_open_impl,
+      retro_vfs_async_read_impl,
+      retro_vfs_async_wait_impl,
+      retro_vfs_async_close_impl,
+      /* VFS API v5 */
+      retro_vfs_file_get_mapped_impl
+   };
+
+   if (info->required_interface_version > supported_vfs_version)
+      return false;
+
+   info->required_interface_version = supported_vfs_version;
+   info->iface                      = &vfs_iface;
+   return true;
+}
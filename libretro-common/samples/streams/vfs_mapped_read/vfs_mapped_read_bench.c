@@ -0,0 +1,201 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (vfs_mapped_read_bench.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Reads a disc image sector by sector the way a disc core does once
+ * the frontend has handed it the VFS interface: with a seek and a
+ * read into a sector buffer per sector, and through the read-only
+ * pointer of VFS API v5 (filestream_get_mapped), which needs no copy.
+ * Both are timed for sequential and random sector order, and every
+ * sector's user data is checksummed as a stand-in for decoding it.
+ *
+ * Usage: vfs_mapped_read_bench <disc image> [sectors] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <sys/time.h>
+
+#include <boolean.h>
+#include <libretro.h>
+#include <streams/file_stream.h>
+
+#define SECTOR_SIZE    2352
+#define USER_DATA      16
+#define USER_DATA_SIZE 2048
+
+bool frontend_get_vfs_interface(struct retro_vfs_interface_info *info);
+
+static double now_ms(void)
+{
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+   return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+static uint32_t decode_sector(const uint8_t *sector)
+{
+   unsigned i;
+   uint32_t sum = 0;
+
+   for (i = 0; i < USER_DATA_SIZE; i += 4)
+   {
+      uint32_t word;
+      memcpy(&word, sector + USER_DATA + i, sizeof(word));
+      sum += word;
+   }
+
+   return sum;
+}
+
+/* Sector to read for the @i-th access */
+static int64_t sector_at(int64_t i, int64_t num_sectors, bool random)
+{
+   if (random)
+      return (int64_t)(((uint64_t)i * 2654435761u + 12345) % num_sectors);
+   return i % num_sectors;
+}
+
+/* Returns: elapsed time in ms, -1 on error */
+static double run(const char *path, int64_t count, bool mapped, bool random,
+      uint32_t *checksum)
+{
+   int64_t i;
+   int64_t len          = 0;
+   int64_t num_sectors  = 0;
+   const uint8_t *data  = NULL;
+   uint32_t sum         = 0;
+   uint8_t sector[SECTOR_SIZE];
+   double start         = now_ms();
+   RFILE *file          = filestream_open(path,
+         RETRO_VFS_FILE_ACCESS_READ,
+         RETRO_VFS_FILE_ACCESS_HINT_FREQUENT_ACCESS);
+
+   if (!file)
+   {
+      fprintf(stderr, "Could not open \"%s\".\n", path);
+      return -1;
+   }
+
+   len         = filestream_get_size(file);
+   num_sectors = len / SECTOR_SIZE;
+
+   if (num_sectors < 1)
+   {
+      fprintf(stderr, "\"%s\" is smaller than a sector.\n", path);
+      filestream_close(file);
+      return -1;
+   }
+
+   if (mapped && !(data = (const uint8_t*)filestream_get_mapped(file, &len)))
+   {
+      fprintf(stderr, "Could not map \"%s\".\n", path);
+      filestream_close(file);
+      return -1;
+   }
+
+   for (i = 0; i < count; i++)
+   {
+      int64_t lba = sector_at(i, num_sectors, random);
+
+      if (mapped)
+         sum += decode_sector(data + lba * SECTOR_SIZE);
+      else
+      {
+         if (filestream_seek(file, lba * SECTOR_SIZE,
+                  RETRO_VFS_SEEK_POSITION_START) < 0
+               || filestream_read(file, sector, SECTOR_SIZE) != SECTOR_SIZE)
+         {
+            fprintf(stderr, "Could not read sector %d.\n", (int)lba);
+            filestream_close(file);
+            return -1;
+         }
+         sum += decode_sector(sector);
+      }
+   }
+
+   filestream_close(file);
+
+   *checksum = sum;
+   return now_ms() - start;
+}
+
+int main(int argc, char *argv[])
+{
+   int pattern;
+   uint32_t sum  = 0;
+   int64_t count = 200000;
+   struct retro_vfs_interface_info vfs_info;
+
+   if (argc < 2)
+   {
+      fprintf(stderr, "Usage: %s <disc image> [sectors]\n", argv[0]);
+      return 1;
+   }
+
+   if (argc > 2)
+      count = atoi(argv[2]);
+   if (count < 1)
+      count = 1;
+
+   /* What a core does in retro_set_environment() */
+   vfs_info.required_interface_version = 5;
+   vfs_info.iface                      = NULL;
+   if (!frontend_get_vfs_interface(&vfs_info))
+   {
+      fprintf(stderr, "Frontend has no VFS v5.\n");
+      return 1;
+   }
+   filestream_vfs_init(&vfs_info);
+
+   /* Warm up the page cache, so both modes start from the same state */
+   if (run(argv[1], count, false, false, &sum) < 0)
+      return 1;
+
+   for (pattern = 0; pattern < 4; pattern++)
+   {
+      uint32_t mode_sum = 0;
+      bool random       = pattern >= 2;
+      bool mapped       = pattern & 1;
+      double elapsed    = run(argv[1], count, mapped, random, &mode_sum);
+
+      if (elapsed < 0)
+         return 1;
+
+      /* Copy and mapped reads of one order see the same sectors */
+      if (pattern & 1 && mode_sum != sum)
+      {
+         fprintf(stderr, "Copy and mapped reads differ.\n");
+         return 1;
+      }
+      sum = mode_sum;
+
+      printf("%-6s %-10s: %7.1f ns/sector, %8.1f MiB/s\n",
+            mapped ? "mapped" : "copy", random ? "random" : "sequential",
+            elapsed * 1000000.0 / count,
+            count * (double)SECTOR_SIZE / (1024.0 * 1024.0)
+            / (elapsed / 1000.0));
+   }
+
+   return 0;
+}
@@ -29,11 +29,31 @@
 #include <streams/chd_stream.h>
 #include <retro_endianness.h>
 #include <libchdr/chd.h>
+#ifdef HAVE_THREADS
+#include <features/features_cpu.h>
+#include <rthreads/rthreads.h>
+#endif
 
 #define SECTOR_SIZE 2352
 #define SUBCODE_SIZE 96
 #define TRACK_PAD 4
 
+/* Consecutive hunks that must be read before the read-ahead thread
+ * is started */
+#define CHDSTREAM_SEQUENTIAL_HUNKS 2
+
+struct chdstream_hunk
+{
+   /* Decompressed hunk data */
+   uint8_t *data;
+   /* Hunk number held in this slot, -1 if empty */
+   int32_t hunknum;
+   /* Value of the use counter when this slot was last used */
+   uint32_t last_used;
+   /* Hunk is being decompressed and must not be read or evicted */
+   bool loading;
+};
+
 struct chdstream
 {
    chd_file *chd;
@@ -53,10 +73,38 @@ struct chdstream
    size_t track_end;
    /* Byte offset of read cursor */
    size_t offset;
-   /* Loaded hunk number */
-   int32_t hunknum;
-   /* Loaded hunk */
+   /* LRU cache of decompressed hunks */
+   struct chdstream_hunk *hunks;
    uint8_t *hunkmem;
+   unsigned num_hunks;
+   uint32_t use_counter;
+   /* Number of hunks to decompress ahead of the one being read */
+   unsigned read_ahead;
+   /* Last hunk read, and how many hunks were read in sequence before it */
+   int32_t last_hunknum;
+   unsigned sequential;
+#ifdef HAVE_THREADS
+   sthread_t *thread;
+   /* Protects the cache and the read-ahead state */
+   slock_t *lock;
+   /* Serialises access to the chd_file */
+   slock_t *chd_lock;
+   /* Wakes up the read-ahead thread */
+   scond_t *cond;
+   /* Signalled whenever the read-ahead thread finished a hunk */
+   scond_t *loaded;
+   /* Slots being filled by the read-ahead thread, and the buffer
+    * chd_read_hunks() decompresses them into */
+   struct chdstream_hunk **batch;
+   uint8_t *batchmem;
+   /* Threads used to decompress one batch */
+   unsigned threads;
+   /* First hunk the read-ahead thread should have decompressed */
+   uint32_t read_ahead_start;
+   /* Hunk the read-ahead thread failed to decompress */
+   int32_t read_ahead_failed;
+   bool quit;
+#endif
 };
 
 typedef struct metadata {
@@ -218,9 +266,22 @@ chdstream_t *chdstream_open(const char *path, int32_t track)
    if (!stream)
       goto error;
 
+   stream->chd     = chd;
    hd              = chd_get_header(chd);
-   stream->hunkmem = (uint8_t*)malloc(hd->hunkbytes);
-   if (!stream->hunkmem)
+
+#ifdef HAVE_THREADS
+   stream->lock              = slock_new();
+   stream->chd_lock          = slock_new();
+   stream->cond              = scond_new();
+   stream->loaded            = scond_new();
+   stream->read_ahead_failed = -1;
+   stream->threads           = cpu_features_get_core_amount();
+   if (!stream->lock || !stream->chd_lock || !stream->cond || !stream->loaded)
+      goto error;
+#endif
+
+   if (!chdstream_set_cache(stream, CHDSTREAM_DEFAULT_CACHE_HUNKS,
+            CHDSTREAM_DEFAULT_READ_AHEAD))
       goto error;
 
    if (!strcmp(meta.type, "MODE1_RAW"))
@@ -251,63 +312,411 @@ chdstream_t *chdstream_open(const char *path, int32_t track)
    else
       pregap = 0;
 
-   stream->chd             = chd;
    stream->frames_per_hunk = hd->hunkbytes / hd->unitbytes;
    stream->track_frame     = meta.frame_offset;
    stream->track_start     = (size_t) pregap * stream->frame_size;
    stream->track_end       = stream->track_start +
       (size_t) meta.frames * stream->frame_size;
    stream->offset          = 0;
-   stream->hunknum         = -1;
+   stream->last_hunknum    = -1;
 
    return stream;
 
 error:
 
-   chdstream_close(stream);
-
-   if (chd)
+   if (stream)
+      chdstream_close(stream);
+   else if (chd)
       chd_close(chd);
 
    return NULL;
 }
 
+static void chdstream_stop_read_ahead(chdstream_t *stream)
+{
+#ifdef HAVE_THREADS
+   if (!stream->thread)
+      return;
+
+   slock_lock(stream->lock);
+   stream->quit = true;
+   scond_signal(stream->cond);
+   slock_unlock(stream->lock);
+
+   sthread_join(stream->thread);
+   stream->thread = NULL;
+   stream->quit   = false;
+#endif
+}
+
 void chdstream_close(chdstream_t *stream)
 {
    if (stream)
    {
-      if (stream->hunkmem)
-         free(stream->hunkmem);
+      chdstream_stop_read_ahead(stream);
+      free(stream->hunks);
+      free(stream->hunkmem);
+#ifdef HAVE_THREADS
+      free(stream->batch);
+      free(stream->batchmem);
+      if (stream->loaded)
+         scond_free(stream->loaded);
+      if (stream->cond)
+         scond_free(stream->cond);
+      if (stream->chd_lock)
+         slock_free(stream->chd_lock);
+      if (stream->lock)
+         slock_free(stream->lock);
+#endif
       if (stream->chd)
          chd_close(stream->chd);
       free(stream);
    }
 }
 
-static bool
-chdstream_load_hunk(chdstream_t *stream, uint32_t hunknum)
+bool chdstream_set_cache(chdstream_t *stream, unsigned hunks,
+      unsigned read_ahead)
+{
+   unsigned i;
+   struct chdstream_hunk *cache = NULL;
+   uint8_t *mem                 = NULL;
+   uint32_t hunkbytes           = 0;
+#ifdef HAVE_THREADS
+   struct chdstream_hunk **batch = NULL;
+   uint8_t *batchmem             = NULL;
+#endif
+
+   if (!stream || !hunks)
+      return false;
+
+   /* Leave room for the hunk being read, and one more so the read-ahead
+    * thread can always find a slot to evict. */
+#ifdef HAVE_THREADS
+   if (read_ahead + 2 > hunks)
+      read_ahead = hunks > 2 ? hunks - 2 : 0;
+#else
+   read_ahead = 0;
+#endif
+
+   hunkbytes = chd_get_header(stream->chd)->hunkbytes;
+   cache     = (struct chdstream_hunk*)calloc(hunks, sizeof(*cache));
+   mem       = (uint8_t*)malloc((size_t)hunks * hunkbytes);
+
+#ifdef HAVE_THREADS
+   if (read_ahead)
+   {
+      batch    = (struct chdstream_hunk**)calloc(read_ahead, sizeof(*batch));
+      batchmem = (uint8_t*)malloc((size_t)read_ahead * hunkbytes);
+   }
+
+   if (read_ahead && (!batch || !batchmem))
+   {
+      free(batch);
+      free(batchmem);
+      batch = NULL;
+      free(mem);
+      mem   = NULL;
+   }
+#endif
+
+   if (!cache || !mem)
+   {
+      free(cache);
+      free(mem);
+      return false;
+   }
+
+   for (i = 0; i < hunks; i++)
+   {
+      cache[i].data    = mem + (size_t)i * hunkbytes;
+      cache[i].hunknum = -1;
+   }
+
+   chdstream_stop_read_ahead(stream);
+
+   free(stream->hunks);
+   free(stream->hunkmem);
+   stream->hunks       = cache;
+   stream->hunkmem     = mem;
+   stream->num_hunks   = hunks;
+   stream->use_counter = 0;
+   stream->sequential  = 0;
+   stream->read_ahead  = read_ahead;
+#ifdef HAVE_THREADS
+   free(stream->batch);
+   free(stream->batchmem);
+   stream->batch       = batch;
+   stream->batchmem    = batchmem;
+#endif
+
+   return true;
+}
+
+static void chdstream_lock(chdstream_t *stream)
+{
+#ifdef HAVE_THREADS
+   slock_lock(stream->lock);
+#endif
+}
+
+static void chdstream_unlock(chdstream_t *stream)
+{
+#ifdef HAVE_THREADS
+   slock_unlock(stream->lock);
+#endif
+}
+
+static void chdstream_swab_hunk(chdstream_t *stream, uint8_t *data)
 {
-   chd_error err;
-   uint16_t *array;
    uint32_t i;
-   uint32_t count;
+   uint32_t count  = chd_get_header(stream->chd)->hunkbytes / 2;
+   uint16_t *array = (uint16_t*)data;
 
-   if (hunknum == stream->hunknum)
-      return true;
+   for (i = 0; i < count; ++i)
+      array[i] = SWAP16(array[i]);
+}
+
+static bool
+chdstream_decode_hunk(chdstream_t *stream, uint32_t hunknum, uint8_t *data)
+{
+   chd_error err;
 
-   err = chd_read(stream->chd, hunknum, stream->hunkmem);
+#ifdef HAVE_THREADS
+   slock_lock(stream->chd_lock);
+#endif
+   err = chd_read(stream->chd, hunknum, data);
+#ifdef HAVE_THREADS
+   slock_unlock(stream->chd_lock);
+#endif
    if (err != CHDERR_NONE)
       return false;
 
    if (stream->swab)
+      chdstream_swab_hunk(stream, data);
+
+   return true;
+}
+
+static struct chdstream_hunk *
+chdstream_find_hunk(chdstream_t *stream, uint32_t hunknum)
+{
+   unsigned i;
+
+   for (i = 0; i < stream->num_hunks; i++)
+      if (stream->hunks[i].hunknum == (int32_t)hunknum)
+         return &stream->hunks[i];
+
+   return NULL;
+}
+
+/* Least recently used slot that is not being loaded; empty slots
+ * were never used, so they are picked first. */
+static struct chdstream_hunk *chdstream_evict_hunk(chdstream_t *stream)
+{
+   unsigned i;
+   struct chdstream_hunk *victim = NULL;
+   uint32_t oldest               = 0;
+
+   for (i = 0; i < stream->num_hunks; i++)
    {
-      count = chd_get_header(stream->chd)->hunkbytes / 2;
-      array = (uint16_t*) stream->hunkmem;
-      for (i = 0; i < count; ++i)
-         array[i] = SWAP16(array[i]);
+      struct chdstream_hunk *hunk = &stream->hunks[i];
+      uint32_t age                = stream->use_counter - hunk->last_used;
+
+      if (hunk->loading)
+         continue;
+      if (hunk->hunknum < 0)
+         return hunk;
+      if (!victim || age > oldest)
+      {
+         victim = hunk;
+         oldest = age;
+      }
+   }
+
+   return victim;
+}
+
+#ifdef HAVE_THREADS
+/* Decompresses consecutive hunks into the given slots, spreading the
+ * work over several threads. */
+static bool chdstream_decode_batch(chdstream_t *stream, uint32_t first,
+      unsigned count)
+{
+   unsigned i;
+   chd_error err;
+   uint32_t hunkbytes = chd_get_header(stream->chd)->hunkbytes;
+
+   slock_lock(stream->chd_lock);
+   err = chd_read_hunks(stream->chd, first, count, stream->batchmem,
+         stream->threads);
+   slock_unlock(stream->chd_lock);
+   if (err != CHDERR_NONE)
+      return false;
+
+   for (i = 0; i < count; i++)
+   {
+      memcpy(stream->batch[i]->data,
+            stream->batchmem + (size_t)i * hunkbytes, hunkbytes);
+      if (stream->swab)
+         chdstream_swab_hunk(stream, stream->batch[i]->data);
    }
 
-   stream->hunknum = hunknum;
+   return true;
+}
+
+static void chdstream_read_ahead_thread(void *data)
+{
+   chdstream_t *stream = (chdstream_t*)data;
+   uint32_t total      = chd_get_header(stream->chd)->totalhunks;
+
+   slock_lock(stream->lock);
+
+   while (!stream->quit)
+   {
+      unsigned i;
+      unsigned count   = 0;
+      uint32_t first   = stream->read_ahead_start;
+      uint32_t end     = first + stream->read_ahead;
+      bool ok;
+
+      if (end > total)
+         end = total;
+
+      for (; first < end; first++)
+         if (     (int32_t)first != stream->read_ahead_failed
+               && !chdstream_find_hunk(stream, first))
+            break;
+
+      /* Claim slots for the run of missing hunks starting there. They
+       * count as used right away so they don't evict each other. */
+      while (first + count < end
+            && (int32_t)(first + count) != stream->read_ahead_failed
+            && !chdstream_find_hunk(stream, first + count))
+      {
+         struct chdstream_hunk *hunk = chdstream_evict_hunk(stream);
+         if (!hunk)
+            break;
+         hunk->hunknum          = first + count;
+         hunk->loading          = true;
+         hunk->last_used        = ++stream->use_counter;
+         stream->batch[count++] = hunk;
+      }
+
+      if (!count)
+      {
+         scond_wait(stream->cond, stream->lock);
+         continue;
+      }
+
+      slock_unlock(stream->lock);
+
+      ok = chdstream_decode_batch(stream, first, count);
+
+      slock_lock(stream->lock);
+      for (i = 0; i < count; i++)
+      {
+         stream->batch[i]->loading = false;
+         if (!ok)
+            stream->batch[i]->hunknum = -1;
+      }
+      /* Skip the first hunk of a failed batch from now on; the reader
+       * decodes the others itself and gets the error. */
+      if (!ok)
+         stream->read_ahead_failed = first;
+      scond_broadcast(stream->loaded);
+   }
+
+   slock_unlock(stream->lock);
+}
+#endif
+
+/* Called with the lock held after each hunk read. Once reads are
+ * sequential, starts the read-ahead thread and points it past
+ * the hunk just read. */
+static void chdstream_update_read_ahead(chdstream_t *stream,
+      uint32_t hunknum)
+{
+   if ((int32_t)hunknum == stream->last_hunknum)
+      return;
+
+   if ((int32_t)hunknum == stream->last_hunknum + 1)
+      stream->sequential++;
+   else
+      stream->sequential = 0;
+   stream->last_hunknum = hunknum;
+
+#ifdef HAVE_THREADS
+   if (!stream->read_ahead)
+      return;
+
+   stream->read_ahead_start = hunknum + 1;
+
+   if (!stream->thread && stream->sequential >= CHDSTREAM_SEQUENTIAL_HUNKS)
+      stream->thread = sthread_create(chdstream_read_ahead_thread, stream);
+
+   if (stream->thread)
+      scond_signal(stream->cond);
+#endif
+}
+
+/* Copies part of a hunk, decompressing it first unless it is cached. */
+static bool chdstream_read_hunk(chdstream_t *stream, uint32_t hunknum,
+      size_t offset, uint8_t *data, size_t bytes)
+{
+   struct chdstream_hunk *hunk = NULL;
+
+   chdstream_lock(stream);
+
+   for (;;)
+   {
+      hunk = chdstream_find_hunk(stream, hunknum);
+
+      if (hunk && !hunk->loading)
+         break;
+
+      if (!hunk)
+      {
+         bool ok;
+
+         hunk = chdstream_evict_hunk(stream);
+         if (hunk)
+         {
+            hunk->hunknum = hunknum;
+            hunk->loading = true;
+            chdstream_unlock(stream);
+
+            ok = chdstream_decode_hunk(stream, hunknum, hunk->data);
+
+            chdstream_lock(stream);
+            hunk->loading = false;
+            if (!ok)
+            {
+               hunk->hunknum = -1;
+               chdstream_unlock(stream);
+               return false;
+            }
+            break;
+         }
+      }
+
+#ifdef HAVE_THREADS
+      /* Either the hunk is being read ahead, and we wait for it rather
+       * than decoding it twice, or every slot is, and we wait for one
+       * to come free. */
+      scond_wait(stream->loaded, stream->lock);
+#else
+      /* Only the read-ahead thread leaves slots loading */
+      chdstream_unlock(stream);
+      return false;
+#endif
+   }
+
+   hunk->last_used = ++stream->use_counter;
+   memcpy(data, hunk->data + offset, bytes);
+
+   chdstream_update_read_ahead(stream, hunknum);
+   chdstream_unlock(stream);
+
    return true;
 }
 
@@ -344,13 +753,10 @@ ssize_t chdstream_read(chdstream_t *stream, void *data, size_t bytes)
          hunk = chd_frame / stream->frames_per_hunk;
          hunk_offset = (chd_frame % stream->frames_per_hunk) * hd->unitbytes;
 
-         if (!chdstream_load_hunk(stream, hunk))
-         {
+         if (!chdstream_read_hunk(stream, hunk,
+                  frame_offset + hunk_offset + stream->frame_offset,
+                  out + data_offset, amount))
             return -1;
-         }
-         memcpy(out + data_offset,
-                stream->hunkmem + frame_offset
-                + hunk_offset + stream->frame_offset, amount);
       }
 
       data_offset    += amount;
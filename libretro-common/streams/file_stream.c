@@ -49,6 +49,11 @@ static retro_vfs_write_t filestream_write_cb       = NULL;
 static retro_vfs_flush_t filestream_flush_cb       = NULL;
 static retro_vfs_remove_t filestream_remove_cb     = NULL;
 static retro_vfs_rename_t filestream_rename_cb     = NULL;
+static retro_vfs_async_open_t filestream_async_open_cb   = NULL;
+static retro_vfs_async_read_t filestream_async_read_cb   = NULL;
+static retro_vfs_async_wait_t filestream_async_wait_cb   = NULL;
+static retro_vfs_async_close_t filestream_async_close_cb = NULL;
+static retro_vfs_get_mapped_t filestream_get_mapped_cb   = NULL;
 
 struct RFILE
 {
@@ -75,6 +80,11 @@ void filestream_vfs_init(const struct retro_vfs_interface_info* vfs_info)
    filestream_flush_cb    = NULL;
    filestream_remove_cb   = NULL;
    filestream_rename_cb   = NULL;
+   filestream_async_open_cb  = NULL;
+   filestream_async_read_cb  = NULL;
+   filestream_async_wait_cb  = NULL;
+   filestream_async_close_cb = NULL;
+   filestream_get_mapped_cb  = NULL;
 
    vfs_iface              = vfs_info->iface;
 
@@ -94,6 +104,20 @@ void filestream_vfs_init(const struct retro_vfs_interface_info* vfs_info)
    filestream_flush_cb    = vfs_iface->flush;
    filestream_remove_cb   = vfs_iface->remove;
    filestream_rename_cb   = vfs_iface->rename;
+
+   /* The frontend has written back the version it provides */
+   if (vfs_info->required_interface_version < 4)
+      return;
+
+   filestream_async_open_cb  = vfs_iface->async_open;
+   filestream_async_read_cb  = vfs_iface->async_read;
+   filestream_async_wait_cb  = vfs_iface->async_wait;
+   filestream_async_close_cb = vfs_iface->async_close;
+
+   if (vfs_info->required_interface_version < 5)
+      return;
+
+   filestream_get_mapped_cb  = vfs_iface->get_mapped;
 }
 
 /* Callback wrappers */
@@ -407,6 +431,88 @@ const char* filestream_get_path(RFILE *stream)
    return retro_vfs_file_get_path_impl((libretro_vfs_implementation_file*)stream->hfile);
 }
 
+const void *filestream_get_mapped(RFILE *stream, int64_t *len)
+{
+   uint64_t size    = 0;
+   const void *data = NULL;
+
+   if (!stream)
+      return NULL;
+
+   if (filestream_get_mapped_cb != NULL)
+   {
+      data = filestream_get_mapped_cb(stream->hfile, 0, &size);
+
+      /* The frontend may only map part of the file */
+      if (data && (int64_t)size < filestream_get_size(stream))
+         return NULL;
+   }
+   /* Files opened by a frontend older than VFS v5 can't be mapped */
+   else if (filestream_open_cb != NULL)
+      return NULL;
+   else
+      data = retro_vfs_file_get_mapped_impl(
+            (libretro_vfs_implementation_file*)stream->hfile, 0, &size);
+
+   if (data && len)
+      *len = (int64_t)size;
+
+   return data;
+}
+
+struct retro_vfs_async_queue *filestream_async_open(unsigned depth)
+{
+   if (filestream_async_open_cb != NULL)
+      return filestream_async_open_cb(depth);
+
+   /* The built-in implementation only reads its own file handles */
+   if (filestream_open_cb != NULL)
+      return NULL;
+
+   return (struct retro_vfs_async_queue*)retro_vfs_async_open_impl(depth);
+}
+
+int filestream_async_read(struct retro_vfs_async_queue *queue,
+      RFILE *stream, void *s, int64_t len, int64_t offset, void *userdata)
+{
+   int output;
+
+   if (!stream || len < 0)
+      return -1;
+
+   if (filestream_async_read_cb != NULL)
+      output = filestream_async_read_cb(queue, stream->hfile,
+            s, len, offset, userdata);
+   else
+      output = retro_vfs_async_read_impl(
+            (libretro_vfs_implementation_async_queue*)queue,
+            (libretro_vfs_implementation_file*)stream->hfile,
+            s, len, offset, userdata);
+
+   return output;
+}
+
+int filestream_async_wait(struct retro_vfs_async_queue *queue,
+      struct retro_vfs_async_result *results, unsigned max,
+      unsigned min_complete)
+{
+   if (filestream_async_wait_cb != NULL)
+      return filestream_async_wait_cb(queue, results, max, min_complete);
+
+   return retro_vfs_async_wait_impl(
+         (libretro_vfs_implementation_async_queue*)queue,
+         results, max, min_complete);
+}
+
+int filestream_async_close(struct retro_vfs_async_queue *queue)
+{
+   if (filestream_async_close_cb != NULL)
+      return filestream_async_close_cb(queue);
+
+   return retro_vfs_async_close_impl(
+         (libretro_vfs_implementation_async_queue*)queue);
+}
+
 int64_t filestream_write(RFILE *stream, const void *s, int64_t len)
 {
    int64_t output;
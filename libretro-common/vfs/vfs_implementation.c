@@ -470,20 +470,35 @@ libretro_vfs_implementation_file *retro_vfs_file_open_impl(
 #ifdef HAVE_MMAP
       if (stream->hints & RETRO_VFS_FILE_ACCESS_HINT_FREQUENT_ACCESS)
       {
+         /* Not retro_vfs_file_seek_internal(), which only returns
+          * the position for mapped files */
+         int64_t mapsize = (int64_t)lseek(stream->fd, 0, SEEK_END);
+
          stream->mappos  = 0;
          stream->mapped  = NULL;
-         stream->mapsize = retro_vfs_file_seek_internal(stream, 0, SEEK_END);
 
-         if (stream->mapsize == (uint64_t)-1)
+         if (mapsize < 0)
             goto error;
 
-         retro_vfs_file_seek_internal(stream, 0, SEEK_SET);
-
-         stream->mapped = (uint8_t*)mmap((void*)0,
-               stream->mapsize, PROT_READ,  MAP_SHARED, stream->fd, 0);
+         stream->mapsize = (uint64_t)mapsize;
+         lseek(stream->fd, 0, SEEK_SET);
 
-         if (stream->mapped == MAP_FAILED)
+         /* Too big to map whole in this address space (32-bit);
+          * a truncated mapping would be reported at full size */
+         if ((uint64_t)(size_t)stream->mapsize != stream->mapsize)
             stream->hints &= ~RETRO_VFS_FILE_ACCESS_HINT_FREQUENT_ACCESS;
+         else
+         {
+            /* Private and writable: the mapping is handed to cores as
+             * their content, and some patch it in place. Written pages
+             * are copied, the file itself is never changed. */
+            stream->mapped = (uint8_t*)mmap((void*)0,
+                  (size_t)stream->mapsize, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE, stream->fd, 0);
+
+            if (stream->mapped == MAP_FAILED)
+               stream->hints &= ~RETRO_VFS_FILE_ACCESS_HINT_FREQUENT_ACCESS;
+         }
       }
 #endif
    }
@@ -861,6 +876,22 @@ const char *retro_vfs_file_get_path_impl(
    return stream->orig_path;
 }
 
+const void *retro_vfs_file_get_mapped_impl(
+      libretro_vfs_implementation_file *stream, int64_t offset, uint64_t *len)
+{
+#ifdef HAVE_MMAP
+   /* The hint is dropped again if mmap() failed */
+   if (stream && stream->mapped
+         && stream->hints & RETRO_VFS_FILE_ACCESS_HINT_FREQUENT_ACCESS
+         && offset >= 0 && (uint64_t)offset < stream->mapsize)
+   {
+      *len = stream->mapsize - (uint64_t)offset;
+      return stream->mapped + offset;
+   }
+#endif
+   return NULL;
+}
+
 int retro_vfs_stat_impl(const char *path, int32_t *size)
 {
 #if defined(VITA) || defined(PSP)
@@ -0,0 +1,822 @@
+/* Copyright  (C) 2010-2019 The RetroArch team
+*
+* ---------------------------------------------------------------------------------------
+* The following license statement only applies to this file (vfs_implementation_async.c).
+* ---------------------------------------------------------------------------------------
+*
+* Permission is hereby granted, free of charge,
+* to any person obtaining a copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation the rights to
+* use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+* and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+* INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+* WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#if defined(HAVE_IO_URING) && !defined(__linux__)
+#undef HAVE_IO_URING
+#endif
+
+#ifdef HAVE_IO_URING
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <vfs/vfs_implementation.h>
+
+/* Reads at an offset without touching the file position */
+#if !defined(_WIN32) && !defined(ORBIS) && !defined(VITA) && !defined(PSP) \
+   && (defined(__unix__) || defined(__APPLE__) || defined(__HAIKU__))
+#define VFS_ASYNC_HAVE_PREAD
+#include <unistd.h>
+#endif
+
+#if defined(HAVE_THREADS) && defined(VFS_ASYNC_HAVE_PREAD)
+#define VFS_ASYNC_HAVE_POOL
+#include <rthreads/rthreads.h>
+#endif
+
+#ifdef HAVE_IO_URING
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#include <retro_timers.h>
+
+/* Older C libraries lack the numbers, which are the same on all
+ * architectures using the generic syscall table */
+#ifndef __NR_io_uring_setup
+#define __NR_io_uring_setup 425
+#endif
+#ifndef __NR_io_uring_enter
+#define __NR_io_uring_enter 426
+#endif
+#endif
+
+/* Upper bound for the reads a queue keeps in flight */
+#define VFS_ASYNC_MAX_DEPTH   4096
+/* Worker threads of the thread pool backend */
+#define VFS_ASYNC_MAX_THREADS 4
+
+enum vfs_async_backend
+{
+   VFS_ASYNC_BACKEND_SYNC = 0,
+   VFS_ASYNC_BACKEND_POOL,
+   VFS_ASYNC_BACKEND_URING
+};
+
+#ifdef VFS_ASYNC_HAVE_POOL
+typedef struct
+{
+   void *s;
+   void *userdata;
+   uint64_t len;
+   int64_t offset;
+   int fd;
+} vfs_async_request_t;
+#endif
+
+#ifdef HAVE_IO_URING
+typedef struct
+{
+   /* What is left to read, after @done bytes */
+   struct iovec iov;
+   void *userdata;
+   int64_t offset;
+   uint64_t done;
+   int fd;
+} vfs_async_uring_slot_t;
+
+typedef struct
+{
+   int fd;
+   /* Entries filled in but not accepted by the kernel yet */
+   unsigned to_submit;
+
+   unsigned *sq_head;
+   unsigned *sq_tail;
+   unsigned *sq_mask;
+   unsigned *sq_array;
+   unsigned *cq_head;
+   unsigned *cq_tail;
+   unsigned *cq_mask;
+   struct io_uring_sqe *sqes;
+   struct io_uring_cqe *cqes;
+
+   void *sq_ring;
+   void *cq_ring;
+   size_t sq_ring_size;
+   size_t cq_ring_size;
+   size_t sqes_size;
+
+   /* One slot per read in flight, the CQE user_data is the slot index */
+   vfs_async_uring_slot_t *slots;
+   unsigned *free_slots;
+   unsigned free_count;
+} vfs_async_uring_t;
+#endif
+
+#ifdef VFS_FRONTEND
+struct retro_vfs_async_queue
+#else
+struct libretro_vfs_implementation_async_queue
+#endif
+{
+   enum vfs_async_backend backend;
+   unsigned depth;
+   /* Reads queued to the backend which have not completed yet */
+   unsigned inflight;
+
+   /* Completed reads not returned by wait yet, a ring of @depth */
+   struct retro_vfs_async_result *done;
+   unsigned done_head;
+   unsigned done_count;
+
+#ifdef VFS_ASYNC_HAVE_POOL
+   slock_t *lock;
+   scond_t *work_cond;
+   scond_t *done_cond;
+   sthread_t *threads[VFS_ASYNC_MAX_THREADS];
+   unsigned num_threads;
+   bool quit;
+
+   /* Reads waiting for a worker, a ring of @depth */
+   vfs_async_request_t *pending;
+   unsigned pending_head;
+   unsigned pending_count;
+#endif
+
+#ifdef HAVE_IO_URING
+   vfs_async_uring_t uring;
+#endif
+};
+
+static void vfs_async_lock(libretro_vfs_implementation_async_queue *queue)
+{
+#ifdef VFS_ASYNC_HAVE_POOL
+   if (queue->lock)
+      slock_lock(queue->lock);
+#endif
+}
+
+static void vfs_async_unlock(libretro_vfs_implementation_async_queue *queue)
+{
+#ifdef VFS_ASYNC_HAVE_POOL
+   if (queue->lock)
+      slock_unlock(queue->lock);
+#endif
+}
+
+/* Called with the queue lock held */
+static void vfs_async_complete(libretro_vfs_implementation_async_queue *queue,
+      void *userdata, int64_t bytes)
+{
+   struct retro_vfs_async_result *result = &queue->done[
+      (queue->done_head + queue->done_count) % queue->depth];
+
+   result->userdata = userdata;
+   result->bytes    = bytes;
+   queue->done_count++;
+}
+
+/* Reads with the blocking interface, restoring the file position */
+static int64_t vfs_async_read_sync(libretro_vfs_implementation_file *stream,
+      void *s, uint64_t len, int64_t offset)
+{
+   int64_t ret;
+   int64_t pos = retro_vfs_file_tell_impl(stream);
+
+   if (pos < 0 || retro_vfs_file_seek_impl(stream, offset,
+            RETRO_VFS_SEEK_POSITION_START) < 0)
+      return -1;
+
+   ret = retro_vfs_file_read_impl(stream, s, len);
+
+   if (retro_vfs_file_seek_impl(stream, pos,
+            RETRO_VFS_SEEK_POSITION_START) < 0)
+      return -1;
+
+   return ret;
+}
+
+#ifdef VFS_ASYNC_HAVE_PREAD
+static int vfs_async_get_fd(libretro_vfs_implementation_file *stream)
+{
+#ifdef HAVE_CDROM
+   if (stream->scheme == VFS_SCHEME_CDROM)
+      return -1;
+#endif
+   if (stream->fp)
+      return fileno(stream->fp);
+   return stream->fd;
+}
+#endif
+
+#ifdef VFS_ASYNC_HAVE_POOL
+static int64_t vfs_async_pread(int fd, void *s, uint64_t len, int64_t offset)
+{
+   uint64_t total = 0;
+
+   while (total < len)
+   {
+      ssize_t ret = pread(fd, (uint8_t*)s + total,
+            (size_t)(len - total), (off_t)(offset + total));
+
+      if (ret < 0)
+      {
+         if (errno == EINTR)
+            continue;
+         return -1;
+      }
+
+      if (ret == 0)
+         break;
+
+      total += ret;
+   }
+
+   return (int64_t)total;
+}
+
+static void vfs_async_worker(void *data)
+{
+   libretro_vfs_implementation_async_queue *queue =
+      (libretro_vfs_implementation_async_queue*)data;
+
+   slock_lock(queue->lock);
+
+   for (;;)
+   {
+      vfs_async_request_t req;
+      int64_t bytes;
+
+      while (!queue->pending_count && !queue->quit)
+         scond_wait(queue->work_cond, queue->lock);
+
+      if (!queue->pending_count)
+         break;
+
+      req                 = queue->pending[queue->pending_head];
+      queue->pending_head = (queue->pending_head + 1) % queue->depth;
+      queue->pending_count--;
+
+      slock_unlock(queue->lock);
+      bytes = vfs_async_pread(req.fd, req.s, req.len, req.offset);
+      slock_lock(queue->lock);
+
+      queue->inflight--;
+      vfs_async_complete(queue, req.userdata, bytes);
+      scond_signal(queue->done_cond);
+   }
+
+   slock_unlock(queue->lock);
+}
+
+static bool vfs_async_pool_init(libretro_vfs_implementation_async_queue *queue)
+{
+   unsigned i;
+   unsigned num_threads = queue->depth < VFS_ASYNC_MAX_THREADS
+      ? queue->depth : VFS_ASYNC_MAX_THREADS;
+
+   queue->pending = (vfs_async_request_t*)
+      malloc(queue->depth * sizeof(*queue->pending));
+
+   if (!queue->pending)
+      return false;
+
+   if (!(queue->work_cond = scond_new()))
+      return false;
+   if (!(queue->done_cond = scond_new()))
+      return false;
+
+   for (i = 0; i < num_threads; i++)
+   {
+      if (!(queue->threads[i] = sthread_create(vfs_async_worker, queue)))
+         break;
+      queue->num_threads++;
+   }
+
+   return queue->num_threads > 0;
+}
+
+static void vfs_async_pool_deinit(libretro_vfs_implementation_async_queue *queue)
+{
+   unsigned i;
+
+   if (queue->num_threads)
+   {
+      slock_lock(queue->lock);
+      queue->quit = true;
+      scond_broadcast(queue->work_cond);
+      slock_unlock(queue->lock);
+
+      /* Workers finish the queued reads before leaving */
+      for (i = 0; i < queue->num_threads; i++)
+         sthread_join(queue->threads[i]);
+   }
+
+   if (queue->work_cond)
+      scond_free(queue->work_cond);
+   if (queue->done_cond)
+      scond_free(queue->done_cond);
+   free(queue->pending);
+}
+
+static int vfs_async_pool_submit(libretro_vfs_implementation_async_queue *queue,
+      int fd, void *s, uint64_t len, int64_t offset, void *userdata)
+{
+   vfs_async_request_t *req = &queue->pending[
+      (queue->pending_head + queue->pending_count) % queue->depth];
+
+   req->s        = s;
+   req->userdata = userdata;
+   req->len      = len;
+   req->offset   = offset;
+   req->fd       = fd;
+
+   queue->pending_count++;
+   queue->inflight++;
+   scond_signal(queue->work_cond);
+
+   return 0;
+}
+#endif
+
+#ifdef HAVE_IO_URING
+static int vfs_async_uring_enter(int fd, unsigned to_submit,
+      unsigned min_complete, unsigned flags)
+{
+   return (int)syscall(__NR_io_uring_enter, fd, to_submit,
+         min_complete, flags, NULL, 0);
+}
+
+static void vfs_async_uring_deinit(vfs_async_uring_t *uring)
+{
+   if (uring->sqes)
+      munmap(uring->sqes, uring->sqes_size);
+   if (uring->cq_ring && uring->cq_ring != uring->sq_ring)
+      munmap(uring->cq_ring, uring->cq_ring_size);
+   if (uring->sq_ring)
+      munmap(uring->sq_ring, uring->sq_ring_size);
+   if (uring->fd >= 0)
+      close(uring->fd);
+
+   free(uring->slots);
+   free(uring->free_slots);
+}
+
+static bool vfs_async_uring_init(vfs_async_uring_t *uring, unsigned depth)
+{
+   unsigned i;
+   struct io_uring_params p;
+   uint8_t *sq_ring         = NULL;
+   uint8_t *cq_ring         = NULL;
+
+   memset(&p, 0, sizeof(p));
+
+   uring->fd = (int)syscall(__NR_io_uring_setup, depth, &p);
+
+   /* Not built into the kernel or blocked by a sandbox */
+   if (uring->fd < 0)
+      return false;
+
+   uring->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+   uring->cq_ring_size = p.cq_off.cqes
+      + p.cq_entries * sizeof(struct io_uring_cqe);
+   uring->sqes_size    = p.sq_entries * sizeof(struct io_uring_sqe);
+
+#ifdef IORING_FEAT_SINGLE_MMAP
+   if (p.features & IORING_FEAT_SINGLE_MMAP)
+   {
+      if (uring->cq_ring_size > uring->sq_ring_size)
+         uring->sq_ring_size = uring->cq_ring_size;
+      uring->cq_ring_size = uring->sq_ring_size;
+   }
+#endif
+
+   sq_ring = (uint8_t*)mmap(NULL, uring->sq_ring_size,
+         PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+         uring->fd, IORING_OFF_SQ_RING);
+   if (sq_ring == MAP_FAILED)
+      return false;
+   uring->sq_ring = sq_ring;
+
+#ifdef IORING_FEAT_SINGLE_MMAP
+   if (p.features & IORING_FEAT_SINGLE_MMAP)
+      cq_ring = sq_ring;
+   else
+#endif
+   {
+      cq_ring = (uint8_t*)mmap(NULL, uring->cq_ring_size,
+            PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            uring->fd, IORING_OFF_CQ_RING);
+      if (cq_ring == MAP_FAILED)
+         return false;
+   }
+   uring->cq_ring = cq_ring;
+
+   uring->sqes = (struct io_uring_sqe*)mmap(NULL, uring->sqes_size,
+         PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+         uring->fd, IORING_OFF_SQES);
+   if (uring->sqes == MAP_FAILED)
+   {
+      uring->sqes = NULL;
+      return false;
+   }
+
+   uring->sq_head  = (unsigned*)(sq_ring + p.sq_off.head);
+   uring->sq_tail  = (unsigned*)(sq_ring + p.sq_off.tail);
+   uring->sq_mask  = (unsigned*)(sq_ring + p.sq_off.ring_mask);
+   uring->sq_array = (unsigned*)(sq_ring + p.sq_off.array);
+   uring->cq_head  = (unsigned*)(cq_ring + p.cq_off.head);
+   uring->cq_tail  = (unsigned*)(cq_ring + p.cq_off.tail);
+   uring->cq_mask  = (unsigned*)(cq_ring + p.cq_off.ring_mask);
+   uring->cqes     = (struct io_uring_cqe*)(cq_ring + p.cq_off.cqes);
+
+   uring->slots      = (vfs_async_uring_slot_t*)
+      calloc(depth, sizeof(*uring->slots));
+   uring->free_slots = (unsigned*)malloc(depth * sizeof(unsigned));
+
+   if (!uring->slots || !uring->free_slots)
+      return false;
+
+   for (i = 0; i < depth; i++)
+      uring->free_slots[i] = depth - 1 - i;
+   uring->free_count = depth;
+
+   return true;
+}
+
+/* Queues the rest of @slot's read, to be submitted on the next enter.
+ * Every slot has at most one entry queued and there are as many
+ * slots as entries, so there is always room. */
+static void vfs_async_uring_queue(vfs_async_uring_t *uring, unsigned slot)
+{
+   unsigned tail                = *uring->sq_tail;
+   unsigned index               = tail & *uring->sq_mask;
+   struct io_uring_sqe *sqe     = &uring->sqes[index];
+   vfs_async_uring_slot_t *req  = &uring->slots[slot];
+
+   /* READV rather than READ, so that 5.1 kernels work as well */
+   memset(sqe, 0, sizeof(*sqe));
+   sqe->opcode    = IORING_OP_READV;
+   sqe->fd        = req->fd;
+   sqe->off       = (uint64_t)(req->offset + req->done);
+   sqe->addr      = (uint64_t)(uintptr_t)&req->iov;
+   sqe->len       = 1;
+   sqe->user_data = slot;
+
+   uring->sq_array[index] = index;
+   __atomic_store_n(uring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+   uring->to_submit++;
+}
+
+static void vfs_async_uring_reap(libretro_vfs_implementation_async_queue *queue)
+{
+   vfs_async_uring_t *uring = &queue->uring;
+   unsigned head            = *uring->cq_head;
+   unsigned tail            = __atomic_load_n(uring->cq_tail, __ATOMIC_ACQUIRE);
+
+   while (head != tail)
+   {
+      struct io_uring_cqe *cqe    = &uring->cqes[head & *uring->cq_mask];
+      unsigned slot               = (unsigned)cqe->user_data;
+      vfs_async_uring_slot_t *req = &uring->slots[slot];
+
+      head++;
+
+      /* Reads only come back short at the end of the file, as with
+       * the other backends; anything else is read again from where
+       * it stopped, keeping the slot */
+      if (cqe->res > 0 && (size_t)cqe->res < req->iov.iov_len)
+      {
+         req->done         += cqe->res;
+         req->iov.iov_base  = (uint8_t*)req->iov.iov_base + cqe->res;
+         req->iov.iov_len  -= cqe->res;
+         vfs_async_uring_queue(uring, slot);
+         continue;
+      }
+
+      vfs_async_complete(queue, req->userdata,
+            cqe->res < 0 ? -1 : (int64_t)(req->done + cqe->res));
+      uring->free_slots[uring->free_count++] = slot;
+      queue->inflight--;
+   }
+
+   __atomic_store_n(uring->cq_head, head, __ATOMIC_RELEASE);
+}
+
+static int vfs_async_uring_submit(libretro_vfs_implementation_async_queue *queue,
+      int fd, void *s, uint64_t len, int64_t offset, void *userdata)
+{
+   int ret;
+   vfs_async_uring_t *uring = &queue->uring;
+   unsigned tail            = *uring->sq_tail;
+   unsigned slot            = uring->free_slots[--uring->free_count];
+
+   uring->slots[slot].iov.iov_base = s;
+   uring->slots[slot].iov.iov_len  = (size_t)len;
+   uring->slots[slot].userdata     = userdata;
+   uring->slots[slot].offset       = offset;
+   uring->slots[slot].done         = 0;
+   uring->slots[slot].fd           = fd;
+
+   vfs_async_uring_queue(uring, slot);
+
+   ret = vfs_async_uring_enter(uring->fd, uring->to_submit, 0, 0);
+
+   if (ret >= 0)
+      uring->to_submit -= ret;
+   else if (errno != EAGAIN && errno != EBUSY && errno != EINTR)
+   {
+      /* The kernel only picks up entries while entering,
+       * so taking this one back is safe */
+      __atomic_store_n(uring->sq_tail, tail, __ATOMIC_RELEASE);
+      uring->to_submit--;
+      uring->free_slots[uring->free_count++] = slot;
+      return -1;
+   }
+
+   /* Entries not accepted yet are retried by the next wait */
+   queue->inflight++;
+   return 0;
+}
+
+static int vfs_async_uring_wait(libretro_vfs_implementation_async_queue *queue,
+      unsigned want)
+{
+   vfs_async_uring_t *uring = &queue->uring;
+
+   vfs_async_uring_reap(queue);
+
+   while (queue->done_count < want || uring->to_submit)
+   {
+      unsigned min_complete = queue->done_count < want
+         ? want - queue->done_count : 0;
+      int ret               = vfs_async_uring_enter(uring->fd,
+            uring->to_submit, min_complete,
+            min_complete ? IORING_ENTER_GETEVENTS : 0);
+
+      if (ret < 0)
+      {
+         if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+            return -1;
+      }
+      else
+         uring->to_submit -= ret;
+
+      vfs_async_uring_reap(queue);
+
+      if (!min_complete)
+         break;
+   }
+
+   return 0;
+}
+#endif
+
+libretro_vfs_implementation_async_queue *retro_vfs_async_open_impl(
+      unsigned depth)
+{
+   libretro_vfs_implementation_async_queue *queue = NULL;
+
+   if (depth == 0 || depth > VFS_ASYNC_MAX_DEPTH)
+      return NULL;
+
+   queue = (libretro_vfs_implementation_async_queue*)
+      calloc(1, sizeof(*queue));
+
+   if (!queue)
+      return NULL;
+
+   queue->depth = depth;
+   queue->done  = (struct retro_vfs_async_result*)
+      malloc(depth * sizeof(*queue->done));
+
+   if (!queue->done)
+      goto error;
+
+#ifdef HAVE_IO_URING
+   queue->uring.fd = -1;
+   if (vfs_async_uring_init(&queue->uring, depth))
+   {
+      queue->backend = VFS_ASYNC_BACKEND_URING;
+      return queue;
+   }
+   vfs_async_uring_deinit(&queue->uring);
+   memset(&queue->uring, 0, sizeof(queue->uring));
+   queue->uring.fd = -1;
+#endif
+
+#ifdef VFS_ASYNC_HAVE_POOL
+   if ((queue->lock = slock_new()))
+   {
+      if (vfs_async_pool_init(queue))
+      {
+         queue->backend = VFS_ASYNC_BACKEND_POOL;
+         return queue;
+      }
+
+      vfs_async_pool_deinit(queue);
+      slock_free(queue->lock);
+      queue->lock        = NULL;
+      queue->work_cond   = NULL;
+      queue->done_cond   = NULL;
+      queue->pending     = NULL;
+      queue->num_threads = 0;
+   }
+#endif
+
+   queue->backend = VFS_ASYNC_BACKEND_SYNC;
+   return queue;
+
+error:
+   free(queue->done);
+   free(queue);
+   return NULL;
+}
+
+int retro_vfs_async_read_impl(libretro_vfs_implementation_async_queue *queue,
+      libretro_vfs_implementation_file *stream, void *s, uint64_t len,
+      int64_t offset, void *userdata)
+{
+   int ret = 0;
+#if defined(HAVE_MMAP) && !defined(__WINRT__)
+   uint64_t size       = 0;
+   const uint8_t *data = NULL;
+#endif
+#ifdef VFS_ASYNC_HAVE_PREAD
+   int fd              = -1;
+#endif
+
+   if (!queue || !stream || !s || offset < 0)
+      return -1;
+
+   vfs_async_lock(queue);
+
+   if (queue->inflight + queue->done_count >= queue->depth)
+   {
+      vfs_async_unlock(queue);
+      return -1;
+   }
+
+#if defined(HAVE_MMAP) && !defined(__WINRT__)
+   /* Mapped files are in memory already */
+   if ((data = (const uint8_t*)retro_vfs_file_get_mapped_impl(stream, 0, &size)))
+   {
+      int64_t bytes = 0;
+
+      if ((uint64_t)offset < size)
+      {
+         bytes = (int64_t)(size - offset);
+         if ((uint64_t)bytes > len)
+            bytes = (int64_t)len;
+         memcpy(s, data + offset, (size_t)bytes);
+      }
+
+      vfs_async_complete(queue, userdata, bytes);
+      vfs_async_unlock(queue);
+      return 0;
+   }
+#endif
+
+#ifdef VFS_ASYNC_HAVE_PREAD
+   fd = vfs_async_get_fd(stream);
+
+   if (fd >= 0)
+   {
+      switch (queue->backend)
+      {
+#ifdef HAVE_IO_URING
+         case VFS_ASYNC_BACKEND_URING:
+            ret = vfs_async_uring_submit(queue, fd, s, len, offset, userdata);
+            vfs_async_unlock(queue);
+            return ret;
+#endif
+#ifdef VFS_ASYNC_HAVE_POOL
+         case VFS_ASYNC_BACKEND_POOL:
+            ret = vfs_async_pool_submit(queue, fd, s, len, offset, userdata);
+            vfs_async_unlock(queue);
+            return ret;
+#endif
+         default:
+            break;
+      }
+   }
+#endif
+
+   /* Streams without a file descriptor (CD-ROM, other platforms)
+    * complete right away */
+   vfs_async_complete(queue, userdata,
+         vfs_async_read_sync(stream, s, len, offset));
+   vfs_async_unlock(queue);
+
+   return ret;
+}
+
+int retro_vfs_async_wait_impl(libretro_vfs_implementation_async_queue *queue,
+      struct retro_vfs_async_result *results, unsigned max,
+      unsigned min_complete)
+{
+   unsigned i, want;
+   unsigned count = 0;
+
+   if (!queue || (max && !results) || min_complete > max)
+      return -1;
+
+   vfs_async_lock(queue);
+
+   want = queue->done_count + queue->inflight;
+   if (min_complete < want)
+      want = min_complete;
+
+   switch (queue->backend)
+   {
+#ifdef HAVE_IO_URING
+      case VFS_ASYNC_BACKEND_URING:
+         if (vfs_async_uring_wait(queue, want) != 0
+               && queue->done_count < want)
+         {
+            vfs_async_unlock(queue);
+            return -1;
+         }
+         break;
+#endif
+#ifdef VFS_ASYNC_HAVE_POOL
+      case VFS_ASYNC_BACKEND_POOL:
+         while (queue->done_count < want)
+            scond_wait(queue->done_cond, queue->lock);
+         break;
+#endif
+      default:
+         break;
+   }
+
+   count = queue->done_count < max ? queue->done_count : max;
+
+   for (i = 0; i < count; i++)
+   {
+      results[i]       = queue->done[queue->done_head];
+      queue->done_head = (queue->done_head + 1) % queue->depth;
+   }
+   queue->done_count -= count;
+
+   vfs_async_unlock(queue);
+
+   return (int)count;
+}
+
+int retro_vfs_async_close_impl(libretro_vfs_implementation_async_queue *queue)
+{
+   if (!queue)
+      return -1;
+
+   switch (queue->backend)
+   {
+#ifdef HAVE_IO_URING
+      case VFS_ASYNC_BACKEND_URING:
+         /* The kernel may still write into the buffers, even once
+          * the ring is closed, so there is no giving up on them */
+         while (queue->inflight)
+         {
+            queue->done_head  = 0;
+            queue->done_count = 0;
+            if (vfs_async_uring_wait(queue, 1) != 0)
+               retro_sleep(1);
+         }
+         vfs_async_uring_deinit(&queue->uring);
+         break;
+#endif
+#ifdef VFS_ASYNC_HAVE_POOL
+      case VFS_ASYNC_BACKEND_POOL:
+         vfs_async_pool_deinit(queue);
+         slock_free(queue->lock);
+         break;
+#endif
+      default:
+         break;
+   }
+
+   free(queue->done);
+   free(queue);
+
+   return 0;
+}
@@ -44,6 +44,44 @@ bool state_manager_check_rewind(bool pressed,
       unsigned rewind_granularity, bool is_paused,
       char *s, size_t len, unsigned *time);
 
+/**
+ * state_manager_raw_maxsize:
+ * @uncomp               : size of the uncompressed state.
+ *
+ * Returns: the worst case size of a patch between two states
+ * of @uncomp bytes.
+ **/
+size_t state_manager_raw_maxsize(size_t uncomp);
+
+/**
+ * state_manager_raw_alloc:
+ * @len                  : size of the state.
+ * @uniq                 : sentinel word, must differ between
+ *                         the two buffers passed to
+ *                         state_manager_raw_compress().
+ *
+ * Allocates a zeroed, padded state buffer usable with
+ * state_manager_raw_compress(). Free it with free().
+ **/
+void *state_manager_raw_alloc(size_t len, uint16_t uniq);
+
+/**
+ * state_manager_raw_compress:
+ * @src                  : state returned from state_manager_raw_alloc().
+ * @dst                  : state returned from state_manager_raw_alloc(),
+ *                         with the same @len and a different uniq.
+ * @len                  : size of both states.
+ * @patch                : output, at least state_manager_raw_maxsize(@len).
+ *
+ * Encodes the 16-bit words of @src that differ from @dst as
+ * (changed, skipped) runs. Applying the patch to a copy of @dst
+ * yields @src.
+ *
+ * Returns: number of bytes written to @patch.
+ **/
+size_t state_manager_raw_compress(const void *src,
+      const void *dst, size_t len, void *patch);
+
 RETRO_END_DECLS
 
 #endif
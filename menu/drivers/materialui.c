@@ -163,6 +163,8 @@ typedef struct materialui_handle
 
    /* Y position of the vertical scroll */
    float scroll_y;
+   /* Scroll tween started by the last navigation */
+   menu_animation_handle_t scroll_anim;
    float content_height;
    float textures_arrow_alpha;
    float categories_x_pos;
@@ -1888,9 +1890,11 @@ static void materialui_navigation_set(void *data, bool scroll)
    /* TODO/FIXME - integer conversion resulted in change of sign */
    entry.tag          = -1;
    entry.cb           = NULL;
+   entry.userdata     = NULL;
 
-   if (entry.subject)
-      menu_animation_push(&entry);
+   /* Only the latest scroll should move the list */
+   menu_animation_kill_by_handle(&mui->scroll_anim);
+   mui->scroll_anim   = menu_animation_push_handle(&entry);
 }
 
 static void materialui_list_set_selection(void *data, file_list_t *list)
@@ -2840,26 +2844,10 @@ static void materialui_list_clear(file_list_t *list)
    size_t i;
    size_t size = list ? list->size : 0;
 
+   /* Nodes are never animated, their line height and position
+    * are set directly, so there are no tweens to kill here */
    for (i = 0; i < size; ++i)
-   {
-      menu_animation_ctx_subject_t subject;
-      float *subjects[2];
-      materialui_node_t *node = (materialui_node_t*)
-         file_list_get_userdata_at_offset(list, i);
-
-      if (!node)
-         continue;
-
-      subjects[0] = &node->line_height;
-      subjects[1] = &node->y;
-
-      subject.count = 2;
-      subject.data  = subjects;
-
-      menu_animation_kill_by_subject(&subject);
-
       file_list_free_userdata(list, i);
-   }
 }
 
 menu_ctx_driver_t menu_ctx_mui = {
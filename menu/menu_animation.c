@@ -25,38 +25,55 @@
 #include <features/features_cpu.h>
 #include <lists/string_list.h>
 
-#define DG_DYNARR_IMPLEMENTATION
-#include <stdio.h>
-#include <retro_assert.h>
-#define DG_DYNARR_ASSERT(cond, msg)  (void)0
-#include <array/dynarray.h>
-#undef DG_DYNARR_IMPLEMENTATION
-
 #include "menu_animation.h"
 #include "../configuration.h"
 #include "../performance_counters.h"
 
-struct tween
-{
-   float       duration;
-   float       running_since;
-   float       initial_value;
-   float       target_value;
-   float       *subject;
-   uintptr_t   tag;
-   easing_cb   easing;
-   tween_cb    cb;
-   void        *userdata;
-   bool        deleted;
+/* Handles carry a slot in their low bits and the generation of the
+ * slot in their high bits, so a stale handle never matches the tween
+ * that reuses its slot */
+#define TWEEN_SLOT_BITS 16
+#define TWEEN_MAX       ((1 << TWEEN_SLOT_BITS) - 1)
+
+/* Tweens sharing an easing function, as parallel arrays. A frame
+ * steps all of them in one loop without an indirect call per tween.
+ * Within a group tweens stay in the order they were pushed. */
+struct tween_group
+{
+   float *duration;
+   float *running_since;
+   float *initial_value;
+   float *delta_value;
+   float *target_value;
+   float *value;          /* eased values of the current frame */
+   float **subject;
+   uintptr_t *tag;
+   tween_cb *cb;
+   void **userdata;
+   menu_animation_handle_t *handle;
+   bool *deleted;
+   size_t count;
+   size_t capacity;
 };
 
-DA_TYPEDEF(struct tween, tween_array_t)
+/* Where the tween of a handle currently lives */
+struct tween_slot
+{
+   uint32_t index;
+   uint16_t generation;
+   uint8_t group;
+   bool used;
+};
 
 struct menu_animation
 {
-   tween_array_t list;
-   tween_array_t pending;
-   bool initialized;
+   struct tween_group groups[EASING_LAST];
+   struct tween_slot *slots;
+   uint16_t *free_slots;
+   size_t slots_count;
+   size_t slots_capacity;
+   size_t free_count;
+   size_t count;           /* tweens in all groups */
    bool pending_deletes;
    bool in_update;
 };
@@ -73,7 +90,7 @@ static const float ticker_pixel_period = (1.0f / 60.0f) * 1000.0f;
 
 static const char ticker_spacer_default[] = TICKER_SPACER_DEFAULT;
 
-static menu_animation_t anim     = {{0}};
+static menu_animation_t anim;
 static retro_time_t cur_time     = 0;
 static retro_time_t old_time     = 0;
 static uint64_t ticker_idx       = 0; /* updated every TICKER_SPEED us */
@@ -311,6 +328,126 @@ static float easing_out_in_bounce(float t, float b, float c, float d)
    return easing_in_bounce((t * 2) - d, b + c / 2, c / 2, d);
 }
 
+#define EASING_BATCH(easing) \
+   for (i = 0; i < n; i++) \
+      out[i] = easing(t[i], b[i], c[i], d[i])
+
+/* Eases @n tweens at once. Each loop calls one easing function
+ * directly, which the compiler can inline and vectorize. */
+static void menu_animation_ease(enum menu_animation_easing_type type,
+      const float *t, const float *b, const float *c, const float *d,
+      float *out, size_t n)
+{
+   size_t i;
+
+   switch (type)
+   {
+      case EASING_LINEAR:
+         EASING_BATCH(easing_linear);
+         break;
+      case EASING_IN_QUAD:
+         EASING_BATCH(easing_in_quad);
+         break;
+      case EASING_OUT_QUAD:
+         EASING_BATCH(easing_out_quad);
+         break;
+      case EASING_IN_OUT_QUAD:
+         EASING_BATCH(easing_in_out_quad);
+         break;
+      case EASING_OUT_IN_QUAD:
+         EASING_BATCH(easing_out_in_quad);
+         break;
+      case EASING_IN_CUBIC:
+         EASING_BATCH(easing_in_cubic);
+         break;
+      case EASING_OUT_CUBIC:
+         EASING_BATCH(easing_out_cubic);
+         break;
+      case EASING_IN_OUT_CUBIC:
+         EASING_BATCH(easing_in_out_cubic);
+         break;
+      case EASING_OUT_IN_CUBIC:
+         EASING_BATCH(easing_out_in_cubic);
+         break;
+      case EASING_IN_QUART:
+         EASING_BATCH(easing_in_quart);
+         break;
+      case EASING_OUT_QUART:
+         EASING_BATCH(easing_out_quart);
+         break;
+      case EASING_IN_OUT_QUART:
+         EASING_BATCH(easing_in_out_quart);
+         break;
+      case EASING_OUT_IN_QUART:
+         EASING_BATCH(easing_out_in_quart);
+         break;
+      case EASING_IN_QUINT:
+         EASING_BATCH(easing_in_quint);
+         break;
+      case EASING_OUT_QUINT:
+         EASING_BATCH(easing_out_quint);
+         break;
+      case EASING_IN_OUT_QUINT:
+         EASING_BATCH(easing_in_out_quint);
+         break;
+      case EASING_OUT_IN_QUINT:
+         EASING_BATCH(easing_out_in_quint);
+         break;
+      case EASING_IN_SINE:
+         EASING_BATCH(easing_in_sine);
+         break;
+      case EASING_OUT_SINE:
+         EASING_BATCH(easing_out_sine);
+         break;
+      case EASING_IN_OUT_SINE:
+         EASING_BATCH(easing_in_out_sine);
+         break;
+      case EASING_OUT_IN_SINE:
+         EASING_BATCH(easing_out_in_sine);
+         break;
+      case EASING_IN_EXPO:
+         EASING_BATCH(easing_in_expo);
+         break;
+      case EASING_OUT_EXPO:
+         EASING_BATCH(easing_out_expo);
+         break;
+      case EASING_IN_OUT_EXPO:
+         EASING_BATCH(easing_in_out_expo);
+         break;
+      case EASING_OUT_IN_EXPO:
+         EASING_BATCH(easing_out_in_expo);
+         break;
+      case EASING_IN_CIRC:
+         EASING_BATCH(easing_in_circ);
+         break;
+      case EASING_OUT_CIRC:
+         EASING_BATCH(easing_out_circ);
+         break;
+      case EASING_IN_OUT_CIRC:
+         EASING_BATCH(easing_in_out_circ);
+         break;
+      case EASING_OUT_IN_CIRC:
+         EASING_BATCH(easing_out_in_circ);
+         break;
+      case EASING_IN_BOUNCE:
+         EASING_BATCH(easing_in_bounce);
+         break;
+      case EASING_OUT_BOUNCE:
+         EASING_BATCH(easing_out_bounce);
+         break;
+      case EASING_IN_OUT_BOUNCE:
+         EASING_BATCH(easing_in_out_bounce);
+         break;
+      case EASING_OUT_IN_BOUNCE:
+         EASING_BATCH(easing_out_in_bounce);
+         break;
+      default:
+         break;
+   }
+}
+
+#undef EASING_BATCH
+
 static void menu_animation_ticker_generic(uint64_t idx,
       size_t max_width, size_t *offset, size_t *width)
 {
@@ -1038,153 +1175,203 @@ void menu_animation_push_delayed(unsigned delay, menu_animation_ctx_entry_t *ent
    menu_timer_start(&delayed_animation->timer, &timer_entry);
 }
 
-bool menu_animation_push(menu_animation_ctx_entry_t *entry)
+#define TWEEN_GROUP_REALLOC(field, type) \
+   if (!(p = realloc(group->field, capacity * sizeof(type)))) \
+      return false; \
+   group->field = (type*)p
+
+static bool menu_animation_group_grow(struct tween_group *group)
 {
-   struct tween t;
+   void *p;
+   size_t capacity = group->capacity ? group->capacity * 2 : 32;
 
-   t.duration           = entry->duration;
-   t.running_since      = 0;
-   t.initial_value      = *entry->subject;
-   t.target_value       = entry->target_value;
-   t.subject            = entry->subject;
-   t.tag                = entry->tag;
-   t.cb                 = entry->cb;
-   t.userdata           = entry->userdata;
-   t.easing             = NULL;
-   t.deleted            = false;
+   TWEEN_GROUP_REALLOC(duration,      float);
+   TWEEN_GROUP_REALLOC(running_since, float);
+   TWEEN_GROUP_REALLOC(initial_value, float);
+   TWEEN_GROUP_REALLOC(delta_value,   float);
+   TWEEN_GROUP_REALLOC(target_value,  float);
+   TWEEN_GROUP_REALLOC(value,         float);
+   TWEEN_GROUP_REALLOC(subject,       float*);
+   TWEEN_GROUP_REALLOC(tag,           uintptr_t);
+   TWEEN_GROUP_REALLOC(cb,            tween_cb);
+   TWEEN_GROUP_REALLOC(userdata,      void*);
+   TWEEN_GROUP_REALLOC(handle,        menu_animation_handle_t);
+   TWEEN_GROUP_REALLOC(deleted,       bool);
+
+   group->capacity = capacity;
+
+   return true;
+}
 
-   switch (entry->easing_enum)
+#undef TWEEN_GROUP_REALLOC
+
+static void menu_animation_group_free(struct tween_group *group)
+{
+   free(group->duration);
+   free(group->running_since);
+   free(group->initial_value);
+   free(group->delta_value);
+   free(group->target_value);
+   free(group->value);
+   free(group->subject);
+   free(group->tag);
+   free(group->cb);
+   free(group->userdata);
+   free(group->handle);
+   free(group->deleted);
+}
+
+static bool menu_animation_alloc_slot(size_t *slot_id)
+{
+   if (anim.free_count > 0)
    {
-      case EASING_LINEAR:
-         t.easing       = &easing_linear;
-         break;
-         /* Quad */
-      case EASING_IN_QUAD:
-         t.easing       = &easing_in_quad;
-         break;
-      case EASING_OUT_QUAD:
-         t.easing       = &easing_out_quad;
-         break;
-      case EASING_IN_OUT_QUAD:
-         t.easing       = &easing_in_out_quad;
-         break;
-      case EASING_OUT_IN_QUAD:
-         t.easing       = &easing_out_in_quad;
-         break;
-         /* Cubic */
-      case EASING_IN_CUBIC:
-         t.easing       = &easing_in_cubic;
-         break;
-      case EASING_OUT_CUBIC:
-         t.easing       = &easing_out_cubic;
-         break;
-      case EASING_IN_OUT_CUBIC:
-         t.easing       = &easing_in_out_cubic;
-         break;
-      case EASING_OUT_IN_CUBIC:
-         t.easing       = &easing_out_in_cubic;
-         break;
-         /* Quart */
-      case EASING_IN_QUART:
-         t.easing       = &easing_in_quart;
-         break;
-      case EASING_OUT_QUART:
-         t.easing       = &easing_out_quart;
-         break;
-      case EASING_IN_OUT_QUART:
-         t.easing       = &easing_in_out_quart;
-         break;
-      case EASING_OUT_IN_QUART:
-         t.easing       = &easing_out_in_quart;
-         break;
-         /* Quint */
-      case EASING_IN_QUINT:
-         t.easing       = &easing_in_quint;
-         break;
-      case EASING_OUT_QUINT:
-         t.easing       = &easing_out_quint;
-         break;
-      case EASING_IN_OUT_QUINT:
-         t.easing       = &easing_in_out_quint;
-         break;
-      case EASING_OUT_IN_QUINT:
-         t.easing       = &easing_out_in_quint;
-         break;
-         /* Sine */
-      case EASING_IN_SINE:
-         t.easing       = &easing_in_sine;
-         break;
-      case EASING_OUT_SINE:
-         t.easing       = &easing_out_sine;
-         break;
-      case EASING_IN_OUT_SINE:
-         t.easing       = &easing_in_out_sine;
-         break;
-      case EASING_OUT_IN_SINE:
-         t.easing       = &easing_out_in_sine;
-         break;
-         /* Expo */
-      case EASING_IN_EXPO:
-         t.easing       = &easing_in_expo;
-         break;
-      case EASING_OUT_EXPO:
-         t.easing       = &easing_out_expo;
-         break;
-      case EASING_IN_OUT_EXPO:
-         t.easing       = &easing_in_out_expo;
-         break;
-      case EASING_OUT_IN_EXPO:
-         t.easing       = &easing_out_in_expo;
-         break;
-         /* Circ */
-      case EASING_IN_CIRC:
-         t.easing       = &easing_in_circ;
-         break;
-      case EASING_OUT_CIRC:
-         t.easing       = &easing_out_circ;
-         break;
-      case EASING_IN_OUT_CIRC:
-         t.easing       = &easing_in_out_circ;
-         break;
-      case EASING_OUT_IN_CIRC:
-         t.easing       = &easing_out_in_circ;
-         break;
-         /* Bounce */
-      case EASING_IN_BOUNCE:
-         t.easing       = &easing_in_bounce;
-         break;
-      case EASING_OUT_BOUNCE:
-         t.easing       = &easing_out_bounce;
-         break;
-      case EASING_IN_OUT_BOUNCE:
-         t.easing       = &easing_in_out_bounce;
-         break;
-      case EASING_OUT_IN_BOUNCE:
-         t.easing       = &easing_out_in_bounce;
-         break;
-      default:
-         break;
+      *slot_id = anim.free_slots[--anim.free_count];
+      return true;
    }
 
-   /* ignore born dead tweens */
-   if (!t.easing || t.duration == 0 || t.initial_value == t.target_value)
-      return false;
-
-   if (!anim.initialized)
+   if (anim.slots_count == anim.slots_capacity)
    {
-      da_init(anim.list);
-      da_init(anim.pending);
-      anim.initialized = true;
+      struct tween_slot *slots = NULL;
+      uint16_t *free_slots     = NULL;
+      size_t capacity          = anim.slots_capacity
+         ? anim.slots_capacity * 2 : 128;
+
+      if (capacity > TWEEN_MAX)
+         capacity = TWEEN_MAX;
+      if (capacity == anim.slots_capacity)
+         return false;
+
+      if (!(slots = (struct tween_slot*)
+               realloc(anim.slots, capacity * sizeof(*slots))))
+         return false;
+      anim.slots = slots;
+
+      if (!(free_slots = (uint16_t*)
+               realloc(anim.free_slots, capacity * sizeof(*free_slots))))
+         return false;
+      anim.free_slots     = free_slots;
+      anim.slots_capacity = capacity;
    }
 
-   if (anim.in_update)
-      da_push(anim.pending, t);
-   else
-      da_push(anim.list, t);
+   *slot_id                         = anim.slots_count++;
+   anim.slots[*slot_id].generation  = 0;
 
    return true;
 }
 
+static void menu_animation_free_slot(menu_animation_handle_t handle)
+{
+   size_t slot_id = (handle & TWEEN_MAX) - 1;
+
+   anim.slots[slot_id].used = false;
+   anim.slots[slot_id].generation++;
+   anim.free_slots[anim.free_count++] = (uint16_t)slot_id;
+}
+
+/* Drops the deleted tweens of a group, keeping the others in order */
+static void menu_animation_group_compact(struct tween_group *group)
+{
+   size_t i, j = 0;
+
+   for (i = 0; i < group->count; i++)
+   {
+      if (group->deleted[i])
+      {
+         menu_animation_free_slot(group->handle[i]);
+         anim.count--;
+         continue;
+      }
+
+      if (i != j)
+      {
+         group->duration[j]      = group->duration[i];
+         group->running_since[j] = group->running_since[i];
+         group->initial_value[j] = group->initial_value[i];
+         group->delta_value[j]   = group->delta_value[i];
+         group->target_value[j]  = group->target_value[i];
+         group->subject[j]       = group->subject[i];
+         group->tag[j]           = group->tag[i];
+         group->cb[j]            = group->cb[i];
+         group->userdata[j]      = group->userdata[i];
+         group->handle[j]        = group->handle[i];
+         group->deleted[j]       = false;
+
+         anim.slots[(group->handle[j] & TWEEN_MAX) - 1].index = (uint32_t)j;
+      }
+
+      j++;
+   }
+
+   group->count = j;
+}
+
+static void menu_animation_delete(struct tween_group *group, size_t idx)
+{
+   group->deleted[idx]  = true;
+   anim.pending_deletes = true;
+}
+
+/**
+ * menu_animation_push_handle:
+ * @entry              : tween to start.
+ *
+ * Starts a tween like menu_animation_push.
+ *
+ * Returns: handle that menu_animation_kill_by_handle takes to stop
+ * the tween, 0 if no tween was started.
+ **/
+menu_animation_handle_t menu_animation_push_handle(
+      menu_animation_ctx_entry_t *entry)
+{
+   size_t idx, slot_id;
+   struct tween_group *group    = NULL;
+   struct tween_slot *slot      = NULL;
+   float initial_value          = *entry->subject;
+
+   /* ignore born dead tweens */
+   if (     (unsigned)entry->easing_enum >= EASING_LAST
+         || entry->duration == 0
+         || initial_value == entry->target_value)
+      return 0;
+
+   group = &anim.groups[entry->easing_enum];
+
+   if (group->count == group->capacity
+         && !menu_animation_group_grow(group))
+      return 0;
+
+   if (!menu_animation_alloc_slot(&slot_id))
+      return 0;
+
+   idx                         = group->count++;
+   slot                        = &anim.slots[slot_id];
+   slot->index                 = (uint32_t)idx;
+   slot->group                 = (uint8_t)entry->easing_enum;
+   slot->used                  = true;
+
+   group->duration[idx]        = entry->duration;
+   group->running_since[idx]   = 0;
+   group->initial_value[idx]   = initial_value;
+   group->delta_value[idx]     = entry->target_value - initial_value;
+   group->target_value[idx]    = entry->target_value;
+   group->subject[idx]         = entry->subject;
+   group->tag[idx]             = entry->tag;
+   group->cb[idx]              = entry->cb;
+   group->userdata[idx]        = entry->userdata;
+   group->handle[idx]          = ((menu_animation_handle_t)slot->generation
+         << TWEEN_SLOT_BITS) | (menu_animation_handle_t)(slot_id + 1);
+   group->deleted[idx]         = false;
+
+   anim.count++;
+
+   return group->handle[idx];
+}
+
+bool menu_animation_push(menu_animation_ctx_entry_t *entry)
+{
+   return menu_animation_push_handle(entry) != 0;
+}
+
 static void menu_animation_update_time(bool timedate_enable, unsigned video_width, unsigned video_height)
 {
    static retro_time_t
@@ -1281,64 +1468,67 @@ static void menu_animation_update_time(bool timedate_enable, unsigned video_widt
 bool menu_animation_update(unsigned video_width, unsigned video_height)
 {
    unsigned i;
+   size_t counts[EASING_LAST];
    settings_t *settings = config_get_ptr();
 
    menu_animation_update_time(settings->bools.menu_timedate_enable, video_width, video_height);
 
    anim.in_update       = true;
-   anim.pending_deletes = false;
 
-   for (i = 0; i < da_count(anim.list); i++)
+   /* Tweens pushed by callbacks start on the next frame,
+    * including those pushed into groups not stepped yet */
+   for (i = 0; i < EASING_LAST; i++)
+      counts[i] = anim.groups[i].count;
+
+   for (i = 0; i < EASING_LAST; i++)
    {
-      struct tween *tween   = da_getptr(anim.list, i);
+      size_t j;
+      struct tween_group *group = &anim.groups[i];
+      /* A callback may also have deinit the animations */
+      size_t count              = MIN(counts[i], group->count);
 
-      if (!tween || tween->deleted)
+      if (count == 0)
          continue;
 
-      tween->running_since += delta_time;
+      for (j = 0; j < count; j++)
+         group->running_since[j] += delta_time;
 
-      *tween->subject = tween->easing(
-            tween->running_since,
-            tween->initial_value,
-            tween->target_value - tween->initial_value,
-            tween->duration);
+      menu_animation_ease((enum menu_animation_easing_type)i,
+            group->running_since, group->initial_value,
+            group->delta_value, group->duration,
+            group->value, count);
 
-      if (tween->running_since >= tween->duration)
+      /* Callbacks may push tweens, which can move the arrays,
+       * or even deinit the animations */
+      for (j = 0; j < count && j < group->count; j++)
       {
-         *tween->subject = tween->target_value;
+         if (group->deleted[j])
+            continue;
+
+         if (group->running_since[j] < group->duration[j])
+         {
+            *group->subject[j] = group->value[j];
+            continue;
+         }
 
-         if (tween->cb)
-            tween->cb(tween->userdata);
+         *group->subject[j] = group->target_value[j];
+         menu_animation_delete(group, j);
 
-         da_delete(anim.list, i);
-         i--;
+         if (group->cb[j])
+            group->cb[j](group->userdata[j]);
       }
    }
 
    if (anim.pending_deletes)
    {
-      for (i = 0; i < da_count(anim.list); i++)
-      {
-         struct tween *tween = da_getptr(anim.list, i);
-         if (!tween)
-            continue;
-         if (tween->deleted)
-         {
-            da_delete(anim.list, i);
-            i--;
-         }
-      }
+      for (i = 0; i < EASING_LAST; i++)
+         if (anim.groups[i].count > 0)
+            menu_animation_group_compact(&anim.groups[i]);
       anim.pending_deletes = false;
    }
 
-   if (da_count(anim.pending) > 0)
-   {
-      da_addn(anim.list, anim.pending.p, da_count(anim.pending));
-      da_clear(anim.pending);
-   }
-
    anim.in_update      = false;
-   animation_is_active = da_count(anim.list) > 0;
+   animation_is_active = anim.count > 0;
 
    return animation_is_active;
 }
@@ -2172,6 +2362,17 @@ bool menu_animation_is_active(void)
    return animation_is_active || ticker_is_active;
 }
 
+/**
+ * menu_animation_kill_by_tag:
+ * @tag                : tag the tweens were pushed with.
+ *
+ * Stops every tween pushed with @tag, in one pass over all tweens.
+ * Callers kill a whole group of tweens at once with a shared tag (XMB
+ * uses the list, the widgets the widget), not one tag per entry, so
+ * this stays linear. Tweens stopped one at a time should use handles.
+ *
+ * Returns: false if @tag is invalid.
+ **/
 bool menu_animation_kill_by_tag(menu_animation_ctx_tag *tag)
 {
    unsigned i;
@@ -2179,60 +2380,84 @@ bool menu_animation_kill_by_tag(menu_animation_ctx_tag *tag)
    if (!tag || *tag == (uintptr_t)-1)
       return false;
 
-   for (i = 0; i < da_count(anim.list); ++i)
+   /* Tweens are only flagged here and dropped by the next update */
+   for (i = 0; i < EASING_LAST; i++)
    {
-      struct tween *t = da_getptr(anim.list, i);
-      if (!t || t->tag != *tag)
-         continue;
+      size_t j;
+      struct tween_group *group = &anim.groups[i];
 
-      if (anim.in_update)
-      {
-         t->deleted = true;
-         anim.pending_deletes = true;
-      }
-      else
-      {
-         da_delete(anim.list, i);
-         --i;
-      }
+      for (j = 0; j < group->count; j++)
+         if (group->tag[j] == *tag && !group->deleted[j])
+            menu_animation_delete(group, j);
    }
 
    return true;
 }
 
+/**
+ * menu_animation_kill_by_subject:
+ * @subject            : subjects whose tweens to stop.
+ *
+ * Scans the tweens once per subject, which adds up when called for
+ * every entry of a list; prefer handles, see
+ * menu_animation_kill_by_handle.
+ **/
 void menu_animation_kill_by_subject(menu_animation_ctx_subject_t *subject)
 {
-   unsigned i, j,  killed = 0;
-   float            **sub = (float**)subject->data;
+   unsigned i;
+   size_t killed = 0;
+   float  **sub  = (float**)subject->data;
 
-   for (i = 0; i < da_count(anim.list) && killed < subject->count; ++i)
+   for (i = 0; i < EASING_LAST && killed < subject->count; i++)
    {
-      struct tween *t = da_getptr(anim.list, i);
-      if (!t)
-         continue;
+      size_t j;
+      struct tween_group *group = &anim.groups[i];
 
-      for (j = 0; j < subject->count; ++j)
+      for (j = 0; j < group->count && killed < subject->count; j++)
       {
-         if (t->subject != sub[j])
+         size_t k;
+
+         if (group->deleted[j])
             continue;
 
-         if (anim.in_update)
-         {
-            t->deleted = true;
-            anim.pending_deletes = true;
-         }
-         else
+         for (k = 0; k < subject->count; k++)
          {
-            da_delete(anim.list, i);
-            --i;
-         }
+            if (group->subject[j] != sub[k])
+               continue;
 
-         killed++;
-         break;
+            menu_animation_delete(group, j);
+            killed++;
+            break;
+         }
       }
    }
 }
 
+/**
+ * menu_animation_kill_by_handle:
+ * @handle             : handle from menu_animation_push_handle, reset
+ *                       to 0.
+ *
+ * Stops the tween of @handle, if it is still running.
+ **/
+void menu_animation_kill_by_handle(menu_animation_handle_t *handle)
+{
+   size_t slot_id;
+
+   if (!handle || !*handle)
+      return;
+
+   slot_id = (*handle & TWEEN_MAX) - 1;
+
+   if (     slot_id < anim.slots_count
+         && anim.slots[slot_id].used
+         && anim.slots[slot_id].generation == (*handle >> TWEEN_SLOT_BITS))
+      menu_animation_delete(&anim.groups[anim.slots[slot_id].group],
+            anim.slots[slot_id].index);
+
+   *handle = 0;
+}
+
 float menu_animation_get_delta_time(void)
 {
    return delta_time;
@@ -2244,20 +2469,13 @@ bool menu_animation_ctl(enum menu_animation_ctl_state state, void *data)
    {
       case MENU_ANIMATION_CTL_DEINIT:
          {
-            size_t i;
-
-            for (i = 0; i < da_count(anim.list); i++)
-            {
-               struct tween *t = da_getptr(anim.list, i);
-               if (!t)
-                  continue;
+            unsigned i;
 
-               if (t->subject)
-                  t->subject = NULL;
-            }
+            for (i = 0; i < EASING_LAST; i++)
+               menu_animation_group_free(&anim.groups[i]);
 
-            da_free(anim.list);
-            da_free(anim.pending);
+            free(anim.slots);
+            free(anim.free_slots);
 
             memset(&anim, 0, sizeof(menu_animation_t));
          }
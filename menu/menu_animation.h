@@ -100,6 +100,9 @@ enum menu_animation_ticker_type
 
 typedef uintptr_t menu_animation_ctx_tag;
 
+/* Identifies a pushed tween until it ends or is killed, 0 for none */
+typedef uint32_t menu_animation_handle_t;
+
 typedef struct menu_animation_ctx_subject
 {
    size_t count;
@@ -218,6 +221,11 @@ void menu_animation_kill_by_subject(menu_animation_ctx_subject_t *subject);
 
 bool menu_animation_push(menu_animation_ctx_entry_t *entry);
 
+menu_animation_handle_t menu_animation_push_handle(
+      menu_animation_ctx_entry_t *entry);
+
+void menu_animation_kill_by_handle(menu_animation_handle_t *handle);
+
 void menu_animation_push_delayed(unsigned delay, menu_animation_ctx_entry_t *entry);
 
 bool menu_animation_ctl(enum menu_animation_ctl_state state, void *data);
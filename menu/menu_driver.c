@@ -48,6 +48,7 @@
 #include "menu_input.h"
 #include "menu_entries.h"
 #include "widgets/menu_dialog.h"
+#include "widgets/menu_filebrowser.h"
 #if defined(HAVE_CG) || defined(HAVE_GLSL) || defined(HAVE_SLANG) || defined(HAVE_HLSL)
 #include "menu_shader.h"
 #endif
@@ -235,6 +236,50 @@ struct menu_list
    file_list_t **selection_buf;
 };
 
+/* Menu the callbacks of a list's entries were bound for. Besides the
+ * entry itself, menu_cbs_init only looks at the top of the menu stack
+ * and at the menu driver. */
+typedef struct menu_entries_bind_ident
+{
+   const menu_ctx_driver_t *driver;
+   enum msg_hash_enums enum_idx;
+   char label[256];
+} menu_entries_bind_ident_t;
+
+/* Entry of a cleared list whose callbacks can be reused */
+typedef struct menu_entries_stash_entry
+{
+   menu_file_list_cbs_t *cbs;
+   /* Offsets into the stash strings, (size_t)-1 for NULL */
+   size_t path;
+   size_t label;
+   unsigned type;
+   enum msg_hash_enums enum_idx;
+} menu_entries_stash_entry_t;
+
+/* Callbacks of the entries of the last list cleared with
+ * MENU_ENTRIES_CTL_CLEAR. A rebuild of the same menu, e.g. after
+ * a setting was toggled, takes them back for the entries it appends
+ * unchanged at the same position instead of looking up the setting
+ * and binding every callback again. */
+typedef struct menu_entries_stash
+{
+   menu_entries_stash_entry_t *entries;
+   char *strings;
+   size_t size;
+   size_t capacity;
+   size_t strings_size;
+   size_t strings_capacity;
+   menu_entries_bind_ident_t ident;
+} menu_entries_stash_t;
+
+/* List being filled by menu_entries_append_enum, and whether all of
+ * its entries were bound for the same menu */
+static const file_list_t *menu_entries_build_list  = NULL;
+static bool menu_entries_build_valid               = false;
+static menu_entries_bind_ident_t menu_entries_build_ident;
+static menu_entries_stash_t menu_entries_stash;
+
 #define menu_entries_need_refresh() ((!menu_entries_nonblocking_refresh) && menu_entries_need_refresh)
 
 menu_handle_t *menu_driver_get_ptr(void)
@@ -901,9 +946,16 @@ static menu_list_t *menu_list_new(void)
       list->menu_stack[i]      = (file_list_t*)
          calloc(1, sizeof(*list->menu_stack[i]));
 
+   /* Selection lists are rebuilt on every refresh, keep their
+    * strings in an arena. Menu drivers rewrite the labels of the
+    * stack lists themselves, those keep separate allocations. */
    for (i = 0; i < list->selection_buf_size; i++)
+   {
       list->selection_buf[i]   = (file_list_t*)
          calloc(1, sizeof(*list->selection_buf[i]));
+      if (list->selection_buf[i])
+         file_list_use_arena(list->selection_buf[i]);
+   }
 
    return list;
 
@@ -1205,8 +1257,224 @@ file_list_t *menu_entries_get_selection_buf_ptr(size_t idx)
    return menu_list_get_selection(menu_list, (unsigned)idx);
 }
 
+static bool menu_entries_get_bind_ident(menu_entries_bind_ident_t *ident)
+{
+   const char *label            = NULL;
+   enum msg_hash_enums enum_idx = MSG_UNKNOWN;
+
+   menu_entries_get_last_stack(NULL, &label, NULL, &enum_idx, NULL);
+
+   if (!label || strlcpy(ident->label, label,
+            sizeof(ident->label)) >= sizeof(ident->label))
+      return false;
+
+   ident->driver   = menu_driver_ctx;
+   ident->enum_idx = enum_idx;
+
+   return true;
+}
+
+static bool menu_entries_bind_ident_equal(
+      const menu_entries_bind_ident_t *a,
+      const menu_entries_bind_ident_t *b)
+{
+   return a->driver   == b->driver
+      &&  a->enum_idx == b->enum_idx
+      &&  string_is_equal(a->label, b->label);
+}
+
+static void menu_entries_stash_flush(void)
+{
+   size_t i;
+
+   for (i = 0; i < menu_entries_stash.size; i++)
+      if (menu_entries_stash.entries[i].cbs)
+         free(menu_entries_stash.entries[i].cbs);
+
+   menu_entries_stash.size         = 0;
+   menu_entries_stash.strings_size = 0;
+}
+
+static void menu_entries_stash_deinit(void)
+{
+   menu_entries_stash_flush();
+
+   free(menu_entries_stash.entries);
+   free(menu_entries_stash.strings);
+   memset(&menu_entries_stash, 0, sizeof(menu_entries_stash));
+
+   menu_entries_build_list  = NULL;
+   menu_entries_build_valid = false;
+}
+
+static bool menu_entries_stash_string(const char *s, size_t *offset)
+{
+   size_t len;
+
+   if (!s)
+   {
+      *offset = (size_t)-1;
+      return true;
+   }
+
+   len = strlen(s) + 1;
+
+   if (menu_entries_stash.strings_capacity
+         - menu_entries_stash.strings_size < len)
+   {
+      size_t capacity = menu_entries_stash.strings_capacity * 2 + len + 4096;
+      char *strings   = (char*)realloc(menu_entries_stash.strings, capacity);
+
+      if (!strings)
+         return false;
+
+      menu_entries_stash.strings          = strings;
+      menu_entries_stash.strings_capacity = capacity;
+   }
+
+   *offset = menu_entries_stash.strings_size;
+   memcpy(menu_entries_stash.strings + *offset, s, len);
+   menu_entries_stash.strings_size += len;
+
+   return true;
+}
+
+static bool menu_entries_stash_string_equal(size_t offset, const char *s)
+{
+   if (offset == (size_t)-1)
+      return !s;
+   return s && string_is_equal(menu_entries_stash.strings + offset, s);
+}
+
+/**
+ * menu_entries_stash_list:
+ * @list               : list about to be cleared.
+ *
+ * Takes the callbacks of the entries of @list, if they were all bound
+ * by menu_entries_append_enum for the same menu, so that rebuilding
+ * that menu can reuse them. Drops the callbacks stashed before.
+ **/
+static void menu_entries_stash_list(file_list_t *list)
+{
+   size_t i;
+
+   /* Clearing an empty list again keeps what was stashed */
+   if (list->size == 0)
+      return;
+
+   menu_entries_stash_flush();
+
+   if (list != menu_entries_build_list || !menu_entries_build_valid)
+      return;
+
+   menu_entries_build_list = NULL;
+
+   if (list->size > menu_entries_stash.capacity)
+   {
+      menu_entries_stash_entry_t *entries = (menu_entries_stash_entry_t*)
+         realloc(menu_entries_stash.entries, list->size * sizeof(*entries));
+
+      if (!entries)
+         return;
+
+      menu_entries_stash.entries  = entries;
+      menu_entries_stash.capacity = list->size;
+   }
+
+   for (i = 0; i < list->size; i++)
+   {
+      menu_entries_stash_entry_t *entry = &menu_entries_stash.entries[i];
+      menu_file_list_cbs_t *cbs         = (menu_file_list_cbs_t*)
+         list->list[i].actiondata;
+
+      if (     cbs
+            && menu_entries_stash_string(list->list[i].path, &entry->path)
+            && menu_entries_stash_string(list->list[i].label, &entry->label))
+      {
+         entry->cbs                = cbs;
+         entry->type               = list->list[i].type;
+         entry->enum_idx           = cbs->enum_idx;
+         list->list[i].actiondata  = NULL;
+      }
+      else
+         entry->cbs                = NULL;
+   }
+
+   menu_entries_stash.size  = list->size;
+   menu_entries_stash.ident = menu_entries_build_ident;
+}
+
+/**
+ * menu_entries_stash_take:
+ * @list               : list the entry is appended to.
+ * @idx                : position of the entry in @list.
+ *
+ * Tracks which menu the entries of @list are bound for, and returns
+ * the stashed callbacks of an identical entry at the same position of
+ * the same menu, refreshed as a new binding would be.
+ *
+ * Returns: callbacks now owned by the caller, NULL if none match.
+ **/
+static menu_file_list_cbs_t *menu_entries_stash_take(const file_list_t *list,
+      size_t idx, const char *path, const char *label,
+      unsigned type, enum msg_hash_enums enum_idx)
+{
+   menu_entries_bind_ident_t ident;
+   menu_entries_stash_entry_t *entry = NULL;
+   menu_file_list_cbs_t *cbs         = NULL;
+   bool has_ident                    = menu_entries_get_bind_ident(&ident);
+
+   if (idx == 0 || list != menu_entries_build_list)
+   {
+      menu_entries_build_list  = list;
+      menu_entries_build_valid = has_ident && idx == 0;
+
+      if (menu_entries_build_valid)
+         menu_entries_build_ident = ident;
+
+      /* Another menu is being built, nothing stashed can match */
+      if (menu_entries_stash.size && !(has_ident
+               && menu_entries_bind_ident_equal(
+                  &menu_entries_stash.ident, &ident)))
+         menu_entries_stash_flush();
+   }
+   else if (menu_entries_build_valid && !(has_ident
+            && menu_entries_bind_ident_equal(
+               &menu_entries_build_ident, &ident)))
+      menu_entries_build_valid = false;
+
+   if (     !menu_entries_build_valid
+         || idx >= menu_entries_stash.size
+         || !menu_entries_bind_ident_equal(
+            &menu_entries_stash.ident, &menu_entries_build_ident))
+      return NULL;
+
+   entry = &menu_entries_stash.entries[idx];
+
+   if (     !entry->cbs
+         ||  entry->type     != type
+         ||  entry->enum_idx != enum_idx
+         || !menu_entries_stash_string_equal(entry->label, label)
+         || !menu_entries_stash_string_equal(entry->path, path))
+      return NULL;
+
+   cbs                            = entry->cbs;
+   entry->cbs                     = NULL;
+
+   cbs->checked                   = false;
+   cbs->action_sublabel_cache[0]  = '\0';
+   cbs->action_title_cache[0]     = '\0';
+
+   /* As menu_setting_find_enum does on a new binding */
+   if (cbs->setting && cbs->setting->read_handler)
+      cbs->setting->read_handler(cbs->setting);
+
+   return cbs;
+}
+
 static void menu_entries_list_deinit(void)
 {
+   menu_entries_stash_deinit();
    if (menu_entries_list)
       menu_list_free(menu_entries_list);
    menu_entries_list     = NULL;
@@ -1214,6 +1482,8 @@ static void menu_entries_list_deinit(void)
 
 static void menu_entries_settings_deinit(void)
 {
+   /* Stashed callbacks point to the settings */
+   menu_entries_stash_deinit();
    menu_setting_free(menu_entries_list_settings);
    if (menu_entries_list_settings)
       free(menu_entries_list_settings);
@@ -1261,6 +1531,10 @@ void menu_entries_append(file_list_t *list, const char *path, const char *label,
 
    file_list_append(list, path, label, type, directory_ptr, entry_idx);
 
+   /* The setting is looked up by label, not by enum */
+   if (list == menu_entries_build_list)
+      menu_entries_build_valid = false;
+
    menu_entries_get_last_stack(&menu_path, NULL, NULL, NULL, NULL);
 
    idx                = list->size - 1;
@@ -1270,7 +1544,7 @@ void menu_entries_append(file_list_t *list, const char *path, const char *label,
    list_info.fullpath = NULL;
 
    if (!string_is_empty(menu_path))
-      list_info.fullpath = strdup(menu_path);
+      list_info.fullpath = menu_path;
 
    list_info.label       = label;
    list_info.idx         = idx;
@@ -1278,9 +1552,6 @@ void menu_entries_append(file_list_t *list, const char *path, const char *label,
 
    menu_driver_list_insert(&list_info);
 
-   if (list_info.fullpath)
-      free(list_info.fullpath);
-
    file_list_free_actiondata(list, idx);
    cbs = (menu_file_list_cbs_t*)
       calloc(1, sizeof(menu_file_list_cbs_t));
@@ -1317,7 +1588,7 @@ bool menu_entries_append_enum(file_list_t *list, const char *path,
    list_info.fullpath    = NULL;
 
    if (!string_is_empty(menu_path))
-      list_info.fullpath = strdup(menu_path);
+      list_info.fullpath = menu_path;
    list_info.list        = list;
    list_info.path        = path;
    list_info.label       = label;
@@ -1326,10 +1597,15 @@ bool menu_entries_append_enum(file_list_t *list, const char *path,
 
    menu_driver_list_insert(&list_info);
 
-   if (list_info.fullpath)
-      free(list_info.fullpath);
-
    file_list_free_actiondata(list, idx);
+
+   if ((cbs = menu_entries_stash_take(list, idx,
+               path, label, type, enum_idx)))
+   {
+      file_list_set_actiondata(list, idx, cbs);
+      return true;
+   }
+
    cbs = (menu_file_list_cbs_t*)
       calloc(1, sizeof(menu_file_list_cbs_t));
 
@@ -1360,6 +1636,10 @@ void menu_entries_prepend(file_list_t *list, const char *path, const char *label
 
    file_list_prepend(list, path, label, type, directory_ptr, entry_idx);
 
+   /* Moves the entries appended so far */
+   if (list == menu_entries_build_list)
+      menu_entries_build_valid = false;
+
    menu_entries_get_last_stack(&menu_path, NULL, NULL, NULL, NULL);
 
    idx              = 0;
@@ -1367,7 +1647,7 @@ void menu_entries_prepend(file_list_t *list, const char *path, const char *label
    list_info.fullpath    = NULL;
 
    if (!string_is_empty(menu_path))
-      list_info.fullpath = strdup(menu_path);
+      list_info.fullpath = menu_path;
    list_info.list        = list;
    list_info.path        = path;
    list_info.label       = label;
@@ -1376,9 +1656,6 @@ void menu_entries_prepend(file_list_t *list, const char *path, const char *label
 
    menu_driver_list_insert(&list_info);
 
-   if (list_info.fullpath)
-      free(list_info.fullpath);
-
    file_list_free_actiondata(list, idx);
    cbs = (menu_file_list_cbs_t*)
       calloc(1, sizeof(menu_file_list_cbs_t));
@@ -1522,6 +1799,7 @@ bool menu_entries_ctl(enum menu_entries_ctl_state state, void *data)
                return false;
 
             menu_driver_list_clear(list);
+            menu_entries_stash_list(list);
 
             for (i = 0; i < list->size; i++)
                file_list_free_actiondata(list, i);
@@ -3193,6 +3471,8 @@ bool menu_driver_iterate(menu_ctx_iterate_t *iterate)
       return true;
    }
 
+   filebrowser_iterate();
+
    if (
          menu_driver_ctx          &&
          menu_driver_ctx->iterate &&
@@ -3465,6 +3745,8 @@ bool menu_driver_ctl(enum rarch_menu_ctl_state state, void *data)
 
             menu_input_ctl(MENU_INPUT_CTL_DEINIT, NULL);
 
+            filebrowser_deinit();
+
             if (menu_driver_ctx && menu_driver_ctx->free)
                menu_driver_ctx->free(menu_userdata);
 
@@ -63,7 +63,7 @@ typedef struct menu_ctx_list
 {
    enum menu_list_type type;
    const char *path;
-   char       *fullpath;
+   const char *fullpath;
    const char *label;
    unsigned entry_type;
    unsigned action;
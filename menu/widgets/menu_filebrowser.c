@@ -14,11 +14,21 @@
  *  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdint.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
 #include <compat/strl.h>
 #include <lists/string_list.h>
 #include <string/stdstring.h>
 #include <file/file_path.h>
 #include <file/archive_file.h>
+#include <features/features_cpu.h>
+
+#if defined(_WIN32) && !defined(_XBOX) && !defined(LEGACY_WIN32)
+#include <encodings/utf.h>
+#endif
 
 #include <lists/dir_list.h>
 
@@ -41,9 +51,357 @@
 #include "../../content.h"
 #include "../../verbosity.h"
 #include "../../dynamic.h"
+#include "../../tasks/tasks_internal.h"
+
+/* Number of complete listings kept for directories visited before */
+#define FILEBROWSER_CACHE_SIZE        8
+/* Time the menu may block on a listing before the rest of it is read
+ * by a task, and the number of entries read between checks */
+#define FILEBROWSER_SYNC_TIME_US      20000
+#define FILEBROWSER_SYNC_BATCH        32
+/* Minimum time between two refreshes of a listing being read */
+#define FILEBROWSER_REFRESH_TIME_US   100000
+
+/* A directory listing, sorted with directories first */
+typedef struct filebrowser_listing
+{
+   char *path;
+   char *exts;
+   struct string_list *list;
+   uint64_t mtime;
+   unsigned last_used;
+   bool include_hidden;
+   bool has_mtime;
+   bool complete;
+} filebrowser_listing_t;
 
 static enum filebrowser_enums filebrowser_types = FILEBROWSER_NONE;
 
+/* Listing of the directory shown last, and the task still reading it */
+static filebrowser_listing_t filebrowser_current;
+static void *filebrowser_task                    = NULL;
+static unsigned filebrowser_task_id              = 0;
+static bool filebrowser_dirty                    = false;
+static bool filebrowser_refreshing               = false;
+static retro_time_t filebrowser_last_refresh     = 0;
+
+static filebrowser_listing_t filebrowser_cache[FILEBROWSER_CACHE_SIZE];
+static unsigned filebrowser_cache_clock          = 0;
+
+static bool filebrowser_dir_mtime(const char *path, uint64_t *mtime)
+{
+#if defined(_WIN32) && !defined(_XBOX)
+   struct _stat buf;
+#if defined(LEGACY_WIN32)
+   if (_stat(path, &buf) != 0)
+      return false;
+#else
+   int ret;
+   wchar_t *path_wide = utf8_to_utf16_string_alloc(path);
+
+   if (!path_wide)
+      return false;
+   ret = _wstat(path_wide, &buf);
+   free(path_wide);
+   if (ret != 0)
+      return false;
+#endif
+   *mtime = (uint64_t)buf.st_mtime;
+   return true;
+#elif defined(VITA) || defined(PSP) || defined(PS2) || defined(ORBIS) || defined(__CELLOS_LV2__) || defined(_XBOX)
+   /* No modification times, so listings are never reused */
+   return false;
+#else
+   struct stat buf;
+
+   if (stat(path, &buf) != 0)
+      return false;
+   *mtime = (uint64_t)buf.st_mtime;
+   return true;
+#endif
+}
+
+static void filebrowser_listing_free(filebrowser_listing_t *listing)
+{
+   free(listing->path);
+   free(listing->exts);
+   string_list_free(listing->list);
+   memset(listing, 0, sizeof(*listing));
+}
+
+static bool filebrowser_listing_matches(const filebrowser_listing_t *listing,
+      const char *path, const char *exts, bool include_hidden)
+{
+   return listing->path
+      && listing->include_hidden == include_hidden
+      && string_is_equal(listing->path, path)
+      && string_is_equal(listing->exts ? listing->exts : "",
+            exts ? exts : "");
+}
+
+/* Whether a complete listing still reflects the directory */
+static bool filebrowser_listing_is_current(
+      const filebrowser_listing_t *listing)
+{
+   uint64_t mtime = 0;
+
+   return listing->has_mtime
+      && filebrowser_dir_mtime(listing->path, &mtime)
+      && mtime == listing->mtime;
+}
+
+/* Stops reading the current listing. Its task finishes on its own and
+ * the callback ignores it. */
+static void filebrowser_cancel_task(void)
+{
+   if (!filebrowser_task)
+      return;
+
+   task_queue_cancel_task(filebrowser_task);
+   filebrowser_task  = NULL;
+   filebrowser_dirty = false;
+   filebrowser_task_id++;
+}
+
+/* Moves the current listing to the cache if it is complete and can be
+ * validated later, otherwise drops it. */
+static void filebrowser_retire_current(void)
+{
+   unsigned i;
+   filebrowser_listing_t *slot = &filebrowser_cache[0];
+
+   filebrowser_cancel_task();
+
+   if (!filebrowser_current.complete || !filebrowser_current.has_mtime)
+   {
+      filebrowser_listing_free(&filebrowser_current);
+      return;
+   }
+
+   for (i = 0; i < FILEBROWSER_CACHE_SIZE; i++)
+   {
+      if (!filebrowser_cache[i].path)
+      {
+         slot = &filebrowser_cache[i];
+         break;
+      }
+      if (filebrowser_cache[i].last_used < slot->last_used)
+         slot = &filebrowser_cache[i];
+   }
+
+   filebrowser_listing_free(slot);
+   *slot           = filebrowser_current;
+   slot->last_used = ++filebrowser_cache_clock;
+   memset(&filebrowser_current, 0, sizeof(filebrowser_current));
+}
+
+/* Makes a cached listing of @path current if the directory has not
+ * changed since. */
+static bool filebrowser_restore_cached(const char *path, const char *exts,
+      bool include_hidden)
+{
+   unsigned i;
+
+   for (i = 0; i < FILEBROWSER_CACHE_SIZE; i++)
+   {
+      filebrowser_listing_t *listing = &filebrowser_cache[i];
+
+      if (!filebrowser_listing_matches(listing, path, exts, include_hidden))
+         continue;
+
+      if (!filebrowser_listing_is_current(listing))
+      {
+         filebrowser_listing_free(listing);
+         return false;
+      }
+
+      filebrowser_current = *listing;
+      memset(listing, 0, sizeof(*listing));
+      return true;
+   }
+
+   return false;
+}
+
+static void filebrowser_request_refresh(void)
+{
+   bool refresh             = false;
+
+   filebrowser_dirty        = false;
+   filebrowser_refreshing   = true;
+   filebrowser_last_refresh = cpu_features_get_time_usec();
+   menu_entries_ctl(MENU_ENTRIES_CTL_SET_REFRESH, &refresh);
+}
+
+static void filebrowser_take_entries(void *task)
+{
+   struct string_list *batch = task_dir_list_take(task);
+
+   if (!batch)
+      return;
+
+   if (dir_list_merge(filebrowser_current.list, batch, true))
+      filebrowser_dirty = true;
+   string_list_free(batch);
+}
+
+static void filebrowser_dir_list_cb(retro_task_t *task,
+      void *task_data, void *user_data, const char *err)
+{
+   const char *path = NULL;
+
+   /* Cancelled listings are left to the task to free */
+   if (task != filebrowser_task
+         || (uintptr_t)user_data != filebrowser_task_id)
+      return;
+
+   filebrowser_take_entries(task);
+   filebrowser_task             = NULL;
+   filebrowser_current.complete = !err;
+
+   if (err)
+      RARCH_WARN("[Browser]: Listing of \"%s\" stopped: %s.\n",
+            filebrowser_current.path, err);
+
+   menu_entries_get_last_stack(&path, NULL, NULL, NULL, NULL);
+
+   if (string_is_equal(path, filebrowser_current.path))
+      filebrowser_request_refresh();
+}
+
+/* Lists @path into filebrowser_current. The part that can be read in
+ * FILEBROWSER_SYNC_TIME_US is read right away, a task reads the rest.
+ * Returns false if the directory could not be opened. */
+static bool filebrowser_list_dir(const char *path, const char *exts,
+      bool include_hidden)
+{
+   int ret                   = 1;
+   retro_time_t start        = cpu_features_get_time_usec();
+   dir_list_stream_t *stream = NULL;
+   struct string_list *batch = NULL;
+
+   filebrowser_current.path           = strdup(path);
+   filebrowser_current.exts           = exts ? strdup(exts) : NULL;
+   filebrowser_current.include_hidden = include_hidden;
+   /* Taken before reading, so changes during the listing invalidate it */
+   filebrowser_current.has_mtime      = filebrowser_dir_mtime(path,
+         &filebrowser_current.mtime);
+
+   if (!(stream = dir_list_stream_new(path, exts, true, include_hidden,
+               true)))
+      return false;
+
+   if (!(filebrowser_current.list = string_list_new())
+         || !(batch = string_list_new()))
+   {
+      dir_list_stream_free(stream);
+      return false;
+   }
+
+   while (ret == 1
+         && cpu_features_get_time_usec() - start < FILEBROWSER_SYNC_TIME_US)
+      ret = dir_list_stream_read(stream, batch, FILEBROWSER_SYNC_BATCH);
+
+   dir_list_merge(filebrowser_current.list, batch, true);
+   string_list_free(batch);
+
+   if (ret != 1)
+   {
+      dir_list_stream_free(stream);
+      filebrowser_current.complete = (ret == 0);
+      return ret == 0;
+   }
+
+   filebrowser_task = task_push_dir_list(stream, filebrowser_dir_list_cb,
+         (void*)(uintptr_t)++filebrowser_task_id);
+   filebrowser_last_refresh = start;
+
+   RARCH_LOG("[Browser]: Reading the rest of \"%s\" in the background.\n",
+         path);
+   return true;
+}
+
+/* Returns the sorted listing of @path, which may still be growing
+ * (see filebrowser_iterate), or NULL if it could not be read. */
+static struct string_list *filebrowser_get_listing(const char *path,
+      const char *exts, bool include_hidden)
+{
+   bool refreshing        = filebrowser_refreshing;
+
+   filebrowser_refreshing = false;
+
+   if (filebrowser_listing_matches(&filebrowser_current, path, exts,
+            include_hidden))
+   {
+      /* Entering a directory again reads it again if it has changed,
+       * refreshes only show what was read so far */
+      if (     refreshing
+            || filebrowser_task
+            || filebrowser_listing_is_current(&filebrowser_current))
+         return filebrowser_current.list;
+   }
+
+   filebrowser_retire_current();
+
+   if (     !filebrowser_restore_cached(path, exts, include_hidden)
+         && !filebrowser_list_dir(path, exts, include_hidden))
+   {
+      filebrowser_listing_free(&filebrowser_current);
+      return NULL;
+   }
+
+   return filebrowser_current.list;
+}
+
+/**
+ * filebrowser_iterate:
+ *
+ * Brings the entries read in the background into the directory listing
+ * shown, or stops reading them once another menu is shown.
+ **/
+void filebrowser_iterate(void)
+{
+   const char *path = NULL;
+
+   if (!filebrowser_task)
+      return;
+
+   menu_entries_get_last_stack(&path, NULL, NULL, NULL, NULL);
+
+   if (!string_is_equal(path, filebrowser_current.path))
+   {
+      filebrowser_retire_current();
+      return;
+   }
+
+   filebrowser_take_entries(filebrowser_task);
+
+   if (filebrowser_dirty && cpu_features_get_time_usec()
+         - filebrowser_last_refresh >= FILEBROWSER_REFRESH_TIME_US)
+      filebrowser_request_refresh();
+}
+
+/**
+ * filebrowser_deinit:
+ *
+ * Stops reading the directory listing shown, if any, and frees it
+ * along with every cached listing.
+ **/
+void filebrowser_deinit(void)
+{
+   unsigned i;
+
+   filebrowser_cancel_task();
+   filebrowser_listing_free(&filebrowser_current);
+
+   for (i = 0; i < FILEBROWSER_CACHE_SIZE; i++)
+      filebrowser_listing_free(&filebrowser_cache[i]);
+
+   filebrowser_refreshing   = false;
+   filebrowser_last_refresh = 0;
+   filebrowser_cache_clock  = 0;
+}
+
 enum filebrowser_enums filebrowser_get_type(void)
 {
    return filebrowser_types;
@@ -63,6 +421,7 @@ void filebrowser_parse(menu_displaylist_info_t *info, unsigned type_data)
 {
    size_t i, list_size;
    struct string_list *str_list         = NULL;
+   bool owns_list                       = true;
    unsigned items_found                 = 0;
    unsigned files_count                 = 0;
    unsigned dirs_count                  = 0;
@@ -102,17 +461,19 @@ void filebrowser_parse(menu_displaylist_info_t *info, unsigned type_data)
    }
    else if (!string_is_empty(path))
    {
+      owns_list = false;
+
       if (filebrowser_types == FILEBROWSER_SELECT_FILE_SUBSYSTEM)
       {
          if (subsystem && subsystem_current_count > 0 && content_get_subsystem_rom_id() < subsystem->num_roms)
-            str_list = dir_list_new(path,
+            str_list = filebrowser_get_listing(path,
                   (filter_ext && info) ? subsystem->roms[content_get_subsystem_rom_id()].valid_extensions : NULL,
-                  true, settings->bools.show_hidden_files, true, false);
+                  settings->bools.show_hidden_files);
       }
       else
-         str_list = dir_list_new(path,
+         str_list = filebrowser_get_listing(path,
                (filter_ext && info) ? info->exts : NULL,
-               true, settings->bools.show_hidden_files, true, false);
+               settings->bools.show_hidden_files);
    }
 
    switch (filebrowser_types)
@@ -151,16 +512,12 @@ void filebrowser_parse(menu_displaylist_info_t *info, unsigned type_data)
       goto end;
    }
 
-   dir_list_sort(str_list, true);
+   if (owns_list)
+      dir_list_sort(str_list, true);
 
    list_size = str_list->size;
 
-   if (list_size == 0)
-   {
-      string_list_free(str_list);
-      str_list = NULL;
-   }
-   else
+   if (list_size > 0)
    {
       for (i = 0; i < list_size; i++)
       {
@@ -296,10 +653,11 @@ void filebrowser_parse(menu_displaylist_info_t *info, unsigned type_data)
       }
    }
 
-   if (str_list && str_list->size > 0)
+   if (owns_list)
       string_list_free(str_list);
 
-   if (items_found == 0)
+   /* Entries may still be on their way */
+   if (items_found == 0 && (owns_list || !filebrowser_task))
    {
       menu_entries_append_enum(info->list,
             msg_hash_to_str(MENU_ENUM_LABEL_VALUE_NO_ITEMS),
@@ -47,6 +47,10 @@ void filebrowser_set_type(enum filebrowser_enums type);
 
 void filebrowser_parse(menu_displaylist_info_t *data, unsigned type);
 
+void filebrowser_iterate(void);
+
+void filebrowser_deinit(void);
+
 RETRO_END_DECLS
 
 #endif
@@ -14,6 +14,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
 #include <net/net_compat.h>
 #include <net/net_socket.h>
@@ -119,31 +120,27 @@ void netplay_clear_socket_buffer(struct socket_buffer *sbuf)
    sbuf->start = sbuf->read = sbuf->end = 0;
 }
 
-/**
- * netplay_send
- *
- * Queue the given data for sending.
- */
-bool netplay_send(struct socket_buffer *sbuf, int sockfd, const void *buf,
-   size_t len)
+/* Describe the unsent part of a send buffer, which is at most two runs */
+static size_t buf_send_iov(struct socket_buffer *sbuf, socket_iov_t *iov)
 {
-   if (buf_remaining(sbuf) < len)
+   if (sbuf->end >= sbuf->start)
    {
-      /* Need to force a blocking send */
-      if (!netplay_send_flush(sbuf, sockfd, true))
-         return false;
+      iov[0].data = sbuf->data + sbuf->start;
+      iov[0].size = sbuf->end - sbuf->start;
+      return 1;
    }
 
-   if (buf_remaining(sbuf) < len)
-   {
-      /* Can only be that this is simply too big for our buffer, in which case
-       * we just need to do a blocking send */
-      if (!socket_send_all_blocking(sockfd, buf, len, false))
-         return false;
-      return true;
-   }
+   /* Buffer overlaps break */
+   iov[0].data = sbuf->data + sbuf->start;
+   iov[0].size = sbuf->bufsz - sbuf->start;
+   iov[1].data = sbuf->data;
+   iov[1].size = sbuf->end;
+   return 2;
+}
 
-   /* Copy it into our buffer */
+static void buf_copy_in(struct socket_buffer *sbuf, const void *buf,
+   size_t len)
+{
    if (sbuf->bufsz - sbuf->end < len)
    {
       /* Half at a time */
@@ -152,87 +149,187 @@ bool netplay_send(struct socket_buffer *sbuf, int sockfd, const void *buf,
       memcpy(sbuf->data + sbuf->end, buf, chunka);
       memcpy(sbuf->data, (const unsigned char *) buf + chunka, chunkb);
       sbuf->end = chunkb;
-
    }
    else
    {
       /* Straight in */
       memcpy(sbuf->data + sbuf->end, buf, len);
       sbuf->end += len;
+   }
+}
+
+/* Payloads at least this large are written straight to the socket, along
+ * with whatever is queued, rather than copied into the send buffer first */
+#define NETPLAY_SENDV_DIRECT_MIN 4096
+
+/* Advance the send buffer past 'sent' bytes written from its start */
+static void buf_consume(struct socket_buffer *sbuf, size_t sent)
+{
+   sbuf->start += sent;
+   if (sbuf->start >= sbuf->bufsz)
+      sbuf->start -= sbuf->bufsz;
+   if (sbuf->start == sbuf->end)
+      sbuf->start = sbuf->end = 0;
+}
 
+/* Drop the first 'skip' bytes of an iovec, returning the new count */
+static size_t iov_skip(socket_iov_t *iov, size_t count, size_t skip)
+{
+   size_t first = 0;
+
+   while (first < count && skip >= iov[first].size)
+      skip -= iov[first++].size;
+
+   if (first < count)
+   {
+      iov[first].data  = (const unsigned char*)iov[first].data + skip;
+      iov[first].size -= skip;
    }
 
-   return true;
+   memmove(iov, iov + first, (count - first) * sizeof(*iov));
+   return count - first;
 }
 
 /**
- * netplay_send_flush
+ * netplay_sendv
  *
- * Flush unsent data in the given socket buffer, blocking to do so if
- * requested.
+ * Queue the given buffers for sending, as one contiguous piece of data.
  *
- * Returns false only on socket failures, true otherwise.
+ * Small data is copied into the socket buffer, to go out with the rest of
+ * the frame. Large payloads (e.g. savestates sent to every peer) are written
+ * to the socket right away together with whatever is queued, and only the
+ * part the socket didn't take is copied. If that doesn't fit either, the
+ * rest is sent with one blocking vectored write. Either way the caller's
+ * buffers are no longer referenced once this returns.
  */
-bool netplay_send_flush(struct socket_buffer *sbuf, int sockfd, bool block)
+bool netplay_sendv(struct socket_buffer *sbuf, int sockfd,
+   const socket_iov_t *iov, size_t count)
 {
-   ssize_t sent;
+   socket_iov_t allv[SOCKET_IOV_MAX];
+   socket_iov_t rest[SOCKET_IOV_MAX];
+   size_t i, allc, queued, len = 0;
 
-   if (buf_used(sbuf) == 0)
+   for (i = 0; i < count; i++)
+      len += iov[i].size;
+
+   if (len < NETPLAY_SENDV_DIRECT_MIN && buf_remaining(sbuf) >= len)
+   {
+      /* Copy it into our buffer */
+      for (i = 0; i < count; i++)
+         buf_copy_in(sbuf, iov[i].data, iov[i].size);
       return true;
+   }
 
-   if (sbuf->end > sbuf->start)
+   queued = buf_used(sbuf);
+   allc   = (queued > 0) ? buf_send_iov(sbuf, allv) : 0;
+   if (allc + count > SOCKET_IOV_MAX)
    {
-      /* Usual case: Everything's in order */
-      if (block)
-      {
-         if (!socket_send_all_blocking(
-                  sockfd, sbuf->data + sbuf->start, buf_used(sbuf), true))
-            return false;
-         sbuf->start = sbuf->end = 0;
+      if (!netplay_send_flush(sbuf, sockfd, true))
+         return false;
+      queued = allc = 0;
+   }
+   memcpy(allv + allc, iov, count * sizeof(*iov));
+   memcpy(rest, iov, count * sizeof(*iov));
+   allc += count;
+
+   if (len >= NETPLAY_SENDV_DIRECT_MIN)
+   {
+      /* Write through, then deal with whatever is left */
+      ssize_t sent = socket_send_iov_all_nonblocking(sockfd, allv, allc, true);
+      if (sent < 0)
+         return false;
 
+      if ((size_t)sent < queued)
+      {
+         buf_consume(sbuf, sent);
+         sent = 0;
       }
       else
       {
-         sent = socket_send_all_nonblocking(sockfd, sbuf->data + sbuf->start, buf_used(sbuf), true);
-         if (sent < 0)
-            return false;
-         sbuf->start += sent;
+         sbuf->start = sbuf->end = 0;
+         sent       -= queued;
+      }
 
-         if (sbuf->start == sbuf->end)
-            sbuf->start = sbuf->end = 0;
+      count = iov_skip(rest, count, sent);
+      len  -= sent;
+      if (count == 0)
+         return true;
 
+      if (buf_remaining(sbuf) >= len)
+      {
+         for (i = 0; i < count; i++)
+            buf_copy_in(sbuf, rest[i].data, rest[i].size);
+         return true;
       }
 
-   }
-   else
-   {
-      /* Unusual case: Buffer overlaps break */
-      if (block)
+      /* Rebuild the list from what is still unsent */
+      allc = (buf_used(sbuf) > 0) ? buf_send_iov(sbuf, allv) : 0;
+      if (allc + count > SOCKET_IOV_MAX)
       {
-         if (!socket_send_all_blocking(sockfd, sbuf->data + sbuf->start, sbuf->bufsz - sbuf->start, true))
+         if (!netplay_send_flush(sbuf, sockfd, true))
             return false;
-         sbuf->start = 0;
-         return netplay_send_flush(sbuf, sockfd, true);
-
+         allc = 0;
       }
-      else
-      {
-         sent = socket_send_all_nonblocking(sockfd, sbuf->data + sbuf->start, sbuf->bufsz - sbuf->start, true);
-         if (sent < 0)
-            return false;
-         sbuf->start += sent;
+      memcpy(allv + allc, rest, count * sizeof(*rest));
+      allc += count;
+   }
 
-         if (sbuf->start >= sbuf->bufsz)
-         {
-            sbuf->start = 0;
-            return netplay_send_flush(sbuf, sockfd, false);
+   /* Need to force a blocking send, of everything at once */
+   if (!socket_send_iov_all_blocking(sockfd, allv, allc, true))
+      return false;
+   sbuf->start = sbuf->end = 0;
 
-         }
+   return true;
+}
 
-      }
+/**
+ * netplay_send
+ *
+ * Queue the given data for sending.
+ */
+bool netplay_send(struct socket_buffer *sbuf, int sockfd, const void *buf,
+   size_t len)
+{
+   socket_iov_t iov;
+   iov.data = buf;
+   iov.size = len;
+   return netplay_sendv(sbuf, sockfd, &iov, 1);
+}
+
+/**
+ * netplay_send_flush
+ *
+ * Flush unsent data in the given socket buffer, blocking to do so if
+ * requested. Data which wraps around the end of the buffer still goes out
+ * in a single vectored write.
+ *
+ * Returns false only on socket failures, true otherwise.
+ */
+bool netplay_send_flush(struct socket_buffer *sbuf, int sockfd, bool block)
+{
+   socket_iov_t iov[2];
+   size_t count;
+   ssize_t sent;
 
+   if (buf_used(sbuf) == 0)
+      return true;
+
+   count = buf_send_iov(sbuf, iov);
+
+   if (block)
+   {
+      if (!socket_send_iov_all_blocking(sockfd, iov, count, true))
+         return false;
+      sbuf->start = sbuf->end = 0;
+      return true;
    }
 
+   sent = socket_send_iov_all_nonblocking(sockfd, iov, count, true);
+   if (sent < 0)
+      return false;
+
+   buf_consume(sbuf, sent);
+
    return true;
 }
 
@@ -23,6 +23,8 @@
 
 #include "netplay_private.h"
 
+#include "../../managers/state_manager.h"
+
 static void clear_input(netplay_input_state_t istate)
 {
    while (istate)
@@ -64,6 +66,7 @@ bool netplay_delta_frame_ready(netplay_t *netplay, struct delta_frame *delta,
       clear_input(delta->resolved_input[i]);
       clear_input(delta->real_input[i]);
       clear_input(delta->simlated_input[i]);
+      clear_input(delta->udp_input[i]);
    }
    delta->have_local = false;
    for (i = 0; i < MAX_CLIENTS; i++)
@@ -119,9 +122,157 @@ void netplay_delta_frame_free(struct delta_frame *delta)
       free_input_state(&delta->resolved_input[i]);
       free_input_state(&delta->real_input[i]);
       free_input_state(&delta->simlated_input[i]);
+      free_input_state(&delta->udp_input[i]);
    }
 }
 
+/**
+ * netplay_delta_frame_find
+ *
+ * Find the buffered frame with the given frame number, or NULL.
+ */
+struct delta_frame *netplay_delta_frame_find(netplay_t *netplay,
+      uint32_t frame)
+{
+   size_t i;
+
+   for (i = 0; i < netplay->buffer_size; i++)
+   {
+      struct delta_frame *delta = &netplay->buffer[i];
+      if (delta->used && delta->frame == frame)
+         return delta;
+   }
+
+   return NULL;
+}
+
+/**
+ * netplay_delta_state_base
+ *
+ * Find the most recent finished frame whose CRC has been sent to our peers,
+ * to use as the base of a delta savestate. Returns NULL if there is none.
+ */
+struct delta_frame *netplay_delta_state_base(netplay_t *netplay,
+      uint32_t frame)
+{
+   size_t ptr = netplay->run_ptr;
+
+   do
+   {
+      struct delta_frame *delta = &netplay->buffer[ptr];
+
+      /* Only the server sends CRCs, and only for check frames. The peer has
+       * either validated its copy of such a frame or asked for a savestate. */
+      if (     delta->used
+            && delta->crc
+            && delta->frame < frame
+            && delta->frame <= netplay->other_frame_count)
+         return delta;
+
+      ptr = PREV_PTR(ptr);
+   } while (ptr != netplay->run_ptr);
+
+   return NULL;
+}
+
+/**
+ * netplay_delta_state_encode
+ *
+ * Encode the given state as a patch against the base frame's state into
+ * netplay->delta_patch. Returns the size of the patch, or 0 on failure.
+ */
+size_t netplay_delta_state_encode(netplay_t *netplay,
+      struct delta_frame *base, const void *state)
+{
+   if (!netplay->delta_patch || !base || !base->state)
+      return 0;
+
+   /* The encoder needs the padded buffers from state_manager_raw_alloc */
+   memcpy(netplay->delta_src, state, netplay->state_size);
+   memcpy(netplay->delta_dst, base->state, netplay->state_size);
+
+   return state_manager_raw_compress(netplay->delta_src,
+         netplay->delta_dst, netplay->state_size, netplay->delta_patch);
+}
+
+/**
+ * netplay_delta_state_decode
+ *
+ * Rebuild a state from the base frame's state and a patch from
+ * netplay_delta_state_encode, validating the patch, the base and the result
+ * against the given CRCs. Returns false if anything doesn't check out, in
+ * which case the peer should be asked for a full savestate.
+ */
+bool netplay_delta_state_decode(netplay_t *netplay,
+      struct delta_frame *base, uint32_t base_crc,
+      const uint8_t *patch, size_t patch_size,
+      uint32_t state_crc, void *state)
+{
+   /* Same format as the rewind buffer, see state_manager.c, but the patch
+    * came from the network so every run is bounds checked */
+   const uint16_t *patch16 = (const uint16_t*)patch;
+   size_t words            = patch_size / sizeof(uint16_t);
+   size_t num16s           = (netplay->state_size + 1) / sizeof(uint16_t);
+   size_t pos              = 0;
+   uint16_t *out16         = (uint16_t*)netplay->delta_dst;
+
+   if (!out16 || !base || !base->state ||
+         netplay_delta_frame_crc(netplay, base) != base_crc)
+      return false;
+
+   memcpy(out16, base->state, netplay->state_size);
+
+   for (;;)
+   {
+      uint16_t numchanged;
+
+      if (words < 1)
+         return false;
+      numchanged = *patch16++;
+      words--;
+
+      if (numchanged)
+      {
+         if (words < 1 + (size_t)numchanged)
+            return false;
+         pos += *patch16++;
+         words--;
+
+         if (pos + numchanged > num16s)
+            return false;
+
+         memcpy(out16 + pos, patch16, numchanged * sizeof(uint16_t));
+         patch16 += numchanged;
+         words   -= numchanged;
+         pos     += numchanged;
+      }
+      else
+      {
+         uint32_t numunchanged;
+
+         if (words < 2)
+            return false;
+         numunchanged = patch16[0] | ((uint32_t)patch16[1] << 16);
+         patch16     += 2;
+         words       -= 2;
+
+         if (!numunchanged)
+            break;
+
+         pos += numunchanged;
+         if (pos > num16s)
+            return false;
+      }
+   }
+
+   if (encoding_crc32(0L, (const unsigned char*)out16,
+            netplay->state_size) != state_crc)
+      return false;
+
+   memcpy(state, out16, netplay->state_size);
+   return true;
+}
+
 /**
  * netplay_input_state_for
  *
@@ -22,6 +22,7 @@
 
 #include <boolean.h>
 #include <compat/strl.h>
+#include <encodings/crc32.h>
 #include <retro_assert.h>
 #include <string/stdstring.h>
 #include <net/net_http.h>
@@ -1177,6 +1178,99 @@ static void netplay_force_future(netplay_t *netplay)
    }
 }
 
+static bool netplay_savestate_peer(struct netplay_connection *connection,
+      uint32_t cx)
+{
+   return connection->active &&
+      connection->mode >= NETPLAY_CONNECTION_CONNECTED &&
+      connection->compression_supported == cx;
+}
+
+static bool netplay_savestate_peer_wants_delta(
+      struct netplay_connection *connection, struct delta_frame *base)
+{
+   return base && connection->delta_supported &&
+      !connection->savestate_full_required;
+}
+
+/**
+ * netplay_send_savestate_delta
+ * @netplay              : pointer to netplay object
+ * @serial_info          : the savestate being loaded
+ * @cx                   : compression type
+ * @z                    : compression backend to use
+ * @base                 : frame to encode the savestate against
+ *
+ * Send a loaded savestate as a patch against @base to those connected peers
+ * which accept deltas.
+ */
+static void netplay_send_savestate_delta(netplay_t *netplay,
+   retro_ctx_serialize_info_t *serial_info, uint32_t cx,
+   struct compression_transcoder *z, struct delta_frame *base)
+{
+   uint32_t header[7];
+   socket_iov_t iov[2];
+   uint32_t rd, wn;
+   size_t i, patch_size;
+   bool wanted = false;
+
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      struct netplay_connection *connection = &netplay->connections[i];
+      if (netplay_savestate_peer(connection, cx) &&
+            netplay_savestate_peer_wants_delta(connection, base))
+         wanted = true;
+   }
+
+   if (!wanted)
+      return;
+
+   patch_size = netplay_delta_state_encode(netplay, base,
+         serial_info->data_const);
+
+   /* Compress the patch */
+   z->compression_backend->set_in(z->compression_stream,
+      netplay->delta_patch, (uint32_t)patch_size);
+   z->compression_backend->set_out(z->compression_stream,
+      netplay->zbuffer, (uint32_t)netplay->zbuffer_size);
+   if (!patch_size || !z->compression_backend->trans(z->compression_stream,
+            true, &rd, &wn, NULL))
+   {
+      /* Couldn't make a delta, send everyone the full state instead */
+      for (i = 0; i < netplay->connections_size; i++)
+         netplay->connections[i].savestate_full_required = true;
+      return;
+   }
+
+   /* Send it to relevant peers */
+   header[0] = htonl(NETPLAY_CMD_LOAD_SAVESTATE_DELTA);
+   header[1] = htonl(wn + 5*sizeof(uint32_t));
+   header[2] = htonl(netplay->run_frame_count);
+   header[3] = htonl(serial_info->size);
+   header[4] = htonl(base->frame);
+   header[5] = htonl(netplay_delta_frame_crc(netplay, base));
+   header[6] = htonl(encoding_crc32(0L,
+            (const unsigned char*)serial_info->data_const,
+            serial_info->size));
+
+   iov[0].data = header;
+   iov[0].size = sizeof(header);
+   iov[1].data = netplay->zbuffer;
+   iov[1].size = wn;
+
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      struct netplay_connection *connection = &netplay->connections[i];
+      if (!netplay_savestate_peer(connection, cx) ||
+          !netplay_savestate_peer_wants_delta(connection, base))
+         continue;
+
+      if (!netplay_sendv(&connection->send_packet_buffer, connection->fd,
+            iov, 2))
+         netplay_hangup(netplay, connection);
+   }
+}
+
 /**
  * netplay_send_savestate
  * @netplay              : pointer to netplay object
@@ -1185,15 +1279,38 @@ static void netplay_force_future(netplay_t *netplay)
  * @z                    : compression backend to use
  *
  * Send a loaded savestate to those connected peers using the given compression
- * scheme.
+ * scheme. Peers which share a validated frame with us get a delta against it,
+ * the others get the whole state.
  */
 void netplay_send_savestate(netplay_t *netplay,
    retro_ctx_serialize_info_t *serial_info, uint32_t cx,
    struct compression_transcoder *z)
 {
    uint32_t header[4];
+   socket_iov_t iov[2];
    uint32_t rd, wn;
    size_t i;
+   struct delta_frame *base = NULL;
+   bool wanted              = false;
+
+   /* Only the server knows which frames its peers have validated */
+   if (netplay->is_server && netplay->delta_patch &&
+         serial_info->size == netplay->state_size)
+      base = netplay_delta_state_base(netplay, netplay->run_frame_count);
+
+   if (base)
+      netplay_send_savestate_delta(netplay, serial_info, cx, z, base);
+
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      struct netplay_connection *connection = &netplay->connections[i];
+      if (netplay_savestate_peer(connection, cx) &&
+            !netplay_savestate_peer_wants_delta(connection, base))
+         wanted = true;
+   }
+
+   if (!wanted)
+      return;
 
    /* Compress it */
    z->compression_backend->set_in(z->compression_stream,
@@ -1215,18 +1332,23 @@ void netplay_send_savestate(netplay_t *netplay,
    header[2] = htonl(netplay->run_frame_count);
    header[3] = htonl(serial_info->size);
 
+   iov[0].data = header;
+   iov[0].size = sizeof(header);
+   iov[1].data = netplay->zbuffer;
+   iov[1].size = wn;
+
    for (i = 0; i < netplay->connections_size; i++)
    {
       struct netplay_connection *connection = &netplay->connections[i];
-      if (!connection->active ||
-          connection->mode < NETPLAY_CONNECTION_CONNECTED ||
-          connection->compression_supported != cx) continue;
+      if (!netplay_savestate_peer(connection, cx) ||
+          netplay_savestate_peer_wants_delta(connection, base))
+         continue;
 
-      if (!netplay_send(&connection->send_packet_buffer, connection->fd, header,
-            sizeof(header)) ||
-          !netplay_send(&connection->send_packet_buffer, connection->fd,
-            netplay->zbuffer, wn))
+      if (!netplay_sendv(&connection->send_packet_buffer, connection->fd,
+            iov, 2))
          netplay_hangup(netplay, connection);
+
+      connection->savestate_full_required = false;
    }
 }
 
@@ -193,6 +193,15 @@ static uint32_t simple_rand_uint32(void)
             parts[2]);
 }
 
+/* What we advertise in the compression field of our header */
+static uint32_t netplay_compression_supported(netplay_t *netplay)
+{
+   uint32_t supported = NETPLAY_COMPRESSION_SUPPORTED;
+   if (netplay->udp_input)
+      supported |= NETPLAY_COMPRESSION_UDP_INPUT;
+   return supported;
+}
+
 /**
  * netplay_handshake_init_send
  *
@@ -206,7 +215,7 @@ bool netplay_handshake_init_send(netplay_t *netplay,
 
    header[0] = htonl(netplay_magic);
    header[1] = htonl(netplay_platform_magic());
-   header[2] = htonl(NETPLAY_COMPRESSION_SUPPORTED);
+   header[2] = htonl(netplay_compression_supported(netplay));
    header[3] = 0;
    header[4] = htonl(NETPLAY_PROTOCOL_VERSION);
    header[5] = htonl(netplay_impl_magic());
@@ -371,7 +380,7 @@ bool netplay_handshake_init(netplay_t *netplay,
 
    /* Check what compression is supported */
    compression  = ntohl(header[2]);
-   compression &= NETPLAY_COMPRESSION_SUPPORTED;
+   compression &= netplay_compression_supported(netplay);
 
    if (compression & NETPLAY_COMPRESSION_ZLIB)
    {
@@ -396,6 +405,11 @@ bool netplay_handshake_init(netplay_t *netplay,
       connection->compression_supported = 0;
    }
 
+   connection->delta_supported =
+      !!(compression & NETPLAY_COMPRESSION_DELTA);
+   connection->udp_supported   =
+      !!(compression & NETPLAY_COMPRESSION_UDP_INPUT);
+
    if (!ctrans->decompression_backend)
       ctrans->decompression_backend = ctrans->compression_backend->reverse;
 
@@ -471,7 +485,28 @@ static void netplay_handshake_ready(netplay_t *netplay,
 
       RARCH_LOG("%s %u\n", msg_hash_to_str(MSG_CONNECTION_SLOT), slot);
 
-      /* Send them the savestate */
+      /* Send them the savestate. They have none of our frames yet, so it
+       * can't be a delta. */
+      connection->savestate_full_required = true;
+
+      /* Tell them how to identify their input datagrams. We only send to
+       * them once they've sent to us, so that we know their address. */
+      if (connection->udp_supported)
+      {
+         uint32_t token;
+
+         if (simple_rand_next == 1)
+            simple_srand((unsigned int) time(NULL));
+         do
+         {
+            connection->udp_token = simple_rand_uint32();
+         } while (!connection->udp_token);
+
+         token = htonl(connection->udp_token);
+         netplay_send_raw_cmd(netplay, connection, NETPLAY_CMD_UDP_TOKEN,
+               &token, sizeof(token));
+      }
+
       if (!(netplay->quirks &
                (NETPLAY_QUIRK_NO_SAVESTATES|NETPLAY_QUIRK_NO_TRANSMISSION)))
          netplay->force_send_savestate = true;
@@ -31,6 +31,8 @@
 #include "netplay_discovery.h"
 
 #include "../../autosave.h"
+#include "../../configuration.h"
+#include "../../managers/state_manager.h"
 #include "../../retroarch.h"
 
 #if defined(AF_INET6) && !defined(HAVE_SOCKET_LEGACY)
@@ -227,6 +229,10 @@ static bool init_socket(netplay_t *netplay, void *direct_host,
    if (!init_tcp_socket(netplay, direct_host, server, port))
       return false;
 
+   /* Clients open their UDP socket once the server gives them a token */
+   if (netplay->is_server && netplay->udp_input)
+      netplay->udp_input = netplay_udp_init_server(netplay, port);
+
    if (netplay->is_server && netplay->nat_traversal)
       netplay_init_nat_traversal(netplay);
 
@@ -304,6 +310,22 @@ bool netplay_init_serialization(netplay_t *netplay)
       return false;
    }
 
+   /* Delta savestates are optional, carry on without them */
+   netplay->delta_patch_size = state_manager_raw_maxsize(netplay->state_size);
+   netplay->delta_patch      = (uint8_t *) malloc(netplay->delta_patch_size);
+   netplay->delta_src        = state_manager_raw_alloc(netplay->state_size, 0);
+   netplay->delta_dst        = state_manager_raw_alloc(netplay->state_size, 0xFFFF);
+   if (!netplay->delta_patch || !netplay->delta_src || !netplay->delta_dst)
+   {
+      free(netplay->delta_patch);
+      free(netplay->delta_src);
+      free(netplay->delta_dst);
+      netplay->delta_patch      = NULL;
+      netplay->delta_src        = NULL;
+      netplay->delta_dst        = NULL;
+      netplay->delta_patch_size = 0;
+   }
+
    return true;
 }
 
@@ -420,11 +442,13 @@ netplay_t *netplay_new(void *direct_host, const char *server, uint16_t port,
    const struct retro_callbacks *cb, bool nat_traversal, const char *nick,
    uint64_t quirks)
 {
-   netplay_t *netplay = (netplay_t*)calloc(1, sizeof(*netplay));
+   settings_t *settings = config_get_ptr();
+   netplay_t *netplay   = (netplay_t*)calloc(1, sizeof(*netplay));
    if (!netplay)
       return NULL;
 
    netplay->listen_fd            = -1;
+   netplay->udp_fd               = -1;
    netplay->tcp_port             = port;
    netplay->cbs                  = *cb;
    netplay->is_server            = (direct_host == NULL && server == NULL);
@@ -435,6 +459,9 @@ netplay_t *netplay_new(void *direct_host, const char *server, uint16_t port,
    netplay->crc_validity_checked = false;
    netplay->crcs_valid           = true;
    netplay->quirks               = quirks;
+   netplay->udp_input            = settings->bools.netplay_udp_input;
+   netplay->udp_sim_loss         = settings->uints.netplay_udp_sim_loss;
+   netplay->udp_sim_latency      = settings->uints.netplay_udp_sim_latency;
    netplay->self_mode            = netplay->is_server ?
                                 NETPLAY_CONNECTION_SPECTATING :
                                 NETPLAY_CONNECTION_NONE;
@@ -512,6 +539,8 @@ error:
    if (netplay->listen_fd >= 0)
       socket_close(netplay->listen_fd);
 
+   netplay_udp_deinit(netplay);
+
    if (netplay->connections && netplay->connections[0].fd >= 0)
       socket_close(netplay->connections[0].fd);
 
@@ -532,6 +561,8 @@ void netplay_free(netplay_t *netplay)
    if (netplay->listen_fd >= 0)
       socket_close(netplay->listen_fd);
 
+   netplay_udp_deinit(netplay);
+
    for (i = 0; i < netplay->connections_size; i++)
    {
       struct netplay_connection *connection = &netplay->connections[i];
@@ -560,6 +591,10 @@ void netplay_free(netplay_t *netplay)
    if (netplay->zbuffer)
       free(netplay->zbuffer);
 
+   free(netplay->delta_patch);
+   free(netplay->delta_src);
+   free(netplay->delta_dst);
+
    if (netplay->compress_nil.compression_stream)
    {
       netplay->compress_nil.compression_backend->stream_free(netplay->compress_nil.compression_stream);
@@ -134,7 +134,8 @@ void netplay_hangup(netplay_t *netplay, struct netplay_connection *connection)
    runloop_msg_queue_push(dmsg, 1, 180, false, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
 
    socket_close(connection->fd);
-   connection->active = false;
+   connection->active    = false;
+   connection->udp_ready = false;
    netplay_deinit_socket_buffer(&connection->send_packet_buffer);
    netplay_deinit_socket_buffer(&connection->recv_packet_buffer);
 
@@ -294,6 +295,48 @@ static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
 #undef BUFSZ
 }
 
+/**
+ * netplay_input_received
+ *
+ * Finish receiving a frame of input from the given client, from either TCP or
+ * UDP, once it has been copied into the frame: mark it as read, advance past
+ * it, and forward it on if we're the server.
+ */
+void netplay_input_received(netplay_t *netplay,
+   struct netplay_connection *connection, struct delta_frame *dframe,
+   uint32_t client_num)
+{
+   dframe->have_real[client_num] = true;
+
+   /* Slaves may go through several packets of data in the same frame
+    * if latency is choppy, so we advance and send their data after
+    * handling all network data this frame */
+   if (connection->mode == NETPLAY_CONNECTION_PLAYING)
+   {
+      netplay->read_ptr[client_num] = NEXT_PTR(netplay->read_ptr[client_num]);
+      netplay->read_frame_count[client_num]++;
+
+      if (netplay->is_server)
+      {
+         /* Forward it on if it's past data */
+         if (dframe->frame <= netplay->self_frame_count)
+            send_input_frame(netplay, dframe, NULL, connection, client_num, false);
+      }
+   }
+
+   /* If this was server data, advance our server pointer too */
+   if (!netplay->is_server && client_num == 0)
+   {
+      netplay->server_ptr = netplay->read_ptr[0];
+      netplay->server_frame_count = netplay->read_frame_count[0];
+   }
+
+#ifdef DEBUG_NETPLAY_STEPS
+   RARCH_LOG("[netplay] Received input from %u\n", client_num);
+   print_state(netplay);
+#endif
+}
+
 /**
  * netplay_send_cur_input
  *
@@ -353,6 +396,9 @@ bool netplay_send_cur_input(netplay_t *netplay,
          false))
       return false;
 
+   /* And the redundant copy over UDP, if they take it */
+   netplay_udp_send_input(netplay, connection);
+
    return true;
 }
 
@@ -368,19 +414,18 @@ bool netplay_send_raw_cmd(netplay_t *netplay,
    size_t size)
 {
    uint32_t cmdbuf[2];
+   socket_iov_t iov[2];
 
    cmdbuf[0] = htonl(cmd);
    cmdbuf[1] = htonl(size);
 
-   if (!netplay_send(&connection->send_packet_buffer, connection->fd, cmdbuf,
-         sizeof(cmdbuf)))
-      return false;
-
-   if (size > 0)
-      if (!netplay_send(&connection->send_packet_buffer, connection->fd, data, size))
-         return false;
+   iov[0].data = cmdbuf;
+   iov[0].size = sizeof(cmdbuf);
+   iov[1].data = data;
+   iov[1].size = size;
 
-   return true;
+   return netplay_sendv(&connection->send_packet_buffer, connection->fd,
+         iov, (size > 0) ? 2 : 1);
 }
 
 /**
@@ -394,6 +439,18 @@ void netplay_send_raw_cmd_all(netplay_t *netplay,
    size_t size)
 {
    size_t i;
+   uint32_t cmdbuf[2];
+   socket_iov_t iov[2];
+
+   /* Every peer gets the same bytes, so build the command once */
+   cmdbuf[0] = htonl(cmd);
+   cmdbuf[1] = htonl(size);
+
+   iov[0].data = cmdbuf;
+   iov[0].size = sizeof(cmdbuf);
+   iov[1].data = data;
+   iov[1].size = size;
+
    for (i = 0; i < netplay->connections_size; i++)
    {
       struct netplay_connection *connection = &netplay->connections[i];
@@ -401,7 +458,8 @@ void netplay_send_raw_cmd_all(netplay_t *netplay,
          continue;
       if (connection->active && connection->mode >= NETPLAY_CONNECTION_CONNECTED)
       {
-         if (!netplay_send_raw_cmd(netplay, connection, cmd, data, size))
+         if (!netplay_sendv(&connection->send_packet_buffer, connection->fd,
+               iov, (size > 0) ? 2 : 1))
             netplay_hangup(netplay, connection);
       }
    }
@@ -477,6 +535,30 @@ bool netplay_cmd_request_savestate(netplay_t *netplay)
       NETPLAY_CMD_REQUEST_SAVESTATE, NULL, 0);
 }
 
+/**
+ * netplay_cmd_request_full_savestate
+ *
+ * Send a savestate request command, asking that the state not be sent as a
+ * delta. Used when we couldn't apply a delta savestate.
+ */
+bool netplay_cmd_request_full_savestate(netplay_t *netplay)
+{
+   uint32_t flags = htonl(NETPLAY_CMD_REQUEST_SAVESTATE_BIT_FULL);
+
+   if (netplay->connections_size == 0 ||
+       !netplay->connections[0].active ||
+       netplay->connections[0].mode < NETPLAY_CONNECTION_CONNECTED)
+      return false;
+
+   /* Older peers don't expect a payload, but they never send deltas either */
+   if (!netplay->connections[0].delta_supported)
+      return netplay_cmd_request_savestate(netplay);
+
+   netplay->savestate_request_outstanding = true;
+   return netplay_send_raw_cmd(netplay, &netplay->connections[0],
+      NETPLAY_CMD_REQUEST_SAVESTATE, &flags, sizeof(flags));
+}
+
 /**
  * netplay_cmd_mode
  *
@@ -1056,35 +1138,7 @@ static bool netplay_get_cmd(netplay_t *netplay,
                for (di = 0; di < dsize; di++)
                   istate->data[di] = ntohl(istate->data[di]);
             }
-            dframe->have_real[client_num] = true;
-
-            /* Slaves may go through several packets of data in the same frame
-             * if latency is choppy, so we advance and send their data after
-             * handling all network data this frame */
-            if (connection->mode == NETPLAY_CONNECTION_PLAYING)
-            {
-               netplay->read_ptr[client_num] = NEXT_PTR(netplay->read_ptr[client_num]);
-               netplay->read_frame_count[client_num]++;
-
-               if (netplay->is_server)
-               {
-                  /* Forward it on if it's past data */
-                  if (dframe->frame <= netplay->self_frame_count)
-                     send_input_frame(netplay, dframe, NULL, connection, client_num, false);
-               }
-            }
-
-            /* If this was server data, advance our server pointer too */
-            if (!netplay->is_server && client_num == 0)
-            {
-               netplay->server_ptr = netplay->read_ptr[0];
-               netplay->server_frame_count = netplay->read_frame_count[0];
-            }
-
-#ifdef DEBUG_NETPLAY_STEPS
-            RARCH_LOG("[netplay] Received input from %u\n", client_num);
-            print_state(netplay);
-#endif
+            netplay_input_received(netplay, connection, dframe, client_num);
             break;
          }
 
@@ -1495,6 +1549,34 @@ static bool netplay_get_cmd(netplay_t *netplay,
             break;
          }
 
+      case NETPLAY_CMD_UDP_TOKEN:
+         {
+            uint32_t token;
+
+            if (netplay->is_server || !connection->udp_supported)
+            {
+               RARCH_ERR("Unexpected NETPLAY_CMD_UDP_TOKEN.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            if (cmd_size != sizeof(uint32_t))
+            {
+               RARCH_ERR("Received invalid payload size for NETPLAY_CMD_UDP_TOKEN.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            RECV(&token, sizeof(token))
+            {
+               RARCH_ERR("Failed to receive NETPLAY_CMD_UDP_TOKEN payload.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            /* If this doesn't work out, TCP alone will do */
+            if (netplay_udp_init_client(netplay, connection, ntohl(token)))
+               RARCH_LOG("[netplay] Sending input over UDP too.\n");
+            break;
+         }
+
       case NETPLAY_CMD_DISCONNECT:
          netplay_hangup(netplay, connection);
          return true;
@@ -1564,12 +1646,32 @@ static bool netplay_get_cmd(netplay_t *netplay,
          }
 
       case NETPLAY_CMD_REQUEST_SAVESTATE:
+         if (cmd_size == sizeof(uint32_t))
+         {
+            uint32_t flags;
+
+            RECV(&flags, sizeof(flags))
+            {
+               RARCH_ERR("NETPLAY_CMD_REQUEST_SAVESTATE failed to receive payload.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            if (ntohl(flags) & NETPLAY_CMD_REQUEST_SAVESTATE_BIT_FULL)
+               connection->savestate_full_required = true;
+         }
+         else if (cmd_size)
+         {
+            RARCH_ERR("NETPLAY_CMD_REQUEST_SAVESTATE received an unexpected payload size.\n");
+            return netplay_cmd_nak(netplay, connection);
+         }
+
          /* Delay until next frame so we don't send the savestate after the
           * input */
          netplay->force_send_savestate = true;
          break;
 
       case NETPLAY_CMD_LOAD_SAVESTATE:
+      case NETPLAY_CMD_LOAD_SAVESTATE_DELTA:
       case NETPLAY_CMD_RESET:
          {
             uint32_t frame;
@@ -1629,6 +1731,8 @@ static bool netplay_get_cmd(netplay_t *netplay,
             /* Check the payload size */
             if ((cmd == NETPLAY_CMD_LOAD_SAVESTATE &&
                  (cmd_size < 2*sizeof(uint32_t) || cmd_size > netplay->zbuffer_size + 2*sizeof(uint32_t))) ||
+                (cmd == NETPLAY_CMD_LOAD_SAVESTATE_DELTA &&
+                 (cmd_size < 5*sizeof(uint32_t) || cmd_size > netplay->zbuffer_size + 5*sizeof(uint32_t))) ||
                 (cmd == NETPLAY_CMD_RESET && cmd_size != sizeof(uint32_t)))
             {
                RARCH_ERR("CMD_LOAD_SAVESTATE received an unexpected payload size.\n");
@@ -1666,7 +1770,80 @@ static bool netplay_get_cmd(netplay_t *netplay,
             }
 
             /* Now we switch based on whether we're loading a state or resetting */
-            if (cmd == NETPLAY_CMD_LOAD_SAVESTATE)
+            if (cmd == NETPLAY_CMD_LOAD_SAVESTATE_DELTA)
+            {
+               uint32_t base_info[3];
+               uint32_t base_frame, base_crc, state_crc;
+               struct delta_frame *base;
+
+               RECV(&isize, sizeof(isize))
+               {
+                  RARCH_ERR("CMD_LOAD_SAVESTATE_DELTA failed to receive inflated size.\n");
+                  return netplay_cmd_nak(netplay, connection);
+               }
+               isize = ntohl(isize);
+
+               if (isize != netplay->state_size)
+               {
+                  RARCH_ERR("CMD_LOAD_SAVESTATE_DELTA received an unexpected save state size.\n");
+                  return netplay_cmd_nak(netplay, connection);
+               }
+
+               RECV(base_info, sizeof(base_info))
+               {
+                  RARCH_ERR("CMD_LOAD_SAVESTATE_DELTA failed to receive base frame.\n");
+                  return netplay_cmd_nak(netplay, connection);
+               }
+               base_frame = ntohl(base_info[0]);
+               base_crc   = ntohl(base_info[1]);
+               state_crc  = ntohl(base_info[2]);
+
+               RECV(netplay->zbuffer, cmd_size - 5*sizeof(uint32_t))
+               {
+                  RARCH_ERR("CMD_LOAD_SAVESTATE_DELTA failed to receive patch.\n");
+                  return netplay_cmd_nak(netplay, connection);
+               }
+
+               /* Decompress the patch, if we have anywhere to put it */
+               wn = 0;
+               switch (connection->compression_supported)
+               {
+                  case NETPLAY_COMPRESSION_ZLIB:
+                     ctrans = &netplay->compress_zlib;
+                     break;
+                  default:
+                     ctrans = &netplay->compress_nil;
+               }
+               if (netplay->delta_patch)
+               {
+                  ctrans->decompression_backend->set_in(ctrans->decompression_stream,
+                     netplay->zbuffer, cmd_size - 5*sizeof(uint32_t));
+                  ctrans->decompression_backend->set_out(ctrans->decompression_stream,
+                     netplay->delta_patch, (unsigned)netplay->delta_patch_size);
+                  ctrans->decompression_backend->trans(ctrans->decompression_stream,
+                     true, &rd, &wn, NULL);
+               }
+
+               /* And apply it. If our copy of the base frame isn't the one the
+                * server has, the patch is useless, so ask for the whole
+                * state. */
+               base = netplay_delta_frame_find(netplay, base_frame);
+               if (!wn || base_frame >= load_frame_count ||
+                   !netplay_delta_state_decode(netplay, base, base_crc,
+                     netplay->delta_patch, wn, state_crc,
+                     netplay->buffer[load_ptr].state))
+               {
+                  RARCH_WARN("CMD_LOAD_SAVESTATE_DELTA couldn't apply delta against frame %u, requesting full savestate.\n",
+                        base_frame);
+                  netplay->savestate_request_outstanding = false;
+                  netplay_cmd_request_full_savestate(netplay);
+                  break;
+               }
+
+               /* Force a rewind to the relevant frame */
+               netplay->force_rewind = true;
+            }
+            else if (cmd == NETPLAY_CMD_LOAD_SAVESTATE)
             {
                RECV(&isize, sizeof(isize))
                {
@@ -1878,6 +2055,8 @@ int netplay_poll_net_input(netplay_t *netplay, bool block)
       if (connection->active && connection->fd >= max_fd)
          max_fd = connection->fd + 1;
    }
+   if (netplay->udp_fd >= max_fd)
+      max_fd = netplay->udp_fd + 1;
 
    if (max_fd == 0)
       return 0;
@@ -1898,6 +2077,10 @@ int netplay_poll_net_input(netplay_t *netplay, bool block)
             netplay_hangup(netplay, connection);
       }
 
+      /* And whatever's come in over UDP */
+      if (netplay_udp_poll(netplay))
+         had_input = true;
+
       if (block)
       {
          netplay_update_unread_ptr(netplay);
@@ -1920,6 +2103,8 @@ int netplay_poll_net_input(netplay_t *netplay, bool block)
                if (connection->active)
                   FD_SET(connection->fd, &fds);
             }
+            if (netplay->udp_fd >= 0)
+               FD_SET(netplay->udp_fd, &fds);
 
             if (socket_select(max_fd, &fds, NULL, NULL, &tv) < 0)
                return -1;
@@ -22,6 +22,7 @@
 
 #include <net/net_compat.h>
 #include <net/net_natt.h>
+#include <net/net_socket.h>
 #include <features/features_cpu.h>
 #include <streams/trans_stream.h>
 
@@ -89,10 +90,15 @@ typedef uint32_t client_bitmap_t;
 
 /* Compression protocols supported */
 #define NETPLAY_COMPRESSION_ZLIB (1<<0)
+/* Savestates may be sent as a patch against an earlier frame */
+#define NETPLAY_COMPRESSION_DELTA (1<<1)
+/* Input may also be sent over UDP (not compression as such, but advertised
+ * alongside it; only set when enabled, see netplay_compression_supported) */
+#define NETPLAY_COMPRESSION_UDP_INPUT (1<<2)
 #if HAVE_ZLIB
-#define NETPLAY_COMPRESSION_SUPPORTED NETPLAY_COMPRESSION_ZLIB
+#define NETPLAY_COMPRESSION_SUPPORTED (NETPLAY_COMPRESSION_ZLIB|NETPLAY_COMPRESSION_DELTA)
 #else
-#define NETPLAY_COMPRESSION_SUPPORTED 0
+#define NETPLAY_COMPRESSION_SUPPORTED NETPLAY_COMPRESSION_DELTA
 #endif
 
 enum netplay_cmd
@@ -140,6 +146,9 @@ enum netplay_cmd
    /* Report player mode refused */
    NETPLAY_CMD_MODE_REFUSED   = 0x0027,
 
+   /* Give the client its token for UDP input */
+   NETPLAY_CMD_UDP_TOKEN      = 0x0028,
+
    /* Loading and synchronization */
 
    /* Send the CRC hash of a frame's state */
@@ -166,6 +175,9 @@ enum netplay_cmd
    /* Sends over cheats enabled on client (unsupported) */
    NETPLAY_CMD_CHEATS         = 0x0047,
 
+   /* Send a savestate as a patch against an earlier frame */
+   NETPLAY_CMD_LOAD_SAVESTATE_DELTA = 0x0048,
+
    /* Misc. commands */
 
    /* Sends multiple config requests over,
@@ -178,11 +190,17 @@ enum netplay_cmd
    NETPLAY_CMD_CFG_ACK        = 0x0062
 };
 
+/* Frames of input in each UDP input datagram, and the most words of input
+ * per frame we'll send that way */
+#define NETPLAY_UDP_INPUT_FRAMES    8
+#define NETPLAY_UDP_MAX_INPUT_WORDS 16
+
 #define NETPLAY_CMD_SYNC_BIT_PAUSED    (1U<<31)
 #define NETPLAY_CMD_PLAY_BIT_SLAVE     (1U<<31)
 #define NETPLAY_CMD_MODE_BIT_YOU       (1U<<31)
 #define NETPLAY_CMD_MODE_BIT_PLAYING   (1U<<30)
 #define NETPLAY_CMD_MODE_BIT_SLAVE     (1U<<29)
+#define NETPLAY_CMD_REQUEST_SAVESTATE_BIT_FULL (1U<<31)
 
 /* These are the reasons given for mode changes to be rejected */
 enum netplay_cmd_mode_reasons
@@ -309,6 +327,10 @@ struct delta_frame
     * it's a real simulation, not real input. */
    netplay_input_state_t simlated_input[MAX_INPUT_DEVICES];
 
+   /* Input received over UDP ahead of the real (TCP) input. Only ever used
+    * in place of a simulation, which the real input then confirms. */
+   netplay_input_state_t udp_input[MAX_INPUT_DEVICES];
+
    /* Have we read local input? */
    bool have_local;
 
@@ -359,6 +381,23 @@ struct netplay_connection
    /* What compression does this peer support? */
    uint32_t compression_supported;
 
+   /* Does this peer accept savestates as deltas? */
+   bool delta_supported;
+
+   /* Must the next savestate sent to this peer be a full one? */
+   bool savestate_full_required;
+
+   /* Does this peer take input over UDP, and have we got an address for it
+    * yet? */
+   bool udp_supported, udp_ready;
+
+   /* Token identifying this connection's UDP input datagrams */
+   uint32_t udp_token;
+
+   /* Where to send UDP input datagrams */
+   struct sockaddr_storage udp_addr;
+   socklen_t udp_addr_len;
+
    /* Is this player paused? */
    bool paused;
 
@@ -394,6 +433,20 @@ struct netplay
    /* TCP connection for listening (server only) */
    int listen_fd;
 
+   /* Socket for UDP input, or -1 */
+   int udp_fd;
+
+   /* Are we offering input over UDP? */
+   bool udp_input;
+
+   /* Simulated loss (percent of datagrams) and latency (ms) on the UDP input
+    * path, for testing */
+   unsigned udp_sim_loss, udp_sim_latency;
+
+   /* Datagrams held back to simulate latency */
+   struct netplay_udp_delayed *udp_delay_queue;
+   size_t udp_delay_head, udp_delay_tail;
+
    /* Our client number */
    uint32_t self_client_num;
 
@@ -459,6 +512,12 @@ struct netplay
    uint8_t *zbuffer;
    size_t zbuffer_size;
 
+   /* Uncompressed delta savestate patch, and the padded scratch
+    * states it is computed from and applied to */
+   uint8_t *delta_patch;
+   size_t delta_patch_size;
+   void *delta_src, *delta_dst;
+
    /* The size of our packet buffers */
    size_t packet_buffer_size;
 
@@ -594,6 +653,16 @@ bool netplay_resize_socket_buffer(struct socket_buffer *sbuf, size_t newsize);
  */
 void netplay_deinit_socket_buffer(struct socket_buffer *sbuf);
 
+/**
+ * netplay_sendv
+ *
+ * Queue the given buffers for sending, as one contiguous piece of data.
+ * Large payloads are written straight to the socket, and only the part it
+ * doesn't take right away is copied.
+ */
+bool netplay_sendv(struct socket_buffer *sbuf, int sockfd,
+   const socket_iov_t *iov, size_t count);
+
 /**
  * netplay_send
  *
@@ -668,6 +737,45 @@ uint32_t netplay_delta_frame_crc(netplay_t *netplay, struct delta_frame *delta);
  */
 void netplay_delta_frame_free(struct delta_frame *delta);
 
+/**
+ * netplay_delta_frame_find
+ *
+ * Find the buffered frame with the given frame number, or NULL.
+ */
+struct delta_frame *netplay_delta_frame_find(netplay_t *netplay,
+      uint32_t frame);
+
+/**
+ * netplay_delta_state_base
+ *
+ * Find the most recent finished frame whose CRC has been sent to our peers,
+ * to use as the base of a delta savestate. Returns NULL if there is none.
+ */
+struct delta_frame *netplay_delta_state_base(netplay_t *netplay,
+      uint32_t frame);
+
+/**
+ * netplay_delta_state_encode
+ *
+ * Encode the given state as a patch against the base frame's state into
+ * netplay->delta_patch. Returns the size of the patch, or 0 on failure.
+ */
+size_t netplay_delta_state_encode(netplay_t *netplay,
+      struct delta_frame *base, const void *state);
+
+/**
+ * netplay_delta_state_decode
+ *
+ * Rebuild a state from the base frame's state and a patch from
+ * netplay_delta_state_encode, validating the patch, the base and the result
+ * against the given CRCs. Returns false if anything doesn't check out, in
+ * which case the peer should be asked for a full savestate.
+ */
+bool netplay_delta_state_decode(netplay_t *netplay,
+      struct delta_frame *base, uint32_t base_crc,
+      const uint8_t *patch, size_t patch_size,
+      uint32_t state_crc, void *state);
+
 /**
  * netplay_input_state_for
  *
@@ -817,6 +925,17 @@ void netplay_hangup(netplay_t *netplay, struct netplay_connection *connection);
  */
 void netplay_delayed_state_change(netplay_t *netplay);
 
+/**
+ * netplay_input_received
+ *
+ * Finish receiving a frame of input from the given client, once it has been
+ * copied into the frame: mark it as read, advance past it, and forward it on
+ * if we're the server.
+ */
+void netplay_input_received(netplay_t *netplay,
+   struct netplay_connection *connection, struct delta_frame *dframe,
+   uint32_t client_num);
+
 /**
  * netplay_send_cur_input
  *
@@ -862,6 +981,14 @@ bool netplay_cmd_crc(netplay_t *netplay, struct delta_frame *delta);
  */
 bool netplay_cmd_request_savestate(netplay_t *netplay);
 
+/**
+ * netplay_cmd_request_full_savestate
+ *
+ * Send a savestate request command, asking for a full savestate rather than
+ * a delta.
+ */
+bool netplay_cmd_request_full_savestate(netplay_t *netplay);
+
 /**
  * netplay_cmd_mode
  *
@@ -977,4 +1104,47 @@ bool netplay_sync_pre_frame(netplay_t *netplay);
  */
 void netplay_sync_post_frame(netplay_t *netplay, bool stalled);
 
+/***************************************************************
+ * NETPLAY-UDP.C
+ **************************************************************/
+
+/**
+ * netplay_udp_init_server
+ *
+ * Open the server's UDP input socket, on the same port as the TCP socket.
+ */
+bool netplay_udp_init_server(netplay_t *netplay, uint16_t port);
+
+/**
+ * netplay_udp_init_client
+ *
+ * Open the client's UDP input socket, aimed at the server, using the token
+ * the server sent us.
+ */
+bool netplay_udp_init_client(netplay_t *netplay,
+   struct netplay_connection *connection, uint32_t token);
+
+/**
+ * netplay_udp_deinit
+ *
+ * Close the UDP input socket.
+ */
+void netplay_udp_deinit(netplay_t *netplay);
+
+/**
+ * netplay_udp_send_input
+ *
+ * Send our input for the current frame and the frames before it over UDP.
+ */
+void netplay_udp_send_input(netplay_t *netplay,
+   struct netplay_connection *connection);
+
+/**
+ * netplay_udp_poll
+ *
+ * Read whatever input datagrams have arrived, into the frames' UDP input.
+ * Returns true if any of them had new input.
+ */
+bool netplay_udp_poll(netplay_t *netplay);
+
 #endif
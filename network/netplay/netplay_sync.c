@@ -352,6 +352,7 @@ bool netplay_resolve_input(netplay_t *netplay, size_t sim_ptr, bool resim)
    netplay_input_state_t simstate, client_state = NULL,
                          resstate, oldresstate, pstate;
    bool ret                     = false;
+   bool from_udp                = false;
    struct delta_frame *pframe   = NULL;
    struct delta_frame *simframe = &netplay->buffer[sim_ptr];
 
@@ -388,13 +389,20 @@ bool netplay_resolve_input(netplay_t *netplay, size_t sim_ptr, bool resim)
             if (!simstate)
                continue;
 
-            prev = PREV_PTR(netplay->read_ptr[client]);
-            pframe = &netplay->buffer[prev];
-            pstate = netplay_input_state_for(&pframe->real_input[device], client, dsize, false, true);
+            /* Input that came in over UDP beats a guess. The real input
+             * will confirm it, or cause a replay like any bad guess. */
+            pstate = netplay_input_state_for(&simframe->udp_input[device], client, dsize, false, true);
+            from_udp = (pstate != NULL);
+            if (!from_udp)
+            {
+               prev = PREV_PTR(netplay->read_ptr[client]);
+               pframe = &netplay->buffer[prev];
+               pstate = netplay_input_state_for(&pframe->real_input[device], client, dsize, false, true);
+            }
             if (!pstate)
                continue;
 
-            if (resim && (dtype == RETRO_DEVICE_JOYPAD || dtype == RETRO_DEVICE_ANALOG))
+            if (resim && !from_udp && (dtype == RETRO_DEVICE_JOYPAD || dtype == RETRO_DEVICE_ANALOG))
             {
                /* In resimulation mode, we only copy the buttons. The reason for this
                 * is nonobvious:
@@ -0,0 +1,505 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2016-2017 - Gregor Richards
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Input over UDP. Each datagram carries the sender's input for its last few
+ * frames, so any one datagram that gets through fills in every frame lost
+ * before it. The same input is still sent over TCP, which remains the only
+ * thing that advances the read pointers. Input from UDP is kept aside in the
+ * frame and used instead of a guess when the frame has to be simulated; when
+ * the TCP copy arrives, it is checked like any other simulated input, and a
+ * mismatch is replayed. See network/netplay/README. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <net/net_compat.h>
+#include <net/net_socket.h>
+#include <retro_miscellaneous.h>
+
+#include "netplay_private.h"
+
+#if defined(AF_INET6) && !defined(HAVE_SOCKET_LEGACY)
+#define HAVE_INET6 1
+#endif
+
+#define NETPLAY_UDP_HEADER_WORDS 5
+#define NETPLAY_UDP_MAX_WORDS    (NETPLAY_UDP_HEADER_WORDS + \
+      NETPLAY_UDP_INPUT_FRAMES * NETPLAY_UDP_MAX_INPUT_WORDS)
+
+/* Datagrams held back by the simulated latency */
+#define NETPLAY_UDP_DELAY_QUEUE_SIZE 64
+
+struct netplay_udp_delayed
+{
+   retro_time_t due;
+   size_t connection;
+   size_t len;
+   uint32_t buf[NETPLAY_UDP_MAX_WORDS];
+};
+
+static void netplay_udp_delay_flush(netplay_t *netplay)
+{
+   retro_time_t now = cpu_features_get_time_usec();
+
+   while (netplay->udp_delay_tail != netplay->udp_delay_head)
+   {
+      struct netplay_connection *connection;
+      struct netplay_udp_delayed *d = &netplay->udp_delay_queue[
+         netplay->udp_delay_tail % NETPLAY_UDP_DELAY_QUEUE_SIZE];
+      if (d->due > now)
+         break;
+      netplay->udp_delay_tail++;
+
+      if (d->connection >= netplay->connections_size)
+         continue;
+      connection = &netplay->connections[d->connection];
+      if (connection->active && connection->udp_ready)
+         sendto(netplay->udp_fd, (const char*)d->buf, d->len, 0,
+               (struct sockaddr*)&connection->udp_addr,
+               connection->udp_addr_len);
+   }
+}
+
+static void netplay_udp_sendto(netplay_t *netplay,
+      struct netplay_connection *connection,
+      const uint32_t *buf, size_t len)
+{
+   /* Simulated loss and latency, set with netplay_udp_sim_loss and
+    * netplay_udp_sim_latency in the configuration */
+   if (netplay->udp_sim_loss && (unsigned)(rand() % 100) < netplay->udp_sim_loss)
+      return;
+
+   if (netplay->udp_delay_queue)
+   {
+      if (netplay->udp_delay_head - netplay->udp_delay_tail <
+            NETPLAY_UDP_DELAY_QUEUE_SIZE)
+      {
+         struct netplay_udp_delayed *d = &netplay->udp_delay_queue[
+            netplay->udp_delay_head % NETPLAY_UDP_DELAY_QUEUE_SIZE];
+         d->due        = cpu_features_get_time_usec() +
+            (retro_time_t)netplay->udp_sim_latency * 1000;
+         d->connection = connection - netplay->connections;
+         d->len        = len;
+         memcpy(d->buf, buf, len);
+         netplay->udp_delay_head++;
+      }
+      netplay_udp_delay_flush(netplay);
+      return;
+   }
+
+   /* Best effort: if it doesn't go out, TCP still has it */
+   sendto(netplay->udp_fd, (const char*)buf, len, 0,
+         (struct sockaddr*)&connection->udp_addr, connection->udp_addr_len);
+}
+
+static int netplay_udp_socket(int family)
+{
+   int fd = socket(family, SOCK_DGRAM, 0);
+
+   if (fd < 0)
+      return -1;
+
+#if defined(F_SETFD) && defined(FD_CLOEXEC)
+   fcntl(fd, F_SETFD, FD_CLOEXEC);
+#endif
+
+   if (!socket_nonblock(fd))
+   {
+      socket_close(fd);
+      return -1;
+   }
+
+   return fd;
+}
+
+/* Set up the simulated loss and latency, if asked for */
+static void netplay_udp_sim_init(netplay_t *netplay)
+{
+   if (!netplay->udp_sim_loss && !netplay->udp_sim_latency)
+      return;
+
+   RARCH_WARN("[netplay] Simulating %u%% loss and %u ms latency on UDP input.\n",
+         netplay->udp_sim_loss, netplay->udp_sim_latency);
+
+   if (netplay->udp_sim_latency && !netplay->udp_delay_queue)
+      netplay->udp_delay_queue = (struct netplay_udp_delayed*)calloc(
+            NETPLAY_UDP_DELAY_QUEUE_SIZE, sizeof(*netplay->udp_delay_queue));
+}
+
+/**
+ * netplay_udp_init_server
+ * @netplay              : pointer to netplay object
+ * @port                 : port the TCP socket is listening on
+ *
+ * Open the server's UDP input socket, on the same port as the TCP socket.
+ * Failure isn't fatal, clients will simply use TCP alone.
+ *
+ * Returns: true if the socket is open.
+ */
+bool netplay_udp_init_server(netplay_t *netplay, uint16_t port)
+{
+   char port_buf[16];
+   struct addrinfo hints          = {0};
+   struct addrinfo *res           = NULL;
+   const struct addrinfo *tmp_info;
+
+   snprintf(port_buf, sizeof(port_buf), "%hu", (unsigned short)port);
+   hints.ai_socktype = SOCK_DGRAM;
+   hints.ai_flags    = AI_PASSIVE;
+#ifdef HAVE_INET6
+   /* Same as TCP, serve IPv6 and IPv4 from one socket if we can */
+   hints.ai_family   = AF_INET6;
+   if (getaddrinfo_retro(NULL, port_buf, &hints, &res) != 0)
+   {
+      hints.ai_family = 0;
+      res             = NULL;
+#endif
+      if (getaddrinfo_retro(NULL, port_buf, &hints, &res) != 0)
+         res = NULL;
+#ifdef HAVE_INET6
+   }
+#endif
+
+   for (tmp_info = res; tmp_info; tmp_info = tmp_info->ai_next)
+   {
+      int fd = netplay_udp_socket(tmp_info->ai_family);
+      if (fd < 0)
+         continue;
+
+#if defined(HAVE_INET6) && defined(IPPROTO_IPV6) && defined(IPV6_V6ONLY)
+      if (tmp_info->ai_family == AF_INET6)
+      {
+         int on = 0;
+         setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, (const char*)&on,
+               sizeof(on));
+      }
+#endif
+
+      if (socket_bind(fd, (void*)tmp_info))
+      {
+         netplay->udp_fd = fd;
+         break;
+      }
+
+      socket_close(fd);
+   }
+
+   if (res)
+      freeaddrinfo_retro(res);
+
+   if (netplay->udp_fd < 0)
+   {
+      RARCH_WARN("[netplay] Could not open UDP input socket, using TCP only.\n");
+      return false;
+   }
+
+   netplay_udp_sim_init(netplay);
+   return true;
+}
+
+/**
+ * netplay_udp_init_client
+ * @netplay              : pointer to netplay object
+ * @connection           : connection to the server
+ * @token                : token the server gave us for this connection
+ *
+ * Open the client's UDP input socket, aimed at the server's address, and say
+ * hello so that the server learns where to send its input.
+ *
+ * Returns: true if UDP input is ready to use.
+ */
+bool netplay_udp_init_client(netplay_t *netplay,
+      struct netplay_connection *connection, uint32_t token)
+{
+   uint32_t hello[NETPLAY_UDP_HEADER_WORDS];
+   socklen_t addr_len = sizeof(connection->udp_addr);
+
+   connection->udp_token = token;
+
+   if (netplay->udp_fd < 0)
+   {
+      if (getpeername(connection->fd,
+               (struct sockaddr*)&connection->udp_addr, &addr_len) < 0)
+         return false;
+      connection->udp_addr_len = addr_len;
+
+      netplay->udp_fd = netplay_udp_socket(
+            connection->udp_addr.ss_family);
+      if (netplay->udp_fd < 0)
+      {
+         RARCH_WARN("[netplay] Could not open UDP input socket, using TCP only.\n");
+         return false;
+      }
+
+      netplay_udp_sim_init(netplay);
+   }
+
+   connection->udp_ready = true;
+
+   /* An empty input datagram */
+   hello[0] = htonl(token);
+   hello[1] = htonl(netplay->self_client_num);
+   hello[2] = htonl(netplay->self_frame_count);
+   hello[3] = 0;
+   hello[4] = 0;
+   netplay_udp_sendto(netplay, connection, hello, sizeof(hello));
+
+   return true;
+}
+
+/**
+ * netplay_udp_deinit
+ * @netplay              : pointer to netplay object
+ *
+ * Close the UDP input socket.
+ */
+void netplay_udp_deinit(netplay_t *netplay)
+{
+   if (netplay->udp_fd >= 0)
+      socket_close(netplay->udp_fd);
+   netplay->udp_fd = -1;
+
+   free(netplay->udp_delay_queue);
+   netplay->udp_delay_queue = NULL;
+   netplay->udp_delay_head  = netplay->udp_delay_tail = 0;
+}
+
+/* Gather one frame of our own input, in the same layout as NETPLAY_CMD_INPUT */
+static bool netplay_udp_gather_input(netplay_t *netplay,
+      struct delta_frame *dframe, uint32_t devices, uint32_t *out)
+{
+   uint32_t device, i;
+   uint32_t client_num = netplay->self_client_num;
+
+   for (device = 0; device < MAX_INPUT_DEVICES; device++)
+   {
+      netplay_input_state_t istate;
+      if (!(devices & (1<<device)))
+         continue;
+      istate = dframe->real_input[device];
+      while (istate && (!istate->used || istate->client_num != client_num))
+         istate = istate->next;
+      if (!istate)
+         return false;
+      for (i = 0; i < istate->size; i++)
+         *out++ = htonl(istate->data[i]);
+   }
+
+   return true;
+}
+
+/**
+ * netplay_udp_send_input
+ * @netplay              : pointer to netplay object
+ * @connection           : connection to send to
+ *
+ * Send our input for the current frame and the frames before it over UDP.
+ */
+void netplay_udp_send_input(netplay_t *netplay,
+      struct netplay_connection *connection)
+{
+   uint32_t buf[NETPLAY_UDP_MAX_WORDS];
+   uint32_t devices = 0, words = 0, frames = 0;
+   size_t ptr       = netplay->self_ptr;
+
+   if (netplay->udp_fd < 0 || !connection->udp_ready)
+      return;
+
+   if (netplay->self_mode == NETPLAY_CONNECTION_PLAYING)
+   {
+      devices = netplay->client_devices[netplay->self_client_num];
+      words   = netplay_expected_input_size(netplay, devices);
+   }
+   if (words > NETPLAY_UDP_MAX_INPUT_WORDS)
+      words = 0;
+
+   /* Newest first, as far back as our input goes */
+   for (; words && frames < NETPLAY_UDP_INPUT_FRAMES; frames++)
+   {
+      struct delta_frame *dframe = &netplay->buffer[ptr];
+      if (!dframe->used ||
+            dframe->frame != netplay->self_frame_count - frames ||
+            !dframe->have_real[netplay->self_client_num] ||
+            !netplay_udp_gather_input(netplay, dframe, devices,
+               buf + NETPLAY_UDP_HEADER_WORDS + frames * words))
+         break;
+      if (dframe->frame == 0)
+      {
+         frames++;
+         break;
+      }
+      ptr = PREV_PTR(ptr);
+   }
+
+   /* With no input to send, clients still remind the server now and then
+    * where to reach them */
+   if (!frames && (netplay->is_server || netplay->self_frame_count % 60))
+      return;
+
+   buf[0] = htonl(connection->udp_token);
+   buf[1] = htonl(netplay->self_client_num);
+   buf[2] = htonl(netplay->self_frame_count);
+   buf[3] = htonl(frames);
+   buf[4] = htonl(words);
+
+   netplay_udp_sendto(netplay, connection, buf,
+         (NETPLAY_UDP_HEADER_WORDS + frames * words) * sizeof(uint32_t));
+}
+
+/* Keep a received datagram's input aside in the frames it is for, until TCP
+ * delivers the real thing. Returns true if it gave us any new input. */
+static bool netplay_udp_apply(netplay_t *netplay, uint32_t client_num,
+      uint32_t newest, uint32_t frames, uint32_t words, const uint32_t *data)
+{
+   uint32_t devices, frame;
+   bool got = false;
+
+   if (client_num >= MAX_CLIENTS ||
+         client_num == netplay->self_client_num ||
+         !(netplay->connected_players & (1<<client_num)))
+      return false;
+
+   devices = netplay->client_devices[client_num];
+   if (words != netplay_expected_input_size(netplay, devices) ||
+         frames > newest + 1)
+      return false;
+
+   /* Oldest first, from wherever TCP has got to */
+   for (frame = newest - (frames - 1); frame <= newest; frame++)
+   {
+      uint32_t device, ahead;
+      struct delta_frame *dframe;
+      const uint32_t *fdata = data + (size_t)(newest - frame) * words;
+
+      if (frame < netplay->read_frame_count[client_num])
+         continue;
+
+      /* Never further ahead than TCP input could be buffered */
+      ahead = frame - netplay->read_frame_count[client_num];
+      if (ahead + 1 >= netplay->buffer_size)
+         break;
+
+      dframe = &netplay->buffer[(netplay->read_ptr[client_num] + ahead) %
+         netplay->buffer_size];
+      if (!netplay_delta_frame_ready(netplay, dframe, frame))
+         break;
+
+      for (device = 0; device < MAX_INPUT_DEVICES; device++)
+      {
+         netplay_input_state_t istate;
+         uint32_t dsize, di;
+         if (!(devices & (1<<device)))
+            continue;
+
+         dsize  = netplay_expected_input_size(netplay, 1 << device);
+         istate = netplay_input_state_for(&dframe->udp_input[device],
+               client_num, dsize, false, false);
+         if (!istate)
+            return got;
+         for (di = 0; di < dsize; di++)
+            istate->data[di] = ntohl(*fdata++);
+      }
+
+      got = true;
+   }
+
+   return got;
+}
+
+/**
+ * netplay_udp_poll
+ * @netplay              : pointer to netplay object
+ *
+ * Read whatever input datagrams have arrived.
+ *
+ * Returns: true if any of them had new input.
+ */
+bool netplay_udp_poll(netplay_t *netplay)
+{
+   uint32_t buf[NETPLAY_UDP_MAX_WORDS];
+   bool got = false;
+
+   if (netplay->udp_fd < 0)
+      return false;
+
+   if (netplay->udp_delay_queue)
+      netplay_udp_delay_flush(netplay);
+
+   for (;;)
+   {
+      struct sockaddr_storage addr;
+      socklen_t addr_len = sizeof(addr);
+      struct netplay_connection *connection = NULL;
+      uint32_t token, client_num, newest, frames, words;
+      size_t i;
+      ssize_t len = recvfrom(netplay->udp_fd, (char*)buf, sizeof(buf), 0,
+            (struct sockaddr*)&addr, &addr_len);
+
+      /* Nothing more, or an error we can't do anything about (TCP will
+       * notice a real disconnection) */
+      if (len < 0)
+         break;
+
+      if ((size_t)len < NETPLAY_UDP_HEADER_WORDS * sizeof(uint32_t))
+         continue;
+
+      token      = ntohl(buf[0]);
+      client_num = ntohl(buf[1]);
+      newest     = ntohl(buf[2]);
+      frames     = ntohl(buf[3]);
+      words      = ntohl(buf[4]);
+
+      for (i = 0; i < netplay->connections_size; i++)
+      {
+         struct netplay_connection *c = &netplay->connections[i];
+         if (c->active && c->udp_supported && c->udp_token == token &&
+               c->mode >= NETPLAY_CONNECTION_CONNECTED)
+         {
+            connection = c;
+            break;
+         }
+      }
+      if (!connection)
+         continue;
+
+      if (netplay->is_server)
+      {
+         /* This is where they're reachable from, now */
+         memcpy(&connection->udp_addr, &addr, sizeof(addr));
+         connection->udp_addr_len = addr_len;
+         connection->udp_ready    = true;
+
+         /* Ignore the claimed client #, must be this client */
+         client_num = (uint32_t)(connection - netplay->connections + 1);
+      }
+
+      if (frames > NETPLAY_UDP_INPUT_FRAMES ||
+            words > NETPLAY_UDP_MAX_INPUT_WORDS ||
+            (size_t)len != (NETPLAY_UDP_HEADER_WORDS + frames * words) *
+               sizeof(uint32_t))
+         continue;
+
+      /* Only input in lockstep with the TCP stream can be used */
+      if (!frames || connection->mode != NETPLAY_CONNECTION_PLAYING)
+         continue;
+
+      if (netplay_udp_apply(netplay, client_num, newest, frames,
+               words, buf + NETPLAY_UDP_HEADER_WORDS))
+         got = true;
+   }
+
+   return got;
+}
@@ -145,8 +145,11 @@ check_lib '' THREAD_STORAGE "$PTHREADLIB" pthread_key_create
 
 if [ "$OS" = 'Linux' ]; then
    check_header CDROM sys/ioctl.h scsi/sg.h
+   check_header IO_URING linux/io_uring.h
 fi
 
+check_platform Linux IO_URING 'io_uring is' true
+
 check_platform 'Linux Win32' CDROM 'CD-ROM is' user
 
 if [ "$OS" = 'Win32' ]; then
@@ -24,7 +24,8 @@
 #include <compat/strl.h>
 
 #include <boolean.h>
-#include <queues/fifo_queue.h>
+#include <retro_math.h>
+#include <retro_miscellaneous.h>
 #include <rthreads/rthreads.h>
 #include <gfx/scaler/scaler.h>
 #include <gfx/video_frame.h>
@@ -39,7 +40,14 @@
 #endif
 
 #ifdef FFEMU_PERF
-#include <time.h>
+#include <features/features_cpu.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <windows.h>
+#define FF_MEMORY_BARRIER() MemoryBarrier()
+#else
+#define FF_MEMORY_BARRIER() __sync_synchronize()
 #endif
 
 #ifdef __cplusplus
@@ -66,6 +74,7 @@ extern "C" {
 #endif
 
 #include "../../configuration.h"
+#include "../../performance_counters.h"
 #include "../../retroarch.h"
 #include "../../verbosity.h"
 
@@ -126,13 +135,46 @@ extern "C" {
 #define av_frame_free avcodec_free_frame
 #endif
 
+#define MAX_FRAMES 32
+
+/* Number of scaled frames in flight between the
+ * conversion and the encoding stage. */
+#define FF_CONV_FRAMES 4
+
+/* Index bookkeeping for the single-producer, single-consumer
+ * rings that connect the recording pipeline stages.
+ * head is only written by the producer, tail only by the
+ * consumer. Both are free-running counters. */
+struct ff_ring_index
+{
+   unsigned count;
+   volatile unsigned head;
+   volatile unsigned tail;
+};
+
+/* A frame scaled to the output size and pixel format,
+ * ready to be handed to the encoder. */
+struct ff_conv_slot
+{
+   AVFrame *frame;
+   uint8_t *buf;
+};
+
+struct ff_conv_ring
+{
+   struct ff_conv_slot *slots;
+   struct ff_ring_index idx;
+};
+
 struct ff_video_info
 {
    AVCodecContext *codec;
    AVCodec *encoder;
 
-   AVFrame *conv_frame;
-   uint8_t *conv_frame_buf;
+   struct ff_conv_ring conv_ring;
+   /* Last frame written by the conversion stage,
+    * repeated for dupes. */
+   AVFrame *last_conv;
    int64_t frame_cnt;
 
    uint8_t *outbuf;
@@ -202,6 +244,80 @@ struct ff_muxer_info
    AVStream *vstream;
 };
 
+/* What the emulation thread does when the encoder
+ * thread falls behind and the queues are full. */
+enum ff_queue_policy
+{
+   /* Drop the frame and count it. Never stalls the caller.
+    * Dropped video is encoded as dupes and dropped audio
+    * as silence, so the streams stay in sync. */
+   FF_QUEUE_POLICY_DROP = 0,
+   /* Wait for the encoder to free up a slot. */
+   FF_QUEUE_POLICY_BLOCK
+};
+
+/* A preallocated video frame, tightly packed. */
+struct ff_video_slot
+{
+   struct record_video_data attr;
+   uint8_t *buf;
+   /* Frames dropped right before this one, encoded as
+    * dupes so the output keeps its timing. */
+   unsigned skipped;
+};
+
+/* Raw frames queued by the emulation thread. */
+struct ff_video_ring
+{
+   struct ff_video_slot *slots;
+   size_t slot_size;
+   struct ff_ring_index idx;
+};
+
+/* Single-producer, single-consumer byte ring for audio.
+ * size is a power of two so the free-running counters
+ * stay consistent when they wrap. */
+struct ff_audio_ring
+{
+   uint8_t *buffer;
+   size_t size;
+   volatile size_t head;
+   volatile size_t tail;
+};
+
+struct ff_queue_stats
+{
+   unsigned video_dropped;
+   unsigned video_depth_max;
+   size_t audio_dropped;
+   size_t audio_depth_max;
+};
+
+/* Queue statistics as frontend perf counters, listed with the others
+ * when performance counters are enabled. The queue counters add up
+ * the depth after every push, so their average is the mean depth
+ * (frames for video, bytes for audio). The dropped counters count one
+ * call per dropped video/audio frame. push_stall is the time the
+ * emulation thread waited for room with the block policy. */
+static struct retro_perf_counter ff_perf_video_queue   = {0};
+static struct retro_perf_counter ff_perf_audio_queue   = {0};
+static struct retro_perf_counter ff_perf_video_dropped = {0};
+static struct retro_perf_counter ff_perf_audio_dropped = {0};
+static struct retro_perf_counter ff_perf_push_stall    = {0};
+
+#ifdef FFEMU_PERF
+/* Time spent in each pipeline stage, for measuring throughput. */
+struct ff_perf_stats
+{
+   retro_time_t video_usec;
+   retro_time_t encode_usec;
+   retro_time_t audio_usec;
+   unsigned video_frames;
+   unsigned encode_frames;
+   unsigned audio_blocks;
+};
+#endif
+
 struct ff_config_param
 {
    config_file_t *conf;
@@ -212,6 +328,10 @@ struct ff_config_param
    unsigned threads;
    unsigned frame_drop_ratio;
    unsigned sample_rate;
+   unsigned queue_frames;
+   enum ff_queue_policy queue_policy;
+   /* FF_THREAD_FRAME and/or FF_THREAD_SLICE, 0 for the codec default. */
+   int thread_type;
    float scale_factor;
 
    bool audio_enable;
@@ -236,16 +356,36 @@ typedef struct ffmpeg
 
    struct record_params params;
 
-   scond_t *cond;
+   /* The recording pipeline runs in three stages:
+    * video scaling/colour conversion, video encoding and
+    * audio resampling/encoding, each on its own thread.
+    * Every stage sleeps on its own condition variable. */
+   scond_t *video_cond;
+   scond_t *encode_cond;
+   scond_t *audio_cond;
+   /* Wakes up the emulation thread when a slot is freed.
+    * Only waited on with FF_QUEUE_POLICY_BLOCK. */
+   scond_t *space_cond;
    slock_t *cond_lock;
-   slock_t *lock;
-   fifo_buffer_t *audio_fifo;
-   fifo_buffer_t *video_fifo;
-   fifo_buffer_t *attr_fifo;
-   sthread_t *thread;
+   /* Serializes access to the muxer between the video
+    * and audio encoding stages. */
+   slock_t *mux_lock;
+   struct ff_video_ring video_ring;
+   struct ff_audio_ring audio_ring;
+   struct ff_queue_stats stats;
+#ifdef FFEMU_PERF
+   struct ff_perf_stats perf;
+#endif
+   unsigned video_skipped;
+   /* Bytes of audio dropped on a full queue and not yet
+    * queued again as silence. */
+   size_t audio_skipped;
+   bool perfcnt_enable;
+   sthread_t *video_thread;
+   sthread_t *encode_thread;
+   sthread_t *audio_thread;
 
    volatile bool alive;
-   volatile bool can_sleep;
 } ffmpeg_t;
 
 AVFormatContext *ctx;
@@ -423,6 +563,7 @@ static bool ffmpeg_init_audio(ffmpeg_t *handle)
 
 static bool ffmpeg_init_video(ffmpeg_t *handle)
 {
+   unsigned i;
    size_t size;
    struct ff_config_param *params  = &handle->config;
    struct ff_video_info *video     = &handle->video;
@@ -522,6 +663,8 @@ static bool ffmpeg_init_video(ffmpeg_t *handle)
    video->codec->pix_fmt             = video->pix_fmt;
 
    video->codec->thread_count = params->threads;
+   if (params->thread_type)
+      video->codec->thread_type = params->thread_type;
 
    if (params->video_qscale)
    {
@@ -547,15 +690,29 @@ static bool ffmpeg_init_video(ffmpeg_t *handle)
 
    size = avpicture_get_size(video->pix_fmt, param->out_width,
          param->out_height);
-   video->conv_frame_buf = (uint8_t*)av_malloc(size);
-   video->conv_frame = av_frame_alloc();
 
-   avpicture_fill((AVPicture*)video->conv_frame, video->conv_frame_buf,
-         video->pix_fmt, param->out_width, param->out_height);
+   video->conv_ring.slots = (struct ff_conv_slot*)
+      calloc(FF_CONV_FRAMES, sizeof(*video->conv_ring.slots));
+   if (!video->conv_ring.slots)
+      return false;
+   video->conv_ring.idx.count = FF_CONV_FRAMES;
+
+   for (i = 0; i < FF_CONV_FRAMES; i++)
+   {
+      struct ff_conv_slot *slot = &video->conv_ring.slots[i];
+
+      slot->buf   = (uint8_t*)av_mallocz(size);
+      slot->frame = av_frame_alloc();
+      if (!slot->buf || !slot->frame)
+         return false;
+
+      avpicture_fill((AVPicture*)slot->frame, slot->buf,
+            video->pix_fmt, param->out_width, param->out_height);
 
-   video->conv_frame->width  = param->out_width;
-   video->conv_frame->height = param->out_height;
-   video->conv_frame->format = video->pix_fmt;
+      slot->frame->width  = param->out_width;
+      slot->frame->height = param->out_height;
+      slot->frame->format = video->pix_fmt;
+   }
 
    return true;
 }
@@ -713,6 +870,16 @@ static bool ffmpeg_init_config_common(struct ff_config_param *params, unsigned p
          break;
    }
 
+   params->queue_frames = MAX_FRAMES;
+   params->queue_policy = FF_QUEUE_POLICY_DROP;
+
+   /* Frame threading scales best, but every extra thread
+    * delays output by a frame, which streams can't afford. */
+   if (preset >= RECORD_CONFIG_TYPE_STREAMING_CUSTOM)
+      params->thread_type = FF_THREAD_SLICE;
+   else
+      params->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
    if (preset <= RECORD_CONFIG_TYPE_RECORDING_LOSSLESS_QUALITY)
    {
       if (!settings->bools.video_gpu_record)
@@ -790,11 +957,15 @@ static bool ffmpeg_init_config(struct ff_config_param *params,
 {
    struct config_file_entry entry;
    char pix_fmt[64]         = {0};
+   char queue_policy[64]    = {0};
+   char thread_type[64]     = {0};
 
    params->out_pix_fmt      = PIX_FMT_NONE;
    params->scale_factor     = 1;
    params->threads          = 1;
    params->frame_drop_ratio = 1;
+   params->queue_frames     = MAX_FRAMES;
+   params->queue_policy     = FF_QUEUE_POLICY_DROP;
    params->audio_enable     = true;
 
    if (!config)
@@ -817,6 +988,22 @@ static bool ffmpeg_init_config(struct ff_config_param *params,
 
    config_get_uint(params->conf, "threads", &params->threads);
 
+   if (config_get_array(params->conf, "thread_type",
+            thread_type, sizeof(thread_type)))
+   {
+      if (string_is_equal(thread_type, "frame"))
+         params->thread_type = FF_THREAD_FRAME;
+      else if (string_is_equal(thread_type, "slice"))
+         params->thread_type = FF_THREAD_SLICE;
+      else if (string_is_equal(thread_type, "frame+slice"))
+         params->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+      else
+      {
+         RARCH_ERR("[FFmpeg] Unknown thread_type \"%s\".\n", thread_type);
+         return false;
+      }
+   }
+
    if (!config_get_uint(params->conf, "frame_drop_ratio",
             &params->frame_drop_ratio) || !params->frame_drop_ratio)
       params->frame_drop_ratio = 1;
@@ -827,6 +1014,24 @@ static bool ffmpeg_init_config(struct ff_config_param *params,
    config_get_uint(params->conf, "sample_rate", &params->sample_rate);
    config_get_float(params->conf, "scale_factor", &params->scale_factor);
 
+   if (!config_get_uint(params->conf, "queue_frames",
+            &params->queue_frames) || params->queue_frames < 2)
+      params->queue_frames = MAX_FRAMES;
+
+   if (config_get_array(params->conf, "queue_policy",
+            queue_policy, sizeof(queue_policy)))
+   {
+      if (string_is_equal(queue_policy, "block"))
+         params->queue_policy = FF_QUEUE_POLICY_BLOCK;
+      else if (string_is_equal(queue_policy, "drop"))
+         params->queue_policy = FF_QUEUE_POLICY_DROP;
+      else
+      {
+         RARCH_ERR("[FFmpeg] Unknown queue_policy \"%s\".\n", queue_policy);
+         return false;
+      }
+   }
+
    params->audio_qscale = config_get_int(params->conf, "audio_global_quality",
          &params->audio_global_quality);
    config_get_int(params->conf, "audio_bit_rate", &params->audio_bit_rate);
@@ -913,71 +1118,243 @@ static bool ffmpeg_init_muxer_post(ffmpeg_t *handle)
    return avformat_write_header(handle->muxer.ctx, NULL) >= 0;
 }
 
-#define MAX_FRAMES 32
+/* Upper bound on how long either side sleeps when a
+ * wakeup is missed. Producers never take a lock to signal. */
+#define FF_WAIT_TIMEOUT_USEC 10000
 
-static void ffmpeg_thread(void *data);
+static INLINE unsigned ff_ring_depth(const struct ff_ring_index *idx)
+{
+   return idx->head - idx->tail;
+}
+
+/* Producer side. Returns the next free slot, or -1 if full. */
+static int ff_ring_acquire(const struct ff_ring_index *idx)
+{
+   if (ff_ring_depth(idx) >= idx->count)
+      return -1;
+   /* Don't touch the slot before we've seen the consumer release it. */
+   FF_MEMORY_BARRIER();
+   return idx->head % idx->count;
+}
+
+static void ff_ring_publish(struct ff_ring_index *idx)
+{
+   FF_MEMORY_BARRIER();
+   idx->head++;
+}
+
+/* Consumer side. Returns the oldest queued slot, or -1 if empty. */
+static int ff_ring_peek(const struct ff_ring_index *idx)
+{
+   if (idx->head == idx->tail)
+      return -1;
+   FF_MEMORY_BARRIER();
+   return idx->tail % idx->count;
+}
+
+static void ff_ring_release(struct ff_ring_index *idx)
+{
+   FF_MEMORY_BARRIER();
+   idx->tail++;
+}
+
+static void ff_video_ring_free(struct ff_video_ring *ring)
+{
+   unsigned i;
+
+   if (!ring->slots)
+      return;
+
+   for (i = 0; i < ring->idx.count; i++)
+      av_free(ring->slots[i].buf);
+
+   free(ring->slots);
+   ring->slots     = NULL;
+   ring->idx.count = 0;
+}
+
+static bool ff_video_ring_init(struct ff_video_ring *ring,
+      unsigned count, size_t slot_size, size_t padding)
+{
+   unsigned i;
+
+   ring->slots = (struct ff_video_slot*)calloc(count, sizeof(*ring->slots));
+   if (!ring->slots)
+      return false;
+
+   ring->slot_size = slot_size;
+   ring->idx.count = count;
+   ring->idx.head  = 0;
+   ring->idx.tail  = 0;
+
+   for (i = 0; i < count; i++)
+   {
+      ring->slots[i].buf = (uint8_t*)av_malloc(slot_size + padding);
+      if (!ring->slots[i].buf)
+      {
+         ff_video_ring_free(ring);
+         return false;
+      }
+   }
+
+   return true;
+}
+
+static bool ff_audio_ring_init(struct ff_audio_ring *ring, size_t size)
+{
+   ring->size   = next_pow2((uint32_t)size);
+   ring->head   = 0;
+   ring->tail   = 0;
+   ring->buffer = (uint8_t*)malloc(ring->size);
+   return ring->buffer != NULL;
+}
+
+static void ff_audio_ring_free(struct ff_audio_ring *ring)
+{
+   free(ring->buffer);
+   ring->buffer = NULL;
+   ring->size   = 0;
+}
+
+static INLINE size_t ff_audio_ring_read_avail(const struct ff_audio_ring *ring)
+{
+   return ring->head - ring->tail;
+}
+
+static INLINE size_t ff_audio_ring_write_avail(const struct ff_audio_ring *ring)
+{
+   return ring->size - (ring->head - ring->tail);
+}
+
+/* Caller must have checked ff_audio_ring_write_avail(). */
+static void ff_audio_ring_write(struct ff_audio_ring *ring,
+      const void *in_buf, size_t size)
+{
+   size_t pos   = ring->head & (ring->size - 1);
+   size_t first = MIN(size, ring->size - pos);
+
+   FF_MEMORY_BARRIER();
+   memcpy(ring->buffer + pos, in_buf, first);
+   memcpy(ring->buffer, (const uint8_t*)in_buf + first, size - first);
+   FF_MEMORY_BARRIER();
+   ring->head += size;
+}
+
+/* Caller must have checked ff_audio_ring_write_avail(). */
+static void ff_audio_ring_write_silence(struct ff_audio_ring *ring,
+      size_t size)
+{
+   size_t pos   = ring->head & (ring->size - 1);
+   size_t first = MIN(size, ring->size - pos);
+
+   FF_MEMORY_BARRIER();
+   memset(ring->buffer + pos, 0, first);
+   memset(ring->buffer, 0, size - first);
+   FF_MEMORY_BARRIER();
+   ring->head += size;
+}
+
+/* Caller must have checked ff_audio_ring_read_avail(). */
+static void ff_audio_ring_read(struct ff_audio_ring *ring,
+      void *out_buf, size_t size)
+{
+   size_t pos   = ring->tail & (ring->size - 1);
+   size_t first = MIN(size, ring->size - pos);
+
+   FF_MEMORY_BARRIER();
+   memcpy(out_buf, ring->buffer + pos, first);
+   memcpy((uint8_t*)out_buf + first, ring->buffer, size - first);
+   FF_MEMORY_BARRIER();
+   ring->tail += size;
+}
+
+static void ffmpeg_video_thread(void *data);
+static void ffmpeg_encode_thread(void *data);
+static void ffmpeg_audio_thread(void *data);
 
 static bool init_thread(ffmpeg_t *handle)
 {
-   handle->lock = slock_new();
-   handle->cond_lock = slock_new();
-   handle->cond = scond_new();
-   handle->audio_fifo = fifo_new(32000 * sizeof(int16_t) *
-         handle->params.channels * MAX_FRAMES / 60); /* Some arbitrary max size. */
-   handle->attr_fifo = fifo_new(sizeof(struct record_video_data) * MAX_FRAMES);
-   handle->video_fifo = fifo_new(handle->params.fb_width * handle->params.fb_height *
-            handle->video.pix_size * MAX_FRAMES);
+   size_t pitch     = handle->params.fb_width * handle->video.pix_size;
+   size_t slot_size = pitch * handle->params.fb_height;
+
+   handle->cond_lock   = slock_new();
+   handle->mux_lock    = slock_new();
+   handle->video_cond  = scond_new();
+   handle->encode_cond = scond_new();
+   handle->audio_cond  = scond_new();
+   handle->space_cond  = scond_new();
+
+   /* For some reason, FFmpeg has a tendency to crash
+    * if we don't overallocate a bit. */
+   if (!ff_video_ring_init(&handle->video_ring,
+            handle->config.queue_frames, slot_size, pitch + 64))
+      return false;
+
+   /* Some arbitrary max size. */
+   if (!ff_audio_ring_init(&handle->audio_ring,
+            32000 * sizeof(int16_t) * handle->params.channels
+            * handle->config.queue_frames / 60))
+      return false;
 
-   handle->alive = true;
-   handle->can_sleep = true;
-   handle->thread = sthread_create(ffmpeg_thread, handle);
+   handle->alive         = true;
+   handle->video_thread  = sthread_create(ffmpeg_video_thread, handle);
+   handle->encode_thread = sthread_create(ffmpeg_encode_thread, handle);
+   if (handle->config.audio_enable)
+      handle->audio_thread = sthread_create(ffmpeg_audio_thread, handle);
 
-   retro_assert(handle->lock && handle->cond_lock &&
-      handle->cond && handle->audio_fifo &&
-      handle->attr_fifo && handle->video_fifo && handle->thread);
+   retro_assert(handle->cond_lock && handle->mux_lock &&
+      handle->video_cond && handle->encode_cond &&
+      handle->audio_cond && handle->space_cond &&
+      handle->video_thread && handle->encode_thread &&
+      (handle->audio_thread || !handle->config.audio_enable));
 
    return true;
 }
 
 static void deinit_thread(ffmpeg_t *handle)
 {
-   if (!handle->thread)
+   if (!handle->video_thread)
       return;
 
    slock_lock(handle->cond_lock);
    handle->alive = false;
-   handle->can_sleep = false;
    slock_unlock(handle->cond_lock);
 
-   scond_signal(handle->cond);
-   sthread_join(handle->thread);
+   scond_signal(handle->video_cond);
+   scond_signal(handle->encode_cond);
+   scond_signal(handle->audio_cond);
+   scond_signal(handle->space_cond);
 
-   slock_free(handle->lock);
-   slock_free(handle->cond_lock);
-   scond_free(handle->cond);
+   sthread_join(handle->video_thread);
+   sthread_join(handle->encode_thread);
+   if (handle->audio_thread)
+      sthread_join(handle->audio_thread);
 
-   handle->thread = NULL;
+   handle->video_thread  = NULL;
+   handle->encode_thread = NULL;
+   handle->audio_thread  = NULL;
 }
 
 static void deinit_thread_buf(ffmpeg_t *handle)
 {
-   if (handle->audio_fifo)
-   {
-      fifo_free(handle->audio_fifo);
-      handle->audio_fifo = NULL;
-   }
+   ff_video_ring_free(&handle->video_ring);
+   ff_audio_ring_free(&handle->audio_ring);
 
-   if (handle->attr_fifo)
-   {
-      fifo_free(handle->attr_fifo);
-      handle->attr_fifo = NULL;
-   }
-
-   if (handle->video_fifo)
-   {
-      fifo_free(handle->video_fifo);
-      handle->video_fifo = NULL;
-   }
+   /* Kept alive until now, the final flush
+    * runs the pipeline stages on the caller's thread. */
+   slock_free(handle->cond_lock);
+   slock_free(handle->mux_lock);
+   scond_free(handle->video_cond);
+   scond_free(handle->encode_cond);
+   scond_free(handle->audio_cond);
+   scond_free(handle->space_cond);
+
+   handle->cond_lock   = NULL;
+   handle->mux_lock    = NULL;
+   handle->video_cond  = NULL;
+   handle->encode_cond = NULL;
+   handle->audio_cond  = NULL;
+   handle->space_cond  = NULL;
 }
 
 static void ffmpeg_free(void *data)
@@ -1003,8 +1380,16 @@ static void ffmpeg_free(void *data)
       av_free(handle->video.codec);
    }
 
-   av_frame_free(&handle->video.conv_frame);
-   av_free(handle->video.conv_frame_buf);
+   if (handle->video.conv_ring.slots)
+   {
+      unsigned i;
+      for (i = 0; i < handle->video.conv_ring.idx.count; i++)
+      {
+         av_frame_free(&handle->video.conv_ring.slots[i].frame);
+         av_free(handle->video.conv_ring.slots[i].buf);
+      }
+      free(handle->video.conv_ring.slots);
+   }
 
    scaler_ctx_gen_reset(&handle->video.scaler);
 
@@ -1066,6 +1451,16 @@ static void *ffmpeg_new(const struct record_params *params)
    if (!init_thread(handle))
       goto error;
 
+   handle->perfcnt_enable = rarch_ctl(RARCH_CTL_IS_PERFCNT_ENABLE, NULL);
+   if (handle->perfcnt_enable)
+   {
+      performance_counter_init(ff_perf_video_queue,   "ffmpeg_video_queue");
+      performance_counter_init(ff_perf_audio_queue,   "ffmpeg_audio_queue");
+      performance_counter_init(ff_perf_video_dropped, "ffmpeg_video_dropped");
+      performance_counter_init(ff_perf_audio_dropped, "ffmpeg_audio_dropped");
+      performance_counter_init(ff_perf_push_stall,    "ffmpeg_push_stall");
+   }
+
    return handle;
 
 error:
@@ -1073,12 +1468,28 @@ error:
    return NULL;
 }
 
+/* Emulation thread side of FF_QUEUE_POLICY_BLOCK: waits for
+ * the pipeline to free up room in the queues. */
+static void ffmpeg_wait_for_space(ffmpeg_t *handle)
+{
+   performance_counter_start_plus(handle->perfcnt_enable,
+         ff_perf_push_stall);
+   slock_lock(handle->cond_lock);
+   if (handle->alive)
+      scond_wait_timeout(handle->space_cond,
+            handle->cond_lock, FF_WAIT_TIMEOUT_USEC);
+   slock_unlock(handle->cond_lock);
+   performance_counter_stop_plus(handle->perfcnt_enable,
+         ff_perf_push_stall);
+}
+
 static bool ffmpeg_push_video(void *data,
       const struct record_video_data *vid)
 {
-   unsigned y;
+   unsigned y, depth;
    bool drop_frame;
-   struct record_video_data attr_data;
+   int slot_idx;
+   struct ff_video_slot *slot;
    ffmpeg_t *handle = (ffmpeg_t*)data;
    int       offset = 0;
 
@@ -1093,59 +1504,88 @@ static bool ffmpeg_push_video(void *data,
    if (drop_frame)
       return true;
 
-   for (;;)
+   while ((slot_idx = ff_ring_acquire(&handle->video_ring.idx)) < 0)
    {
-      unsigned avail;
-      slock_lock(handle->lock);
-      avail = fifo_write_avail(handle->attr_fifo);
-      slock_unlock(handle->lock);
-
       if (!handle->alive)
          return false;
 
-      if (avail >= sizeof(*vid))
-         break;
-
-      slock_lock(handle->cond_lock);
-      if (handle->can_sleep)
+      if (handle->config.queue_policy == FF_QUEUE_POLICY_DROP)
       {
-         handle->can_sleep = false;
-         scond_wait(handle->cond, handle->cond_lock);
-         handle->can_sleep = true;
+         /* The pipeline will emit a dupe in its place. */
+         handle->stats.video_dropped++;
+         handle->video_skipped++;
+         if (handle->perfcnt_enable)
+            ff_perf_video_dropped.call_cnt++;
+         scond_signal(handle->video_cond);
+         return true;
       }
-      else
-         scond_signal(handle->cond);
 
-      slock_unlock(handle->cond_lock);
+      ffmpeg_wait_for_space(handle);
    }
 
-   slock_lock(handle->lock);
+   if (!handle->alive)
+      return false;
+
+   slot = &handle->video_ring.slots[slot_idx];
 
    /* Tightly pack our frame to conserve memory.
     * libretro tends to use a very large pitch.
     */
-   attr_data = *vid;
+   slot->attr            = *vid;
+   slot->attr.data       = slot->buf;
+   slot->skipped         = handle->video_skipped;
+   handle->video_skipped = 0;
 
-   if (attr_data.is_dupe)
-      attr_data.width = attr_data.height = attr_data.pitch = 0;
+   if (slot->attr.is_dupe)
+      slot->attr.width = slot->attr.height = slot->attr.pitch = 0;
    else
-      attr_data.pitch = attr_data.width * handle->video.pix_size;
+      slot->attr.pitch = slot->attr.width * handle->video.pix_size;
+
+   if ((size_t)slot->attr.pitch * slot->attr.height
+         > handle->video_ring.slot_size)
+   {
+      slot->attr.is_dupe = true;
+      slot->attr.width   = slot->attr.height = slot->attr.pitch = 0;
+   }
 
-   fifo_write(handle->attr_fifo, &attr_data, sizeof(attr_data));
+   for (y = 0; y < slot->attr.height; y++, offset += vid->pitch)
+      memcpy(slot->buf + y * slot->attr.pitch,
+            (const uint8_t*)vid->data + offset, slot->attr.pitch);
 
-   for (y = 0; y < attr_data.height; y++, offset += vid->pitch)
-      fifo_write(handle->video_fifo,
-            (const uint8_t*)vid->data + offset, attr_data.pitch);
+   ff_ring_publish(&handle->video_ring.idx);
 
-   slock_unlock(handle->lock);
-   scond_signal(handle->cond);
+   depth = ff_ring_depth(&handle->video_ring.idx);
+   if (depth > handle->stats.video_depth_max)
+      handle->stats.video_depth_max = depth;
+   if (handle->perfcnt_enable)
+   {
+      ff_perf_video_queue.call_cnt++;
+      ff_perf_video_queue.total += depth;
+   }
+
+   scond_signal(handle->video_cond);
 
    return true;
 }
 
+/* Drops @size bytes of audio. The audio PTS only counts what
+ * gets encoded, so the same amount of silence is queued in its
+ * place once there's room again. */
+static void ffmpeg_drop_audio(ffmpeg_t *handle, size_t size,
+      size_t frame_size)
+{
+   handle->audio_skipped       += size;
+   handle->stats.audio_dropped += size / frame_size;
+   if (handle->perfcnt_enable)
+      ff_perf_audio_dropped.call_cnt += size / frame_size;
+   scond_signal(handle->audio_cond);
+}
+
 static bool ffmpeg_push_audio(void *data,
       const struct record_audio_data *audio_data)
 {
+   size_t size, frame_size, chunk_max;
+   const uint8_t *in;
    ffmpeg_t *handle = (ffmpeg_t*)data;
 
    if (!handle || !audio_data)
@@ -1154,39 +1594,65 @@ static bool ffmpeg_push_audio(void *data,
    if (!handle->config.audio_enable)
       return true;
 
-   for (;;)
+   frame_size = handle->params.channels * sizeof(int16_t);
+   size       = audio_data->frames * frame_size;
+   in         = (const uint8_t*)audio_data->data;
+   /* A push larger than the ring would never fit at once,
+    * so it is queued in chunks of whole frames. */
+   chunk_max  = handle->audio_ring.size / frame_size * frame_size;
+
+   if (handle->audio_skipped)
    {
-      unsigned avail;
-      slock_lock(handle->lock);
-      avail = fifo_write_avail(handle->audio_fifo);
-      slock_unlock(handle->lock);
+      size_t silence = MIN(handle->audio_skipped,
+            ff_audio_ring_write_avail(&handle->audio_ring)
+            / frame_size * frame_size);
 
-      if (!handle->alive)
-         return false;
+      ff_audio_ring_write_silence(&handle->audio_ring, silence);
+      handle->audio_skipped -= silence;
 
-      if (avail >= audio_data->frames * handle->params.channels
-            * sizeof(int16_t))
-         break;
+      /* Still behind, this push has to go as well. */
+      if (handle->audio_skipped)
+      {
+         ffmpeg_drop_audio(handle, size, frame_size);
+         return true;
+      }
+   }
+
+   while (size)
+   {
+      size_t depth;
+      size_t chunk = MIN(size, chunk_max);
+
+      while (ff_audio_ring_write_avail(&handle->audio_ring) < chunk)
+      {
+         if (!handle->alive)
+            return false;
 
-      slock_lock(handle->cond_lock);
-      if (handle->can_sleep)
+         if (handle->config.queue_policy == FF_QUEUE_POLICY_DROP)
+         {
+            ffmpeg_drop_audio(handle, size, frame_size);
+            return true;
+         }
+
+         ffmpeg_wait_for_space(handle);
+      }
+
+      ff_audio_ring_write(&handle->audio_ring, in, chunk);
+      in   += chunk;
+      size -= chunk;
+
+      depth = ff_audio_ring_read_avail(&handle->audio_ring);
+      if (depth > handle->stats.audio_depth_max)
+         handle->stats.audio_depth_max = depth;
+      if (handle->perfcnt_enable)
       {
-         handle->can_sleep = false;
-         scond_wait(handle->cond, handle->cond_lock);
-         handle->can_sleep = true;
+         ff_perf_audio_queue.call_cnt++;
+         ff_perf_audio_queue.total += depth;
       }
-      else
-         scond_signal(handle->cond);
 
-      slock_unlock(handle->cond_lock);
+      scond_signal(handle->audio_cond);
    }
 
-   slock_lock(handle->lock);
-   fifo_write(handle->audio_fifo, audio_data->data,
-         audio_data->frames * handle->params.channels * sizeof(int16_t));
-   slock_unlock(handle->lock);
-   scond_signal(handle->cond);
-
    return true;
 }
 
@@ -1226,7 +1692,7 @@ static bool encode_video(ffmpeg_t *handle, AVPacket *pkt, AVFrame *frame)
 }
 
 static void ffmpeg_scale_input(ffmpeg_t *handle,
-      const struct record_video_data *vid)
+      const struct record_video_data *vid, AVFrame *frame)
 {
    /* Attempt to preserve more information if we scale down. */
    bool shrunk = handle->params.out_width < vid->width
@@ -1243,18 +1709,17 @@ static void ffmpeg_scale_input(ffmpeg_t *handle,
             shrunk ? SWS_BILINEAR : SWS_POINT, NULL, NULL, NULL);
 
       sws_scale(handle->video.sws, (const uint8_t* const*)&vid->data,
-            &linesize, 0, vid->height, handle->video.conv_frame->data,
-            handle->video.conv_frame->linesize);
+            &linesize, 0, vid->height, frame->data, frame->linesize);
    }
    else
    {
       video_frame_record_scale(
             &handle->video.scaler,
-            handle->video.conv_frame->data[0],
+            frame->data[0],
             vid->data,
             handle->params.out_width,
             handle->params.out_height,
-            handle->video.conv_frame->linesize[0],
+            frame->linesize[0],
             vid->width,
             vid->height,
             vid->pitch,
@@ -1262,26 +1727,46 @@ static void ffmpeg_scale_input(ffmpeg_t *handle,
    }
 }
 
-static bool ffmpeg_push_video_thread(ffmpeg_t *handle,
-      const struct record_video_data *vid)
+static bool ffmpeg_write_packet(ffmpeg_t *handle, AVPacket *pkt)
 {
-   AVPacket pkt;
+   int ret;
+
+   if (handle->mux_lock)
+      slock_lock(handle->mux_lock);
+   ret = av_interleaved_write_frame(handle->muxer.ctx, pkt);
+   if (handle->mux_lock)
+      slock_unlock(handle->mux_lock);
+
+   return ret >= 0;
+}
+
+/* Conversion stage. A NULL or dupe frame repeats the last one. */
+static void ffmpeg_convert_video(ffmpeg_t *handle,
+      const struct record_video_data *vid, AVFrame *frame)
+{
+   if (vid && !vid->is_dupe)
+      ffmpeg_scale_input(handle, vid, frame);
+   else if (handle->video.last_conv)
+      av_picture_copy((AVPicture*)frame,
+            (const AVPicture*)handle->video.last_conv,
+            handle->video.pix_fmt,
+            handle->params.out_width, handle->params.out_height);
 
-   if (!vid->is_dupe)
-      ffmpeg_scale_input(handle, vid);
+   frame->pts                = handle->video.frame_cnt++;
+   handle->video.last_conv   = frame;
+}
 
-   handle->video.conv_frame->pts = handle->video.frame_cnt;
+/* Encoding stage. */
+static bool ffmpeg_encode_video_frame(ffmpeg_t *handle, AVFrame *frame)
+{
+   AVPacket pkt;
 
-   if (!encode_video(handle, &pkt, handle->video.conv_frame))
+   if (!encode_video(handle, &pkt, frame))
       return false;
 
    if (pkt.size)
-   {
-      if (av_interleaved_write_frame(handle->muxer.ctx, &pkt) < 0)
-         return false;
-   }
+      return ffmpeg_write_packet(handle, &pkt);
 
-   handle->video.frame_cnt++;
    return true;
 }
 
@@ -1506,7 +1991,7 @@ static bool ffmpeg_push_audio_thread(ffmpeg_t *handle,
 
       if (pkt.size)
       {
-         if (av_interleaved_write_frame(handle->muxer.ctx, &pkt) < 0)
+         if (!ffmpeg_write_packet(handle, &pkt))
             return false;
       }
    }
@@ -1517,13 +2002,16 @@ static bool ffmpeg_push_audio_thread(ffmpeg_t *handle,
 static void ffmpeg_flush_audio(ffmpeg_t *handle, void *audio_buf,
       size_t audio_buf_size)
 {
-   size_t avail = fifo_read_avail(handle->audio_fifo);
+   size_t avail = ff_audio_ring_read_avail(&handle->audio_ring);
+
+   if (avail > audio_buf_size)
+      avail = audio_buf_size;
 
    if (avail)
    {
       struct record_audio_data aud = {0};
 
-      fifo_read(handle->audio_fifo, audio_buf, avail);
+      ff_audio_ring_read(&handle->audio_ring, audio_buf, avail);
 
       aud.frames = avail / (sizeof(int16_t) * handle->params.channels);
       aud.data = audio_buf;
@@ -1535,7 +2023,7 @@ static void ffmpeg_flush_audio(ffmpeg_t *handle, void *audio_buf,
    {
       AVPacket pkt;
       if (!encode_audio(handle, &pkt, true) || !pkt.size ||
-            av_interleaved_write_frame(handle->muxer.ctx, &pkt) < 0)
+            !ffmpeg_write_packet(handle, &pkt))
          break;
    }
 }
@@ -1546,16 +2034,99 @@ static void ffmpeg_flush_video(ffmpeg_t *handle)
    {
       AVPacket pkt;
       if (!encode_video(handle, &pkt, NULL) || !pkt.size ||
-            av_interleaved_write_frame(handle->muxer.ctx, &pkt) < 0)
+            !ffmpeg_write_packet(handle, &pkt))
          break;
    }
 }
 
+static INLINE void ffmpeg_signal_space(ffmpeg_t *handle)
+{
+   if (handle->config.queue_policy == FF_QUEUE_POLICY_BLOCK)
+      scond_signal(handle->space_cond);
+}
+
+/* Resamples and encodes one block of queued audio.
+ * Returns true if anything was consumed. */
+static bool ffmpeg_audio_step(ffmpeg_t *handle,
+      void *audio_buf, size_t audio_buf_size)
+{
+   struct record_audio_data aud = {0};
+
+   if (!audio_buf || ff_audio_ring_read_avail(&handle->audio_ring)
+         < audio_buf_size)
+      return false;
+
+   ff_audio_ring_read(&handle->audio_ring, audio_buf, audio_buf_size);
+   ffmpeg_signal_space(handle);
+
+   aud.frames = handle->audio.codec->frame_size;
+   aud.data   = audio_buf;
+
+   ffmpeg_push_audio_thread(handle, &aud, true);
+   return true;
+}
+
+/* Scales one queued raw frame into the conversion ring.
+ * Returns true if anything was consumed. */
+static bool ffmpeg_video_step(ffmpeg_t *handle)
+{
+   struct ff_video_slot *raw;
+   struct ff_conv_ring *conv = &handle->video.conv_ring;
+   int raw_idx               = ff_ring_peek(&handle->video_ring.idx);
+   bool did_work             = false;
+
+   if (raw_idx < 0)
+      return false;
+
+   raw = &handle->video_ring.slots[raw_idx];
+
+   for (;;)
+   {
+      int conv_idx = ff_ring_acquire(&conv->idx);
+
+      /* Encoder is behind, try again once it frees a frame. */
+      if (conv_idx < 0)
+         return did_work;
+
+      /* Frames dropped on a full queue are repeated so
+       * the stream keeps its timing. */
+      ffmpeg_convert_video(handle, raw->skipped ? NULL : &raw->attr,
+            conv->slots[conv_idx].frame);
+
+      ff_ring_publish(&conv->idx);
+      scond_signal(handle->encode_cond);
+      did_work = true;
+
+      if (!raw->skipped)
+         break;
+      raw->skipped--;
+   }
+
+   ff_ring_release(&handle->video_ring.idx);
+   ffmpeg_signal_space(handle);
+   return true;
+}
+
+/* Encodes one converted frame.
+ * Returns true if anything was consumed. */
+static bool ffmpeg_encode_step(ffmpeg_t *handle)
+{
+   struct ff_conv_ring *conv = &handle->video.conv_ring;
+   int conv_idx              = ff_ring_peek(&conv->idx);
+
+   if (conv_idx < 0)
+      return false;
+
+   ffmpeg_encode_video_frame(handle, conv->slots[conv_idx].frame);
+
+   ff_ring_release(&conv->idx);
+   scond_signal(handle->video_cond);
+   return true;
+}
+
 static void ffmpeg_flush_buffers(ffmpeg_t *handle)
 {
    bool did_work;
-   void *video_buf = av_malloc(2 * handle->params.fb_width *
-         handle->params.fb_height * handle->video.pix_size);
    size_t audio_buf_size = handle->config.audio_enable ?
       (handle->audio.codec->frame_size *
        handle->params.channels * sizeof(int16_t)) : 0;
@@ -1563,41 +2134,15 @@ static void ffmpeg_flush_buffers(ffmpeg_t *handle)
 
    if (audio_buf_size)
       audio_buf = av_malloc(audio_buf_size);
-   /* Try pushing data in an interleaving pattern to
-    * ease the work of the muxer a bit. */
 
+   /* Run the pipeline stages on this thread until everything
+    * has been pushed through. Interleave audio and video to
+    * ease the work of the muxer a bit. */
    do
    {
-      struct record_video_data attr_buf;
-
-      did_work = false;
-
-      if (handle->config.audio_enable)
-      {
-         if (fifo_read_avail(handle->audio_fifo) >= audio_buf_size)
-         {
-            struct record_audio_data aud = {0};
-
-            fifo_read(handle->audio_fifo, audio_buf, audio_buf_size);
-
-            aud.frames = handle->audio.codec->frame_size;
-            aud.data = audio_buf;
-
-            ffmpeg_push_audio_thread(handle, &aud, true);
-            did_work = true;
-         }
-      }
-
-      if (fifo_read_avail(handle->attr_fifo) >= sizeof(attr_buf))
-      {
-         fifo_read(handle->attr_fifo, &attr_buf, sizeof(attr_buf));
-         fifo_read(handle->video_fifo, video_buf,
-               attr_buf.height * attr_buf.pitch);
-         attr_buf.data = video_buf;
-         ffmpeg_push_video_thread(handle, &attr_buf);
-
-         did_work = true;
-      }
+      did_work  = ffmpeg_audio_step(handle, audio_buf, audio_buf_size);
+      did_work |= ffmpeg_video_step(handle);
+      did_work |= ffmpeg_encode_step(handle);
    } while (did_work);
 
    /* Flush out last audio. */
@@ -1607,10 +2152,40 @@ static void ffmpeg_flush_buffers(ffmpeg_t *handle)
    /* Flush out last video. */
    ffmpeg_flush_video(handle);
 
-   av_free(video_buf);
    av_free(audio_buf);
 }
 
+#ifdef FFEMU_PERF
+static bool ffmpeg_perf_step(ffmpeg_t *ff, bool (*step)(ffmpeg_t*),
+      retro_time_t *usec, unsigned *count)
+{
+   retro_time_t start = cpu_features_get_time_usec();
+   bool did_work      = step(ff);
+
+   if (did_work)
+   {
+      *usec += cpu_features_get_time_usec() - start;
+      (*count)++;
+   }
+
+   return did_work;
+}
+
+static void ffmpeg_perf_log(ffmpeg_t *handle)
+{
+   struct ff_perf_stats *perf = &handle->perf;
+
+   RARCH_LOG("[FFmpeg]: Convert: %u frames in %.3f s (%.1f fps).\n",
+         perf->video_frames, perf->video_usec / 1000000.0,
+         perf->video_usec ? perf->video_frames * 1000000.0 / perf->video_usec : 0.0);
+   RARCH_LOG("[FFmpeg]: Encode: %u frames in %.3f s (%.1f fps).\n",
+         perf->encode_frames, perf->encode_usec / 1000000.0,
+         perf->encode_usec ? perf->encode_frames * 1000000.0 / perf->encode_usec : 0.0);
+   RARCH_LOG("[FFmpeg]: Audio: %u blocks in %.3f s.\n",
+         perf->audio_blocks, perf->audio_usec / 1000000.0);
+}
+#endif
+
 static bool ffmpeg_finalize(void *data)
 {
    ffmpeg_t *handle = (ffmpeg_t*)data;
@@ -1622,6 +2197,19 @@ static bool ffmpeg_finalize(void *data)
    /* Flush out data still in buffers (internal, and FFmpeg internal). */
    ffmpeg_flush_buffers(handle);
 
+   RARCH_LOG("[FFmpeg]: Dropped %u video frames, %u audio frames. "
+         "Max queue depth: %u/%u video frames, %u/%u audio bytes.\n",
+         handle->stats.video_dropped,
+         (unsigned)handle->stats.audio_dropped,
+         handle->stats.video_depth_max,
+         handle->config.queue_frames,
+         (unsigned)handle->stats.audio_depth_max,
+         (unsigned)handle->audio_ring.size);
+
+#ifdef FFEMU_PERF
+   ffmpeg_perf_log(handle);
+#endif
+
    deinit_thread_buf(handle);
 
    /* Write final data. */
@@ -1632,83 +2220,70 @@ static bool ffmpeg_finalize(void *data)
    return true;
 }
 
-static void ffmpeg_thread(void *data)
+static void ffmpeg_stage_wait(ffmpeg_t *ff, scond_t *cond)
 {
-   size_t audio_buf_size;
-   void *audio_buf = NULL;
-   ffmpeg_t *ff    = (ffmpeg_t*)data;
-   /* For some reason, FFmpeg has a tendency to crash
-    * if we don't overallocate a bit. */
-   void *video_buf = av_malloc(2 * ff->params.fb_width *
-         ff->params.fb_height * ff->video.pix_size);
-
-   retro_assert(video_buf);
+   slock_lock(ff->cond_lock);
+   if (ff->alive)
+      scond_wait_timeout(cond, ff->cond_lock, FF_WAIT_TIMEOUT_USEC);
+   slock_unlock(ff->cond_lock);
+}
 
-   audio_buf_size = ff->config.audio_enable ?
-      (ff->audio.codec->frame_size * ff->params.channels * sizeof(int16_t)) : 0;
-   audio_buf      = audio_buf_size ? av_malloc(audio_buf_size) : NULL;
+static void ffmpeg_video_thread(void *data)
+{
+   ffmpeg_t *ff = (ffmpeg_t*)data;
 
    while (ff->alive)
    {
-      struct record_video_data attr_buf;
-
-      bool avail_video = false;
-      bool avail_audio = false;
-
-      slock_lock(ff->lock);
-      if (fifo_read_avail(ff->attr_fifo) >= sizeof(attr_buf))
-         avail_video = true;
-
-      if (ff->config.audio_enable)
-         if (fifo_read_avail(ff->audio_fifo) >= audio_buf_size)
-            avail_audio = true;
-      slock_unlock(ff->lock);
+#ifdef FFEMU_PERF
+      if (!ffmpeg_perf_step(ff, ffmpeg_video_step,
+               &ff->perf.video_usec, &ff->perf.video_frames))
+#else
+      if (!ffmpeg_video_step(ff))
+#endif
+         ffmpeg_stage_wait(ff, ff->video_cond);
+   }
+}
 
-      if (!avail_video && !avail_audio)
-      {
-         slock_lock(ff->cond_lock);
-         if (ff->can_sleep)
-         {
-            ff->can_sleep = false;
-            scond_wait(ff->cond, ff->cond_lock);
-            ff->can_sleep = true;
-         }
-         else
-            scond_signal(ff->cond);
+static void ffmpeg_encode_thread(void *data)
+{
+   ffmpeg_t *ff = (ffmpeg_t*)data;
 
-         slock_unlock(ff->cond_lock);
-      }
+   while (ff->alive)
+   {
+#ifdef FFEMU_PERF
+      if (!ffmpeg_perf_step(ff, ffmpeg_encode_step,
+               &ff->perf.encode_usec, &ff->perf.encode_frames))
+#else
+      if (!ffmpeg_encode_step(ff))
+#endif
+         ffmpeg_stage_wait(ff, ff->encode_cond);
+   }
+}
 
-      if (avail_video && video_buf)
-      {
-         slock_lock(ff->lock);
-         fifo_read(ff->attr_fifo, &attr_buf, sizeof(attr_buf));
-         fifo_read(ff->video_fifo, video_buf,
-               attr_buf.height * attr_buf.pitch);
-         slock_unlock(ff->lock);
-         scond_signal(ff->cond);
-
-         attr_buf.data = video_buf;
-         ffmpeg_push_video_thread(ff, &attr_buf);
-      }
+static void ffmpeg_audio_thread(void *data)
+{
+   ffmpeg_t *ff          = (ffmpeg_t*)data;
+   size_t audio_buf_size = ff->audio.codec->frame_size
+      * ff->params.channels * sizeof(int16_t);
+   void *audio_buf       = av_malloc(audio_buf_size);
 
-      if (avail_audio && audio_buf)
+   while (ff->alive)
+   {
+#ifdef FFEMU_PERF
+      retro_time_t start = cpu_features_get_time_usec();
+      if (ffmpeg_audio_step(ff, audio_buf, audio_buf_size))
       {
-         struct record_audio_data aud = {0};
-
-         slock_lock(ff->lock);
-         fifo_read(ff->audio_fifo, audio_buf, audio_buf_size);
-         slock_unlock(ff->lock);
-         scond_signal(ff->cond);
-
-         aud.frames = ff->audio.codec->frame_size;
-         aud.data = audio_buf;
-
-         ffmpeg_push_audio_thread(ff, &aud, true);
+         ff->perf.audio_usec += cpu_features_get_time_usec() - start;
+         ff->perf.audio_blocks++;
+         continue;
       }
+#else
+      if (ffmpeg_audio_step(ff, audio_buf, audio_buf_size))
+         continue;
+#endif
+      ffmpeg_stage_wait(ff, ff->audio_cond);
    }
 
-   av_free(video_buf);
    av_free(audio_buf);
 }
 
@@ -871,6 +871,28 @@ static retro_time_t frame_limit_last_time                       = 0.0;
 static retro_time_t libretro_core_runtime_last                  = 0;
 static retro_time_t libretro_core_runtime_usec                  = 0;
 
+/* Automatic frame delay state, see runloop_frame_delay_auto_update(). */
+typedef struct frame_delay_auto
+{
+   retro_time_t frame_start;     /* When the previous frame began */
+   retro_time_t present_usec;    /* Time spent presenting in core_run() */
+   retro_time_t work_peak_usec;  /* Decaying peak of core work per frame */
+   retro_time_t penalty_usec;    /* Extra headroom after missed VSyncs */
+   unsigned delay;               /* Frame delay in milliseconds */
+   unsigned frames_since_miss;
+   unsigned frames_at_target;
+   bool active;
+} frame_delay_auto_t;
+
+static frame_delay_auto_t runloop_frame_delay_auto;
+
+/* Frame timing, visible through the performance counter interface. */
+static struct retro_perf_counter perf_frame_delay               = {0};
+static struct retro_perf_counter perf_core_run                  = {0};
+static struct retro_perf_counter perf_video_present             = {0};
+static struct retro_perf_counter perf_input_to_present          = {0};
+static bool perf_input_to_present_pending                       = false;
+
 static bool has_set_core                                        = false;
 #ifdef HAVE_DISCORD
 bool discord_is_inited                                          = false;
@@ -1211,6 +1233,20 @@ static slock_t *_runloop_msg_queue_lock                         = NULL;
 #define runloop_msg_queue_unlock()
 #endif
 
+/* Producers read the queue pointer without the lock, see
+ * runloop_msg_queue_push_tagged */
+#if defined(__ATOMIC_ACQUIRE)
+#define runloop_msg_queue_get() \
+   __atomic_load_n(&runloop_msg_queue, __ATOMIC_ACQUIRE)
+#define runloop_msg_queue_set(queue) \
+   __atomic_store_n(&runloop_msg_queue, (queue), __ATOMIC_RELEASE)
+#else
+#define runloop_msg_queue_get() \
+   (*(msg_queue_t *volatile*)&runloop_msg_queue)
+#define runloop_msg_queue_set(queue) \
+   (*(msg_queue_t *volatile*)&runloop_msg_queue = (queue))
+#endif
+
 /* BSV MOVIE GLOBAL VARIABLES */
 
 enum rarch_movie_type
@@ -1864,6 +1900,24 @@ struct turbo_buttons
    unsigned count;
 };
 
+typedef struct input_state_cache input_state_cache_t;
+
+/* Core input resolved since the last poll.
+ *
+ * Cores tend to ask for the same buttons several times per frame,
+ * and the answer can only change when the input driver is polled,
+ * so each query is resolved once (remaps, overlay, turbo, ...)
+ * and answered from this table afterwards. */
+struct input_state_cache
+{
+   /* data: RETRO_DEVICE_JOYPAD ids,
+    * analogs: RETRO_DEVICE_ANALOG left/right X/Y,
+    * analog_buttons: RETRO_DEVICE_INDEX_ANALOG_BUTTON ids */
+   input_bits_t state;
+   uint32_t analog_valid;
+   uint16_t joypad_valid;
+};
+
 struct input_keyboard_line
 {
    char *buffer;
@@ -1890,6 +1944,7 @@ static unsigned osk_last_codepoint_len            = 0;
 static input_keyboard_press_t g_keyboard_press_cb;
 
 static turbo_buttons_t input_driver_turbo_btns;
+static input_state_cache_t input_driver_state_cache[MAX_USERS];
 #ifdef HAVE_COMMAND
 static command_t *input_driver_command            = NULL;
 #endif
@@ -2043,28 +2098,38 @@ void *video_driver_get_ptr(bool force_nonthreaded_data)
 
 /* MESSAGE QUEUE */
 
+/* Must only be called once no task can push anymore (after
+ * task_queue_deinit): producers don't take the lock, so the pointer is
+ * cleared before the queue goes, but one already read stays in use. */
 static void retroarch_msg_queue_deinit(void)
 {
-   runloop_msg_queue_lock();
+   msg_queue_t *queue = runloop_msg_queue_get();
 
-   if (!runloop_msg_queue)
-      return;
+   runloop_msg_queue_set(NULL);
 
-   msg_queue_free(runloop_msg_queue);
+   runloop_msg_queue_lock();
+
+   msg_queue_free(queue);
 
    runloop_msg_queue_unlock();
 #ifdef HAVE_THREADS
    slock_free(_runloop_msg_queue_lock);
    _runloop_msg_queue_lock = NULL;
 #endif
-
-   runloop_msg_queue = NULL;
 }
 
 static void retroarch_msg_queue_init(void)
 {
-   retroarch_msg_queue_deinit();
-   runloop_msg_queue       = msg_queue_new(8);
+   /* Tasks may still be running; keep the queue they push to */
+   if (runloop_msg_queue_get())
+   {
+      runloop_msg_queue_lock();
+      msg_queue_clear(runloop_msg_queue);
+      runloop_msg_queue_unlock();
+      return;
+   }
+
+   runloop_msg_queue_set(msg_queue_new(8));
 
 #ifdef HAVE_THREADS
    _runloop_msg_queue_lock = slock_new();
@@ -5139,20 +5204,41 @@ TODO: Add a setting for these tweaks */
       case CMD_EVENT_CORE_INFO_INIT:
          {
             char ext_name[255];
+            char cache_path[PATH_MAX_LENGTH];
             settings_t *settings      = configuration_settings;
 
             ext_name[0]               = '\0';
+            cache_path[0]             = '\0';
 
             command_event(CMD_EVENT_CORE_INFO_DEINIT, NULL);
 
             if (!frontend_driver_get_core_extension(ext_name, sizeof(ext_name)))
                return false;
 
+            if (settings->bools.core_info_cache_enable)
+            {
+               if (!string_is_empty(settings->paths.directory_cache))
+                  fill_pathname_join(cache_path,
+                        settings->paths.directory_cache,
+                        "core_info.cache", sizeof(cache_path));
+               else if (!path_is_empty(RARCH_PATH_CONFIG))
+               {
+                  char config_dir[PATH_MAX_LENGTH];
+                  fill_pathname_basedir(config_dir,
+                        path_get(RARCH_PATH_CONFIG), sizeof(config_dir));
+                  fill_pathname_join(cache_path, config_dir, "cache",
+                        sizeof(cache_path));
+                  fill_pathname_join(cache_path, cache_path,
+                        "core_info.cache", sizeof(cache_path));
+               }
+            }
+
             if (!string_is_empty(settings->paths.directory_libretro))
                core_info_init_list(settings->paths.path_libretro_info,
                      settings->paths.directory_libretro,
                      ext_name,
-                     settings->bools.show_hidden_files
+                     settings->bools.show_hidden_files,
+                     cache_path
                      );
          }
          break;
@@ -6029,13 +6115,14 @@ void main_exit(void *args)
    rarch_error_on_init     = false;
    rarch_block_config_read = false;
 
-   retroarch_msg_queue_deinit();
    driver_uninit(DRIVERS_CMD_ALL);
    command_event(CMD_EVENT_LOG_FILE_DEINIT, NULL);
 
    rarch_ctl(RARCH_CTL_STATE_FREE,  NULL);
    global_free();
    rarch_ctl(RARCH_CTL_DATA_DEINIT, NULL);
+   /* After DATA_DEINIT has joined the task threads */
+   retroarch_msg_queue_deinit();
 
    if (configuration_settings)
       free(configuration_settings);
@@ -8233,7 +8320,7 @@ static bool rarch_environment_cb(unsigned cmd, void *data)
 
       case RETRO_ENVIRONMENT_GET_VFS_INTERFACE:
       {
-         const uint32_t supported_vfs_version = 3;
+         const uint32_t supported_vfs_version = 5;
          static struct retro_vfs_interface vfs_iface =
          {
             /* VFS API v1 */
@@ -8257,7 +8344,14 @@ static bool rarch_environment_cb(unsigned cmd, void *data)
             retro_vfs_readdir_impl,
             retro_vfs_dirent_get_name_impl,
             retro_vfs_dirent_is_dir_impl,
-            retro_vfs_closedir_impl
+            retro_vfs_closedir_impl,
+            /* VFS API v4 */
+            retro_vfs_async_open_impl,
+            retro_vfs_async_read_impl,
+            retro_vfs_async_wait_impl,
+            retro_vfs_async_close_impl,
+            /* VFS API v5 */
+            retro_vfs_file_get_mapped_impl
          };
 
          struct retro_vfs_interface_info *vfs_iface_info = (struct retro_vfs_interface_info *) data;
@@ -9559,14 +9653,23 @@ static void ui_companion_driver_msg_queue_push(
 {
    const ui_companion_driver_t *ui = ui_companion;
 
+   /* Companions are not thread-safe, only they take the lock */
    if (ui && ui->msg_queue_push)
+   {
+      runloop_msg_queue_lock();
       ui->msg_queue_push(ui_companion_data, msg, priority, duration, flush);
+      runloop_msg_queue_unlock();
+   }
 #ifdef HAVE_QT
    {
       settings_t *settings            = configuration_settings;
       if (settings->bools.desktop_menu_enable)
          if (ui_companion_qt.msg_queue_push && qt_is_inited)
+         {
+            runloop_msg_queue_lock();
             ui_companion_qt.msg_queue_push(ui_companion_qt_data, msg, priority, duration, flush);
+            runloop_msg_queue_unlock();
+         }
    }
 #endif
 }
@@ -11595,8 +11698,22 @@ static void input_driver_poll(void)
 
    current_input->poll(current_input_data);
 
+   /* Only the first poll before a frame is presented counts,
+    * run-ahead polls several times per frame. */
+   if (runloop_perfcnt_enable && !perf_input_to_present_pending)
+   {
+      performance_counter_start_plus(true, perf_input_to_present);
+      perf_input_to_present_pending = true;
+   }
+
    input_driver_turbo_btns.count++;
 
+   for (i = 0; i < MAX_USERS; i++)
+   {
+      input_driver_state_cache[i].joypad_valid = 0;
+      input_driver_state_cache[i].analog_valid = 0;
+   }
+
    for (i = 0; i < max_users; i++)
       input_driver_turbo_btns.frame_enable[i] = 0;
 
@@ -12064,6 +12181,122 @@ static int16_t input_state_device(
    return res;
 }
 
+/**
+ * input_state_cached:
+ * @port                 : user number.
+ * @device               : device identifier of user.
+ * @idx                  : index value of user.
+ * @id                   : identifier of key pressed by user.
+ * @result               : set to the cached value on success.
+ *
+ * Looks up a query already resolved since the last input poll.
+ *
+ * Returns: true (1) if @result was set, otherwise false (0).
+ **/
+static bool input_state_cached(unsigned port, unsigned device,
+      unsigned idx, unsigned id, int16_t *result)
+{
+   input_state_cache_t *cache = &input_driver_state_cache[port];
+
+   switch (device)
+   {
+      case RETRO_DEVICE_JOYPAD:
+         if (idx != 0)
+            return false;
+         if (id == RETRO_DEVICE_ID_JOYPAD_MASK)
+         {
+            if (cache->joypad_valid != 0xffff)
+               return false;
+            *result = (int16_t)(cache->state.data[0] & 0xffff);
+            return true;
+         }
+         if (id >= RARCH_FIRST_CUSTOM_BIND
+               || !(cache->joypad_valid & (1 << id)))
+            return false;
+         *result = BIT256_GET(cache->state, id) ? 1 : 0;
+         return true;
+      case RETRO_DEVICE_ANALOG:
+         if (idx < 2 && id < 2)
+         {
+            unsigned slot = (idx * 2) + id;
+            if (!(cache->analog_valid & (1 << slot)))
+               return false;
+            *result = (int16_t)cache->state.analogs[slot];
+            return true;
+         }
+         if (     idx == RETRO_DEVICE_INDEX_ANALOG_BUTTON
+               && id  <  RARCH_FIRST_CUSTOM_BIND)
+         {
+            if (!(cache->analog_valid & (1 << (4 + id))))
+               return false;
+            *result = (int16_t)cache->state.analog_buttons[id];
+            return true;
+         }
+         break;
+      default:
+         break;
+   }
+
+   return false;
+}
+
+/**
+ * input_state_cache_store:
+ * @port                 : user number.
+ * @device               : device identifier of user.
+ * @idx                  : index value of user.
+ * @id                   : identifier of key pressed by user.
+ * @result               : resolved input state.
+ *
+ * Remembers a resolved query until the next input poll.
+ * Mouse, keyboard, lightgun and pointer state is not cached.
+ **/
+static void input_state_cache_store(unsigned port, unsigned device,
+      unsigned idx, unsigned id, int16_t result)
+{
+   input_state_cache_t *cache = &input_driver_state_cache[port];
+
+   switch (device)
+   {
+      case RETRO_DEVICE_JOYPAD:
+         if (idx != 0)
+            break;
+         if (id == RETRO_DEVICE_ID_JOYPAD_MASK)
+         {
+            cache->state.data[0] = (cache->state.data[0] & ~0xffffU)
+               | ((uint16_t)result);
+            cache->joypad_valid  = 0xffff;
+         }
+         /* Plain button queries are stored as bits, so only
+          * remember the usual 0/1 answers. */
+         else if (id < RARCH_FIRST_CUSTOM_BIND && (result == 0 || result == 1))
+         {
+            if (result)
+               BIT256_SET(cache->state, id);
+            else
+               BIT256_CLEAR(cache->state, id);
+            cache->joypad_valid |= (1 << id);
+         }
+         break;
+      case RETRO_DEVICE_ANALOG:
+         if (idx < 2 && id < 2)
+         {
+            unsigned slot = (idx * 2) + id;
+            cache->state.analogs[slot] = (uint16_t)result;
+            cache->analog_valid       |= (1 << slot);
+         }
+         else if (idx == RETRO_DEVICE_INDEX_ANALOG_BUTTON
+               && id  <  RARCH_FIRST_CUSTOM_BIND)
+         {
+            cache->state.analog_buttons[id] = (uint16_t)result;
+            cache->analog_valid            |= (1 << (4 + id));
+         }
+         break;
+      default:
+         break;
+   }
+}
+
 /**
  * input_state:
  * @port                 : user number.
@@ -12095,6 +12328,15 @@ static int16_t input_state(unsigned port, unsigned device,
    }
 
    device &= RETRO_DEVICE_MASK;
+
+   /* Movies record every single query, so only
+    * go through the cache when no movie is active. */
+   if (!bsv_movie_state_handle && port < MAX_USERS)
+   {
+      if (input_state_cached(port, device, idx, id, &result))
+         return result;
+   }
+
    ret     = current_input->input_state(
          current_input_data, joypad_info,
          libretro_input_binds, port, device, idx, id);
@@ -12115,6 +12357,9 @@ static int16_t input_state(unsigned port, unsigned device,
       }
       else
          result = input_state_device(ret, port, device, idx, id, false);
+
+      if (port < MAX_USERS)
+         input_state_cache_store(port, device, idx, id, result);
    }
 
    if (BSV_MOVIE_IS_PLAYBACK_OFF())
@@ -19170,10 +19415,32 @@ static void video_driver_frame(const void *data, unsigned width,
 #endif
    }
 
-   video_driver_active = current_video->frame(
-         video_driver_data, data, width, height,
-         video_driver_frame_count,
-         (unsigned)pitch, video_driver_msg, &video_info);
+   {
+      retro_time_t present_start = runloop_frame_delay_auto.active
+         ? cpu_features_get_time_usec() : 0;
+
+      performance_counter_start_plus(runloop_perfcnt_enable,
+            perf_video_present);
+
+      video_driver_active = current_video->frame(
+            video_driver_data, data, width, height,
+            video_driver_frame_count,
+            (unsigned)pitch, video_driver_msg, &video_info);
+
+      performance_counter_stop_plus(runloop_perfcnt_enable,
+            perf_video_present);
+
+      if (runloop_frame_delay_auto.active)
+         runloop_frame_delay_auto.present_usec +=
+            cpu_features_get_time_usec() - present_start;
+   }
+
+   if (perf_input_to_present_pending)
+   {
+      performance_counter_stop_plus(runloop_perfcnt_enable,
+            perf_input_to_present);
+      perf_input_to_present_pending = false;
+   }
 
    video_driver_frame_count++;
 
@@ -20809,6 +21076,8 @@ bool driver_ctl(enum driver_ctl_state state, void *data)
          input_driver_nonblock_state           = false;
          input_driver_flushing_input           = false;
          memset(&input_driver_turbo_btns, 0, sizeof(turbo_buttons_t));
+         memset(input_driver_state_cache, 0,
+               sizeof(input_driver_state_cache));
          current_input                         = NULL;
 
 #ifdef HAVE_MENU
@@ -22979,6 +23248,39 @@ error:
    return false;
 }
 
+/* @tag identifies the sender of messages that supersede
+ * each other, such as the progress of a task */
+static void runloop_msg_queue_push_tagged(uint32_t tag,
+      const char *msg,
+      unsigned prio, unsigned duration,
+      bool flush,
+      char *title,
+      enum message_queue_icon icon,
+      enum message_queue_category category)
+{
+#if defined(HAVE_MENU) && defined(HAVE_MENU_WIDGETS)
+   if (menu_widgets_inited)
+   {
+      runloop_msg_queue_lock();
+      menu_widgets_msg_queue_push(NULL, msg,
+            roundf((float)duration / 60.0f * 1000.0f),
+            title, icon, category, prio, flush);
+      runloop_msg_queue_unlock();
+      duration = duration * 60 / 1000;
+   }
+   else
+#endif
+   {
+      /* Lock-free, the queue is drained when the next frame pulls it */
+      msg_queue_t *queue = runloop_msg_queue_get();
+      if (queue && !msg_queue_submit(queue, msg, prio, duration, flush, tag))
+         RARCH_WARN("[msg_queue] Dropped message: %s\n", msg);
+   }
+
+   ui_companion_driver_msg_queue_push(msg,
+         prio, duration, flush);
+}
+
 static void runloop_task_msg_queue_push(
       retro_task_t *task, const char *msg,
       unsigned prio, unsigned duration,
@@ -22987,15 +23289,16 @@ static void runloop_task_msg_queue_push(
 #if defined(HAVE_MENU) && defined(HAVE_MENU_WIDGETS)
    if (menu_widgets_inited && task->title && !task->mute)
    {
-      runloop_msg_queue_lock();
       ui_companion_driver_msg_queue_push(msg,
             prio, task ? duration : duration * 60 / 1000, flush);
+      runloop_msg_queue_lock();
       menu_widgets_msg_queue_push(task, msg, duration, NULL, (enum message_queue_icon)MESSAGE_QUEUE_CATEGORY_INFO, (enum message_queue_category)MESSAGE_QUEUE_ICON_DEFAULT, prio, flush);
       runloop_msg_queue_unlock();
    }
    else
 #endif
-      runloop_msg_queue_push(msg, prio, duration, flush, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+      /* Not the task pointer, a later task may get the same address */
+      runloop_msg_queue_push_tagged(task->ident, msg, prio, duration, flush, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
 }
 
 /* Fetches core options path for current core/content
@@ -24012,32 +24315,8 @@ void runloop_msg_queue_push(const char *msg,
       enum message_queue_icon icon,
       enum message_queue_category category)
 {
-   runloop_msg_queue_lock();
-
-#if defined(HAVE_MENU) && defined(HAVE_MENU_WIDGETS)
-   if (menu_widgets_inited)
-   {
-      menu_widgets_msg_queue_push(NULL, msg,
-            roundf((float)duration / 60.0f * 1000.0f),
-            title, icon, category, prio, flush);
-      duration = duration * 60 / 1000;
-   }
-   else
-#endif
-   {
-      if (flush)
-         msg_queue_clear(runloop_msg_queue);
-
-      if (runloop_msg_queue)
-         msg_queue_push(runloop_msg_queue, msg,
-               prio, duration,
-               title, icon, category);
-   }
-
-   ui_companion_driver_msg_queue_push(msg,
-         prio, duration, flush);
-
-   runloop_msg_queue_unlock();
+   runloop_msg_queue_push_tagged(0, msg, prio, duration, flush,
+         title, icon, category);
 }
 
 void runloop_get_status(bool *is_paused, bool *is_idle,
@@ -25103,6 +25382,79 @@ static enum runloop_state runloop_check_state(void)
    return RUNLOOP_STATE_ITERATE;
 }
 
+/**
+ * runloop_frame_delay_auto_update:
+ * @fd                   : automatic frame delay state.
+ * @frame_usec           : duration of one refresh in microseconds.
+ * @work_usec            : time the last core_run() spent not presenting.
+ * @interval_usec        : time between the last two frames, 0 if unknown.
+ * @max_delay            : upper limit in milliseconds, 0 for none.
+ * @margin               : milliseconds to keep free before VSync.
+ *
+ * Picks the frame delay for the next frame so that the delay plus
+ * the core's run time stays @margin short of a refresh. The core's
+ * work is tracked as a slowly decaying peak so a single heavy frame
+ * is remembered for a while. A missed VSync lowers the delay at once
+ * and keeps it lower for some time; the delay is only raised again
+ * after the higher value has been safe for a second.
+ **/
+static void runloop_frame_delay_auto_update(frame_delay_auto_t *fd,
+      retro_time_t frame_usec, retro_time_t work_usec,
+      retro_time_t interval_usec, unsigned max_delay, unsigned margin)
+{
+   retro_time_t budget;
+   unsigned target;
+
+   if (work_usec < 0)
+      work_usec = 0;
+
+   if (work_usec > fd->work_peak_usec)
+      fd->work_peak_usec  = work_usec;
+   else
+      fd->work_peak_usec -= (fd->work_peak_usec - work_usec) / 64;
+
+   /* Anything far longer than a refresh was a pause, not a miss */
+   if (     interval_usec > frame_usec + frame_usec / 2
+         && interval_usec < frame_usec * 4)
+   {
+      fd->penalty_usec     += 1000;
+      if (fd->penalty_usec  > frame_usec)
+         fd->penalty_usec   = frame_usec;
+      fd->frames_since_miss = 0;
+   }
+   else if (fd->penalty_usec && ++fd->frames_since_miss >= 300)
+   {
+      fd->penalty_usec      = (fd->penalty_usec > 1000)
+         ? fd->penalty_usec - 1000 : 0;
+      fd->frames_since_miss = 0;
+   }
+
+   budget = frame_usec - fd->work_peak_usec - fd->penalty_usec
+      - (retro_time_t)margin * 1000;
+   target = (budget > 0) ? (unsigned)(budget / 1000) : 0;
+
+   if (target > 15)
+      target = 15;
+   if (max_delay && target > max_delay)
+      target = max_delay;
+
+   if (target < fd->delay)
+   {
+      fd->delay            = target;
+      fd->frames_at_target = 0;
+   }
+   else if (target > fd->delay)
+   {
+      if (++fd->frames_at_target >= 60)
+      {
+         fd->delay++;
+         fd->frames_at_target = 0;
+      }
+   }
+   else
+      fd->frames_at_target = 0;
+}
+
 /**
  * runloop_iterate:
  *
@@ -25120,6 +25472,8 @@ int runloop_iterate(void)
    unsigned video_frame_delay                   = settings->uints.video_frame_delay;
    bool vrr_runloop_enable                      = settings->bools.vrr_runloop_enable;
    unsigned max_users                           = input_driver_max_users;
+   retro_time_t frame_delay_auto_interval       = 0;
+   retro_time_t frame_delay_auto_core_start     = 0;
 
 #ifdef HAVE_DISCORD
    if (discord_is_inited)
@@ -25219,8 +25573,45 @@ int runloop_iterate(void)
       }
    }
 
+   if (runloop_perfcnt_enable)
+   {
+      performance_counter_init(perf_frame_delay,      "frame_delay");
+      performance_counter_init(perf_core_run,         "core_run");
+      performance_counter_init(perf_video_present,    "video_present");
+      performance_counter_init(perf_input_to_present, "input_to_present");
+   }
+
+   runloop_frame_delay_auto.active = settings->bools.video_frame_delay_auto
+      && !input_driver_nonblock_state;
+
+   if (runloop_frame_delay_auto.active)
+   {
+      retro_time_t now = cpu_features_get_time_usec();
+
+      frame_delay_auto_interval                =
+         runloop_frame_delay_auto.frame_start
+         ? now - runloop_frame_delay_auto.frame_start : 0;
+      runloop_frame_delay_auto.frame_start     = now;
+      runloop_frame_delay_auto.present_usec    = 0;
+      video_frame_delay                        =
+         runloop_frame_delay_auto.delay;
+   }
+   else
+      runloop_frame_delay_auto.frame_start     = 0;
+
    if ((video_frame_delay > 0) && !input_driver_nonblock_state)
+   {
+      performance_counter_start_plus(runloop_perfcnt_enable,
+            perf_frame_delay);
       retro_sleep(video_frame_delay);
+      performance_counter_stop_plus(runloop_perfcnt_enable,
+            perf_frame_delay);
+   }
+
+   if (runloop_frame_delay_auto.active)
+      frame_delay_auto_core_start = cpu_features_get_time_usec();
+
+   performance_counter_start_plus(runloop_perfcnt_enable, perf_core_run);
 
    {
 #ifdef HAVE_RUNAHEAD
@@ -25238,6 +25629,28 @@ int runloop_iterate(void)
          core_run();
    }
 
+   performance_counter_stop_plus(runloop_perfcnt_enable, perf_core_run);
+
+   if (runloop_frame_delay_auto.active)
+   {
+      float refresh_rate     = settings->floats.video_refresh_rate;
+      unsigned swap_interval = settings->uints.video_swap_interval;
+      retro_time_t work_usec = cpu_features_get_time_usec()
+         - frame_delay_auto_core_start
+         - runloop_frame_delay_auto.present_usec;
+
+      if (refresh_rate <= 0.0f)
+         refresh_rate = 60.0f;
+      if (swap_interval < 1)
+         swap_interval = 1;
+
+      runloop_frame_delay_auto_update(&runloop_frame_delay_auto,
+            (retro_time_t)(1000000.0f * swap_interval / refresh_rate),
+            work_usec, frame_delay_auto_interval,
+            settings->uints.video_frame_delay,
+            settings->uints.video_frame_delay_auto_margin);
+   }
+
    /* Increment runtime tick counter after each call to
     * core_run() or run_ahead() */
    libretro_core_runtime_usec += rarch_core_runtime_tick();
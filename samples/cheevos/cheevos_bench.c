@@ -0,0 +1,295 @@
+/* Replays a memory trace through a set of achievement triggers, once with
+ * a fixup lookup per operand read (rcheevos_peek) and once with the
+ * per-frame memory snapshot, and checks both agree.
+ *
+ * Usage: cheevos_bench [triggers.txt trace.bin ram_size]
+ *
+ * triggers.txt holds one MemAddr string per line, as found in the patch
+ * data. trace.bin is a sequence of ram_size byte dumps of the system RAM,
+ * one per frame. Without arguments a synthetic set and trace are used. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+
+#include "../../cheevos-new/fixup.h"
+#include "../../core.h"
+#include "../../retroarch.h"
+
+#define SYNTH_RAM_SIZE  0x10000
+#define SYNTH_TRIGGERS  400
+#define SYNTH_FRAMES    3600
+#define SYNTH_HOT_ADDRS 256
+
+static uint8_t *ram;
+static size_t ram_size;
+static rarch_system_info_t system_info;
+static rcheevos_fixups_t fixups;
+
+/* What fixup.c needs from the rest of RetroArch */
+rarch_system_info_t *runloop_get_system_info(void)
+{
+   return &system_info;
+}
+
+bool core_get_memory(retro_ctx_memory_info_t *info)
+{
+   info->data = info->id == RETRO_MEMORY_SYSTEM_RAM ? ram : NULL;
+   info->size = info->id == RETRO_MEMORY_SYSTEM_RAM ? ram_size : 0;
+   return true;
+}
+
+void RARCH_LOG(const char *fmt, ...) { }
+void RARCH_ERR(const char *fmt, ...) { }
+void RARCH_WARN(const char *fmt, ...) { }
+
+static double now_sec(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned peek_fixup(unsigned address, unsigned num_bytes, void* ud)
+{
+   return rcheevos_fixup_peek(&fixups, address, num_bytes, 0);
+}
+
+static char **synth_triggers(unsigned *count)
+{
+   static const char sizes[] = { 'H', 'H', 'H', ' ', 'X', 'M', 'L' };
+   unsigned hot[SYNTH_HOT_ADDRS];
+   char **triggers = (char**)calloc(SYNTH_TRIGGERS, sizeof(char*));
+   unsigned i, j;
+
+   for (i = 0; i < SYNTH_HOT_ADDRS; i++)
+      hot[i] = (unsigned)(rand() % (SYNTH_RAM_SIZE - 4));
+
+   for (i = 0; i < SYNTH_TRIGGERS; i++)
+   {
+      char buf[512];
+      size_t len        = 0;
+      unsigned conds    = 3 + rand() % 6;
+
+      for (j = 0; j < conds; j++)
+      {
+         char size    = sizes[rand() % sizeof(sizes)];
+         unsigned a   = hot[rand() % SYNTH_HOT_ADDRS];
+
+         if (j % 3 == 2)
+            len += snprintf(buf + len, sizeof(buf) - len, "%s0x%c%04x>d0x%c%04x",
+                  j ? "_" : "", size, a, size, a);
+         else
+            len += snprintf(buf + len, sizeof(buf) - len, "%s0x%c%04x=%u",
+                  j ? "_" : "", size, a, (unsigned)(rand() % 4));
+      }
+
+      triggers[i] = strdup(buf);
+   }
+
+   *count = SYNTH_TRIGGERS;
+   return triggers;
+}
+
+static uint8_t *synth_trace(unsigned *frames)
+{
+   uint8_t *trace = (uint8_t*)malloc((size_t)SYNTH_FRAMES * SYNTH_RAM_SIZE);
+   unsigned f, i;
+
+   for (i = 0; i < SYNTH_RAM_SIZE; i++)
+      trace[i] = (uint8_t)(rand() % 4);
+
+   /* Each frame changes a few percent of the RAM */
+   for (f = 1; f < SYNTH_FRAMES; f++)
+   {
+      uint8_t *frame = trace + (size_t)f * SYNTH_RAM_SIZE;
+
+      memcpy(frame, frame - SYNTH_RAM_SIZE, SYNTH_RAM_SIZE);
+      for (i = 0; i < SYNTH_RAM_SIZE / 32; i++)
+         frame[rand() % SYNTH_RAM_SIZE] = (uint8_t)(rand() % 4);
+   }
+
+   *frames = SYNTH_FRAMES;
+   return trace;
+}
+
+static char **load_triggers(const char *path, unsigned *count)
+{
+   char line[4096];
+   char **triggers   = NULL;
+   unsigned capacity = 0;
+   FILE *file        = fopen(path, "r");
+
+   *count = 0;
+
+   if (!file)
+      return NULL;
+
+   while (fgets(line, sizeof(line), file))
+   {
+      line[strcspn(line, "\r\n")] = '\0';
+
+      if (!*line)
+         continue;
+
+      if (*count == capacity)
+      {
+         capacity = capacity ? capacity * 2 : 64;
+         triggers = (char**)realloc(triggers, capacity * sizeof(char*));
+      }
+
+      triggers[(*count)++] = strdup(line);
+   }
+
+   fclose(file);
+   return triggers;
+}
+
+static uint8_t *load_trace(const char *path, size_t size, unsigned *frames)
+{
+   void *data = NULL;
+   long len;
+   FILE *file = fopen(path, "rb");
+
+   if (!file)
+      return NULL;
+
+   fseek(file, 0, SEEK_END);
+   len = ftell(file);
+   fseek(file, 0, SEEK_SET);
+
+   *frames = (unsigned)(len / size);
+   if (*frames)
+   {
+      data = malloc((size_t)*frames * size);
+      if (fread(data, size, *frames, file) != *frames)
+         *frames = 0;
+   }
+
+   fclose(file);
+   return (uint8_t*)data;
+}
+
+static rc_trigger_t **parse_triggers(char **memaddrs, unsigned count)
+{
+   rc_trigger_t **triggers = (rc_trigger_t**)calloc(count, sizeof(*triggers));
+   unsigned i;
+
+   for (i = 0; i < count; i++)
+   {
+      int size = rc_trigger_size(memaddrs[i]);
+
+      if (size < 0)
+      {
+         fprintf(stderr, "Invalid trigger \"%s\"\n", memaddrs[i]);
+         exit(1);
+      }
+
+      triggers[i] = (rc_trigger_t*)calloc(1, size);
+      rc_parse_trigger(triggers[i], memaddrs[i], NULL, 0);
+   }
+
+   return triggers;
+}
+
+int main(int argc, char *argv[])
+{
+   rcheevos_snapshot_t snapshot;
+   char **memaddrs;
+   uint8_t *trace;
+   unsigned count, frames, f, i;
+   unsigned **slots, *num_slots;
+   unsigned long hits_fixup    = 0;
+   unsigned long hits_snapshot = 0;
+   unsigned long sum_fixup     = 0;
+   unsigned long sum_snapshot  = 0;
+   rc_trigger_t **a, **b;
+   double start, t_fixup, t_snapshot;
+
+   if (argc == 4)
+   {
+      ram_size = strtoul(argv[3], NULL, 0);
+      memaddrs = load_triggers(argv[1], &count);
+      trace    = ram_size ? load_trace(argv[2], ram_size, &frames) : NULL;
+   }
+   else
+   {
+      srand(1);
+      ram_size = SYNTH_RAM_SIZE;
+      memaddrs = synth_triggers(&count);
+      trace    = synth_trace(&frames);
+   }
+
+   if (!memaddrs || !trace || !frames)
+   {
+      fprintf(stderr, "Usage: %s [triggers.txt trace.bin ram_size]\n", argv[0]);
+      return 1;
+   }
+
+   ram = (uint8_t*)calloc(1, ram_size);
+   a   = parse_triggers(memaddrs, count);
+   b   = parse_triggers(memaddrs, count);
+
+   rcheevos_fixup_init(&fixups);
+
+   /* Per operand fixup lookups, as rcheevos_test used to do */
+   start = now_sec();
+   for (f = 0; f < frames; f++)
+   {
+      memcpy(ram, trace + (size_t)f * ram_size, ram_size);
+
+      for (i = 0; i < count; i++)
+         if (rc_test_trigger(a[i], peek_fixup, NULL, NULL))
+         {
+            hits_fixup++;
+            sum_fixup = sum_fixup * 31 + f * count + i;
+         }
+   }
+   t_fixup = now_sec() - start;
+
+   /* Snapshot gathered once per frame */
+   rcheevos_snapshot_init(&snapshot, &fixups, 0);
+   slots     = (unsigned**)calloc(count, sizeof(*slots));
+   num_slots = (unsigned*)calloc(count, sizeof(*num_slots));
+
+   for (i = 0; i < count; i++)
+      rcheevos_snapshot_add(&snapshot, b[i]->memrefs);
+   rcheevos_snapshot_resolve(&snapshot);
+   for (i = 0; i < count; i++)
+      slots[i] = rcheevos_snapshot_slots(&snapshot, b[i]->memrefs, &num_slots[i]);
+
+   start = now_sec();
+   for (f = 0; f < frames; f++)
+   {
+      memcpy(ram, trace + (size_t)f * ram_size, ram_size);
+      rcheevos_snapshot_update(&snapshot);
+
+      for (i = 0; i < count; i++)
+      {
+         rcheevos_snapshot_peek_t peek;
+         peek.snapshot = &snapshot;
+         peek.slots    = slots[i];
+         peek.count    = num_slots[i];
+         peek.next     = 0;
+
+         if (rc_test_trigger(b[i], rcheevos_snapshot_peek, &peek, NULL))
+         {
+            hits_snapshot++;
+            sum_snapshot = sum_snapshot * 31 + f * count + i;
+         }
+      }
+   }
+   t_snapshot = now_sec() - start;
+
+   printf("%u triggers, %u distinct addresses, %u frames of %u bytes\n",
+         count, snapshot.count, frames, (unsigned)ram_size);
+   printf("fixup lookups: %8.3f ms/frame (%lu hits)\n",
+         t_fixup * 1000.0 / frames, hits_fixup);
+   printf("snapshot:      %8.3f ms/frame (%lu hits)%s\n",
+         t_snapshot * 1000.0 / frames, hits_snapshot,
+         sum_fixup != sum_snapshot ? " MISMATCH" : "");
+
+   return sum_fixup != sum_snapshot;
+}
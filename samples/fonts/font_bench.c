@@ -0,0 +1,196 @@
+/* Lays out a screen of menu labels every frame, once by looking up each
+ * glyph as the font drivers used to, once through the glyph run cache
+ * and once reusing the vertices cached with each run, and checks all
+ * three produce the same vertices.
+ *
+ * Usage: font_bench font.ttf [size] [frames] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <encodings/utf.h>
+#include <features/features_cpu.h>
+
+#include "../../gfx/font_driver.h"
+#include "../../gfx/font_glyph_run.h"
+
+extern font_renderer_driver_t stb_unicode_font_renderer;
+
+static const char *labels[] = {
+   "Load Core", "Load Content", "Online Updater", "Information",
+   "Configuration File", "Help", "Quit RetroArch", "Settings",
+   "Favorites", "History", "Images", "Music", "Videos", "Netplay",
+   "Import Content", "Explore", "Drivers", "Video", "Audio", "Input",
+   "Latency", "Core", "Configuration", "Saving", "Logging",
+   "File Browser", "Frame Throttle", "Recording", "On-Screen Display",
+   "User Interface", "AI Service", "Power Management", "Achievements",
+   "Network", "Playlists", "User", "Directory", "Start Directly",
+   "\xe8\xa8\xad\xe5\xae\x9a", "\xe3\x83\x8d\xe3\x83\x83\xe3\x83\x88\xe3\x83\x97\xe3\x83\xac\xe3\x82\xa4",
+   "Super Mario World (USA)", "The Legend of Zelda - A Link to the Past (USA)",
+   "Sonic the Hedgehog 2 (World) (Rev A)", "Castlevania - Symphony of the Night (USA)",
+};
+
+#define NUM_LABELS (sizeof(labels) / sizeof(labels[0]))
+
+static float vertices[2 * 6 * 256];
+
+/* Same vertex math as the GL raster font, one quad per glyph */
+static void emit(float *out, const struct font_glyph *glyph,
+      int pen_x, int pen_y, float scale)
+{
+   unsigned c;
+   static const int quad[6][2] = {{0,1},{1,1},{0,0},{1,0},{0,0},{1,1}};
+
+   for (c = 0; c < 6; c++)
+   {
+      out[2 * c + 0] = (100 + (pen_x + glyph->draw_offset_x
+               + quad[c][0] * (int)glyph->width) * scale) / 1920.0f;
+      out[2 * c + 1] = (200 + (pen_y - glyph->draw_offset_y
+               - quad[c][1] * (int)glyph->height) * scale) / 1080.0f;
+   }
+}
+
+/* Stands in for handing the vertices to the GPU */
+static double submit(const float *v, unsigned glyphs)
+{
+   unsigned i;
+   double sum = 0.0;
+
+   for (i = 0; i < 2 * 6 * glyphs; i++)
+      sum += v[i];
+
+   return sum;
+}
+
+static double layout_direct(void *font, const char *msg, float scale)
+{
+   unsigned i          = 0;
+   int delta_x         = 0;
+   int delta_y         = 0;
+   const char *msg_end = msg + strlen(msg);
+
+   while (msg < msg_end && i < 256)
+   {
+      unsigned code                  = utf8_walk(&msg);
+      const struct font_glyph *glyph =
+         stb_unicode_font_renderer.get_glyph(font, code);
+
+      if (!glyph)
+         glyph = stb_unicode_font_renderer.get_glyph(font, '?');
+      if (!glyph)
+         continue;
+
+      emit(&vertices[2 * 6 * i++], glyph, delta_x, delta_y, scale);
+      delta_x += glyph->advance_x;
+      delta_y -= glyph->advance_y;
+   }
+
+   return submit(vertices, i) + delta_x * scale;
+}
+
+static double layout_runs(font_glyph_run_cache_t *cache,
+      const char *msg, float scale)
+{
+   unsigned i;
+   const font_glyph_run_t *run = font_glyph_run_cache_get(
+         cache, msg, (unsigned)strlen(msg));
+
+   if (!run)
+      return 0.0;
+
+   for (i = 0; i < run->count && i < 256; i++)
+      emit(&vertices[2 * 6 * i], &run->glyphs[i], 0, 0, scale);
+
+   return submit(vertices, i) + run->width * scale;
+}
+
+static double layout_coords(font_glyph_run_cache_t *cache,
+      const char *msg, float scale)
+{
+   unsigned i;
+   float key[FONT_GLYPH_RUN_KEY_SIZE]    = {0};
+   const font_glyph_run_coords_t *cached = NULL;
+   font_glyph_run_t *run                 = font_glyph_run_cache_get(
+         cache, msg, (unsigned)strlen(msg));
+
+   if (!run || !run->count)
+      return 0.0;
+
+   key[0] = scale;
+
+   if (!(cached = font_glyph_run_find_coords(run, key)))
+   {
+      font_glyph_run_coords_t *cached_new =
+         font_glyph_run_alloc_coords(run, key);
+
+      if (!cached_new)
+         return 0.0;
+
+      for (i = 0; i < run->count; i++)
+         emit(&cached_new->vertex[2 * 6 * i], &run->glyphs[i], 0, 0, scale);
+
+      cached = cached_new;
+   }
+
+   return submit(cached->vertex, run->count) + run->width * scale;
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned frame, i;
+   bool match;
+   retro_time_t start, direct_usec, runs_usec, coords_usec;
+   double direct_sum                = 0.0;
+   double runs_sum                  = 0.0;
+   double coords_sum                = 0.0;
+   font_glyph_run_cache_t *cache    = NULL;
+   void *font                       = NULL;
+   float size                       = argc > 2 ? (float)atof(argv[2]) : 24.0f;
+   unsigned frames                  = argc > 3 ? (unsigned)atoi(argv[3]) : 2000;
+
+   if (argc < 2)
+   {
+      fprintf(stderr, "Usage: %s font.ttf [size] [frames]\n", argv[0]);
+      return 1;
+   }
+
+   if (!(font = stb_unicode_font_renderer.init(argv[1], size)))
+   {
+      fprintf(stderr, "Couldn't load %s\n", argv[1]);
+      return 1;
+   }
+
+   cache = font_glyph_run_cache_new(&stb_unicode_font_renderer, font);
+
+   start = cpu_features_get_time_usec();
+   for (frame = 0; frame < frames; frame++)
+      for (i = 0; i < NUM_LABELS; i++)
+         direct_sum += layout_direct(font, labels[i], 1.0f + (i & 1));
+   direct_usec = cpu_features_get_time_usec() - start;
+
+   start = cpu_features_get_time_usec();
+   for (frame = 0; frame < frames; frame++)
+      for (i = 0; i < NUM_LABELS; i++)
+         runs_sum += layout_runs(cache, labels[i], 1.0f + (i & 1));
+   runs_usec = cpu_features_get_time_usec() - start;
+
+   start = cpu_features_get_time_usec();
+   for (frame = 0; frame < frames; frame++)
+      for (i = 0; i < NUM_LABELS; i++)
+         coords_sum += layout_coords(cache, labels[i], 1.0f + (i & 1));
+   coords_usec = cpu_features_get_time_usec() - start;
+
+   printf("%u labels x %u frames\n", (unsigned)NUM_LABELS, frames);
+   printf("glyph lookups: %8.2f us/frame\n", (double)direct_usec / frames);
+   printf("glyph runs:    %8.2f us/frame\n", (double)runs_usec   / frames);
+   printf("cached coords: %8.2f us/frame\n", (double)coords_usec / frames);
+
+   match = direct_sum == runs_sum && direct_sum == coords_sum;
+   printf("vertices %s\n", match ? "match" : "DIFFER");
+
+   font_glyph_run_cache_free(cache);
+   stb_unicode_font_renderer.free(font);
+
+   return match ? 0 : 1;
+}
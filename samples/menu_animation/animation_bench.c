@@ -0,0 +1,228 @@
+/* Simulates fast XMB navigation: every few frames the selection moves
+ * or the category changes, which kills the tweens of the current list
+ * by tag and pushes new ones for each entry, while menu timers run and
+ * a list clear kills tweens by subject, as Material UI used to. Time is
+ * simulated, so the final state is deterministic and printed as a
+ * checksum to compare implementations.
+ *
+ * Usage: animation_bench [entries [frames]] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../../menu/menu_animation.c"
+
+#define BENCH_ENTRIES     400
+#define BENCH_CATEGORIES  24
+#define BENCH_FRAMES      20000
+/* Frames between two moves of the selection */
+#define BENCH_MOVE_FRAMES 3
+
+typedef struct
+{
+   float alpha;
+   float label_alpha;
+   float zoom;
+   float x;
+   float y;
+} bench_node_t;
+
+static settings_t bench_settings;
+static retro_time_t bench_time_usec;
+static unsigned bench_timer_fired;
+
+/* What menu_animation.c needs from the rest of RetroArch */
+settings_t *config_get_ptr(void)
+{
+   return &bench_settings;
+}
+
+retro_time_t cpu_features_get_time_usec(void)
+{
+   return bench_time_usec;
+}
+
+int font_driver_get_message_width(void *font_data,
+      const char *msg, unsigned len, float scale)
+{
+   return (int)len * 8;
+}
+
+int font_driver_get_line_height(void *font_data, float scale)
+{
+   return 16;
+}
+
+static double now_sec(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench_push(float *subject, float target, uintptr_t tag,
+      enum menu_animation_easing_type easing)
+{
+   menu_animation_ctx_entry_t entry;
+
+   entry.duration     = 166.0f;
+   entry.target_value = target;
+   entry.subject      = subject;
+   entry.easing_enum  = easing;
+   entry.tag          = tag;
+   entry.cb           = NULL;
+   entry.userdata     = NULL;
+
+   menu_animation_push(&entry);
+}
+
+static void bench_timer_cb(void *userdata)
+{
+   bench_timer_fired++;
+}
+
+/* Same tweens as xmb_selection_pointer_changed/xmb_list_open */
+static void bench_select(bench_node_t *nodes, unsigned count,
+      unsigned selection, bool open)
+{
+   unsigned i;
+   menu_animation_ctx_tag tag = (uintptr_t)nodes;
+
+   menu_animation_kill_by_tag(&tag);
+
+   for (i = 0; i < count; i++)
+   {
+      float ia   = (i == selection) ? 1.0f : 0.5f;
+      float iz   = (i == selection) ? 1.0f : 0.5f;
+      float iy   = ((float)i - (float)selection) * 64.0f;
+
+      bench_push(&nodes[i].alpha,       ia, tag, EASING_OUT_QUAD);
+      bench_push(&nodes[i].label_alpha, ia, tag, EASING_OUT_QUAD);
+      bench_push(&nodes[i].zoom,        iz, tag, EASING_OUT_QUAD);
+      bench_push(&nodes[i].y,           iy, tag, EASING_OUT_QUAD);
+      if (open)
+         bench_push(&nodes[i].x, (float)(selection % 7) * 12.0f,
+               tag, EASING_OUT_QUAD);
+   }
+}
+
+static void bench_switch_category(bench_node_t *categories,
+      unsigned category)
+{
+   unsigned i;
+   menu_animation_ctx_tag tag = (uintptr_t)categories;
+
+   menu_animation_kill_by_tag(&tag);
+
+   for (i = 0; i < BENCH_CATEGORIES; i++)
+   {
+      bench_push(&categories[i].alpha,
+            (i == category) ? 1.0f : 0.5f, tag, EASING_OUT_QUAD);
+      bench_push(&categories[i].zoom,
+            (i == category) ? 1.0f : 0.5f, tag, EASING_OUT_QUAD);
+      bench_push(&categories[i].x,
+            ((float)i - (float)category) * 150.0f, tag, EASING_IN_OUT_SINE);
+   }
+}
+
+/* Same lookups as materialui_list_clear */
+static void bench_clear(bench_node_t *nodes, unsigned count)
+{
+   unsigned i;
+
+   for (i = 0; i < count; i++)
+   {
+      menu_animation_ctx_subject_t subject;
+      float *subjects[2];
+
+      subjects[0]   = &nodes[i].zoom;
+      subjects[1]   = &nodes[i].y;
+      subject.count = 2;
+      subject.data  = subjects;
+
+      menu_animation_kill_by_subject(&subject);
+   }
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i, frame;
+   double t0, t1, checksum = 0.0;
+   menu_timer_t timers[4];
+   unsigned entries        = argc > 1 ? (unsigned)atoi(argv[1]) : BENCH_ENTRIES;
+   unsigned frames         = argc > 2 ? (unsigned)atoi(argv[2]) : BENCH_FRAMES;
+   unsigned selection      = 0;
+   unsigned category       = 0;
+   bench_node_t *nodes     = (bench_node_t*)calloc(entries, sizeof(*nodes));
+   bench_node_t *categories= (bench_node_t*)calloc(BENCH_CATEGORIES,
+         sizeof(*categories));
+
+   if (!nodes || !categories || entries == 0)
+      return 1;
+
+   bench_settings.floats.menu_ticker_speed = 1.0f;
+   strlcpy(bench_settings.arrays.menu_driver, "xmb",
+         sizeof(bench_settings.arrays.menu_driver));
+
+   memset(timers, 0, sizeof(timers));
+
+   t0 = now_sec();
+
+   for (frame = 0; frame < frames; frame++)
+   {
+      if (frame % BENCH_MOVE_FRAMES == 0)
+      {
+         /* Mostly scrolling, now and then a new category whose list
+          * is cleared and opened */
+         if ((frame / BENCH_MOVE_FRAMES) % 16 == 15)
+         {
+            category = (category + 1) % BENCH_CATEGORIES;
+            bench_switch_category(categories, category);
+            bench_clear(nodes, entries);
+            selection = 0;
+            bench_select(nodes, entries, selection, true);
+         }
+         else
+         {
+            selection = (selection + 1) % entries;
+            bench_select(nodes, entries, selection, false);
+         }
+      }
+
+      if (frame % 20 == 0)
+      {
+         menu_timer_ctx_entry_t timer_entry;
+
+         timer_entry.cb       = bench_timer_cb;
+         timer_entry.duration = 250.0f;
+         timer_entry.userdata = NULL;
+
+         menu_timer_start(&timers[(frame / 20) % 4], &timer_entry);
+      }
+
+      bench_time_usec += 16667;
+      menu_animation_update(1920, 1080);
+   }
+
+   t1 = now_sec();
+
+   for (i = 0; i < entries; i++)
+      checksum += nodes[i].alpha + nodes[i].label_alpha
+         + nodes[i].zoom + nodes[i].x + nodes[i].y * 0.001;
+   for (i = 0; i < BENCH_CATEGORIES; i++)
+      checksum += categories[i].alpha + categories[i].zoom
+         + categories[i].x * 0.001;
+
+   printf("%u entries, %u frames: %.3f ms total, %.2f us/frame\n",
+         entries, frames, (t1 - t0) * 1000.0,
+         (t1 - t0) * 1e6 / frames);
+   printf("timers fired: %u, checksum: %.6f\n", bench_timer_fired, checksum);
+
+   menu_animation_ctl(MENU_ANIMATION_CTL_DEINIT, NULL);
+   free(nodes);
+   free(categories);
+
+   return 0;
+}
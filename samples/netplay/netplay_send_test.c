@@ -0,0 +1,338 @@
+/* Loopback test of the netplay send path: one host broadcasts every frame's
+ * commands to a number of spectators through netplay_buf, the way
+ * netplay_send_raw_cmd_all does, plus a savestate every so often. A reader
+ * thread parses every spectator's stream and checks that each command
+ * arrives whole, in order and with the right payload.
+ *
+ * The run is repeated with a send buffer sized as netplay sizes it, and
+ * with a tiny one, so that queued data wraps around the end of the buffer
+ * and the blocking fallback gets used. The host's socket send buffers are
+ * kept small so that savestates are only partly written through.
+ *
+ * Usage: netplay_send_test [peers [frames]] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <net/net_compat.h>
+#include <net/net_socket.h>
+#include <rthreads/rthreads.h>
+
+#include "../../network/netplay/netplay_private.h"
+
+#define CMDS_PER_FRAME  8
+#define CMD_SIZE        16
+#define STATE_SIZE      (64 * 1024)
+#define STATE_INTERVAL  60
+#define SMALL_BUFFER    256
+/* Small enough that a savestate never goes out in one write */
+#define SOCKET_SNDBUF   (16 * 1024)
+
+struct stream_check
+{
+   uint32_t hdr[2];
+   size_t hdr_have;
+   size_t payload_have;
+   uint32_t next_seq;
+   bool bad;
+};
+
+struct peer
+{
+   int host_fd;
+   int spec_fd;
+   struct socket_buffer sbuf;
+   struct stream_check check;
+};
+
+struct reader
+{
+   struct peer *peers;
+   unsigned num_peers;
+   uint32_t expected;
+   bool failed;
+};
+
+static double now_sec(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint8_t pattern(uint32_t seq, size_t i)
+{
+   return (uint8_t)(seq * 31 + i);
+}
+
+static void check_data(struct stream_check *check,
+      const uint8_t *data, size_t len)
+{
+   while (len && !check->bad)
+   {
+      if (check->hdr_have < sizeof(check->hdr))
+      {
+         size_t take = sizeof(check->hdr) - check->hdr_have;
+         if (take > len)
+            take = len;
+         memcpy((uint8_t*)check->hdr + check->hdr_have, data, take);
+         check->hdr_have += take;
+         data            += take;
+         len             -= take;
+
+         if (check->hdr_have == sizeof(check->hdr))
+         {
+            uint32_t size = ntohl(check->hdr[1]);
+            if (ntohl(check->hdr[0]) != check->next_seq ||
+                  (size != CMD_SIZE && size != STATE_SIZE))
+               check->bad = true;
+         }
+         continue;
+      }
+      else
+      {
+         uint32_t seq  = ntohl(check->hdr[0]);
+         size_t size   = ntohl(check->hdr[1]);
+         size_t take   = size - check->payload_have;
+         size_t i;
+
+         if (take > len)
+            take = len;
+         for (i = 0; i < take; i++)
+            if (data[i] != pattern(seq, check->payload_have + i))
+               check->bad = true;
+         check->payload_have += take;
+         data                += take;
+         len                 -= take;
+
+         if (check->payload_have == size)
+         {
+            check->hdr_have     = 0;
+            check->payload_have = 0;
+            check->next_seq++;
+         }
+      }
+   }
+}
+
+static void reader_thread(void *data)
+{
+   static uint8_t sink[65536];
+   struct reader *reader = (struct reader*)data;
+   unsigned i;
+
+   for (;;)
+   {
+      fd_set fds;
+      struct timeval tv;
+      int max_fd = -1;
+      bool done  = true;
+
+      FD_ZERO(&fds);
+      for (i = 0; i < reader->num_peers; i++)
+      {
+         struct peer *peer = &reader->peers[i];
+
+         /* A broken stream never completes; keep draining it so the host
+          * doesn't block, until it stops sending */
+         if (peer->check.bad)
+            reader->failed = true;
+         if (peer->check.bad || peer->check.next_seq < reader->expected)
+         {
+            done = false;
+            FD_SET(peer->spec_fd, &fds);
+            if (peer->spec_fd > max_fd)
+               max_fd = peer->spec_fd;
+         }
+      }
+      if (done)
+         return;
+
+      tv.tv_sec  = 2;
+      tv.tv_usec = 0;
+      if (socket_select(max_fd + 1, &fds, NULL, NULL, &tv) <= 0)
+      {
+         reader->failed = true;
+         return;
+      }
+
+      for (i = 0; i < reader->num_peers; i++)
+      {
+         struct peer *peer = &reader->peers[i];
+         ssize_t ret;
+
+         if (!FD_ISSET(peer->spec_fd, &fds))
+            continue;
+         while ((ret = recv(peer->spec_fd, (char*)sink, sizeof(sink), 0)) > 0)
+            check_data(&peer->check, sink, ret);
+      }
+   }
+}
+
+/* As netplay_send_raw_cmd_all: one header, shared by every peer */
+static bool send_cmd_all(struct peer *peers, unsigned num_peers,
+      uint32_t seq, const void *data, size_t size)
+{
+   uint32_t cmdbuf[2];
+   socket_iov_t iov[2];
+   unsigned i;
+
+   cmdbuf[0]   = htonl(seq);
+   cmdbuf[1]   = htonl(size);
+   iov[0].data = cmdbuf;
+   iov[0].size = sizeof(cmdbuf);
+   iov[1].data = data;
+   iov[1].size = size;
+
+   for (i = 0; i < num_peers; i++)
+      if (!netplay_sendv(&peers[i].sbuf, peers[i].host_fd, iov, 2))
+         return false;
+
+   return true;
+}
+
+static bool run(struct peer *peers, unsigned num_peers, unsigned frames,
+      size_t bufsz, double *elapsed)
+{
+   static uint8_t state[STATE_SIZE];
+   uint8_t cmd[CMD_SIZE];
+   struct reader reader;
+   sthread_t *thread;
+   uint32_t seq = 0;
+   unsigned frame, i, c;
+   bool ok      = true;
+   double start;
+
+   for (i = 0; i < num_peers; i++)
+   {
+      memset(&peers[i].check, 0, sizeof(peers[i].check));
+      if (!netplay_init_socket_buffer(&peers[i].sbuf, bufsz))
+         return false;
+   }
+
+   reader.peers     = peers;
+   reader.num_peers = num_peers;
+   reader.expected  = frames * CMDS_PER_FRAME +
+      (frames + STATE_INTERVAL - 1) / STATE_INTERVAL;
+   reader.failed    = false;
+
+   start  = now_sec();
+   thread = sthread_create(reader_thread, &reader);
+   if (!thread)
+      return false;
+
+   for (frame = 0; frame < frames && ok; frame++)
+   {
+      for (c = 0; c < CMDS_PER_FRAME && ok; c++, seq++)
+      {
+         for (i = 0; i < CMD_SIZE; i++)
+            cmd[i] = pattern(seq, i);
+         ok = send_cmd_all(peers, num_peers, seq, cmd, CMD_SIZE);
+      }
+
+      if (ok && (frame % STATE_INTERVAL) == 0)
+      {
+         /* Rewritten right after the broadcast, so any reference the send
+          * path kept to it would show up as a corrupt payload */
+         for (i = 0; i < STATE_SIZE; i++)
+            state[i] = pattern(seq, i);
+         ok = send_cmd_all(peers, num_peers, seq++, state, STATE_SIZE);
+         memset(state, 0, sizeof(state));
+      }
+
+      for (i = 0; i < num_peers && ok; i++)
+         ok = netplay_send_flush(&peers[i].sbuf, peers[i].host_fd, false);
+   }
+
+   for (i = 0; i < num_peers && ok; i++)
+      ok = netplay_send_flush(&peers[i].sbuf, peers[i].host_fd, true);
+
+   sthread_join(thread);
+   *elapsed = now_sec() - start;
+
+   for (i = 0; i < num_peers; i++)
+      netplay_deinit_socket_buffer(&peers[i].sbuf);
+
+   return ok && !reader.failed;
+}
+
+int main(int argc, char *argv[])
+{
+   struct sockaddr_in addr;
+   socklen_t addrlen  = sizeof(addr);
+   unsigned num_peers = (argc > 1) ? (unsigned)atoi(argv[1]) : 16;
+   unsigned frames    = (argc > 2) ? (unsigned)atoi(argv[2]) : 3000;
+   struct peer *peers = (struct peer*)calloc(num_peers, sizeof(*peers));
+   /* As netplay_init_socket_buffers, with an uncompressed state */
+   size_t bufsizes[2];
+   int listen_fd;
+   unsigned i;
+   int ret            = 0;
+
+   bufsizes[0] = STATE_SIZE + NETPLAY_MAX_STALL_FRAMES * 16;
+   bufsizes[1] = SMALL_BUFFER;
+
+   if (!peers || !network_init())
+      return 1;
+
+   listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+   memset(&addr, 0, sizeof(addr));
+   addr.sin_family      = AF_INET;
+   addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+   if (listen_fd < 0 ||
+         bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+         getsockname(listen_fd, (struct sockaddr*)&addr, &addrlen) < 0 ||
+         listen(listen_fd, num_peers) < 0)
+   {
+      perror("listen");
+      return 1;
+   }
+
+   for (i = 0; i < num_peers; i++)
+   {
+      int flag   = 1;
+      int sndbuf = SOCKET_SNDBUF;
+
+      peers[i].spec_fd = socket(AF_INET, SOCK_STREAM, 0);
+      if (connect(peers[i].spec_fd, (struct sockaddr*)&addr,
+               sizeof(addr)) < 0)
+      {
+         perror("connect");
+         return 1;
+      }
+      peers[i].host_fd = accept(listen_fd, NULL, NULL);
+      setsockopt(peers[i].host_fd, IPPROTO_TCP, TCP_NODELAY,
+            (const char*)&flag, sizeof(flag));
+      setsockopt(peers[i].host_fd, SOL_SOCKET, SO_SNDBUF,
+            (const char*)&sndbuf, sizeof(sndbuf));
+      socket_nonblock(peers[i].host_fd);
+      socket_nonblock(peers[i].spec_fd);
+   }
+
+   printf("%u spectators, %u frames, %u x %u byte commands per frame, "
+         "%u byte state every %u frames\n", num_peers, frames,
+         CMDS_PER_FRAME, CMD_SIZE, STATE_SIZE, STATE_INTERVAL);
+
+   for (i = 0; i < 2; i++)
+   {
+      double t = 0;
+      bool ok = run(peers, num_peers, frames, bufsizes[i], &t);
+
+      printf("send buffer %6u bytes: %s, %8.3f s\n",
+            (unsigned)bufsizes[i], ok ? "OK" : "FAILED", t);
+      if (!ok)
+         ret = 1;
+   }
+
+   for (i = 0; i < num_peers; i++)
+   {
+      socket_close(peers[i].host_fd);
+      socket_close(peers[i].spec_fd);
+   }
+   socket_close(listen_fd);
+   free(peers);
+
+   return ret;
+}
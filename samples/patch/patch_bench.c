@@ -0,0 +1,321 @@
+/* Builds large synthetic BPS and UPS patches, applies them with the
+ * soft-patching code and checks the result against the expected target.
+ * Also times a patch cache hit, which is what later launches pay instead
+ * of applying the patch.
+ *
+ * Usage: patch_bench [size_mib [runs]] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+
+#include "../../tasks/task_patch.c"
+
+#define SYNTH_SIZE_MIB 64
+#define SYNTH_RUNS     5
+
+/* What task_patch.c needs from the rest of RetroArch */
+const char *msg_hash_to_str(enum msg_hash_enums msg)
+{
+   return "";
+}
+
+void RARCH_LOG(const char *fmt, ...) { }
+void RARCH_ERR(const char *fmt, ...) { }
+void RARCH_WARN(const char *fmt, ...) { }
+
+struct patch_buf
+{
+   uint8_t *data;
+   size_t size;
+   size_t capacity;
+};
+
+static double now_sec(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void put(struct patch_buf *buf, const void *data, size_t len)
+{
+   if (buf->size + len > buf->capacity)
+   {
+      buf->capacity = (buf->size + len) * 2;
+      buf->data     = (uint8_t*)realloc(buf->data, buf->capacity);
+   }
+   memcpy(buf->data + buf->size, data, len);
+   buf->size += len;
+}
+
+static void put_byte(struct patch_buf *buf, uint8_t x)
+{
+   put(buf, &x, 1);
+}
+
+/* Variable-length number shared by BPS and UPS */
+static void put_number(struct patch_buf *buf, uint64_t data)
+{
+   for (;;)
+   {
+      uint8_t x = data & 0x7f;
+      data    >>= 7;
+      if (!data)
+      {
+         put_byte(buf, 0x80 | x);
+         break;
+      }
+      put_byte(buf, x);
+      data--;
+   }
+}
+
+static void put_crc(struct patch_buf *buf, uint32_t crc)
+{
+   unsigned i;
+   for (i = 0; i < 32; i += 8)
+      put_byte(buf, (uint8_t)(crc >> i));
+}
+
+static void put_offset(struct patch_buf *buf, int64_t offset)
+{
+   put_number(buf, offset < 0 ? ((uint64_t)-offset << 1) | 1
+         : (uint64_t)offset << 1);
+}
+
+/* A BPS patch mixing all four commands, with runs of a few hundred
+ * bytes. Fills @target with what the patch produces. */
+static void make_bps(const uint8_t *source, size_t size,
+      uint8_t *target, struct patch_buf *patch)
+{
+   size_t out           = 0;
+   size_t source_offset = 0;
+   size_t target_offset = 0;
+
+   put(patch, "BPS1", 4);
+   put_number(patch, size);
+   put_number(patch, size);
+   put_number(patch, 0);
+
+   while (out < size)
+   {
+      unsigned mode = rand() % 4;
+      size_t length = 1 + rand() % 512;
+
+      if (length > size - out)
+         length = size - out;
+
+      /* Copies from the target need something behind them */
+      if (mode == TARGET_COPY && out < 16)
+         mode = SOURCE_READ;
+
+      put_number(patch, ((uint64_t)(length - 1) << 2) | mode);
+
+      switch (mode)
+      {
+         case SOURCE_READ:
+            memcpy(target + out, source + out, length);
+            break;
+         case TARGET_READ:
+         {
+            size_t i;
+            for (i = 0; i < length; i++)
+               target[out + i] = (uint8_t)rand();
+            put(patch, target + out, length);
+            break;
+         }
+         case SOURCE_COPY:
+         {
+            size_t from = rand() % (size - length + 1);
+            put_offset(patch, (int64_t)from - (int64_t)source_offset);
+            memcpy(target + out, source + from, length);
+            source_offset = from + length;
+            break;
+         }
+         case TARGET_COPY:
+         {
+            /* Mostly short repeats, as run-length encoding would give */
+            size_t back = rand() % 2 ? 1 + rand() % 8 : 1 + rand() % out;
+            size_t from = out - (back > out ? out : back);
+            size_t i;
+            put_offset(patch, (int64_t)from - (int64_t)target_offset);
+            for (i = 0; i < length; i++)
+               target[out + i] = target[from + i];
+            target_offset = from + length;
+            break;
+         }
+      }
+
+      out += length;
+   }
+
+   put_crc(patch, encoding_crc32(0, source, size));
+   put_crc(patch, encoding_crc32(0, target, size));
+   put_crc(patch, encoding_crc32(0, patch->data, patch->size));
+}
+
+/* A UPS patch changing a run of bytes every few hundred. Fills
+ * @target with what the patch produces. */
+static void make_ups(const uint8_t *source, size_t size,
+      uint8_t *target, struct patch_buf *patch)
+{
+   size_t pos = 0;
+
+   memcpy(target, source, size);
+
+   put(patch, "UPS1", 4);
+   put_number(patch, size);
+   put_number(patch, size);
+
+   for (;;)
+   {
+      size_t skip   = rand() % 512;
+      size_t length = 1 + rand() % 256;
+      size_t i;
+
+      /* Room for the changed run and the equal byte ending it */
+      if (pos + skip + length + 1 > size)
+         break;
+
+      put_number(patch, skip);
+      pos += skip;
+
+      for (i = 0; i < length; i++)
+      {
+         uint8_t x = (uint8_t)(1 + rand() % 255);
+         put_byte(patch, x);
+         target[pos++] ^= x;
+      }
+
+      put_byte(patch, 0);
+      pos++;
+   }
+
+   put_crc(patch, encoding_crc32(0, source, size));
+   put_crc(patch, encoding_crc32(0, target, size));
+   put_crc(patch, encoding_crc32(0, patch->data, patch->size));
+}
+
+static bool run(const char *name, patch_func_t func,
+      const struct patch_buf *patch, const uint8_t *source,
+      const uint8_t *target, size_t size, unsigned runs)
+{
+   unsigned i;
+   double best = 1e9;
+
+   for (i = 0; i < runs; i++)
+   {
+      uint8_t *out     = NULL;
+      uint64_t out_len = 0;
+      double start     = now_sec();
+      enum patch_error err = func(patch->data, patch->size,
+            source, size, &out, &out_len);
+      double elapsed   = now_sec() - start;
+
+      if (err != PATCH_SUCCESS || out_len != size
+            || memcmp(out, target, size))
+      {
+         printf("%s: wrong result (error %u)\n", name, (unsigned)err);
+         free(out);
+         return false;
+      }
+
+      free(out);
+      if (elapsed < best)
+         best = elapsed;
+   }
+
+   printf("%s: %.1f MiB patch, %8.2f ms, %8.1f MiB/s\n", name,
+         patch->size / (1024.0 * 1024.0), best * 1000.0,
+         size / (1024.0 * 1024.0) / best);
+   return true;
+}
+
+#ifdef PATCH_CACHE_MAGIC
+static bool run_cache(const struct patch_buf *patch, const uint8_t *source,
+      const uint8_t *target, size_t size)
+{
+   patch_cache_t cache;
+   char path[PATH_MAX_LENGTH];
+   const char *content_path = "/tmp/patch_bench_content.bin";
+   const char *patch_path   = "/tmp/patch_bench_content.bps";
+   uint8_t *out             = NULL;
+   uint64_t out_len         = 0;
+   double start;
+   bool ret;
+
+   /* The cache is keyed on the files, not their data */
+   if (     !filestream_write_file(content_path, source, size)
+         || !filestream_write_file(patch_path, patch->data, patch->size))
+      return false;
+
+   snprintf(cache.dir, sizeof(cache.dir), "/tmp/patch_bench_cache");
+   cache.max_size     = (uint64_t)size * 4;
+   cache.content_path = content_path;
+
+   ret = patch_cache_entry_path(&cache, "BPS", patch_path,
+         path, sizeof(path));
+   if (ret)
+   {
+      patch_cache_store(&cache, path, target, size);
+
+      start = now_sec();
+      ret   = patch_cache_entry_path(&cache, "BPS", patch_path,
+            path, sizeof(path))
+         && patch_cache_load(path, &out, &out_len);
+      printf("cache hit: %8.2f ms\n", (now_sec() - start) * 1000.0);
+
+      ret   = ret && out_len == size && !memcmp(out, target, size);
+      filestream_delete(path);
+   }
+
+   if (!ret)
+      printf("cache hit: wrong result\n");
+
+   free(out);
+   filestream_delete(content_path);
+   filestream_delete(patch_path);
+   return ret;
+}
+#endif
+
+int main(int argc, char **argv)
+{
+   struct patch_buf bps = {0};
+   struct patch_buf ups = {0};
+   size_t size   = (size_t)(argc > 1 ? atoi(argv[1]) : SYNTH_SIZE_MIB)
+      * 1024 * 1024;
+   unsigned runs = argc > 2 ? (unsigned)atoi(argv[2]) : SYNTH_RUNS;
+   uint8_t *source = (uint8_t*)malloc(size);
+   uint8_t *target = (uint8_t*)malloc(size);
+   bool ok         = true;
+   size_t i;
+
+   /* Only the patchers and the cache are exercised */
+   (void)patch_content;
+
+   if (!source || !target)
+      return 1;
+
+   srand(1);
+   for (i = 0; i < size; i++)
+      source[i] = (uint8_t)rand();
+
+   make_bps(source, size, target, &bps);
+   ok = run("BPS", bps_apply_patch, &bps, source, target, size, runs) && ok;
+#ifdef PATCH_CACHE_MAGIC
+   ok = run_cache(&bps, source, target, size) && ok;
+#endif
+
+   make_ups(source, size, target, &ups);
+   ok = run("UPS", ups_apply_patch, &ups, source, target, size, runs) && ok;
+
+   free(bps.data);
+   free(ups.data);
+   free(source);
+   free(target);
+   return ok ? 0 : 1;
+}
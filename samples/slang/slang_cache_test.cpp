@@ -0,0 +1,283 @@
+/* Headless test of the SPIR-V cache in glslang_compile_shader: a miss
+ * compiles and stores an entry, a hit loads it back unchanged, and corrupt
+ * or truncated entries are ignored and recompiled. Also compiles on several
+ * threads at once into an empty cache, and checks that the size limit
+ * evicts the least recently used entries.
+ *
+ * Usage: slang_cache_test [cache dir] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include <file/file_path.h>
+#include <lists/dir_list.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
+
+#include "../../configuration.h"
+#include "../../paths.h"
+#include "../../verbosity.h"
+#include "../../gfx/drivers_shader/glslang_util.h"
+#include "../../gfx/drivers_shader/glslang_util_cxx.h"
+
+#define NUM_SHADERS 4
+
+static settings_t test_settings;
+static unsigned compiles, hits;
+
+/* What glslang_util_cxx.cpp needs from the rest of RetroArch */
+settings_t *config_get_ptr(void)
+{
+   return &test_settings;
+}
+
+const char *path_get(enum rarch_path_type type) { return NULL; }
+bool path_is_empty(enum rarch_path_type type) { return true; }
+
+void RARCH_LOG(const char *fmt, ...)
+{
+   /* Counting the log lines tells hits and misses apart */
+   if (strstr(fmt, "Compiling shader"))
+      __atomic_fetch_add(&compiles, 1, __ATOMIC_RELAXED);
+   else if (strstr(fmt, "Loaded cached SPIR-V"))
+      __atomic_fetch_add(&hits, 1, __ATOMIC_RELAXED);
+}
+
+void RARCH_WARN(const char *fmt, ...) { }
+
+void RARCH_ERR(const char *fmt, ...)
+{
+   va_list ap;
+   va_start(ap, fmt);
+   vfprintf(stderr, fmt, ap);
+   va_end(ap);
+}
+
+static const char *shader_source =
+   "#version 450\n"
+   "layout(push_constant) uniform Push { vec4 SourceSize; } params;\n"
+   "layout(std140, set = 0, binding = 0) uniform UBO { mat4 MVP; } global;\n"
+   "#pragma stage vertex\n"
+   "layout(location = 0) in vec4 Position;\n"
+   "layout(location = 1) in vec2 TexCoord;\n"
+   "layout(location = 0) out vec2 vTexCoord;\n"
+   "void main() { gl_Position = global.MVP * Position; vTexCoord = TexCoord; }\n"
+   "#pragma stage fragment\n"
+   "layout(location = 0) in vec2 vTexCoord;\n"
+   "layout(location = 0) out vec4 FragColor;\n"
+   "layout(set = 0, binding = 2) uniform sampler2D Source;\n"
+   "void main() { FragColor = texture(Source, vTexCoord) * %d.0; }\n";
+
+static char cache_dir[PATH_MAX_LENGTH];
+static char spv_dir[PATH_MAX_LENGTH];
+static char shader_paths[NUM_SHADERS][PATH_MAX_LENGTH];
+static glslang_output reference[NUM_SHADERS];
+static int failures;
+
+static void check(bool cond, const char *what)
+{
+   printf("%-60s %s\n", what, cond ? "OK" : "FAILED");
+   if (!cond)
+      failures++;
+}
+
+static struct string_list *list_dir(const char *ext)
+{
+   return dir_list_new(spv_dir, ext, false, true, false, false);
+}
+
+static size_t count_files(const char *ext)
+{
+   struct string_list *list = list_dir(ext);
+   size_t count             = list ? list->size : 0;
+   string_list_free(list);
+   return count;
+}
+
+static void clear_cache(void)
+{
+   size_t i;
+   struct string_list *list = list_dir(NULL);
+
+   for (i = 0; list && i < list->size; i++)
+      filestream_delete(list->elems[i].data);
+   string_list_free(list);
+}
+
+static bool same_output(const glslang_output &a, const glslang_output &b)
+{
+   return a.vertex == b.vertex && a.fragment == b.fragment;
+}
+
+/* Compiles shader @i and reports whether it hit the cache */
+static bool compile(unsigned i, glslang_output *output, bool *hit)
+{
+   unsigned hits_before = hits;
+   bool ret             = glslang_compile_shader(shader_paths[i], output);
+   *hit                 = hits != hits_before;
+   return ret;
+}
+
+/* Rewrites the only cache entry with @edit applied */
+static bool edit_entry(void (*edit)(std::vector<uint8_t> &data))
+{
+   void *buf                = NULL;
+   int64_t len              = 0;
+   struct string_list *list = list_dir("spv");
+   bool ret                 = false;
+
+   if (list && list->size == 1 &&
+         filestream_read_file(list->elems[0].data, &buf, &len))
+   {
+      std::vector<uint8_t> data((uint8_t*)buf, (uint8_t*)buf + len);
+      edit(data);
+      ret = filestream_write_file(list->elems[0].data,
+            data.data(), data.size());
+   }
+
+   free(buf);
+   string_list_free(list);
+   return ret;
+}
+
+static void flip_payload_byte(std::vector<uint8_t> &data)
+{
+   data[data.size() / 2] ^= 0x40;
+}
+
+static void truncate_entry(std::vector<uint8_t> &data)
+{
+   data.resize(data.size() - 7);
+}
+
+static void corrupt_magic(std::vector<uint8_t> &data)
+{
+   data[0] ^= 0xFF;
+}
+
+/* Writes an entry of @size bytes which was last used long ago */
+static void write_stale_entry(const char *name, size_t size)
+{
+   char path[PATH_MAX_LENGTH];
+   std::vector<uint32_t> data(size / sizeof(uint32_t));
+
+   /* magic, version, vertex words, fragment words, crc, last_used */
+   data[0] = 0x43565053;
+   data[1] = 2;
+   data[2] = 1;
+   data[3] = (uint32_t)data.size() - 7;
+   data[4] = 0;
+   data[5] = 1;
+
+   fill_pathname_join(path, spv_dir, name, sizeof(path));
+   filestream_write_file(path, data.data(), data.size() * sizeof(uint32_t));
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i;
+   bool hit;
+   glslang_output output;
+
+   strlcpy(cache_dir, argc > 1 ? argv[1] : "slang_cache_test_dir",
+         sizeof(cache_dir));
+   fill_pathname_join(spv_dir, cache_dir, "slang", sizeof(spv_dir));
+   path_mkdir(spv_dir);
+   clear_cache();
+
+   test_settings.bools.video_shader_spirv_cache      = true;
+   test_settings.uints.video_shader_spirv_cache_size = 32;
+   strlcpy(test_settings.paths.directory_cache, cache_dir,
+         sizeof(test_settings.paths.directory_cache));
+
+   for (i = 0; i < NUM_SHADERS; i++)
+   {
+      char name[32];
+      char source[2048];
+
+      snprintf(name, sizeof(name), "test%u.slang", i);
+      snprintf(source, sizeof(source), shader_source, (int)i + 1);
+      fill_pathname_join(shader_paths[i], cache_dir, name,
+            sizeof(shader_paths[i]));
+      filestream_write_file(shader_paths[i], source, strlen(source));
+   }
+
+   /* Reference output, without the cache */
+   test_settings.bools.video_shader_spirv_cache = false;
+   for (i = 0; i < NUM_SHADERS; i++)
+      if (!glslang_compile_shader(shader_paths[i], &reference[i]))
+      {
+         fprintf(stderr, "Failed to compile %s.\n", shader_paths[i]);
+         return 1;
+      }
+   test_settings.bools.video_shader_spirv_cache = true;
+   check(count_files("spv") == 0, "disabled cache writes nothing");
+
+   check(compile(0, &output, &hit) && !hit, "miss compiles");
+   check(same_output(output, reference[0]), "miss output matches");
+   check(count_files("spv") == 1, "miss stores one entry");
+
+   output = glslang_output();
+   check(compile(0, &output, &hit) && hit, "second compile hits");
+   check(same_output(output, reference[0]), "hit output matches");
+
+   check(edit_entry(flip_payload_byte), "flip a payload byte");
+   check(compile(0, &output, &hit) && !hit, "corrupt payload is recompiled");
+   check(same_output(output, reference[0]), "recompiled output matches");
+   check(compile(0, &output, &hit) && hit, "recompiled entry hits");
+
+   check(edit_entry(truncate_entry), "truncate the entry");
+   check(compile(0, &output, &hit) && !hit, "truncated entry is recompiled");
+
+   check(edit_entry(corrupt_magic), "corrupt the magic");
+   check(compile(0, &output, &hit) && !hit, "bad magic is recompiled");
+   check(compile(0, &output, &hit) && hit, "rewritten entry hits");
+
+   /* Every pass of a preset compiles at once; some share their source */
+   clear_cache();
+   {
+      std::vector<glslang_output> outputs(NUM_SHADERS * 4);
+      bool ok = glslang_parallel_for((unsigned)outputs.size(),
+            [&](unsigned j) -> bool {
+               return glslang_compile_shader(
+                     shader_paths[j % NUM_SHADERS], &outputs[j]);
+            });
+      bool match = ok;
+
+      for (i = 0; i < outputs.size(); i++)
+         if (!same_output(outputs[i], reference[i % NUM_SHADERS]))
+            match = false;
+
+      check(ok && match, "parallel compiles into an empty cache");
+      check(count_files("spv") == NUM_SHADERS, "one entry per source");
+      check(count_files("tmp") == 0, "no temporary files left");
+   }
+
+   for (i = 0; i < NUM_SHADERS; i++)
+      check(compile(i, &output, &hit) && hit &&
+            same_output(output, reference[i]), "parallel entry hits");
+
+   /* A stale entry bigger than the limit goes on the next store */
+   clear_cache();
+   test_settings.uints.video_shader_spirv_cache_size = 1;
+   write_stale_entry("stale.spv", 2 * 1024 * 1024);
+   check(compile(1, &output, &hit) && !hit, "miss with a full cache");
+   {
+      char stale[PATH_MAX_LENGTH];
+      fill_pathname_join(stale, spv_dir, "stale.spv", sizeof(stale));
+      check(!path_is_valid(stale), "least recently used entry evicted");
+   }
+   check(count_files("spv") == 1, "new entry kept");
+
+   clear_cache();
+   for (i = 0; i < NUM_SHADERS; i++)
+      filestream_delete(shader_paths[i]);
+
+   printf("%u compiles, %u cache hits, %d failures\n",
+         compiles, hits, failures);
+   return failures ? 1 : 0;
+}
@@ -0,0 +1,173 @@
+/* Times compiling every pass of a multi-pass preset one after the other,
+ * as the Vulkan and GL core filter chains used to, and through
+ * glslang_parallel_for, as they do now. The SPIR-V cache is off, and both
+ * runs must produce the same code.
+ *
+ * Without arguments, a preset of synthetic passes is generated; otherwise
+ * the given .slang files are used as the passes.
+ *
+ * Usage: slang_preset_bench [runs [pass.slang ...]] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+
+#include <file/file_path.h>
+#include <streams/file_stream.h>
+#include <features/features_cpu.h>
+
+#include "../../configuration.h"
+#include "../../paths.h"
+#include "../../verbosity.h"
+#include "../../gfx/drivers_shader/glslang_util.h"
+#include "../../gfx/drivers_shader/glslang_util_cxx.h"
+
+#define SYNTH_PASSES 8
+
+static settings_t bench_settings;
+
+/* What glslang_util_cxx.cpp needs from the rest of RetroArch */
+settings_t *config_get_ptr(void)
+{
+   return &bench_settings;
+}
+
+const char *path_get(enum rarch_path_type type) { return NULL; }
+bool path_is_empty(enum rarch_path_type type) { return true; }
+
+void RARCH_LOG(const char *fmt, ...) { }
+void RARCH_WARN(const char *fmt, ...) { }
+
+void RARCH_ERR(const char *fmt, ...)
+{
+   va_list ap;
+   va_start(ap, fmt);
+   vfprintf(stderr, fmt, ap);
+   va_end(ap);
+}
+
+/* A pass with a few taps and some math, in the spirit of the usual
+ * CRT and scaling shaders; @taps makes the passes differ in size. */
+static std::string synth_pass(unsigned pass, unsigned taps)
+{
+   char line[256];
+   unsigned i;
+   std::string src =
+      "#version 450\n"
+      "layout(push_constant) uniform Push { vec4 SourceSize; vec4 OutputSize; } params;\n"
+      "layout(std140, set = 0, binding = 0) uniform UBO { mat4 MVP; } global;\n"
+      "#pragma stage vertex\n"
+      "layout(location = 0) in vec4 Position;\n"
+      "layout(location = 1) in vec2 TexCoord;\n"
+      "layout(location = 0) out vec2 vTexCoord;\n"
+      "void main() { gl_Position = global.MVP * Position; vTexCoord = TexCoord; }\n"
+      "#pragma stage fragment\n"
+      "layout(location = 0) in vec2 vTexCoord;\n"
+      "layout(location = 0) out vec4 FragColor;\n"
+      "layout(set = 0, binding = 2) uniform sampler2D Source;\n"
+      "vec3 tonemap(vec3 c) { return c / (c + vec3(1.0)); }\n"
+      "void main()\n"
+      "{\n"
+      "   vec2 px = params.SourceSize.zw;\n"
+      "   vec3 acc = vec3(0.0);\n";
+
+   for (i = 0; i < taps; i++)
+   {
+      snprintf(line, sizeof(line),
+            "   acc += tonemap(texture(Source, vTexCoord + px * vec2(%d.0, %d.0)).rgb)"
+            " * exp(-%u.0 * 0.0%u);\n",
+            (int)(i % 5) - 2, (int)(i / 5) - 2, i, pass + 1);
+      src += line;
+   }
+
+   snprintf(line, sizeof(line),
+         "   FragColor = vec4(pow(acc / %u.0, vec3(1.0 / 2.%u)), 1.0);\n"
+         "}\n", taps, pass);
+   src += line;
+   return src;
+}
+
+static double now_sec(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i, run;
+   unsigned runs      = (argc > 1) ? (unsigned)atoi(argv[1]) : 3;
+   double best_serial = 1e9, best_parallel = 1e9;
+   std::vector<std::string> paths;
+   bool synthetic     = argc <= 2;
+   bool ok            = true;
+
+   bench_settings.bools.video_shader_spirv_cache = false;
+
+   if (synthetic)
+   {
+      for (i = 0; i < SYNTH_PASSES; i++)
+      {
+         char path[64];
+         std::string src = synth_pass(i, 9 + i * 2);
+
+         snprintf(path, sizeof(path), "slang_preset_bench_pass%u.slang", i);
+         filestream_write_file(path, src.data(), src.size());
+         paths.push_back(path);
+      }
+   }
+   else
+      for (i = 2; i < (unsigned)argc; i++)
+         paths.push_back(argv[i]);
+
+   printf("%u passes, %u cores, best of %u runs\n",
+         (unsigned)paths.size(), cpu_features_get_core_amount(), runs);
+
+   for (run = 0; run < runs && ok; run++)
+   {
+      std::vector<glslang_output> serial(paths.size());
+      std::vector<glslang_output> parallel(paths.size());
+      double start = now_sec();
+
+      for (i = 0; i < paths.size() && ok; i++)
+         ok = glslang_compile_shader(paths[i].c_str(), &serial[i]);
+      if (now_sec() - start < best_serial)
+         best_serial = now_sec() - start;
+
+      start = now_sec();
+      ok    = ok && glslang_parallel_for((unsigned)paths.size(),
+            [&](unsigned j) -> bool {
+               return glslang_compile_shader(paths[j].c_str(), &parallel[j]);
+            });
+      if (now_sec() - start < best_parallel)
+         best_parallel = now_sec() - start;
+
+      for (i = 0; i < paths.size() && ok; i++)
+         if (     serial[i].vertex   != parallel[i].vertex
+               || serial[i].fragment != parallel[i].fragment)
+         {
+            fprintf(stderr, "Pass %u compiled differently.\n", i);
+            ok = false;
+         }
+   }
+
+   if (synthetic)
+      for (i = 0; i < paths.size(); i++)
+         filestream_delete(paths[i].c_str());
+
+   if (!ok)
+   {
+      fprintf(stderr, "Failed.\n");
+      return 1;
+   }
+
+   printf("serial:   %8.1f ms\n", best_serial * 1000.0);
+   printf("parallel: %8.1f ms (%.2fx)\n", best_parallel * 1000.0,
+         best_serial / best_parallel);
+   return 0;
+}
@@ -55,6 +55,7 @@
 #include <compat/posix_string.h>
 #include <file/file_path.h>
 #include <file/archive_file.h>
+#include <file/archive_file_cache.h>
 #include <string/stdstring.h>
 
 #include <vfs/vfs_implementation.h>
@@ -179,6 +180,7 @@ struct content_information_ctx
    bool patch_is_blocked;
    bool bios_is_missing;
    bool check_firmware_before_loading;
+   bool mmap_content;
 
    struct string_list *temporary_content;
 };
@@ -493,18 +495,170 @@ void task_push_cdrom_dump(const char *drive)
 }
 #endif
 
+/* Directory @subdir of the cache directory, or of "cache" next to the
+ * config file if none is set. */
+static bool content_cache_subdir(const char *subdir, char *dir, size_t len)
+{
+   settings_t *settings = config_get_ptr();
+
+   if (settings && !string_is_empty(settings->paths.directory_cache))
+      fill_pathname_join(dir, settings->paths.directory_cache, subdir,
+            len);
+   else if (!path_is_empty(RARCH_PATH_CONFIG))
+   {
+      char config_dir[PATH_MAX_LENGTH];
+      fill_pathname_basedir(config_dir, path_get(RARCH_PATH_CONFIG),
+            sizeof(config_dir));
+      fill_pathname_join(dir, config_dir, "cache", len);
+      fill_pathname_join(dir, dir, subdir, len);
+   }
+   else
+      return false;
+
+   return true;
+}
+
+/* Directory and size limit of the cache of soft-patched content
+ * (see apply_patch_content) for the content at @path. Returns false
+ * if it is disabled. */
+static bool content_patch_cache(patch_cache_t *cache, const char *path)
+{
+   settings_t *settings = config_get_ptr();
+
+   if (!settings || !settings->uints.content_patch_cache_size)
+      return false;
+
+   if (!content_cache_subdir("patch", cache->dir, sizeof(cache->dir)))
+      return false;
+
+   cache->max_size     = (uint64_t)settings->uints.content_patch_cache_size
+      * 1024 * 1024;
+   cache->content_path = path;
+   return true;
+}
+
+#ifdef HAVE_COMPRESSION
+/* Directory and size limit of the cache of extracted archive members
+ * (see file_archive_cache_extract). Returns false if it is disabled. */
+static bool content_archive_cache_dir(char *dir, size_t len,
+      uint64_t *max_size)
+{
+   settings_t *settings = config_get_ptr();
+
+   if (!settings || !settings->uints.content_archive_cache_size)
+      return false;
+
+   if (!content_cache_subdir("archive", dir, len))
+      return false;
+
+   *max_size = (uint64_t)settings->uints.content_archive_cache_size
+      * 1024 * 1024;
+   return true;
+}
+
+/* Extracts an archive member through the archive cache. Archives without
+ * a member use the first file with a valid extension, as
+ * file_archive_extract_file would. Returns false if the cache is disabled
+ * or could not take the file. */
+static bool content_archive_cache_extract(const char *path,
+      const char *valid_ext, char *new_path, size_t len)
+{
+   char dir[PATH_MAX_LENGTH];
+   char member_path[PATH_MAX_LENGTH];
+   uint64_t max_size = 0;
+
+   if (!content_archive_cache_dir(dir, sizeof(dir), &max_size))
+      return false;
+
+   if (!path_contains_compressed_file(path))
+   {
+      struct string_list *list = file_archive_get_file_list(path, valid_ext);
+
+      if (!list || list->size == 0)
+      {
+         string_list_free(list);
+         return false;
+      }
+
+      fill_pathname_join_delim(member_path, path, list->elems[0].data, '#',
+            sizeof(member_path));
+      string_list_free(list);
+      path = member_path;
+   }
+
+   if (!file_archive_cache_extract(dir, max_size, path, new_path, len))
+      return false;
+
+   RARCH_LOG("[Content]: Using cached extraction of \"%s\": %s.\n",
+         path, new_path);
+   return true;
+}
+#endif
+
 static int64_t content_file_read(const char *path, void **buf, int64_t *length)
 {
 #ifdef HAVE_COMPRESSION
    if (path_contains_compressed_file(path))
    {
-      if (file_archive_compressed_read(path, buf, NULL, length))
+      char dir[PATH_MAX_LENGTH];
+      uint64_t max_size = 0;
+
+      if (content_archive_cache_dir(dir, sizeof(dir), &max_size))
+      {
+         if (file_archive_cache_read(dir, max_size, path, buf, length))
+            return 1;
+      }
+      else if (file_archive_compressed_read(path, buf, NULL, length))
          return 1;
    }
 #endif
    return filestream_read_file(path, buf, length);
 }
 
+/**
+ * content_file_map:
+ * @path         : path of the content file.
+ * @buf          : read-only view of the content file.
+ * @length       : size of the content file.
+ *
+ * Memory-maps a content file that is not inside an archive, instead
+ * of reading it into a heap buffer. The VFS maps files copy-on-write,
+ * so cores that write to their content get private pages rather than
+ * a fault, just as with a heap buffer.
+ *
+ * The read path NUL-terminates the buffer and some cores rely on it.
+ * A mapping reads as zeroes past the end of the file up to the end of
+ * its last page, which terminates it just the same, but a file that
+ * ends on a page boundary has no such byte and is read instead.
+ *
+ * Returns: the file to close once the content is no longer needed,
+ * or NULL if it could not be mapped.
+ **/
+static RFILE *content_file_map(const char *path, const void **buf,
+      int64_t *length)
+{
+   RFILE *file = NULL;
+
+#ifdef HAVE_COMPRESSION
+   if (path_contains_compressed_file(path))
+      return NULL;
+#endif
+
+   if (!(file = filestream_open(path, RETRO_VFS_FILE_ACCESS_READ,
+               RETRO_VFS_FILE_ACCESS_HINT_FREQUENT_ACCESS)))
+      return NULL;
+
+   /* Pages are 4 KiB or a multiple of it wherever files are mapped */
+   if (     !(*buf = filestream_get_mapped(file, length))
+         || (*length % 4096) == 0)
+   {
+      filestream_close(file);
+      return NULL;
+   }
+
+   return file;
+}
+
 /**
  * content_load_init_wrap:
  * @args                 : Input arguments.
@@ -689,6 +843,8 @@ static bool content_load(content_ctx_info_t *info)
  * @path         : buffer of the content file.
  * @buf          : size   of the content file.
  * @length       : size of the content file that has been read from.
+ * @mapped_file  : set to the file backing *buf if it is memory-mapped,
+ *                 otherwise *buf has to be freed.
  *
  * Read the content file. If read into memory, also performs soft patching
  * (see patch_content function) in case soft patching has not been
@@ -699,18 +855,31 @@ static bool content_load(content_ctx_info_t *info)
 static bool load_content_into_memory(
       content_information_ctx_t *content_ctx,
       unsigned i, const char *path, void **buf,
-      int64_t *length)
+      int64_t *length, RFILE **mapped_file)
 {
    uint8_t *ret_buf          = NULL;
 
    RARCH_LOG("%s: %s.\n",
          msg_hash_to_str(MSG_LOADING_CONTENT_FILE), path);
 
-   if (!content_file_read(path, (void**) &ret_buf, length))
+   *mapped_file = NULL;
+
+   if (content_ctx->mmap_content)
+      *mapped_file = content_file_map(path,
+            (const void**)&ret_buf, length);
+
+   if (!*mapped_file && !content_file_read(path, (void**) &ret_buf, length))
       return false;
 
    if (*length < 0)
+   {
+      if (*mapped_file)
+         filestream_close(*mapped_file);
+      else
+         free(ret_buf);
+      *mapped_file = NULL;
       return false;
+   }
 
    if (i == 0)
    {
@@ -719,12 +888,16 @@ static bool load_content_into_memory(
       /* If we have a media type, ignore CRC32 calculation. */
       if (type == RARCH_CONTENT_NONE)
       {
-         bool has_patch = false;
+         patch_cache_t patch_cache;
+         bool has_patch    = false;
+         uint8_t *patched  = ret_buf;
 
          /* First content file is significant, attempt to do patching,
           * CRC checking, etc. */
 
-         /* Attempt to apply a patch. */
+         /* Attempt to apply a patch. The patchers read the (possibly
+          * mapped) content and write a new buffer, so a mapping never
+          * has to be copied. */
          if (!content_ctx->patch_is_blocked)
             has_patch = patch_content(
                   content_ctx->is_ips_pref,
@@ -733,9 +906,21 @@ static bool load_content_into_memory(
                   content_ctx->name_ips,
                   content_ctx->name_bps,
                   content_ctx->name_ups,
-                  (uint8_t**)&ret_buf,
+                  content_patch_cache(&patch_cache, path)
+                  ? &patch_cache : NULL,
+                  &patched,
                   (void*)length);
 
+         if (patched != ret_buf)
+         {
+            if (*mapped_file)
+               filestream_close(*mapped_file);
+            else
+               free(ret_buf);
+            *mapped_file = NULL;
+            ret_buf      = patched;
+         }
+
          if (has_patch)
          {
             content_rom_crc = encoding_crc32(0, ret_buf, (size_t)*length);
@@ -778,6 +963,16 @@ static bool load_content_from_compressed_archive(
    new_basedir[0]                    = '\0';
    attributes.i                      = 0;
 
+   if (content_archive_cache_extract(path, NULL, new_path, new_path_size))
+   {
+      free(new_basedir);
+      string_list_append(additional_path_allocs, new_path, attributes);
+      info[i].path =
+         additional_path_allocs->elems[additional_path_allocs->size - 1].data;
+      free(new_path);
+      return true;
+   }
+
    RARCH_LOG("Compressed file in case of need_fullpath."
          " Now extracting to temporary directory.\n");
 
@@ -871,6 +1066,16 @@ static bool content_file_init_extract(
 
          temp_content[0] = new_path[0] = '\0';
 
+         /* Cached extractions are kept, not temporary content */
+         if (valid_ext && content_archive_cache_extract(path, valid_ext,
+                  new_path, new_path_size))
+         {
+            string_list_set(content, i, new_path);
+            free(temp_content);
+            free(new_path);
+            continue;
+         }
+
          if (!string_is_empty(path))
             strlcpy(temp_content, path, temp_content_size);
 
@@ -930,6 +1135,7 @@ static bool content_file_init_extract(
  **/
 static bool content_file_load(
       struct retro_game_info *info,
+      RFILE **mapped_files,
       const struct string_list *content,
       content_information_ctx_t *content_ctx,
       char **error_string,
@@ -971,7 +1177,8 @@ static bool content_file_load(
 
          if (!load_content_into_memory(
                   content_ctx,
-                  i, path, (void**)&info[i].data, &len))
+                  i, path, (void**)&info[i].data, &len,
+                  &mapped_files[i]))
          {
             size_t msg_size = 1024 * sizeof(char);
             char *msg       = (char*)malloc(msg_size);
@@ -1278,14 +1485,26 @@ static bool content_file_init(
    {
       unsigned i;
       struct string_list *additional_path_allocs = string_list_new();
+      RFILE **mapped_files                       = (RFILE**)
+         calloc(content->size, sizeof(*mapped_files));
 
-      ret = content_file_load(info, content, content_ctx, error_string,
-            special, additional_path_allocs);
+      if (mapped_files)
+         ret = content_file_load(info, mapped_files, content, content_ctx,
+               error_string, special, additional_path_allocs);
+      else
+         ret = false;
       string_list_free(additional_path_allocs);
 
+      /* The core has to copy the content during retro_load_game() */
       for (i = 0; i < content->size; i++)
-         free((void*)info[i].data);
+      {
+         if (mapped_files && mapped_files[i])
+            filestream_close(mapped_files[i]);
+         else
+            free((void*)info[i].data);
+      }
 
+      free(mapped_files);
       free(info);
    }
    else if (!special)
@@ -1579,6 +1798,7 @@ bool task_push_start_dummy_core(content_ctx_info_t *content_info)
       return false;
 
    content_ctx.check_firmware_before_loading  = settings->bools.check_firmware_before_loading;
+   content_ctx.mmap_content                   = settings->bools.content_mmap_enable;
    content_ctx.is_ips_pref                    = rarch_ctl(RARCH_CTL_IS_IPS_PREF, NULL);
    content_ctx.is_bps_pref                    = rarch_ctl(RARCH_CTL_IS_BPS_PREF, NULL);
    content_ctx.is_ups_pref                    = rarch_ctl(RARCH_CTL_IS_UPS_PREF, NULL);
@@ -1669,6 +1889,7 @@ bool task_push_load_content_from_playlist_from_menu(
    rarch_system_info_t *sys_info              = runloop_get_system_info();
 
    content_ctx.check_firmware_before_loading  = settings->bools.check_firmware_before_loading;
+   content_ctx.mmap_content                   = settings->bools.content_mmap_enable;
    content_ctx.is_ips_pref                    = rarch_ctl(RARCH_CTL_IS_IPS_PREF, NULL);
    content_ctx.is_bps_pref                    = rarch_ctl(RARCH_CTL_IS_BPS_PREF, NULL);
    content_ctx.is_ups_pref                    = rarch_ctl(RARCH_CTL_IS_UPS_PREF, NULL);
@@ -1770,6 +1991,7 @@ bool task_push_start_current_core(content_ctx_info_t *content_info)
       return false;
 
    content_ctx.check_firmware_before_loading  = settings->bools.check_firmware_before_loading;
+   content_ctx.mmap_content                   = settings->bools.content_mmap_enable;
    content_ctx.is_ips_pref                    = rarch_ctl(RARCH_CTL_IS_IPS_PREF, NULL);
    content_ctx.is_bps_pref                    = rarch_ctl(RARCH_CTL_IS_BPS_PREF, NULL);
    content_ctx.is_ups_pref                    = rarch_ctl(RARCH_CTL_IS_UPS_PREF, NULL);
@@ -1894,6 +2116,7 @@ bool task_push_load_content_with_new_core_from_menu(
    settings_t *settings                       = config_get_ptr();
 
    content_ctx.check_firmware_before_loading  = settings->bools.check_firmware_before_loading;
+   content_ctx.mmap_content                   = settings->bools.content_mmap_enable;
    content_ctx.is_ips_pref                    = rarch_ctl(RARCH_CTL_IS_IPS_PREF, NULL);
    content_ctx.is_bps_pref                    = rarch_ctl(RARCH_CTL_IS_BPS_PREF, NULL);
    content_ctx.is_ups_pref                    = rarch_ctl(RARCH_CTL_IS_UPS_PREF, NULL);
@@ -1996,6 +2219,7 @@ static bool task_load_content_callback(content_ctx_info_t *content_info,
    rarch_system_info_t *sys_info              = runloop_get_system_info();
 
    content_ctx.check_firmware_before_loading  = settings->bools.check_firmware_before_loading;
+   content_ctx.mmap_content                   = settings->bools.content_mmap_enable;
    content_ctx.is_ips_pref                    = rarch_ctl(RARCH_CTL_IS_IPS_PREF, NULL);
    content_ctx.is_bps_pref                    = rarch_ctl(RARCH_CTL_IS_BPS_PREF, NULL);
    content_ctx.is_ups_pref                    = rarch_ctl(RARCH_CTL_IS_UPS_PREF, NULL);
@@ -2472,6 +2696,7 @@ bool content_init(void)
    temporary_content                          = string_list_new();
 
    content_ctx.check_firmware_before_loading  = settings->bools.check_firmware_before_loading;
+   content_ctx.mmap_content                   = settings->bools.content_mmap_enable;
    content_ctx.patch_is_blocked               = rarch_ctl(RARCH_CTL_IS_PATCH_BLOCKED, NULL);
    content_ctx.is_ips_pref                    = rarch_ctl(RARCH_CTL_IS_IPS_PREF, NULL);
    content_ctx.is_bps_pref                    = rarch_ctl(RARCH_CTL_IS_BPS_PREF, NULL);
@@ -50,6 +50,11 @@ typedef struct database_state_handle
    size_t list_index;
    size_t entry_index;
    uint8_t *buf;
+   /* Reused by every CRC computed during the scan,
+    * see task_database_file_get_crc */
+   struct retro_vfs_async_queue *crc_queue;
+   uint8_t *crc_buffers;
+   bool crc_queue_failed;
    char archive_name[511];
    char serial[4096];
    database_info_list_t *info;
@@ -362,66 +367,156 @@ static int intfstream_get_crc(intfstream_t *fd, uint32_t *crc)
    return 1;
 }
 
-static bool intfstream_file_get_crc(const char *name,
-      uint64_t offset, size_t size, uint32_t *crc)
+/* Bytes per read while computing the CRC of a file */
+#define DATABASE_CRC_CHUNK_SIZE  (256 * 1024)
+/* Reads queued ahead of the chunk being checksummed */
+#define DATABASE_CRC_QUEUE_DEPTH 4
+
+/* Chunk still being read */
+#define DATABASE_CRC_PENDING     -2
+
+/* The read buffers and the asynchronous read queue are set up on the
+ * first call of a scan and kept in @db_state until it ends. */
+static bool task_database_file_get_crc(database_state_handle_t *db_state,
+      const char *name, uint64_t offset, size_t size, uint32_t *crc)
 {
-   int rv;
-   intfstream_t *fd  = intfstream_open_file(name,
+   unsigned i;
+   uint64_t end, next_read, next_crc;
+   struct retro_vfs_async_result results[DATABASE_CRC_QUEUE_DEPTH];
+   int64_t bytes[DATABASE_CRC_QUEUE_DEPTH];
+   uint32_t acc                        = 0;
+   bool ret                            = false;
+   int64_t file_size                   = -1;
+   uint8_t *buffers                    = NULL;
+   struct retro_vfs_async_queue *queue = NULL;
+   RFILE *fd                           = filestream_open(name,
          RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE);
-   uint8_t *data     = NULL;
-   int64_t file_size = -1;
 
    if (!fd)
-      return 0;
+      return false;
 
-   if (intfstream_seek(fd, 0, SEEK_END) == -1)
-      goto error;
+   file_size = filestream_get_size(fd);
 
-   file_size = intfstream_tell(fd);
+   if (file_size < 0 || offset > (uint64_t)file_size)
+      goto end;
 
-   if (intfstream_seek(fd, 0, SEEK_SET) == -1)
-      goto error;
+   /* A region has to be inside the file, the whole file
+    * is requested with SIZE_MAX */
+   if (offset != 0 || size < (uint64_t)file_size)
+   {
+      if (size > (uint64_t)file_size - offset)
+         goto end;
+      end = offset + size;
+   }
+   else
+      end = (uint64_t)file_size;
 
-   if (file_size < 0)
-      goto error;
+   if (!db_state->crc_buffers && !(db_state->crc_buffers = (uint8_t*)
+            malloc(DATABASE_CRC_QUEUE_DEPTH * DATABASE_CRC_CHUNK_SIZE)))
+      goto end;
+   buffers = db_state->crc_buffers;
 
-   if (offset != 0 || size < (uint64_t) file_size)
+   /* Don't try again for every file once it failed */
+   if (!db_state->crc_queue && !db_state->crc_queue_failed)
+      db_state->crc_queue_failed = !(db_state->crc_queue =
+            filestream_async_open(DATABASE_CRC_QUEUE_DEPTH));
+   queue = db_state->crc_queue;
+
+   /* Without asynchronous reads, read and checksum in turns */
+   if (!queue)
    {
-      if (intfstream_seek(fd, (int64_t)offset, SEEK_SET) == -1)
-         goto error;
+      if (filestream_seek(fd, (int64_t)offset,
+               RETRO_VFS_SEEK_POSITION_START) < 0)
+         goto end;
 
-      data = (uint8_t*)malloc(size);
+      for (next_crc = offset; next_crc < end; )
+      {
+         int64_t len = end - next_crc < DATABASE_CRC_CHUNK_SIZE
+            ? (int64_t)(end - next_crc) : DATABASE_CRC_CHUNK_SIZE;
 
-      if (intfstream_read(fd, data, size) != (int64_t) size)
-         goto error;
+         if (filestream_read(fd, buffers, len) != len)
+            goto end;
 
-      intfstream_close(fd);
-      free(fd);
-      fd = intfstream_open_memory(data, RETRO_VFS_FILE_ACCESS_READ,
-            RETRO_VFS_FILE_ACCESS_HINT_NONE, size);
+         acc       = encoding_crc32(acc, buffers, (size_t)len);
+         next_crc += len;
+      }
 
-      if (!fd)
-         goto error;
+      *crc = acc;
+      ret  = true;
+      goto end;
    }
 
-   rv = intfstream_get_crc(fd, crc);
-   intfstream_close(fd);
-   free(fd);
-   free(data);
-   return rv;
+   /* Chunk n goes to buffer n % DATABASE_CRC_QUEUE_DEPTH, the next
+    * chunks are read while the current one is checksummed */
+   next_read = offset;
+   next_crc  = offset;
 
-error:
-   if (fd)
+   while (next_crc < end)
    {
-      intfstream_close(fd);
-      free(fd);
+      int64_t len;
+      unsigned idx;
+
+      /* Only buffers already checksummed are reused */
+      while (next_read < end && next_read - next_crc
+            < DATABASE_CRC_QUEUE_DEPTH * DATABASE_CRC_CHUNK_SIZE)
+      {
+         idx = (unsigned)(((next_read - offset) / DATABASE_CRC_CHUNK_SIZE)
+               % DATABASE_CRC_QUEUE_DEPTH);
+         len = end - next_read < DATABASE_CRC_CHUNK_SIZE
+            ? (int64_t)(end - next_read) : DATABASE_CRC_CHUNK_SIZE;
+
+         bytes[idx] = DATABASE_CRC_PENDING;
+
+         if (filestream_async_read(queue, fd,
+                  buffers + idx * DATABASE_CRC_CHUNK_SIZE, len,
+                  (int64_t)next_read, (void*)(uintptr_t)idx) != 0)
+            goto end;
+
+         next_read += len;
+      }
+
+      idx = (unsigned)(((next_crc - offset) / DATABASE_CRC_CHUNK_SIZE)
+            % DATABASE_CRC_QUEUE_DEPTH);
+      len = end - next_crc < DATABASE_CRC_CHUNK_SIZE
+         ? (int64_t)(end - next_crc) : DATABASE_CRC_CHUNK_SIZE;
+
+      while (bytes[idx] == DATABASE_CRC_PENDING)
+      {
+         int count = filestream_async_wait(queue, results,
+               DATABASE_CRC_QUEUE_DEPTH, 1);
+
+         if (count < 0)
+            goto end;
+
+         for (i = 0; i < (unsigned)count; i++)
+            bytes[(uintptr_t)results[i].userdata] = results[i].bytes;
+      }
+
+      if (bytes[idx] != len)
+         goto end;
+
+      acc       = encoding_crc32(acc,
+            buffers + idx * DATABASE_CRC_CHUNK_SIZE, (size_t)len);
+      next_crc += len;
    }
-   if (data)
-      free(data);
-   return 0;
+
+   *crc = acc;
+   ret  = true;
+
+end:
+   /* Reads still queued after an error write into the buffers,
+    * closing the queue waits for them */
+   if (queue && !ret)
+   {
+      filestream_async_close(queue);
+      db_state->crc_queue = NULL;
+   }
+   filestream_close(fd);
+   return ret;
 }
 
-static int task_database_cue_get_crc(const char *name, uint32_t *crc)
+static int task_database_cue_get_crc(database_state_handle_t *db_state,
+      const char *name, uint32_t *crc)
 {
    char *track_path = (char *)malloc(PATH_MAX_LENGTH);
    uint64_t offset  = 0;
@@ -446,7 +541,8 @@ static int task_database_cue_get_crc(const char *name, uint32_t *crc)
 
    RARCH_LOG("%s\n", msg_hash_to_str(MSG_READING_FIRST_DATA_TRACK));
 
-   rv = intfstream_file_get_crc(track_path, offset, (size_t)size, crc);
+   rv = task_database_file_get_crc(db_state, track_path,
+         offset, (size_t)size, crc);
    if (rv == 1)
    {
       RARCH_LOG("CUE '%s' crc: %x\n", name, *crc);
@@ -455,7 +551,8 @@ static int task_database_cue_get_crc(const char *name, uint32_t *crc)
    return rv;
 }
 
-static int task_database_gdi_get_crc(const char *name, uint32_t *crc)
+static int task_database_gdi_get_crc(database_state_handle_t *db_state,
+      const char *name, uint32_t *crc)
 {
    char *track_path = (char *)malloc(PATH_MAX_LENGTH);
    int rv           = 0;
@@ -476,7 +573,7 @@ static int task_database_gdi_get_crc(const char *name, uint32_t *crc)
 
    RARCH_LOG("%s\n", msg_hash_to_str(MSG_READING_FIRST_DATA_TRACK));
 
-   rv = intfstream_file_get_crc(track_path, 0, SIZE_MAX, crc);
+   rv = task_database_file_get_crc(db_state, track_path, 0, SIZE_MAX, crc);
    if (rv == 1)
    {
       RARCH_LOG("GDI '%s' crc: %x\n", name, *crc);
@@ -626,7 +723,7 @@ static int task_database_iterate_playlist(
 #ifdef HAVE_COMPRESSION
          database_info_set_type(db, DATABASE_TYPE_CRC_LOOKUP);
          /* first check crc of archive itself */
-         return intfstream_file_get_crc(name,
+         return task_database_file_get_crc(db_state, name,
                0, SIZE_MAX, &db_state->archive_crc);
 #else
          break;
@@ -639,7 +736,8 @@ static int task_database_iterate_playlist(
          else
          {
             database_info_set_type(db, DATABASE_TYPE_CRC_LOOKUP);
-            return task_database_cue_get_crc(name, &db_state->crc);
+            return task_database_cue_get_crc(db_state, name,
+                  &db_state->crc);
          }
          break;
       case FILE_TYPE_GDI:
@@ -652,7 +750,8 @@ static int task_database_iterate_playlist(
          else
          {
             database_info_set_type(db, DATABASE_TYPE_CRC_LOOKUP);
-            return task_database_gdi_get_crc(name, &db_state->crc);
+            return task_database_gdi_get_crc(db_state, name,
+                  &db_state->crc);
          }
          break;
       /* Consider Wii WBFS files similar to ISO files. */
@@ -677,7 +776,8 @@ static int task_database_iterate_playlist(
          break;
       default:
          database_info_set_type(db, DATABASE_TYPE_CRC_LOOKUP);
-         return intfstream_file_get_crc(name, 0, SIZE_MAX, &db_state->crc);
+         return task_database_file_get_crc(db_state, name,
+               0, SIZE_MAX, &db_state->crc);
    }
 
    return 1;
@@ -1345,6 +1445,9 @@ task_finished:
    {
       if (dbstate->list)
          dir_list_free(dbstate->list);
+      if (dbstate->crc_queue)
+         filestream_async_close(dbstate->crc_queue);
+      free(dbstate->crc_buffers);
    }
 
    if (db)
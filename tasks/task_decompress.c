@@ -18,9 +18,15 @@
 #include <string/stdstring.h>
 #include <file/file_path.h>
 #include <file/archive_file.h>
+#include <streams/file_stream.h>
 #include <retro_miscellaneous.h>
 #include <compat/strl.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#include <features/features_cpu.h>
+#endif
+
 #include "tasks_internal.h"
 #include "../file_path_special.h"
 #include "../verbosity.h"
@@ -28,6 +34,358 @@
 
 #define CALLBACK_ERROR_SIZE 4200
 
+/* Archive entries queued per call of the task handler when
+ * they are inflated on worker threads */
+#define DECOMPRESS_ENTRIES_PER_ITERATION 16
+
+#ifdef HAVE_THREADS
+/* Most threads inflating the entries of one archive */
+#define DECOMPRESS_MAX_THREADS           8
+/* Inflated bytes not written yet. An entry larger than this
+ * is still accepted when nothing else is pending */
+#define DECOMPRESS_MEMORY_BUDGET         (64 * 1024 * 1024)
+
+typedef struct decompress_job
+{
+   /* Points into the archive, valid until parsing has ended */
+   const uint8_t *cdata;
+   /* Inflated contents, NULL for stored and empty entries */
+   uint8_t *data;
+   struct decompress_job *next;
+   struct decompress_job *next_work;
+   uint32_t csize;
+   uint32_t size;
+   int progress;
+   bool inflate;
+   bool done;
+   bool failed;
+   char path[PATH_MAX_LENGTH];
+} decompress_job_t;
+
+struct decompress_pool
+{
+   const struct file_archive_file_backend *backend;
+   slock_t *lock;
+   /* Workers wait here for jobs */
+   scond_t *work_cond;
+   /* The task waits here for the oldest job */
+   scond_t *done_cond;
+   sthread_t *threads[DECOMPRESS_MAX_THREADS];
+   unsigned num_threads;
+   /* Jobs in archive order, files are written from the head */
+   decompress_job_t *head;
+   decompress_job_t *tail;
+   /* Jobs not taken by a worker yet */
+   decompress_job_t *work_head;
+   decompress_job_t *work_tail;
+   unsigned num_jobs;
+   unsigned max_jobs;
+   size_t pending_bytes;
+   /* Progress of the last entry written */
+   int progress;
+   bool quit;
+};
+#endif
+
+static void task_decompress_set_error(decompress_state_t *dec,
+      const char *path)
+{
+   /* Keep the first error */
+   if (dec->callback_error)
+      return;
+
+   dec->callback_error = (char*)malloc(CALLBACK_ERROR_SIZE);
+   snprintf(dec->callback_error, CALLBACK_ERROR_SIZE,
+         "Failed to deflate %s.\n", path);
+}
+
+#ifdef HAVE_THREADS
+static bool task_decompress_inflate(
+      const struct file_archive_file_backend *backend,
+      decompress_job_t *job)
+{
+   int ret;
+   file_archive_file_handle_t handle;
+
+   handle.stream        = NULL;
+   handle.data          = NULL;
+   handle.real_checksum = 0;
+   handle.backend       = backend;
+
+   if (!backend->stream_decompress_data_to_file_init(&handle,
+            job->cdata, job->csize, job->size))
+      return false;
+
+   do
+   {
+      ret = backend->stream_decompress_data_to_file_iterate(handle.stream);
+   } while (ret == 0);
+
+   backend->stream_free(handle.stream);
+
+   if (ret == -1)
+   {
+      free(handle.data);
+      return false;
+   }
+
+   job->data = handle.data;
+   return true;
+}
+
+static void task_decompress_worker(void *data)
+{
+   struct decompress_pool *pool = (struct decompress_pool*)data;
+
+   slock_lock(pool->lock);
+
+   for (;;)
+   {
+      bool ok;
+      decompress_job_t *job = NULL;
+
+      while (!pool->work_head && !pool->quit)
+         scond_wait(pool->work_cond, pool->lock);
+
+      if (pool->quit)
+         break;
+
+      job             = pool->work_head;
+      pool->work_head = job->next_work;
+      if (!pool->work_head)
+         pool->work_tail = NULL;
+
+      slock_unlock(pool->lock);
+      ok = task_decompress_inflate(pool->backend, job);
+      slock_lock(pool->lock);
+
+      job->failed = !ok;
+      job->done   = true;
+      scond_signal(pool->done_cond);
+   }
+
+   slock_unlock(pool->lock);
+}
+
+static void task_decompress_pool_free(struct decompress_pool *pool)
+{
+   unsigned i;
+
+   if (!pool)
+      return;
+
+   if (pool->num_threads)
+   {
+      /* Workers finish the entry they are inflating, the
+       * others are dropped */
+      slock_lock(pool->lock);
+      pool->quit = true;
+      scond_broadcast(pool->work_cond);
+      slock_unlock(pool->lock);
+
+      for (i = 0; i < pool->num_threads; i++)
+         sthread_join(pool->threads[i]);
+   }
+
+   while (pool->head)
+   {
+      decompress_job_t *job = pool->head;
+      pool->head            = job->next;
+      free(job->data);
+      free(job);
+   }
+
+   if (pool->work_cond)
+      scond_free(pool->work_cond);
+   if (pool->done_cond)
+      scond_free(pool->done_cond);
+   if (pool->lock)
+      slock_free(pool->lock);
+   free(pool);
+}
+
+static struct decompress_pool *task_decompress_pool_new(
+      const struct file_archive_file_backend *backend)
+{
+   unsigned i;
+   unsigned num_threads         = cpu_features_get_core_amount();
+   struct decompress_pool *pool = NULL;
+
+   /* Only zip entries can be inflated independently, 7z entries
+    * come out of one solid stream */
+   if (!backend || backend != file_archive_get_zlib_file_backend()
+         || num_threads < 2)
+      return NULL;
+
+   if (num_threads > DECOMPRESS_MAX_THREADS)
+      num_threads = DECOMPRESS_MAX_THREADS;
+
+   if (!(pool = (struct decompress_pool*)calloc(1, sizeof(*pool))))
+      return NULL;
+
+   pool->backend   = backend;
+   pool->max_jobs  = num_threads * 4;
+   pool->lock      = slock_new();
+   pool->work_cond = scond_new();
+   pool->done_cond = scond_new();
+
+   if (!pool->lock || !pool->work_cond || !pool->done_cond)
+      goto error;
+
+   for (i = 0; i < num_threads; i++)
+   {
+      if (!(pool->threads[i] = sthread_create(task_decompress_worker, pool)))
+         break;
+      pool->num_threads++;
+   }
+
+   if (!pool->num_threads)
+      goto error;
+
+   return pool;
+
+error:
+   task_decompress_pool_free(pool);
+   return NULL;
+}
+
+/* Writes the oldest entry if it has been inflated, waiting for it
+ * if @wait is set. Returns 1 if an entry was written, 0 if there was
+ * none ready and -1 on error. */
+static int task_decompress_pool_write_head(decompress_state_t *dec, bool wait)
+{
+   bool ok;
+   struct decompress_pool *pool = dec->pool;
+   decompress_job_t *job        = NULL;
+
+   slock_lock(pool->lock);
+
+   if (!(job = pool->head) || (!job->done && !wait))
+   {
+      slock_unlock(pool->lock);
+      return 0;
+   }
+
+   while (!job->done)
+      scond_wait(pool->done_cond, pool->lock);
+
+   pool->head = job->next;
+   if (!pool->head)
+      pool->tail = NULL;
+   pool->num_jobs--;
+   if (job->inflate)
+      pool->pending_bytes -= job->size;
+
+   slock_unlock(pool->lock);
+
+   /* Entries after an error are dropped */
+   ok = !job->failed && !dec->callback_error
+      && filestream_write_file(job->path,
+            job->data ? job->data : job->cdata, job->size);
+
+   if (!ok)
+      task_decompress_set_error(dec, job->path);
+
+   pool->progress = job->progress;
+
+   free(job->data);
+   free(job);
+
+   return ok ? 1 : -1;
+}
+
+/* Writes all entries, in archive order */
+static void task_decompress_pool_flush(decompress_state_t *dec)
+{
+   while (dec->pool->head)
+      task_decompress_pool_write_head(dec, true);
+}
+
+static bool task_decompress_pool_push(decompress_state_t *dec,
+      const char *path, const uint8_t *cdata, unsigned cmode,
+      uint32_t csize, uint32_t size)
+{
+   struct decompress_pool *pool = dec->pool;
+   decompress_job_t *job        = NULL;
+   bool inflate                 = cmode == ARCHIVE_MODE_COMPRESSED && size;
+
+   if (cmode != ARCHIVE_MODE_UNCOMPRESSED && cmode != ARCHIVE_MODE_COMPRESSED)
+      return false;
+
+   /* Write the oldest entries until this one fits into the budget */
+   for (;;)
+   {
+      bool full;
+
+      slock_lock(pool->lock);
+      full = pool->num_jobs >= pool->max_jobs
+         || (pool->num_jobs && inflate
+               && pool->pending_bytes + size > DECOMPRESS_MEMORY_BUDGET);
+      slock_unlock(pool->lock);
+
+      if (!full)
+         break;
+
+      if (task_decompress_pool_write_head(dec, true) < 0)
+         return false;
+   }
+
+   if (!(job = (decompress_job_t*)calloc(1, sizeof(*job))))
+      return false;
+
+   job->cdata    = cdata;
+   job->csize    = csize;
+   job->size     = size;
+   job->inflate  = inflate;
+   job->done     = !inflate;
+   job->progress = file_archive_parse_file_progress(&dec->archive);
+   strlcpy(job->path, path, sizeof(job->path));
+
+   slock_lock(pool->lock);
+
+   if (pool->tail)
+      pool->tail->next = job;
+   else
+      pool->head       = job;
+   pool->tail          = job;
+   pool->num_jobs++;
+
+   if (inflate)
+   {
+      if (pool->work_tail)
+         pool->work_tail->next_work = job;
+      else
+         pool->work_head            = job;
+      pool->work_tail               = job;
+      pool->pending_bytes          += size;
+      scond_signal(pool->work_cond);
+   }
+
+   slock_unlock(pool->lock);
+
+   return true;
+}
+#endif
+
+/* Extracts an entry, on the worker threads if there are any */
+static bool task_decompress_file(decompress_state_t *dec,
+      const char *path, const char *valid_exts,
+      const uint8_t *cdata, unsigned cmode, uint32_t csize, uint32_t size,
+      uint32_t crc32, struct archive_extract_userdata *userdata)
+{
+   /* A queued entry has failed already */
+   if (dec->callback_error)
+      return false;
+
+#ifdef HAVE_THREADS
+   if (dec->pool)
+      return task_decompress_pool_push(dec, path, cdata, cmode, csize, size);
+#endif
+
+   return file_archive_perform_mode(path, valid_exts,
+         cdata, cmode, csize, size, crc32, userdata);
+}
+
 static int file_decompressed_target_file(const char *name,
       const char *valid_exts,
       const uint8_t *cdata,
@@ -68,7 +426,7 @@ static int file_decompressed_subdir(const char *name,
    if (!path_mkdir(path_dir))
       goto error;
 
-   if (!file_archive_perform_mode(path, valid_exts,
+   if (!task_decompress_file(userdata->dec, path, valid_exts,
             cdata, cmode, csize, size, crc32, userdata))
       goto error;
 
@@ -79,9 +437,7 @@ static int file_decompressed_subdir(const char *name,
    return 1;
 
 error:
-   userdata->dec->callback_error = (char*)malloc(CALLBACK_ERROR_SIZE);
-   snprintf(userdata->dec->callback_error,
-         CALLBACK_ERROR_SIZE, "Failed to deflate %s.\n", path);
+   task_decompress_set_error(userdata->dec, path);
 
    return 0;
 }
@@ -110,7 +466,7 @@ static int file_decompressed(const char *name, const char *valid_exts,
 
    fill_pathname_join(path, dec->target_dir, name, sizeof(path));
 
-   if (!file_archive_perform_mode(path, valid_exts,
+   if (!task_decompress_file(dec, path, valid_exts,
             cdata, cmode, csize, size, crc32, userdata))
       goto error;
 
@@ -120,9 +476,7 @@ static int file_decompressed(const char *name, const char *valid_exts,
    return 1;
 
 error:
-   dec->callback_error = (char*)malloc(CALLBACK_ERROR_SIZE);
-   snprintf(dec->callback_error, CALLBACK_ERROR_SIZE,
-         "Failed to deflate %s.\n", path);
+   task_decompress_set_error(dec, path);
 
    return 0;
 }
@@ -132,6 +486,11 @@ static void task_decompress_handler_finished(retro_task_t *task,
 {
    task_set_finished(task, true);
 
+#ifdef HAVE_THREADS
+   task_decompress_pool_free(dec->pool);
+   dec->pool = NULL;
+#endif
+
    if (!task_get_error(task) && task_get_cancelled(task))
       task_set_error(task, strdup("Task canceled"));
 
@@ -156,27 +515,62 @@ static void task_decompress_handler_finished(retro_task_t *task,
    free(dec);
 }
 
-static void task_decompress_handler(retro_task_t *task)
+static void task_decompress_iterate(retro_task_t *task,
+      decompress_state_t *dec, file_archive_file_cb file_cb)
 {
    int ret;
-   bool retdec                              = false;
-   decompress_state_t *dec                  = (decompress_state_t*)
-      task->state;
+   bool retdec      = false;
+   unsigned entries = 0;
 
    dec->userdata->dec            = dec;
    strlcpy(dec->userdata->archive_path,
          dec->source_file, sizeof(dec->userdata->archive_path));
 
-   ret                     = file_archive_parse_file_iterate(
-         &dec->archive,
-         &retdec, dec->source_file,
-         dec->valid_ext, file_decompressed, dec->userdata);
+#ifdef HAVE_THREADS
+   if (dec->pool)
+   {
+      /* Queued entries point into the archive, which is
+       * closed by the next iteration once parsing has ended */
+      if (dec->archive.type != ARCHIVE_TRANSFER_ITERATE)
+         task_decompress_pool_flush(dec);
+      else
+         while (task_decompress_pool_write_head(dec, false) > 0);
+   }
+#endif
 
-   task_set_progress(task,
-         file_archive_parse_file_progress(&dec->archive));
+   do
+   {
+      bool init = dec->archive.type == ARCHIVE_TRANSFER_INIT;
+
+      ret       = file_archive_parse_file_iterate(
+            &dec->archive,
+            &retdec, dec->source_file,
+            dec->valid_ext, file_cb, dec->userdata);
+
+#ifdef HAVE_THREADS
+      if (init && dec->archive.type == ARCHIVE_TRANSFER_ITERATE)
+         dec->pool = task_decompress_pool_new(dec->archive.backend);
+#endif
+   } while (dec->pool && ret == 0
+         && dec->archive.type == ARCHIVE_TRANSFER_ITERATE
+         && ++entries < DECOMPRESS_ENTRIES_PER_ITERATION
+         && !task_get_cancelled(task));
+
+#ifdef HAVE_THREADS
+   if (dec->pool)
+      task_set_progress(task, dec->pool->progress);
+   else
+#endif
+      task_set_progress(task,
+            file_archive_parse_file_progress(&dec->archive));
 
    if (task_get_cancelled(task) || ret != 0)
    {
+#ifdef HAVE_THREADS
+      /* Stop the workers before the archive is closed */
+      task_decompress_pool_free(dec->pool);
+      dec->pool = NULL;
+#endif
       task_set_error(task, dec->callback_error);
       file_archive_parse_file_iterate_stop(&dec->archive);
 
@@ -184,6 +578,12 @@ static void task_decompress_handler(retro_task_t *task)
    }
 }
 
+static void task_decompress_handler(retro_task_t *task)
+{
+   task_decompress_iterate(task,
+         (decompress_state_t*)task->state, file_decompressed);
+}
+
 static void task_decompress_handler_target_file(retro_task_t *task)
 {
    bool retdec;
@@ -212,30 +612,8 @@ static void task_decompress_handler_target_file(retro_task_t *task)
 
 static void task_decompress_handler_subdir(retro_task_t *task)
 {
-   int ret;
-   bool retdec;
-   decompress_state_t *dec = (decompress_state_t*)task->state;
-
-   dec->userdata->dec            = dec;
-   strlcpy(dec->userdata->archive_path,
-         dec->source_file,
-         sizeof(dec->userdata->archive_path));
-
-   ret                     = file_archive_parse_file_iterate(
-         &dec->archive,
-         &retdec, dec->source_file,
-         dec->valid_ext, file_decompressed_subdir, dec->userdata);
-
-   task_set_progress(task,
-         file_archive_parse_file_progress(&dec->archive));
-
-   if (task_get_cancelled(task) || ret != 0)
-   {
-      task_set_error(task, dec->callback_error);
-      file_archive_parse_file_iterate_stop(&dec->archive);
-
-      task_decompress_handler_finished(task, dec);
-   }
+   task_decompress_iterate(task,
+         (decompress_state_t*)task->state, file_decompressed_subdir);
 }
 
 static bool task_decompress_finder(
@@ -325,7 +703,7 @@ bool task_push_decompress(
    if (!s)
       return false;
 
-   t                   = (retro_task_t*)calloc(1, sizeof(*t));
+   t                   = task_init();
 
    if (!t)
    {
@@ -0,0 +1,193 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <lists/dir_list.h>
+#include <lists/string_list.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#include "tasks_internal.h"
+
+/* Directory entries read per call of the task handler */
+#define DIR_LIST_BATCH_SIZE 256
+
+typedef struct dir_list_handle
+{
+   dir_list_stream_t *stream;
+   /* Entries read but not taken yet, NULL if there are none */
+   struct string_list *pending;
+#ifdef HAVE_THREADS
+   slock_t *lock;
+#endif
+} dir_list_handle_t;
+
+static void task_dir_list_free(retro_task_t *task)
+{
+   dir_list_handle_t *handle = (dir_list_handle_t*)task->state;
+
+   if (!handle)
+      return;
+
+   dir_list_stream_free(handle->stream);
+   string_list_free(handle->pending);
+#ifdef HAVE_THREADS
+   slock_free(handle->lock);
+#endif
+   free(handle);
+   task->state = NULL;
+}
+
+static void task_dir_list_handler(retro_task_t *task)
+{
+   int ret;
+   dir_list_handle_t *handle = (dir_list_handle_t*)task->state;
+   struct string_list *batch = NULL;
+
+   if (task_get_cancelled(task))
+   {
+      task_set_finished(task, true);
+      return;
+   }
+
+   if (!(batch = string_list_new()))
+   {
+      task_set_error(task, strdup("out of memory"));
+      task_set_finished(task, true);
+      return;
+   }
+
+   /* Directory access happens outside the lock, so taking entries
+    * never waits on a slow file system */
+   ret = dir_list_stream_read(handle->stream, batch, DIR_LIST_BATCH_SIZE);
+
+#ifdef HAVE_THREADS
+   slock_lock(handle->lock);
+#endif
+   if (!handle->pending)
+   {
+      handle->pending = batch;
+      batch           = NULL;
+   }
+   else
+   {
+      size_t i;
+      for (i = 0; i < batch->size; i++)
+         string_list_append(handle->pending,
+               batch->elems[i].data, batch->elems[i].attr);
+   }
+#ifdef HAVE_THREADS
+   slock_unlock(handle->lock);
+#endif
+
+   string_list_free(batch);
+
+   if (ret == -1)
+      task_set_error(task, strdup("could not read directory"));
+
+   if (ret != 1)
+      task_set_finished(task, true);
+}
+
+/**
+ * task_dir_list_take:
+ * @task               : task returned by task_push_dir_list.
+ *
+ * Takes the entries the task has read since the last call. Only valid
+ * until the task callback has run.
+ *
+ * Returns: the entries in directory order, NULL if there are none.
+ * Has to be freed with string_list_free.
+ **/
+struct string_list *task_dir_list_take(void *task)
+{
+   struct string_list *list  = NULL;
+   dir_list_handle_t *handle = (dir_list_handle_t*)
+      ((retro_task_t*)task)->state;
+
+   if (!handle)
+      return NULL;
+
+#ifdef HAVE_THREADS
+   slock_lock(handle->lock);
+#endif
+   list            = handle->pending;
+   handle->pending = NULL;
+#ifdef HAVE_THREADS
+   slock_unlock(handle->lock);
+#endif
+
+   return list;
+}
+
+/**
+ * task_push_dir_list:
+ * @stream             : directory stream, owned by the task from now on.
+ * @cb                 : called on the main thread once the listing has
+ *                       ended or was cancelled. It can still take the
+ *                       last entries with task_dir_list_take.
+ * @user_data          : passed to @cb.
+ *
+ * Reads the rest of a directory listing in the background, a batch of
+ * entries at a time. Cancel it with task_queue_cancel_task.
+ *
+ * Returns: the task, NULL on error (the stream is freed).
+ **/
+void *task_push_dir_list(dir_list_stream_t *stream,
+      retro_task_callback_t cb, void *user_data)
+{
+   retro_task_t *task        = NULL;
+   dir_list_handle_t *handle = (dir_list_handle_t*)
+      calloc(1, sizeof(*handle));
+
+   if (!handle)
+      goto error;
+
+   handle->stream = stream;
+
+#ifdef HAVE_THREADS
+   if (!(handle->lock = slock_new()))
+      goto error;
+#endif
+
+   if (!(task = task_init()))
+      goto error;
+
+   task->handler   = task_dir_list_handler;
+   task->callback  = cb;
+   task->cleanup   = task_dir_list_free;
+   task->state     = handle;
+   task->user_data = user_data;
+   task->mute      = true;
+
+   task_queue_push(task);
+
+   return task;
+
+error:
+   if (handle)
+   {
+#ifdef HAVE_THREADS
+      slock_free(handle->lock);
+#endif
+      free(handle);
+   }
+   dir_list_stream_free(stream);
+   return NULL;
+}
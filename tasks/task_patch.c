@@ -21,19 +21,30 @@
 
 #include <stdint.h>
 #include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 #include <boolean.h>
 
 #include <compat/msvc.h>
+#include <compat/strl.h>
 #include <file/file_path.h>
+#include <lists/dir_list.h>
 #include <streams/file_stream.h>
 #include <string/stdstring.h>
+#include <retro_miscellaneous.h>
+#include <rhash.h>
 
 #include <encodings/crc32.h>
+#include <encodings/utf.h>
 
 #include "../msg_hash.h"
 #include "../verbosity.h"
 
+#define PATCH_CACHE_MAGIC   0x48435450 /* "PTCH" */
+#define PATCH_CACHE_VERSION 2
+
 enum bps_mode
 {
    SOURCE_READ = 0,
@@ -69,12 +80,10 @@ struct bps_data
    size_t modify_offset;
    size_t source_offset;
    size_t target_offset;
-   uint32_t modify_checksum;
-   uint32_t source_checksum;
-   uint32_t target_checksum;
    size_t source_relative_offset;
    size_t target_relative_offset;
    size_t output_offset;
+   bool overrun;
 };
 
 struct ups_data
@@ -88,20 +97,43 @@ struct ups_data
    unsigned patch_offset;
    unsigned source_offset;
    unsigned target_offset;
-   unsigned patch_checksum;
-   unsigned source_checksum;
-   unsigned target_checksum;
+};
+
+/* Where patched content is cached, see apply_patch_content */
+typedef struct
+{
+   char dir[PATH_MAX_LENGTH];
+   uint64_t max_size;
+   /* File the content being patched was loaded from */
+   const char *content_path;
+} patch_cache_t;
+
+/* Header of a cache entry, followed by the patched content */
+struct patch_cache_header
+{
+   uint32_t magic;
+   uint32_t version;
+   /* time() of the last launch that used the entry */
+   uint64_t last_used;
+   uint64_t size;
+   uint32_t crc;
+   uint32_t padding;
 };
 
 typedef enum patch_error (*patch_func_t)(const uint8_t*, uint64_t,
       const uint8_t*, uint64_t, uint8_t**, uint64_t*);
 
+/* The checksums of the patch, source and target data are computed over
+ * whole blocks once the patch has been applied, instead of per byte. */
+
 static uint8_t bps_read(struct bps_data *bps)
 {
-   uint8_t data         = bps->modify_data[bps->modify_offset++];
-   bps->modify_checksum = ~(encoding_crc32(
-         ~bps->modify_checksum, &data, 1));
-   return data;
+   if (bps->modify_offset < bps->modify_length)
+      return bps->modify_data[bps->modify_offset++];
+
+   /* Flag the overrun and end any number being decoded */
+   bps->overrun = true;
+   return 0x80;
 }
 
 static uint64_t bps_decode(struct bps_data *bps)
@@ -121,10 +153,37 @@ static uint64_t bps_decode(struct bps_data *bps)
    return data;
 }
 
-static void bps_write(struct bps_data *bps, uint8_t data)
+/* Copies @length bytes from bps->target_offset to the output offset.
+ * The ranges overlap when the offset is just behind the output, which
+ * repeats the bytes in between. */
+static void bps_copy_target(struct bps_data *bps, size_t length)
 {
-   bps->target_data[bps->output_offset++] = data;
-   bps->target_checksum = ~(encoding_crc32(~bps->target_checksum, &data, 1));
+   uint8_t *target = bps->target_data;
+   size_t src      = bps->target_offset;
+   size_t dst      = bps->output_offset;
+
+   bps->target_offset += length;
+   bps->output_offset += length;
+
+   if (src >= dst || src + length <= dst)
+   {
+      memmove(target + dst, target + src, length);
+      return;
+   }
+
+   /* target[src, dst) repeats from dst on, so the run that can be
+    * copied in one go doubles every time */
+   while (length)
+   {
+      size_t n = dst - src;
+
+      if (n > length)
+         n = length;
+
+      memcpy(target + dst, target + src, n);
+      dst    += n;
+      length -= n;
+   }
 }
 
 static enum patch_error bps_apply_patch(
@@ -134,6 +193,8 @@ static enum patch_error bps_apply_patch(
 {
    size_t i;
    uint32_t checksum;
+   uint32_t source_checksum;
+   uint32_t target_checksum;
    size_t modify_source_size;
    size_t modify_target_size;
    size_t modify_markup_size;
@@ -154,12 +215,10 @@ static enum patch_error bps_apply_patch(
    bps.modify_offset          = 0;
    bps.source_offset          = 0;
    bps.target_offset          = 0;
-   bps.modify_checksum        = ~0;
-   bps.source_checksum        = 0;
-   bps.target_checksum        = ~0;
    bps.source_relative_offset = 0;
    bps.target_relative_offset = 0;
    bps.output_offset          = 0;
+   bps.overrun                = false;
 
    if (  (bps_read(&bps) != 'B') ||
          (bps_read(&bps) != 'P') ||
@@ -171,8 +230,9 @@ static enum patch_error bps_apply_patch(
    modify_target_size  = bps_decode(&bps);
    modify_markup_size  = bps_decode(&bps);
 
-   for (i = 0; i < modify_markup_size; i++)
-      bps_read(&bps);
+   if (modify_markup_size > bps.modify_length - bps.modify_offset)
+      return PATCH_PATCH_INVALID;
+   bps.modify_offset += modify_markup_size;
 
    if (modify_source_size > bps.source_length)
       return PATCH_SOURCE_TOO_SMALL;
@@ -191,19 +251,31 @@ static enum patch_error bps_apply_patch(
    {
       size_t length = bps_decode(&bps);
       unsigned mode = length & 3;
+      size_t space  = bps.target_length - bps.output_offset;
 
       length = (length >> 2) + 1;
 
+      if (bps.overrun || length > space)
+         return PATCH_PATCH_INVALID;
+
       switch (mode)
       {
          case SOURCE_READ:
-            while (length--)
-               bps_write(&bps, bps.source_data[bps.output_offset]);
+            if (bps.output_offset > bps.source_length
+                  || length > bps.source_length - bps.output_offset)
+               return PATCH_PATCH_INVALID;
+            memcpy(bps.target_data + bps.output_offset,
+                  bps.source_data + bps.output_offset, length);
+            bps.output_offset += length;
             break;
 
          case TARGET_READ:
-            while (length--)
-               bps_write(&bps, bps_read(&bps));
+            if (length > bps.modify_length - bps.modify_offset)
+               return PATCH_PATCH_INVALID;
+            memcpy(bps.target_data + bps.output_offset,
+                  bps.modify_data + bps.modify_offset, length);
+            bps.modify_offset += length;
+            bps.output_offset += length;
             break;
 
          case SOURCE_COPY:
@@ -220,15 +292,21 @@ static enum patch_error bps_apply_patch(
             if (mode == SOURCE_COPY)
             {
                bps.source_offset += offset;
-               while (length--)
-                  bps_write(&bps, bps.source_data[bps.source_offset++]);
+               if (bps.source_offset > bps.source_length
+                     || length > bps.source_length - bps.source_offset)
+                  return PATCH_PATCH_INVALID;
+               memcpy(bps.target_data + bps.output_offset,
+                     bps.source_data + bps.source_offset, length);
+               bps.source_offset += length;
+               bps.output_offset += length;
             }
             else
             {
                bps.target_offset += offset;
-               while (length--)
-                  bps_write(&bps, bps.target_data[bps.target_offset++]);
-               break;
+               if (bps.target_offset > bps.target_length
+                     || length > bps.target_length - bps.target_offset)
+                  return PATCH_PATCH_INVALID;
+               bps_copy_target(&bps, length);
             }
             break;
          }
@@ -240,18 +318,23 @@ static enum patch_error bps_apply_patch(
    for (i = 0; i < 32; i += 8)
       modify_target_checksum |= bps_read(&bps) << i;
 
-   checksum = ~bps.modify_checksum;
+   /* Everything up to the patch's own checksum */
+   checksum = encoding_crc32(0, bps.modify_data, bps.modify_offset);
    for (i = 0; i < 32; i += 8)
       modify_modify_checksum |= bps_read(&bps) << i;
 
-   bps.source_checksum = encoding_crc32(0,
+   if (bps.overrun)
+      return PATCH_PATCH_INVALID;
+
+   source_checksum = encoding_crc32(0,
          bps.source_data, bps.source_length);
-   bps.target_checksum = ~bps.target_checksum;
+   target_checksum = encoding_crc32(0,
+         bps.target_data, bps.output_offset);
 
-   if (bps.source_checksum != modify_source_checksum)
+   if (source_checksum != modify_source_checksum)
       return PATCH_SOURCE_CHECKSUM_INVALID;
 
-   if (bps.target_checksum != modify_target_checksum)
+   if (target_checksum != modify_target_checksum)
       return PATCH_TARGET_CHECKSUM_INVALID;
 
    if (checksum != modify_modify_checksum)
@@ -265,41 +348,95 @@ static enum patch_error bps_apply_patch(
 static uint8_t ups_patch_read(struct ups_data *data)
 {
    if (data && data->patch_offset < data->patch_length)
-   {
-      uint8_t n = data->patch_data[data->patch_offset++];
-      data->patch_checksum =
-         ~(encoding_crc32(~data->patch_checksum, &n, 1));
-      return n;
-   }
+      return data->patch_data[data->patch_offset++];
    return 0x00;
 }
 
 static uint8_t ups_source_read(struct ups_data *data)
 {
    if (data && data->source_offset < data->source_length)
-   {
-      uint8_t n = data->source_data[data->source_offset++];
-      data->source_checksum =
-         ~(encoding_crc32(~data->source_checksum, &n, 1));
-      return n;
-   }
+      return data->source_data[data->source_offset++];
    return 0x00;
 }
 
 static void ups_target_write(struct ups_data *data, uint8_t n)
 {
-
    if (data && data->target_offset < data->target_length)
-   {
       data->target_data[data->target_offset] = n;
-      data->target_checksum =
-         ~(encoding_crc32(~data->target_checksum, &n, 1));
-   }
 
    if (data)
       data->target_offset++;
 }
 
+/* Same as @length calls of ups_target_write(ups_source_read()):
+ * source bytes past its end read as zero, target bytes past its
+ * end are dropped. */
+static void ups_copy_source(struct ups_data *data, unsigned length)
+{
+   unsigned from_source = data->source_length - data->source_offset;
+   unsigned space       = 0;
+   unsigned copied;
+
+   if (data->target_offset < data->target_length)
+      space = data->target_length - data->target_offset;
+
+   if (from_source > length)
+      from_source = length;
+
+   copied = from_source < space ? from_source : space;
+   memcpy(data->target_data + data->target_offset,
+         data->source_data + data->source_offset, copied);
+
+   if (space > length)
+      space = length;
+   memset(data->target_data + data->target_offset + copied, 0,
+         space - copied);
+
+   data->source_offset += from_source;
+   data->target_offset += length;
+}
+
+/* Applies one run of XOR bytes, up to and including its zero byte. */
+static void ups_xor_run(struct ups_data *data)
+{
+   unsigned i;
+   unsigned length         = data->patch_length  - data->patch_offset;
+   const uint8_t *patch    = data->patch_data  + data->patch_offset;
+   const uint8_t *source   = data->source_data + data->source_offset;
+   uint8_t *target         = data->target_data + data->target_offset;
+   const uint8_t *end      = NULL;
+
+   /* Block-wise while patch, source and target are all in range */
+   if (data->source_length - data->source_offset < length)
+      length = data->source_length - data->source_offset;
+   if (data->target_offset > data->target_length)
+      length = 0;
+   else if (data->target_length - data->target_offset < length)
+      length = data->target_length - data->target_offset;
+
+   if (length && (end = (const uint8_t*)memchr(patch, 0, length)))
+      length = (unsigned)(end - patch) + 1;
+
+   for (i = 0; i < length; i++)
+      target[i] = patch[i] ^ source[i];
+
+   data->patch_offset  += length;
+   data->source_offset += length;
+   data->target_offset += length;
+
+   if (end)
+      return;
+
+   /* Byte by byte near the end of any of them */
+   for (;;)
+   {
+      uint8_t patch_xor = ups_patch_read(data);
+      ups_target_write(data, patch_xor ^ ups_source_read(data));
+      if (patch_xor == 0)
+         break;
+   }
+}
+
 static uint64_t ups_decode(struct ups_data *data)
 {
    uint64_t offset = 0, shift = 1;
@@ -310,6 +447,9 @@ static uint64_t ups_decode(struct ups_data *data)
 
       if (x & 0x80)
          break;
+      /* Reads past the end of the patch are zero */
+      if (data->patch_offset >= data->patch_length)
+         break;
       shift <<= 7;
       offset += shift;
    }
@@ -326,6 +466,8 @@ static enum patch_error ups_apply_patch(
    unsigned source_read_length;
    unsigned target_read_length;
    uint32_t patch_result_checksum;
+   uint32_t source_checksum;
+   uint32_t target_checksum;
    uint32_t patch_read_checksum  = 0;
    uint32_t source_read_checksum = 0;
    uint32_t target_read_checksum = 0;
@@ -339,9 +481,6 @@ static enum patch_error ups_apply_patch(
    data.patch_offset    = 0;
    data.source_offset   = 0;
    data.target_offset   = 0;
-   data.patch_checksum  = ~0;
-   data.source_checksum = ~0;
-   data.target_checksum = ~0;
 
    if (data.patch_length < 18)
       return PATCH_PATCH_INVALID;
@@ -375,34 +514,31 @@ static enum patch_error ups_apply_patch(
    }
 
    data.target_length = (unsigned)*targetlength;
-   
+
    while (data.patch_offset < data.patch_length - 12)
    {
-      unsigned length = (unsigned)ups_decode(&data);
-      while (length--)
-         ups_target_write(&data, ups_source_read(&data));
-      while (true)
-      {
-         uint8_t patch_xor = ups_patch_read(&data);
-         ups_target_write(&data, patch_xor ^ ups_source_read(&data));
-         if (patch_xor == 0)
-            break;
-      }
+      ups_copy_source(&data, (unsigned)ups_decode(&data));
+      ups_xor_run(&data);
    }
 
-   while (data.source_offset < data.source_length)
-      ups_target_write(&data, ups_source_read(&data));
-   while (data.target_offset < data.target_length)
-      ups_target_write(&data, ups_source_read(&data));
+   if (data.source_offset < data.source_length)
+      ups_copy_source(&data, data.source_length - data.source_offset);
+   if (data.target_offset < data.target_length)
+      ups_copy_source(&data, data.target_length - data.target_offset);
 
    for (i = 0; i < 4; i++)
       source_read_checksum |= ups_patch_read(&data) << (i * 8);
    for (i = 0; i < 4; i++)
       target_read_checksum |= ups_patch_read(&data) << (i * 8);
 
-   patch_result_checksum = ~data.patch_checksum;
-   data.source_checksum  = ~data.source_checksum;
-   data.target_checksum  = ~data.target_checksum;
+   /* Everything up to the patch's own checksum, every source byte
+    * that was read and every target byte that was written */
+   patch_result_checksum = encoding_crc32(0,
+         data.patch_data, data.patch_offset);
+   source_checksum       = encoding_crc32(0,
+         data.source_data, data.source_offset);
+   target_checksum       = encoding_crc32(0, data.target_data,
+         MIN(data.target_offset, data.target_length));
 
    for (i = 0; i < 4; i++)
       patch_read_checksum |= ups_patch_read(&data) << (i * 8);
@@ -410,18 +546,18 @@ static enum patch_error ups_apply_patch(
    if (patch_result_checksum != patch_read_checksum)
       return PATCH_PATCH_INVALID;
 
-   if (data.source_checksum == source_read_checksum
+   if (source_checksum == source_read_checksum
          && data.source_length == source_read_length)
    {
-      if (data.target_checksum == target_read_checksum
+      if (target_checksum == target_read_checksum
             && data.target_length == target_read_length)
          return PATCH_SUCCESS;
       return PATCH_TARGET_INVALID;
    }
-   else if (data.source_checksum == target_read_checksum
+   else if (source_checksum == target_read_checksum
          && data.source_length == target_read_length)
    {
-      if (data.target_checksum == source_read_checksum
+      if (target_checksum == source_read_checksum
             && data.target_length == source_read_length)
          return PATCH_SUCCESS;
       return PATCH_TARGET_INVALID;
@@ -488,11 +624,8 @@ static enum patch_error ips_alloc_targetdata(
          if (offset > patchlen - length)
             break;
 
-         while (length--)
-         {
-            address++;
-            offset++;
-         }
+         address += length;
+         offset  += length;
       }
       else /* RLE */
       {
@@ -505,9 +638,7 @@ static enum patch_error ips_alloc_targetdata(
          if (length == 0) /* Illegal */
             break;
 
-         while (length--)
-            address++;
-
+         address += length;
          offset++;
       }
 
@@ -539,7 +670,12 @@ static enum patch_error ips_apply_patch(
    if ( error_patch != PATCH_SUCCESS)
       return error_patch;
 
-   memcpy(*targetdata, sourcedata, (size_t)sourcelength);
+   /* A truncating patch makes the target smaller than the source */
+   memcpy(*targetdata, sourcedata,
+         (size_t)MIN(sourcelength, *targetlength));
+   if (*targetlength > sourcelength)
+      memset(*targetdata + sourcelength, 0,
+            (size_t)(*targetlength - sourcelength));
 
    for (;;)
    {
@@ -558,12 +694,7 @@ static enum patch_error ips_apply_patch(
          if (offset == patchlen)
             return PATCH_SUCCESS;
          else if (offset == patchlen - 3)
-         {
-            uint32_t size = patchdata[offset++] << 16;
-            size |= patchdata[offset++] << 8;
-            size |= patchdata[offset++] << 0;
             return PATCH_SUCCESS;
-         }
       }
 
       if (offset > patchlen - 2)
@@ -577,8 +708,10 @@ static enum patch_error ips_apply_patch(
          if (offset > patchlen - length)
             break;
 
-         while (length--)
-            (*targetdata)[address++] = patchdata[offset++];
+         if (address < *targetlength)
+            memcpy(*targetdata + address, patchdata + offset,
+                  (size_t)MIN(length, *targetlength - address));
+         offset += length;
       }
       else /* RLE */
       {
@@ -591,9 +724,9 @@ static enum patch_error ips_apply_patch(
          if (length == 0) /* Illegal */
             break;
 
-         while (length--)
-            (*targetdata)[address++] = patchdata[offset];
-
+         if (address < *targetlength)
+            memset(*targetdata + address, patchdata[offset],
+                  (size_t)MIN(length, *targetlength - address));
          offset++;
       }
    }
@@ -601,116 +734,323 @@ static enum patch_error ips_apply_patch(
    return PATCH_PATCH_INVALID;
 }
 
+static bool patch_cache_stat(const char *path,
+      uint64_t *size, uint64_t *mtime)
+{
+#if defined(_WIN32) && !defined(_XBOX)
+   struct _stat buf;
+#if defined(LEGACY_WIN32)
+   if (_stat(path, &buf) != 0)
+      return false;
+#else
+   int ret;
+   wchar_t *path_wide = utf8_to_utf16_string_alloc(path);
+
+   if (!path_wide)
+      return false;
+   ret = _wstat(path_wide, &buf);
+   free(path_wide);
+   if (ret != 0)
+      return false;
+#endif
+   *size  = (uint64_t)buf.st_size;
+   *mtime = (uint64_t)buf.st_mtime;
+   return true;
+#elif defined(VITA) || defined(PSP) || defined(PS2) || defined(ORBIS) || defined(__CELLOS_LV2__) || defined(_XBOX)
+   /* No modification times, so nothing to key the cache on */
+   return false;
+#else
+   struct stat buf;
+
+   if (stat(path, &buf) != 0)
+      return false;
+   *size  = (uint64_t)buf.st_size;
+   *mtime = (uint64_t)buf.st_mtime;
+   return true;
+#endif
+}
+
+/* Name of the cache entry for a patch applied to a content file: a hash
+ * of the patch format and of the path, size and modification time of
+ * both files. Neither file has to be read to find a cached result.
+ * Returns false if the files can't be identified that way. */
+static bool patch_cache_entry_path(const patch_cache_t *cache,
+      const char *patch_desc, const char *patch_path,
+      char *path, size_t len)
+{
+   unsigned i;
+   MD5_CTX md5;
+   uint64_t content_size, content_mtime, patch_size, patch_mtime;
+   char key[2 * PATH_MAX_LENGTH + 128];
+   uint8_t digest[16];
+   char name[64];
+
+   if (     string_is_empty(cache->content_path)
+         || !patch_cache_stat(cache->content_path,
+            &content_size, &content_mtime)
+         || !patch_cache_stat(patch_path, &patch_size, &patch_mtime))
+      return false;
+
+   snprintf(key, sizeof(key), "%s\n%s\n%.0f\n%.0f\n%s\n%.0f\n%.0f",
+         patch_desc,
+         cache->content_path, (double)content_size, (double)content_mtime,
+         patch_path, (double)patch_size, (double)patch_mtime);
+
+   MD5_Init(&md5);
+   MD5_Update(&md5, key, strlen(key));
+   MD5_Final(digest, &md5);
+
+   for (i = 0; i < 16; i++)
+      snprintf(name + i * 2, 3, "%02x", digest[i]);
+   strlcat(name, ".patched", sizeof(name));
+
+   fill_pathname_join(path, cache->dir, name, len);
+   return true;
+}
+
+static bool patch_cache_read_header(RFILE *file,
+      struct patch_cache_header *header)
+{
+   return filestream_read(file, header, sizeof(*header))
+         == sizeof(*header)
+      && header->magic   == PATCH_CACHE_MAGIC
+      && header->version == PATCH_CACHE_VERSION;
+}
+
+/* Reads a cached patched content and marks it as used. */
+static bool patch_cache_load(const char *path,
+      uint8_t **buf, uint64_t *size)
+{
+   struct patch_cache_header header;
+   uint8_t *data = NULL;
+   RFILE *file   = filestream_open(path,
+         RETRO_VFS_FILE_ACCESS_READ_WRITE | RETRO_VFS_FILE_ACCESS_UPDATE_EXISTING,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!file)
+      return false;
+
+   if (!patch_cache_read_header(file, &header)
+         || header.size > (uint64_t)filestream_get_size(file)
+         || !(data = (uint8_t*)malloc((size_t)MAX(header.size, 1)))
+         || filestream_read(file, data, header.size) != (int64_t)header.size
+         || encoding_crc32(0, data, (size_t)header.size) != header.crc)
+   {
+      filestream_close(file);
+      free(data);
+      return false;
+   }
+
+   header.last_used = (uint64_t)time(NULL);
+   filestream_seek(file, 0, RETRO_VFS_SEEK_POSITION_START);
+   filestream_write(file, &header, sizeof(header));
+   filestream_close(file);
+
+   *buf  = data;
+   *size = header.size;
+   return true;
+}
+
+/* Drops the least recently used entries until the cache, including
+ * the entry at @keep, fits in cache->max_size. */
+static void patch_cache_evict(const patch_cache_t *cache, const char *keep)
+{
+   size_t i;
+   uint64_t total           = 0;
+   uint64_t *last_used      = NULL;
+   uint64_t *sizes          = NULL;
+   struct string_list *list = dir_list_new(cache->dir, "patched",
+         false, false, false, false);
+
+   if (!list)
+      return;
+
+   last_used = (uint64_t*)calloc(list->size + 1, sizeof(*last_used));
+   sizes     = (uint64_t*)calloc(list->size + 1, sizeof(*sizes));
+
+   if (!last_used || !sizes)
+      goto end;
+
+   for (i = 0; i < list->size; i++)
+   {
+      struct patch_cache_header header;
+      RFILE *file = filestream_open(list->elems[i].data,
+            RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+      if (!file)
+         continue;
+
+      sizes[i] = (uint64_t)filestream_get_size(file);
+      if (patch_cache_read_header(file, &header))
+         last_used[i] = header.last_used;
+      filestream_close(file);
+
+      /* The entry just written goes last */
+      if (string_is_equal(list->elems[i].data, keep))
+         last_used[i] = (uint64_t)-1;
+
+      total += sizes[i];
+   }
+
+   while (total > cache->max_size)
+   {
+      size_t oldest = 0;
+
+      for (i = 1; i < list->size; i++)
+         if (sizes[i] && (!sizes[oldest]
+                  || last_used[i] < last_used[oldest]))
+            oldest = i;
+
+      if (!sizes[oldest] || last_used[oldest] == (uint64_t)-1)
+         break;
+
+      filestream_delete(list->elems[oldest].data);
+      total        -= sizes[oldest];
+      sizes[oldest] = 0;
+   }
+
+end:
+   free(last_used);
+   free(sizes);
+   string_list_free(list);
+}
+
+/* Writes a patched content to the cache, replacing the entry at once
+ * so a crash never leaves a partial one behind. */
+static void patch_cache_store(const patch_cache_t *cache, const char *path,
+      const uint8_t *buf, uint64_t size)
+{
+   struct patch_cache_header header;
+   char tmp_path[PATH_MAX_LENGTH];
+   RFILE *file = NULL;
+   bool ret    = false;
+
+   if (size + sizeof(header) > cache->max_size)
+      return;
+
+   if (!path_is_directory(cache->dir) && !path_mkdir(cache->dir))
+      return;
+
+   header.magic     = PATCH_CACHE_MAGIC;
+   header.version   = PATCH_CACHE_VERSION;
+   header.last_used = (uint64_t)time(NULL);
+   header.size      = size;
+   header.crc       = encoding_crc32(0, buf, (size_t)size);
+   header.padding   = 0;
+
+   strlcpy(tmp_path, path, sizeof(tmp_path));
+   strlcat(tmp_path, ".tmp", sizeof(tmp_path));
+
+   file = filestream_open(tmp_path, RETRO_VFS_FILE_ACCESS_WRITE,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+   if (!file)
+      return;
+
+   ret = filestream_write(file, &header, sizeof(header)) == sizeof(header)
+      && filestream_write(file, buf, size) == (int64_t)size;
+   ret = filestream_close(file) == 0 && ret;
+
+   if (!ret || filestream_rename(tmp_path, path) != 0)
+   {
+      filestream_delete(tmp_path);
+      return;
+   }
+
+   patch_cache_evict(cache, path);
+}
+
 static bool apply_patch_content(uint8_t **buf,
       ssize_t *size, const char *patch_desc, const char *patch_path,
-      patch_func_t func, void *patch_data, int64_t patch_size)
+      patch_func_t func, const patch_cache_t *cache)
 {
+   char cache_path[PATH_MAX_LENGTH];
    enum patch_error err     = PATCH_UNKNOWN;
    ssize_t ret_size         = *size;
    uint8_t *ret_buf         = *buf;
    uint64_t target_size     = 0;
    uint8_t *patched_content = NULL;
+   void *patch_data         = NULL;
+   int64_t patch_size       = 0;
 
    RARCH_LOG("Found %s file in \"%s\", attempting to patch ...\n",
          patch_desc, patch_path);
 
+   cache_path[0] = '\0';
+
+   if (cache && patch_cache_entry_path(cache, patch_desc, patch_path,
+            cache_path, sizeof(cache_path))
+         && patch_cache_load(cache_path, &patched_content, &target_size))
+   {
+      RARCH_LOG("[Patch]: Using cached %s result: %s.\n",
+            patch_desc, cache_path);
+      *buf  = patched_content;
+      *size = target_size;
+      return true;
+   }
+
+   if (!filestream_read_file(patch_path, &patch_data, &patch_size))
+      return false;
+
+   if (patch_size < 0)
+   {
+      free(patch_data);
+      return false;
+   }
+
    err = func((const uint8_t*)patch_data, patch_size, ret_buf,
          ret_size, &patched_content, &target_size);
+   free(patch_data);
 
+   /* The source buffer is left to the caller, it may be memory-mapped */
    if (err == PATCH_SUCCESS)
    {
-      free(ret_buf);
       *buf  = patched_content;
       *size = target_size;
+
+      if (!string_is_empty(cache_path))
+         patch_cache_store(cache, cache_path, patched_content, target_size);
    }
    else
+   {
       RARCH_ERR("%s %s: %s #%u\n",
             msg_hash_to_str(MSG_FAILED_TO_PATCH),
             patch_desc,
             msg_hash_to_str(MSG_ERROR),
             (unsigned)err);
+      free(patched_content);
+   }
 
    return true;
 }
 
 static bool try_bps_patch(bool allow_bps, const char *name_bps,
-      uint8_t **buf, ssize_t *size)
+      uint8_t **buf, ssize_t *size, const patch_cache_t *cache)
 {
    if (allow_bps && !string_is_empty(name_bps))
       if (path_is_valid(name_bps))
-      {
-         int64_t patch_size;
-         bool ret                 = false;
-         void *patch_data         = NULL;
-
-         if (!filestream_read_file(name_bps, &patch_data, &patch_size))
-            return false;
-
-         if (patch_size >= 0)
-         {
-            ret                      = apply_patch_content(
-                  buf, size, "BPS", name_bps,
-                  bps_apply_patch, patch_data, patch_size);
-         }
-
-         if (patch_data)
-            free(patch_data);
-         return ret;
-      }
+         return apply_patch_content(buf, size, "BPS", name_bps,
+               bps_apply_patch, cache);
    return false;
 }
 
 static bool try_ups_patch(bool allow_ups, const char *name_ups,
-      uint8_t **buf, ssize_t *size)
+      uint8_t **buf, ssize_t *size, const patch_cache_t *cache)
 {
    if (allow_ups && !string_is_empty(name_ups))
       if (path_is_valid(name_ups))
-      {
-         int64_t patch_size;
-         bool ret                 = false;
-         void *patch_data         = NULL;
-
-         if (!filestream_read_file(name_ups, &patch_data, &patch_size))
-            return false;
-
-         if (patch_size >= 0)
-         {
-            ret                      = apply_patch_content(
-                  buf, size, "UPS", name_ups,
-                  ups_apply_patch, patch_data, patch_size);
-         }
-
-         if (patch_data)
-            free(patch_data);
-         return ret;
-      }
+         return apply_patch_content(buf, size, "UPS", name_ups,
+               ups_apply_patch, cache);
    return false;
 }
 
 static bool try_ips_patch(bool allow_ips,
-      const char *name_ips, uint8_t **buf, ssize_t *size)
+      const char *name_ips, uint8_t **buf, ssize_t *size,
+      const patch_cache_t *cache)
 {
    if (allow_ips && !string_is_empty(name_ips))
       if (path_is_valid(name_ips))
-      {
-         int64_t patch_size;
-         bool ret                 = false;
-         void *patch_data         = NULL;
-
-         if (!filestream_read_file(name_ips, &patch_data, &patch_size))
-            return false;
-
-         if (patch_size >= 0)
-         {
-            ret                      = apply_patch_content(
-                  buf, size, "IPS", name_ips,
-                  ips_apply_patch, patch_data, patch_size);
-         }
-
-         if (patch_data)
-            free(patch_data);
-         return ret;
-      }
+         return apply_patch_content(buf, size, "IPS", name_ips,
+               ips_apply_patch, cache);
    return false;
 }
 
@@ -718,8 +1058,11 @@ static bool try_ips_patch(bool allow_ips,
  * patch_content:
  * @buf          : buffer of the content file.
  * @size         : size   of the content file.
+ * @cache        : where to look up and store patched content,
+ *                 NULL to always apply the patch.
  *
- * Apply patch to the content file in-memory.
+ * Apply patch to the content file in-memory. On success *buf points to
+ * a newly allocated buffer; the original one is not freed.
  *
  **/
 static bool patch_content(
@@ -729,6 +1072,7 @@ static bool patch_content(
       const char *name_ips,
       const char *name_bps,
       const char *name_ups,
+      const patch_cache_t *cache,
       uint8_t **buf,
       void *data)
 {
@@ -746,9 +1090,9 @@ static bool patch_content(
       return false;
    }
 
-   if (     !try_ips_patch(allow_ips, name_ips, buf, size)
-         && !try_bps_patch(allow_bps, name_bps, buf, size)
-         && !try_ups_patch(allow_ups, name_ups, buf, size))
+   if (     !try_ips_patch(allow_ips, name_ips, buf, size, cache)
+         && !try_bps_patch(allow_bps, name_bps, buf, size, cache)
+         && !try_ups_patch(allow_ups, name_ups, buf, size, cache))
    {
       RARCH_LOG("%s\n",
             msg_hash_to_str(MSG_DID_NOT_FIND_A_VALID_CONTENT_PATCH));
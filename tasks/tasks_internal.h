@@ -23,6 +23,7 @@
 #include <retro_miscellaneous.h>
 
 #include <queues/task_queue.h>
+#include <lists/dir_list.h>
 
 #ifdef HAVE_CONFIG_H
 #include "../config.h"
@@ -82,6 +83,11 @@ bool task_push_pl_entry_thumbnail_download(
 
 bool task_push_pl_manager_reset_cores(const char *playlist_path);
 
+void *task_push_dir_list(dir_list_stream_t *stream,
+      retro_task_callback_t cb, void *user_data);
+
+struct string_list *task_dir_list_take(void *task);
+
 bool task_push_image_load(const char *fullpath,
       bool supports_rgba, unsigned upscale_threshold,
       retro_task_callback_t cb, void *userdata);